@@ -0,0 +1,150 @@
+#!/bin/sh
+###
+###     JM encoder/decoder benchmark
+###
+###     Generates a fixed set of synthetic streams with lencod (from a
+###     deterministic yuvgen source) and times ldecod on each of them in
+###     full-decode (FullDecode = 1) and extraction-only (FullDecode = 0)
+###     mode. Streams are cached in $BENCH_WORK/streams and only
+###     regenerated if missing, so consecutive runs decode identical input.
+###
+###     Environment:
+###       BENCH_SIZES    resolutions                    (default "176x144 352x288")
+###       BENCH_FRAMES   frames per stream              (default 30)
+###       BENCH_ENTROPY  entropy coders: cavlc cabac    (default "cavlc cabac")
+###       BENCH_GOPS     GOP structures: i ippp ibbp    (default "i ippp ibbp")
+###       BENCH_SLICES   slices per picture             (default "1 8")
+###       BENCH_REPEAT   decoder runs per measurement   (default 3, fastest run is reported)
+###       BENCH_WORK     work directory                 (default $TMPDIR/jm-bench, /tmp/jm-bench)
+###       BENCH_CSV      result file                    (default $BENCH_WORK/results.csv)
+###
+###     Reported per stream and mode: frames/s, MB/s, MVD key records/s,
+###     peak RSS and, for full decoding, whether the output matches the
+###     encoder reconstruction. Note that the figures include the trace
+###     file output if TRACE is enabled in ldecod/inc/defines.h.
+###
+
+set -e
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+BIN=$(cd "$BENCH_DIR/../bin" && pwd)
+
+BENCH_SIZES=${BENCH_SIZES:-"176x144 352x288"}
+BENCH_FRAMES=${BENCH_FRAMES:-30}
+BENCH_ENTROPY=${BENCH_ENTROPY:-"cavlc cabac"}
+BENCH_GOPS=${BENCH_GOPS:-"i ippp ibbp"}
+BENCH_SLICES=${BENCH_SLICES:-"1 8"}
+BENCH_REPEAT=${BENCH_REPEAT:-3}
+BENCH_WORK=${BENCH_WORK:-"${TMPDIR:-/tmp}/jm-bench"}
+BENCH_CSV=${BENCH_CSV:-"$BENCH_WORK/results.csv"}
+
+for tool in lencod.exe ldecod.exe yuvgen.exe runstat.exe; do
+  if [ ! -x "$BIN/$tool" ]; then
+    echo "bench: $BIN/$tool not found, build it first (make bench from the top directory)" >&2
+    exit 1
+  fi
+done
+
+# ldecod/lencod write some files relative to the working directory (../vediofile/...)
+mkdir -p "$BENCH_WORK/streams" "$BENCH_WORK/run" "$BENCH_WORK/vediofile/decoder" "$BENCH_WORK/vediofile/encoder/output"
+RUN="$BENCH_WORK/run"
+KEYFILE="$BENCH_WORK/vediofile/decoder/encrypt.ec"
+
+entropy_args() {
+  case $1 in
+    cavlc) echo "-p SymbolMode=0" ;;
+    cabac) echo "-p SymbolMode=1" ;;
+    *) echo "bench: unknown entropy coder $1" >&2; exit 1 ;;
+  esac
+}
+
+gop_args() {
+  case $1 in
+    i)    echo "-p IntraPeriod=1 -p IDRPeriod=1 -p NumberBFrames=0" ;;
+    ippp) echo "-p IntraPeriod=0 -p IDRPeriod=0 -p NumberBFrames=0" ;;
+    ibbp) echo "-p IntraPeriod=0 -p IDRPeriod=0 -p NumberBFrames=2 -p HierarchicalCoding=0" ;;
+    *) echo "bench: unknown GOP structure $1" >&2; exit 1 ;;
+  esac
+}
+
+# generate (or reuse) one stream; sets STREAM and RECON
+make_stream() {
+  size=$1; entropy=$2; gop=$3; slices=$4
+  w=${size%x*}; h=${size#*x}
+  mbs=$(( (w / 16) * (h / 16) ))
+  name="${size}_${entropy}_${gop}_s${slices}_f${BENCH_FRAMES}"
+  SOURCE="$BENCH_WORK/streams/src_${size}_f${BENCH_FRAMES}.yuv"
+  STREAM="$BENCH_WORK/streams/$name.264"
+  RECON="$BENCH_WORK/streams/$name.rec.yuv"
+
+  if [ ! -f "$SOURCE" ]; then
+    "$BIN/yuvgen.exe" "$w" "$h" "$BENCH_FRAMES" "$SOURCE"
+  fi
+
+  if [ "$slices" -gt 1 ]; then
+    slice_args="-p SliceMode=1 -p SliceArgument=$(( (mbs + slices - 1) / slices ))"
+  else
+    slice_args="-p SliceMode=0"
+  fi
+
+  if [ ! -f "$STREAM" ] || [ ! -f "$RECON" ]; then
+    echo "bench: encoding $name"
+    ( cd "$RUN" && "$BIN/lencod.exe" -d "$BIN/encoder.cfg" \
+        -p InputFile="$SOURCE" -p SourceWidth="$w" -p SourceHeight="$h" \
+        -p OutputWidth="$w" -p OutputHeight="$h" -p FramesToBeEncoded="$BENCH_FRAMES" \
+        -p OutputFile="$STREAM" -p ReconFile="$RECON" \
+        -p TraceFile="$RUN/trace_enc.txt" -p StatsFile="$RUN/stats.dat" \
+        -p ExtractionOn=0 $(entropy_args "$entropy") $(gop_args "$gop") $slice_args \
+        > "$RUN/enc_$name.log" 2>&1 ) || { echo "bench: encoding $name failed, see $RUN/enc_$name.log" >&2; exit 1; }
+  fi
+}
+
+# decode STREAM BENCH_REPEAT times in the given mode; sets SECONDS_BEST, RSS, RECORDS, DECODED
+run_decoder() {
+  full=$1
+  SECONDS_BEST=""
+  i=0
+  while [ $i -lt "$BENCH_REPEAT" ]; do
+    rm -f "$RUN/dec.yuv" "$KEYFILE"
+    ( cd "$RUN" && "$BIN/runstat.exe" "$RUN/stat.txt" "$BIN/ldecod.exe" -d "$BIN/decoder.cfg" \
+        -p InputFile="$STREAM" -p OutputFile="$RUN/dec.yuv" -p RefFile='""' \
+        -p ExtractionLogFile="$RUN/extraction.log" -p FullDecode="$full" \
+        > "$RUN/dec.log" 2>&1 ) || { echo "bench: decoding $STREAM failed, see $RUN/dec.log" >&2; exit 1; }
+    read -r secs rss status < "$RUN/stat.txt"
+    if [ -z "$SECONDS_BEST" ] || [ "$(echo "$secs < $SECONDS_BEST" | awk '{print ($1 < $3)}')" = 1 ]; then
+      SECONDS_BEST=$secs
+      RSS=$rss
+    fi
+    i=$((i + 1))
+  done
+  RECORDS=$(wc -l < "$KEYFILE" 2>/dev/null || echo 0)
+  DECODED=$(sed -n 's/^\([0-9]*\) frames are decoded.*/\1/p' "$RUN/dec.log")
+}
+
+echo "config,width,height,frames,mode,seconds,fps,mb_per_s,key_records,key_records_per_s,peak_rss_kb,recon_match" > "$BENCH_CSV"
+printf "%-32s %-10s %9s %11s %12s %10s %6s\n" "stream" "mode" "frames/s" "MB/s" "records/s" "RSS(kB)" "match"
+
+for size in $BENCH_SIZES; do
+  for entropy in $BENCH_ENTROPY; do
+    for gop in $BENCH_GOPS; do
+      for slices in $BENCH_SLICES; do
+        make_stream "$size" "$entropy" "$gop" "$slices"
+        w=${size%x*}; h=${size#*x}
+        mbs=$(( (w / 16) * (h / 16) ))
+        for mode in full extract; do
+          if [ $mode = full ]; then run_decoder 1; else run_decoder 0; fi
+          match="-"
+          if [ $mode = full ]; then
+            if cmp -s "$RUN/dec.yuv" "$RECON"; then match=yes; else match=no; fi
+          fi
+          line=$(echo "$DECODED $mbs $RECORDS $SECONDS_BEST" | awk '{ s = ($4 > 0) ? $4 : 1e-9; printf "%.3f %.1f %.1f", $1 / s, $1 * $2 / s, $3 / s }')
+          set -- $line
+          printf "%-32s %-10s %9s %11s %12s %10s %6s\n" "$entropy/$gop/s$slices@$size" "$mode" "$1" "$2" "$3" "$RSS" "$match"
+          echo "${entropy}_${gop}_s${slices},$w,$h,$DECODED,$mode,$SECONDS_BEST,$1,$2,$RECORDS,$3,$RSS,$match" >> "$BENCH_CSV"
+        done
+      done
+    done
+  done
+done
+
+echo "bench: results written to $BENCH_CSV"
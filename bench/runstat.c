@@ -0,0 +1,77 @@
+/*!
+ ***************************************************************************
+ * \file
+ *    runstat.c
+ *
+ * \brief
+ *    Runs a command and records its wall clock time and peak resident
+ *    set size for the JM benchmark harness (UNIX only).
+ *
+ *    usage: runstat <statfile> <command> [arguments...]
+ *
+ *    The command's stdout/stderr are passed through unchanged; the
+ *    statfile receives one line "<seconds> <peak_rss_kb> <exit_status>".
+ ***************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+int main(int argc, char **argv)
+{
+  struct timespec start, end;
+  struct rusage usage;
+  int status = 0;
+  long max_rss;
+  pid_t pid;
+  FILE *f;
+
+  if (argc < 3)
+  {
+    fprintf(stderr, "usage: %s <statfile> <command> [arguments...]\n", argv[0]);
+    return 1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if ((pid = fork()) < 0)
+  {
+    perror("runstat: fork");
+    return 1;
+  }
+  if (pid == 0)
+  {
+    execvp(argv[2], &argv[2]);
+    perror("runstat: exec");
+    _exit(127);
+  }
+  if (wait4(pid, &status, 0, &usage) < 0)
+  {
+    perror("runstat: wait4");
+    return 1;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  // ru_maxrss is reported in kilobytes on Linux and in bytes on Mac OS X
+#if defined(__APPLE__)
+  max_rss = usage.ru_maxrss / 1024;
+#else
+  max_rss = usage.ru_maxrss;
+#endif
+
+  if ((f = fopen(argv[1], "w")) == NULL)
+  {
+    fprintf(stderr, "runstat: cannot open %s\n", argv[1]);
+    return 1;
+  }
+  fprintf(f, "%.6f %ld %d\n", (double) (end.tv_sec - start.tv_sec) + (double) (end.tv_nsec - start.tv_nsec) * 1e-9,
+    max_rss, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+  fclose(f);
+
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
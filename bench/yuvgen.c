@@ -0,0 +1,165 @@
+/*!
+ ***************************************************************************
+ * \file
+ *    yuvgen.c
+ *
+ * \brief
+ *    Synthetic YUV 4:2:0 (8 bit) sequence generator for the JM benchmark.
+ *
+ *    The content is fully deterministic (fixed seed) so the benchmark
+ *    streams can be regenerated bit-exactly on any machine:
+ *    a slowly panning textured background, a set of textured objects
+ *    moving with different velocities (exercising motion estimation
+ *    and compensation) and a small amount of pseudo random noise
+ *    (keeping the residual and entropy coding busy).
+ *
+ *    usage: yuvgen <width> <height> <frames> <output.yuv>
+ ***************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_OBJECTS  6
+
+typedef struct
+{
+  int x, y;          //!< position of the top left corner (in 1/4 pel)
+  int w, h;          //!< size
+  int dx, dy;        //!< velocity (in 1/4 pel per frame)
+  int luma;          //!< base luma level
+  int cb, cr;        //!< chroma levels
+} Object;
+
+static unsigned int rnd_state = 0x1234567;
+
+static unsigned int rnd(void)
+{
+  rnd_state = rnd_state * 1103515245u + 12345u;
+  return (rnd_state >> 16) & 0x7fff;
+}
+
+static unsigned char clip255(int v)
+{
+  return (unsigned char) (v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+static int texture(int x, int y)
+{
+  // sum of a few periodic patterns; gives edges in all directions
+  return ((x * 3 + y) & 31) + (((x >> 3) ^ (y >> 3)) & 1) * 24 + ((x * y) >> 5 & 15);
+}
+
+int main(int argc, char **argv)
+{
+  int width, height, frames, frame;
+  int i, j, k;
+  unsigned char *y_buf, *u_buf, *v_buf;
+  Object obj[NUM_OBJECTS];
+  FILE *f;
+
+  if (argc != 5)
+  {
+    fprintf(stderr, "usage: %s <width> <height> <frames> <output.yuv>\n", argv[0]);
+    return 1;
+  }
+
+  width  = atoi(argv[1]);
+  height = atoi(argv[2]);
+  frames = atoi(argv[3]);
+  if (width <= 0 || height <= 0 || (width & 1) || (height & 1) || frames <= 0)
+  {
+    fprintf(stderr, "yuvgen: invalid size %dx%d or frame count %d\n", width, height, frames);
+    return 1;
+  }
+
+  if ((f = fopen(argv[4], "wb")) == NULL)
+  {
+    fprintf(stderr, "yuvgen: cannot open %s\n", argv[4]);
+    return 1;
+  }
+
+  y_buf = (unsigned char *) malloc(width * height);
+  u_buf = (unsigned char *) malloc(width * height / 4);
+  v_buf = (unsigned char *) malloc(width * height / 4);
+  if (!y_buf || !u_buf || !v_buf)
+  {
+    fprintf(stderr, "yuvgen: out of memory\n");
+    return 1;
+  }
+
+  for (k = 0; k < NUM_OBJECTS; k++)
+  {
+    obj[k].w    = width  / 8 + (int) (rnd() % (width  / 6 + 1));
+    obj[k].h    = height / 8 + (int) (rnd() % (height / 6 + 1));
+    obj[k].x    = (int) (rnd() % width)  << 2;
+    obj[k].y    = (int) (rnd() % height) << 2;
+    obj[k].dx   = (int) (rnd() % 25) - 12;
+    obj[k].dy   = (int) (rnd() % 17) - 8;
+    obj[k].luma = 40 + (int) (rnd() % 160);
+    obj[k].cb   = 64 + (int) (rnd() % 128);
+    obj[k].cr   = 64 + (int) (rnd() % 128);
+  }
+
+  for (frame = 0; frame < frames; frame++)
+  {
+    int pan_x = frame * 2;
+    int pan_y = frame;
+
+    // background
+    for (j = 0; j < height; j++)
+      for (i = 0; i < width; i++)
+        y_buf[j * width + i] = clip255(64 + (i + j) * 96 / (width + height) + texture(i + pan_x, j + pan_y));
+
+    for (j = 0; j < height / 2; j++)
+      for (i = 0; i < width / 2; i++)
+      {
+        u_buf[j * width / 2 + i] = clip255(128 + ((i + pan_x / 2) & 63) / 4 - 8);
+        v_buf[j * width / 2 + i] = clip255(128 + ((j + pan_y / 2) & 63) / 4 - 8);
+      }
+
+    // moving objects (wrapping around the picture borders)
+    for (k = 0; k < NUM_OBJECTS; k++)
+    {
+      int ox = obj[k].x >> 2;
+      int oy = obj[k].y >> 2;
+
+      for (j = 0; j < obj[k].h; j++)
+      {
+        int py = (oy + j) % height;
+        for (i = 0; i < obj[k].w; i++)
+        {
+          int px = (ox + i) % width;
+          y_buf[py * width + px] = clip255(obj[k].luma + texture(i * 2, j) / 2);
+          if (!(px & 1) && !(py & 1))
+          {
+            u_buf[(py >> 1) * width / 2 + (px >> 1)] = (unsigned char) obj[k].cb;
+            v_buf[(py >> 1) * width / 2 + (px >> 1)] = (unsigned char) obj[k].cr;
+          }
+        }
+      }
+
+      obj[k].x = (obj[k].x + obj[k].dx + (width  << 2)) % (width  << 2);
+      obj[k].y = (obj[k].y + obj[k].dy + (height << 2)) % (height << 2);
+    }
+
+    // noise
+    for (i = 0; i < width * height; i++)
+      y_buf[i] = clip255(y_buf[i] + (int) (rnd() % 5) - 2);
+
+    if (fwrite(y_buf, 1, width * height, f) != (size_t) (width * height)
+      || fwrite(u_buf, 1, width * height / 4, f) != (size_t) (width * height / 4)
+      || fwrite(v_buf, 1, width * height / 4, f) != (size_t) (width * height / 4))
+    {
+      fprintf(stderr, "yuvgen: error writing %s\n", argv[4]);
+      return 1;
+    }
+  }
+
+  fclose(f);
+  free(y_buf);
+  free(u_buf);
+  free(v_buf);
+  return 0;
+}
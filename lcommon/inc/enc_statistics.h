@@ -53,6 +53,11 @@ struct stat_parameters
   int64  bit_ctr_filler_data;
   int64  bit_ctr_filler_data_n;
 
+  // fast high complexity mode decision (FastMDHigh)
+  int64  md_tested;                   //!< RD evaluated candidates
+  int64  md_pruned;                   //!< candidates pruned without RD evaluation
+  int64  md_sub8x8_pruned;            //!< 8x8 blocks without sub-8x8 partition search
+
 #if (MVC_EXTENSION_ENABLE)
   float  bitrate_v[2];                       //!< average bit rate for the sequence except first frame
   int64  bit_ctr_v[2];                     //!< counter for bit usage
@@ -0,0 +1,35 @@
+
+/*!
+ ************************************************************************
+ * \file frm_rng.h
+ *
+ * \brief
+ *    Frame range sets (ExtractFrmRng): the frames, in coding order, in
+ *    which the motion vector differences are scrambled
+ *
+ ************************************************************************
+ */
+
+#ifndef _FRM_RNG_H_
+#define _FRM_RNG_H_
+
+//! closed interval of frame numbers
+typedef struct frame_range
+{
+  int first;
+  int last;
+} FrameRange;
+
+//! sorted, disjoint and non-adjacent intervals; an empty set means every frame
+typedef struct frame_range_set
+{
+  FrameRange *rng;
+  int         num;
+} FrameRangeSet;
+
+extern void parse_frame_range_set (FrameRangeSet *set, char *str);
+extern void free_frame_range_set  (FrameRangeSet *set);
+extern int  frame_in_range_set    (FrameRangeSet *set, int frame);
+extern int  frame_range_set_last  (FrameRangeSet *set);
+
+#endif
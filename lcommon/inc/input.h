@@ -19,6 +19,8 @@ extern void AllocateFrameMemory (VideoParameters *p_Vid, InputParameters *p_Inp,
 extern void DeleteFrameMemory (VideoParameters *p_Vid);
 
 extern int  read_one_frame (VideoParameters *p_Vid, VideoDataFile *input_file, int FrameNoInFile, int HeaderSize, FrameFormat *source, FrameFormat *output, imgpel **pImage[3]);
+extern int  read_frame_data    (VideoParameters *p_Vid, VideoDataFile *input_file, int FrameNoInFile, int HeaderSize, FrameFormat *source, unsigned char **buf, unsigned char **ibuf, unsigned char **data);
+extern void convert_frame_data (VideoParameters *p_Vid, FrameFormat *source, FrameFormat *output, unsigned char *data, imgpel **pImage[3]);
 extern void pad_borders    ( FrameFormat output, int img_size_x, int img_size_y, int img_size_x_cr, int img_size_y_cr, imgpel **pImage[3]);
 
 #endif
@@ -0,0 +1,40 @@
+
+/*!
+ ************************************************************************
+ * \file io_mbinfo.h
+ *
+ * \brief
+ *    Macroblock side information files (coding decisions of a parsed
+ *    bitstream, written by the decoder and reused by the encoder)
+ *
+ ************************************************************************
+ */
+
+#ifndef _IO_MBINFO_H_
+#define _IO_MBINFO_H_
+
+//! coding decisions of one macroblock
+typedef struct mb_info_record
+{
+  int   poc;                 //!< picture order count of the picture
+  int   mb_addr;             //!< macroblock address
+  short mb_type;             //!< macroblock type (PSKIP/BSKIP_DIRECT ... IPCM)
+  short cbp;                 //!< coded block pattern (0 for skipped macroblocks)
+  char  slice_type;          //!< slice type (P_SLICE, B_SLICE, I_SLICE, ...)
+  char  qp;                  //!< luma QP
+  char  transform_8x8;       //!< transform_size_8x8_flag
+  char  i16mode;             //!< intra 16x16 prediction mode
+  char  c_ipred_mode;        //!< chroma intra prediction mode
+  char  b8mode[4];           //!< 8x8 partition modes (0: direct, 4..7: sub-partitions)
+  char  b8pdir[4];           //!< 8x8 prediction directions (0: list 0, 1: list 1, 2: bi-pred)
+  char  ipredmode[16];       //!< intra 4x4 / 8x8 prediction modes (raster scan of the 4x4 blocks)
+  char  ref_idx[2][16];      //!< reference indices (raster scan of the 4x4 blocks)
+  short mv[2][16][2];        //!< motion vectors (raster scan of the 4x4 blocks)
+} MBInfoRecord;
+
+extern FILE *open_mb_info_file  (char *filename, int write_file);
+extern void  close_mb_info_file (FILE *f);
+extern void  write_mb_info      (FILE *f, MBInfoRecord *rec);
+extern int   read_mb_info       (FILE *f, MBInfoRecord *rec);
+
+#endif
@@ -17,6 +17,9 @@
 
 extern int ReadFrameConcatenated  (InputParameters *p_Inp, VideoDataFile *input_file, int FrameNoInFile, int HeaderSize, FrameFormat *source, unsigned char *buf);
 extern int ReadFrameSeparate      (InputParameters *p_Inp, VideoDataFile *input_file, int FrameNoInFile, int HeaderSize, FrameFormat *source, unsigned char *buf);
+extern int MapFrameFile           (VideoDataFile *input_file);
+extern void UnmapFrameFile        (VideoDataFile *input_file);
+extern unsigned char *GetMappedFrame (InputParameters *p_Inp, VideoDataFile *input_file, int FrameNoInFile, int HeaderSize, FrameFormat *source);
 
 #endif
 
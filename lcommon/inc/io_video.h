@@ -51,6 +51,8 @@ typedef struct video_data_file
   int           crop_y_size;           //!< crop information (y component)
   int           crop_x_offset;         //!< crop offset (x component);
   int           crop_y_offset;         //!< crop offset (y component);
+  unsigned char *f_map;                //!< memory mapped file contents (NULL if the file is read)
+  int64         f_map_size;            //!< size of the memory mapped file in bytes
 
   // AVI related information to be added here
   int* avi;
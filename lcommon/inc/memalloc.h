@@ -183,10 +183,38 @@ extern int  malloc_mem3Dpel_2SLayers(imgpel ****buf0, int imgtype0, imgpel ****b
 extern void free_mem2Dpel_2SLayers(imgpel ***buf0, imgpel ***buf1);
 extern void free_mem3Dpel_2SLayers(imgpel ****buf0, imgpel ****buf1);
 
+//! block of a memory arena
+typedef struct mem_arena_block
+{
+  struct mem_arena_block *next;
+  byte   *data;
+  size_t  size;
+  size_t  used;
+} MemArenaBlock;
+
+//! memory arena: allocations are carved out of a few large blocks and released together by reset_mem_arena()
+typedef struct mem_arena
+{
+  MemArenaBlock *head;
+  MemArenaBlock *cur;                 //!< block serving the next allocation
+  size_t         block_size;          //!< minimum size of a new block
+} MemArena;
+
+extern MemArena *mem_arena;           //!< arena serving mem_malloc()/mem_calloc(), NULL: heap (select outside of parallel regions only)
+
+extern MemArena *new_mem_arena  (size_t block_size);
+extern void      free_mem_arena (MemArena *arena);
+extern void      reset_mem_arena(MemArena *arena);
+extern MemArena *set_mem_arena  (MemArena *arena);
+extern void     *mem_arena_alloc(MemArena *arena, size_t size);
+extern int       mem_arena_owns (MemArena *arena, void *pointer);
+
 
 static inline void* mem_malloc(size_t nitems)
 {
   void *d;
+  if (mem_arena != NULL)
+    return mem_arena_alloc(mem_arena, nitems);
   if((d = malloc(nitems)) == NULL)
   {
     no_mem_exit("malloc failed.\n");
@@ -211,6 +239,9 @@ static inline void* mem_calloc(size_t nitems, size_t size)
 
 static inline void mem_free(void *a)
 {
+  // arena memory is released by reset_mem_arena()
+  if (mem_arena != NULL && mem_arena_owns(mem_arena, a))
+    return;
   free_pointer(a);
 }
 
@@ -0,0 +1,52 @@
+/*!
+ ************************************************************************
+ * \file thread_util.h
+ *
+ * \brief
+ *    Minimal portable threads, mutexes and condition variables
+ *    (POSIX threads, or the native API on Windows) for helper threads
+ *    that run next to the coding loop, e.g. file readers. OpenMP is
+ *    only available in OPENMP builds and cannot keep a thread running
+ *    across calls, so such helpers use these wrappers instead.
+ *
+ ************************************************************************
+ */
+
+#ifndef _THREAD_UTIL_H_
+#define _THREAD_UTIL_H_
+
+#if defined(WIN32) || defined(WIN64)
+# include <windows.h>
+typedef HANDLE             ThreadHandle;
+typedef CRITICAL_SECTION   ThreadMutex;
+typedef CONDITION_VARIABLE ThreadCond;
+#else
+# include <pthread.h>
+typedef pthread_t          ThreadHandle;
+typedef pthread_mutex_t    ThreadMutex;
+typedef pthread_cond_t     ThreadCond;
+#endif
+
+typedef void (*ThreadFunc) (void *arg);
+
+//! storage class of variables with one instance per thread
+#if defined(_MSC_VER)
+# define THREAD_LOCAL __declspec(thread)
+#else
+# define THREAD_LOCAL __thread
+#endif
+
+extern void thread_create        (ThreadHandle *thread, ThreadFunc func, void *arg);
+extern void thread_join          (ThreadHandle thread);
+
+extern void thread_mutex_init    (ThreadMutex *mutex);
+extern void thread_mutex_destroy (ThreadMutex *mutex);
+extern void thread_mutex_lock    (ThreadMutex *mutex);
+extern void thread_mutex_unlock  (ThreadMutex *mutex);
+
+extern void thread_cond_init     (ThreadCond *cond);
+extern void thread_cond_destroy  (ThreadCond *cond);
+extern void thread_cond_wait     (ThreadCond *cond, ThreadMutex *mutex);
+extern void thread_cond_signal   (ThreadCond *cond);
+
+#endif
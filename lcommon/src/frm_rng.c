@@ -0,0 +1,159 @@
+/*!
+ *************************************************************************************
+ * \file frm_rng.c
+ *
+ * \brief
+ *    Frame range sets (ExtractFrmRng).
+ *
+ *    The range string is a list of frame numbers or closed ranges
+ *    separated by ',' (e.g. "4~30" or "0~9,50~99,120"). It is stored as
+ *    sorted, merged intervals, so a membership test is a binary search
+ *    whatever the length of the ranges.
+ *
+ *************************************************************************************
+ */
+#include "contributors.h"
+
+#include <limits.h>
+
+#include "global.h"
+#include "memalloc.h"
+#include "frm_rng.h"
+
+/*!
+ ************************************************************************
+ * \brief
+ *    qsort() comparison of two intervals by their first frame
+ ************************************************************************
+ */
+static int compare_frame_range(const void *arg1, const void *arg2)
+{
+  const FrameRange *a = (const FrameRange *) arg1;
+  const FrameRange *b = (const FrameRange *) arg2;
+
+  return (a->first > b->first) - (a->first < b->first);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Parses a frame range string ("" selects every frame)
+ ************************************************************************
+ */
+void parse_frame_range_set (FrameRangeSet *set, char *str)
+{
+  char *p = str;
+  int i, num = 0;
+
+  set->rng = NULL;
+  set->num = 0;
+
+  while (*p != '\0')
+  {
+    char *end;
+    FrameRange r;
+
+    while (*p == ' ' || *p == ',')
+      ++p;
+    if (*p == '\0')
+      break;
+
+    r.first = (int) strtol(p, &end, 10);
+    if (end == p)
+      break;
+    p = end;
+    while (*p == ' ')
+      ++p;
+    if (*p == '~')
+    {
+      ++p;
+      r.last = (int) strtol(p, &end, 10);
+      if (end == p)
+        break;
+      p = end;
+    }
+    else
+      r.last = r.first;
+
+    if (r.first < 0 || r.last < r.first)
+      break;
+
+    if ((set->rng = (FrameRange *) realloc(set->rng, (num + 1) * sizeof(FrameRange))) == NULL)
+      no_mem_exit("parse_frame_range_set: set->rng");
+    set->rng[num++] = r;
+  }
+
+  if (*p != '\0')
+  {
+    snprintf(errortext, ET_SIZE, "Invalid frame range \"%s\" (expected e.g. \"4~30\" or \"0~9,50~99\")", str);
+    error(errortext, 500);
+  }
+
+  if (num == 0)
+    return;
+
+  // sort and merge overlapping or adjacent intervals
+  qsort(set->rng, num, sizeof(FrameRange), compare_frame_range);
+  set->num = 1;
+  for (i = 1; i < num; ++i)
+  {
+    FrameRange *last = &set->rng[set->num - 1];
+
+    if (set->rng[i].first <= last->last + 1)
+      last->last = imax(last->last, set->rng[i].last);
+    else
+      set->rng[set->num++] = set->rng[i];
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Frees the intervals of a frame range set
+ ************************************************************************
+ */
+void free_frame_range_set (FrameRangeSet *set)
+{
+  free(set->rng);
+  set->rng = NULL;
+  set->num = 0;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Returns 1 if the frame belongs to the set (binary search)
+ ************************************************************************
+ */
+int frame_in_range_set (FrameRangeSet *set, int frame)
+{
+  int lo = 0, hi = set->num - 1;
+
+  if (set->num == 0)
+    return 1;
+
+  while (lo <= hi)
+  {
+    int mid = (lo + hi) >> 1;
+
+    if (frame < set->rng[mid].first)
+      hi = mid - 1;
+    else if (frame > set->rng[mid].last)
+      lo = mid + 1;
+    else
+      return 1;
+  }
+
+  return 0;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Returns the last frame of the set (INT_MAX if every frame is selected)
+ ************************************************************************
+ */
+int frame_range_set_last (FrameRangeSet *set)
+{
+  return (set->num == 0) ? INT_MAX : set->rng[set->num - 1].last;
+}
@@ -276,6 +276,7 @@ void OpenFiles( VideoDataFile *input_file)
  */
 void CloseFiles(VideoDataFile *input_file)
 {
+  UnmapFrameFile(input_file);
   if (input_file->f_num != -1)
     close(input_file->f_num);
   input_file->f_num = -1;
@@ -774,7 +774,7 @@ void DeleteFrameMemory (VideoParameters *p_Vid)
 /*!
  ************************************************************************
  * \brief
- *    Reads one new frame from file
+ *    Reads the data of one frame from file (without converting it)
  *
  * \param input_file
  *    structure containing information (filename, format) about the source file
@@ -784,38 +784,40 @@ void DeleteFrameMemory (VideoParameters *p_Vid)
  *    Number of bytes in the source file to be skipped
  * \param source  (input par)
  *    source file (on disk) information 
- * \param output  (input par)
- *    output file (for encoding) information
- * \param pImage
- *    Image planes 洢pImage[0]:Y data pImage[1]/[2]:U/V data
+ * \param buf
+ *    frame buffer the data is read into
+ * \param ibuf
+ *    buffer used for de-interleaving (swapped with *buf)
+ * \param data  (output par)
+ *    planar frame data: *buf, or the memory mapped file itself
  ************************************************************************
  */
-int read_one_frame (VideoParameters *p_Vid, VideoDataFile *input_file, int FrameNoInFile, int HeaderSize, FrameFormat *source, FrameFormat *output, imgpel **pImage[3])
+int read_frame_data (VideoParameters *p_Vid, VideoDataFile *input_file, int FrameNoInFile, int HeaderSize, FrameFormat *source, unsigned char **buf, unsigned char **ibuf, unsigned char **data)
 {
   InputParameters *p_Inp = p_Vid->p_Inp;
   int file_read = 0;
   unsigned int symbol_size_in_bytes = source->pic_unit_size_shift3;  //һöλʾ
 
-  const int bytes_y  = source->size_cmp[0] * symbol_size_in_bytes;
-  const int bytes_uv = source->size_cmp[1] * symbol_size_in_bytes;
-  int bit_scale;  
-
-  Boolean rgb_input = (Boolean) (source->color_model == CM_RGB && source->yuv_format == YUV444);
+  if (input_file->f_map != NULL) // memory mapped file: the frame is converted in place
+  {
+    *data = GetMappedFrame (p_Inp, input_file, FrameNoInFile, HeaderSize, source);
+    return (*data != NULL);
+  }
 
   if (input_file->is_concatenated == 0) //single input
   {    
     if (input_file->vdtype == VIDEO_TIFF)  //file format tiff pic format
     {
-      file_read = ReadTIFFImage     (p_Inp, input_file, FrameNoInFile, source, p_Vid->buf);
+      file_read = ReadTIFFImage     (p_Inp, input_file, FrameNoInFile, source, *buf);
     }
     else
     {
-      file_read = ReadFrameSeparate (p_Inp, input_file, FrameNoInFile, HeaderSize, source, p_Vid->buf);
+      file_read = ReadFrameSeparate (p_Inp, input_file, FrameNoInFile, HeaderSize, source, *buf);
     }
   }
   else  //execute this 
   {
-    file_read = ReadFrameConcatenated (p_Inp, input_file, FrameNoInFile, HeaderSize, source, p_Vid->buf);
+    file_read = ReadFrameConcatenated (p_Inp, input_file, FrameNoInFile, HeaderSize, source, *buf);
   }
 
   if ( !file_read )
@@ -826,17 +828,51 @@ int read_one_frame (VideoParameters *p_Vid, VideoDataFile *input_file, int Frame
   // De-interleave input source ǷǸɨ
   if (input_file->is_interleaved)
   {
-    deinterleave ( &p_Vid->buf, &p_Vid->ibuf, source, symbol_size_in_bytes);
+    deinterleave ( buf, ibuf, source, symbol_size_in_bytes);
   }
 
+  *data = *buf;
+  return file_read;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Converts the data of one frame (read by read_frame_data) to the
+ *    image planes. Only touches data and pImage, so that several frames
+ *    can be converted concurrently.
+ *
+ * \param source  (input par)
+ *    source file (on disk) information 
+ * \param output  (input par)
+ *    output file (for encoding) information
+ * \param data
+ *    planar frame data
+ * \param pImage
+ *    Image planes
+ ************************************************************************
+ */
+void convert_frame_data (VideoParameters *p_Vid, FrameFormat *source, FrameFormat *output, unsigned char *data, imgpel **pImage[3])
+{
+#if (ALLOW_GRAYSCALE)
+  InputParameters *p_Inp = p_Vid->p_Inp;
+#endif
+  unsigned int symbol_size_in_bytes = source->pic_unit_size_shift3;
+
+  const int bytes_y  = source->size_cmp[0] * symbol_size_in_bytes;
+  const int bytes_uv = source->size_cmp[1] * symbol_size_in_bytes;
+  int bit_scale;  
+
+  Boolean rgb_input = (Boolean) (source->color_model == CM_RGB && source->yuv_format == YUV444);
+
   bit_scale = source->bit_depth[0] - output->bit_depth[0];  
 
   //Y Data
   //صbuf2img_basic |pImage[0]ԭʼδY data
   if(rgb_input)
-    p_Vid->buf2img(pImage[0], p_Vid->buf + bytes_y, source->width[0], source->height[0], output->width[0], output->height[0], symbol_size_in_bytes, bit_scale);
+    p_Vid->buf2img(pImage[0], data + bytes_y, source->width[0], source->height[0], output->width[0], output->height[0], symbol_size_in_bytes, bit_scale);
   else
-    p_Vid->buf2img(pImage[0], p_Vid->buf, source->width[0], source->height[0], output->width[0], output->height[0], symbol_size_in_bytes, bit_scale);
+    p_Vid->buf2img(pImage[0], data, source->width[0], source->height[0], output->width[0], output->height[0], symbol_size_in_bytes, bit_scale);
 
 #if (DEBUG_BITDEPTH)
   MaskMSBs(pImage[0], ((1 << output->bit_depth[0]) - 1), output->width[0], output->height[0]);
@@ -851,22 +887,50 @@ int read_one_frame (VideoParameters *p_Vid, VideoDataFile *input_file, int Frame
     {
       //U Data
       if(rgb_input)
-        p_Vid->buf2img(pImage[1], p_Vid->buf + bytes_y + bytes_uv, source->width[1], source->height[1], output->width[1], output->height[1], symbol_size_in_bytes, bit_scale);
+        p_Vid->buf2img(pImage[1], data + bytes_y + bytes_uv, source->width[1], source->height[1], output->width[1], output->height[1], symbol_size_in_bytes, bit_scale);
       else 
-        p_Vid->buf2img(pImage[1], p_Vid->buf + bytes_y, source->width[1], source->height[1], output->width[1], output->height[1], symbol_size_in_bytes, bit_scale);
+        p_Vid->buf2img(pImage[1], data + bytes_y, source->width[1], source->height[1], output->width[1], output->height[1], symbol_size_in_bytes, bit_scale);
 
       bit_scale = source->bit_depth[2] - output->bit_depth[2];
       //V Data
       if(rgb_input)
-        p_Vid->buf2img(pImage[2], p_Vid->buf, source->width[1], source->height[1], output->width[1], output->height[1], symbol_size_in_bytes, bit_scale);
+        p_Vid->buf2img(pImage[2], data, source->width[1], source->height[1], output->width[1], output->height[1], symbol_size_in_bytes, bit_scale);
       else
-        p_Vid->buf2img(pImage[2], p_Vid->buf + bytes_y + bytes_uv, source->width[1], source->height[1], output->width[1], output->height[1], symbol_size_in_bytes, bit_scale);
+        p_Vid->buf2img(pImage[2], data + bytes_y + bytes_uv, source->width[1], source->height[1], output->width[1], output->height[1], symbol_size_in_bytes, bit_scale);
     }
 #if (DEBUG_BITDEPTH)
     MaskMSBs(pImage[1], ((1 << output->bit_depth[1]) - 1), output->width[1], output->height[1]);
     MaskMSBs(pImage[2], ((1 << output->bit_depth[2]) - 1), output->width[1], output->height[1]);
 #endif
   }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Reads one new frame from file
+ *
+ * \param input_file
+ *    structure containing information (filename, format) about the source file
+ * \param FrameNoInFile
+ *    Frame number in the source file
+ * \param HeaderSize
+ *    Number of bytes in the source file to be skipped
+ * \param source  (input par)
+ *    source file (on disk) information 
+ * \param output  (input par)
+ *    output file (for encoding) information
+ * \param pImage
+ *    Image planes 洢pImage[0]:Y data pImage[1]/[2]:U/V data
+ ************************************************************************
+ */
+int read_one_frame (VideoParameters *p_Vid, VideoDataFile *input_file, int FrameNoInFile, int HeaderSize, FrameFormat *source, FrameFormat *output, imgpel **pImage[3])
+{
+  unsigned char *data = NULL;
+  int file_read = read_frame_data (p_Vid, input_file, FrameNoInFile, HeaderSize, source, &p_Vid->buf, &p_Vid->ibuf, &data);
+
+  if (file_read)
+    convert_frame_data (p_Vid, source, output, data, pImage);
 
   return file_read;
 }
@@ -0,0 +1,98 @@
+/*!
+ *************************************************************************************
+ * \file io_mbinfo.c
+ *
+ * \brief
+ *    Macroblock side information files.
+ *
+ *    The decoder stores the parsed coding decisions of every macroblock
+ *    (type, partitions, intra modes, reference indices, motion vectors
+ *    and QP) in coding order; the encoder reads them back to re-encode a
+ *    stream without motion estimation and mode decision.
+ *    The file starts with a tag and the record size, followed by one
+ *    MBInfoRecord per macroblock.
+ *
+ *************************************************************************************
+ */
+#include "contributors.h"
+
+#include "global.h"
+#include "io_mbinfo.h"
+
+static const char mb_info_tag[4] = { 'J', 'M', 'M', 'B' };
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Opens a macroblock side information file for writing (write_file = 1)
+ *    or reading and checks its header
+ ************************************************************************
+ */
+FILE *open_mb_info_file (char *filename, int write_file)
+{
+  FILE *f;
+  char tag[4];
+  int  record_size = sizeof(MBInfoRecord);
+
+  if ((f = fopen(filename, write_file ? "wb" : "rb")) == NULL)
+  {
+    snprintf(errortext, ET_SIZE, "Error opening macroblock info file %s", filename);
+    error(errortext, 500);
+  }
+
+  if (write_file)
+  {
+    if (fwrite(mb_info_tag, sizeof(mb_info_tag), 1, f) != 1 || fwrite(&record_size, sizeof(int), 1, f) != 1)
+    {
+      snprintf(errortext, ET_SIZE, "Error writing macroblock info file %s", filename);
+      error(errortext, 500);
+    }
+  }
+  else
+  {
+    if (fread(tag, sizeof(tag), 1, f) != 1 || memcmp(tag, mb_info_tag, sizeof(tag)) != 0 ||
+      fread(&record_size, sizeof(int), 1, f) != 1 || record_size != (int) sizeof(MBInfoRecord))
+    {
+      snprintf(errortext, ET_SIZE, "%s is not a macroblock info file (or was written by an incompatible version)", filename);
+      error(errortext, 500);
+    }
+  }
+
+  return f;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Closes a macroblock side information file
+ ************************************************************************
+ */
+void close_mb_info_file (FILE *f)
+{
+  if (f != NULL)
+    fclose(f);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Appends the record of one macroblock
+ ************************************************************************
+ */
+void write_mb_info (FILE *f, MBInfoRecord *rec)
+{
+  if (fwrite(rec, sizeof(MBInfoRecord), 1, f) != 1)
+    error("write_mb_info: error writing macroblock info file", 500);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Reads the record of the next macroblock.
+ *    Returns 0 at the end of the file.
+ ************************************************************************
+ */
+int read_mb_info (FILE *f, MBInfoRecord *rec)
+{
+  return (fread(rec, sizeof(MBInfoRecord), 1, f) == 1);
+}
@@ -17,6 +17,10 @@
 #include "global.h"
 #include "img_io.h"
 
+#if !(defined(WIN32) || defined(WIN64))
+#include <sys/mman.h>
+#endif
+
 #define FAST_READ 1
 
 #if FAST_READ
@@ -205,3 +209,100 @@ int ReadFrameSeparate (InputParameters *p_Inp, VideoDataFile *input_file, int Fr
 
   return file_read;
 }
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Maps a concatenated raw file into memory so that frames can be
+ *    converted directly from the mapped data (no read() calls and no
+ *    intermediate copy). Interleaved sources, which have to be
+ *    de-interleaved into a separate buffer anyway, are not mapped.
+ *    Returns 1 on success, 0 if the file is read as usual.
+ *
+ * \param input_file
+ *    Input file to map (must be open)
+ ************************************************************************
+ */
+int MapFrameFile (VideoDataFile *input_file)
+{
+#if !(defined(WIN32) || defined(WIN64))
+  struct stat file_stat;
+  void *map;
+
+  if (input_file->is_concatenated == 0 || input_file->is_interleaved || input_file->vdtype == VIDEO_TIFF || input_file->f_num == -1)
+    return 0;
+
+  if (fstat(input_file->f_num, &file_stat) != 0 || file_stat.st_size <= 0)
+    return 0;
+
+  map = mmap(NULL, (size_t) file_stat.st_size, PROT_READ, MAP_PRIVATE, input_file->f_num, 0);
+  if (map == MAP_FAILED)
+    return 0;
+#ifdef MADV_SEQUENTIAL
+  madvise(map, (size_t) file_stat.st_size, MADV_SEQUENTIAL);
+#endif
+
+  input_file->f_map      = (unsigned char *) map;
+  input_file->f_map_size = (int64) file_stat.st_size;
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Releases the memory mapping of an input file (if any)
+ ************************************************************************
+ */
+void UnmapFrameFile (VideoDataFile *input_file)
+{
+#if !(defined(WIN32) || defined(WIN64))
+  if (input_file->f_map != NULL)
+    munmap(input_file->f_map, (size_t) input_file->f_map_size);
+#endif
+  input_file->f_map      = NULL;
+  input_file->f_map_size = 0;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Returns a pointer to one frame of a memory mapped concatenated
+ *    raw file (NULL if the frame lies beyond the end of the file)
+ *
+ * \param input_file
+ *    Input file (mapped by MapFrameFile)
+ * \param FrameNoInFile
+ *    Frame number in the source file
+ * \param HeaderSize
+ *    Number of bytes in the source file to be skipped
+ * \param source
+ *    source file (on disk) information 
+ ************************************************************************
+ */
+unsigned char *GetMappedFrame (InputParameters *p_Inp, VideoDataFile *input_file, int FrameNoInFile, int HeaderSize, FrameFormat *source)
+{
+  unsigned int symbol_size_in_bytes = source->pic_unit_size_shift3;
+
+  const int bytes_y  = source->size_cmp[0] * symbol_size_in_bytes;
+  const int bytes_uv = source->size_cmp[1] * symbol_size_in_bytes;
+
+  const int64 framesize_in_bytes = bytes_y + 2 * bytes_uv;
+  const int64 offset = HeaderSize + framesize_in_bytes * (FrameNoInFile + p_Inp->start_frame);
+
+  if ((source->pic_unit_size_on_disk & 0x07) != 0)
+  {
+    printf ("read_one_frame (NOT IMPLEMENTED): pic unit size on disk must be divisible by 8");
+    exit (-1);
+  }
+
+  if (offset + framesize_in_bytes > input_file->f_map_size)
+  {
+    printf ("read_one_frame: cannot read %d bytes from input file, unexpected EOF!\n", source->width[0]);
+    return NULL;
+  }
+
+  return input_file->f_map + offset;
+}
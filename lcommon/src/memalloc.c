@@ -18,6 +18,8 @@
 #include "global.h"
 #include "memalloc.h"
 
+MemArena *mem_arena = NULL;
+
 /*!
  ************************************************************************
  * \brief
@@ -2713,10 +2715,144 @@ void free_mem2Ddistblk(distblk **array2D)
       mem_free (*array2D);
     else 
       error ("free_mem2Ddistblk: trying to free unused memory",100);
-    free (array2D);
+    mem_free (array2D);
   } 
   else
   {
     error ("free_mem2Ddistblk: trying to free unused memory",100);
   }
 }
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Allocate a memory arena. Its blocks are allocated on demand and
+ *    hold at least block_size bytes each.
+ ************************************************************************
+ */
+MemArena *new_mem_arena(size_t block_size)
+{
+  MemArena *arena;
+
+  if ((arena = (MemArena *) calloc(1, sizeof(MemArena))) == NULL)
+    no_mem_exit("new_mem_arena: arena");
+  arena->block_size = block_size;
+
+  return arena;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Free a memory arena along with all its blocks
+ ************************************************************************
+ */
+void free_mem_arena(MemArena *arena)
+{
+  if (arena)
+  {
+    MemArenaBlock *block = arena->head;
+
+    while (block != NULL)
+    {
+      MemArenaBlock *next = block->next;
+      free(block->data);
+      free(block);
+      block = next;
+    }
+    free(arena);
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Release all allocations of a memory arena at once. The blocks are
+ *    kept for the next allocations.
+ ************************************************************************
+ */
+void reset_mem_arena(MemArena *arena)
+{
+  MemArenaBlock *block;
+
+  for (block = arena->head; block != NULL; block = block->next)
+    block->used = 0;
+  arena->cur = arena->head;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Select the arena serving mem_malloc() and mem_calloc()
+ *    (NULL: heap)
+ *
+ * \return
+ *    previously selected arena
+ ************************************************************************
+ */
+MemArena *set_mem_arena(MemArena *arena)
+{
+  MemArena *prev = mem_arena;
+
+  mem_arena = arena;
+  return prev;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Allocate memory aligned at SSE_MEMORY_ALIGNMENT from an arena
+ ************************************************************************
+ */
+void *mem_arena_alloc(MemArena *arena, size_t size)
+{
+  MemArenaBlock *block = arena->cur;
+  void *d;
+
+  // empty requests get their own address as well, see mem_arena_owns()
+  size = (size == 0) ? SSE_MEMORY_ALIGNMENT : (size + SSE_MEMORY_ALIGNMENT - 1) & ~((size_t) SSE_MEMORY_ALIGNMENT - 1);
+
+  // skip blocks too small for the request
+  while (block != NULL && block->used + size > block->size)
+    block = block->next;
+
+  if (block == NULL)
+  {
+    MemArenaBlock **tail = &arena->head;
+
+    if ((block = (MemArenaBlock *) calloc(1, sizeof(MemArenaBlock))) == NULL)
+      no_mem_exit("mem_arena_alloc: block");
+    block->size = (size > arena->block_size) ? size : arena->block_size;
+    if ((block->data = (byte *) malloc(block->size)) == NULL)
+      no_mem_exit("mem_arena_alloc: block->data");
+
+    while (*tail != NULL)
+      tail = &(*tail)->next;
+    *tail = block;
+  }
+
+  arena->cur = block;
+  d = block->data + block->used;
+  block->used += size;
+
+  return d;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Check whether pointer has been allocated from an arena
+ ************************************************************************
+ */
+int mem_arena_owns(MemArena *arena, void *pointer)
+{
+  MemArenaBlock *block;
+  byte *p = (byte *) pointer;
+
+  for (block = arena->head; block != NULL; block = block->next)
+  {
+    if (p >= block->data && p < block->data + block->size)
+      return TRUE;
+  }
+  return FALSE;
+}
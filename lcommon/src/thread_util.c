@@ -0,0 +1,138 @@
+/*!
+ *************************************************************************************
+ * \file thread_util.c
+ *
+ * \brief
+ *    Minimal portable threads, mutexes and condition variables.
+ *    Failing to create a thread or a synchronization object is fatal
+ *    (error()), like failing to allocate memory.
+ *
+ *************************************************************************************
+ */
+#include "contributors.h"
+
+#include "global.h"
+#include "memalloc.h"
+#include "thread_util.h"
+
+//! function and argument of a thread being started
+typedef struct thread_start
+{
+  ThreadFunc func;
+  void      *arg;
+} ThreadStart;
+
+#if defined(WIN32) || defined(WIN64)
+
+static DWORD WINAPI thread_main (LPVOID param)
+{
+  ThreadStart start = *(ThreadStart *) param;
+
+  free(param);
+  start.func(start.arg);
+  return 0;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Starts a thread running func(arg)
+ ************************************************************************
+ */
+void thread_create (ThreadHandle *thread, ThreadFunc func, void *arg)
+{
+  ThreadStart *start;
+
+  if ((start = (ThreadStart *) malloc(sizeof(ThreadStart))) == NULL)
+    no_mem_exit("thread_create: start");
+  start->func = func;
+  start->arg  = arg;
+
+  if ((*thread = CreateThread(NULL, 0, thread_main, start, 0, NULL)) == NULL)
+    error("thread_create: could not create thread", 500);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Waits for a thread to finish and releases it
+ ************************************************************************
+ */
+void thread_join (ThreadHandle thread)
+{
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
+
+void thread_mutex_init    (ThreadMutex *mutex) { InitializeCriticalSection(mutex); }
+void thread_mutex_destroy (ThreadMutex *mutex) { DeleteCriticalSection(mutex); }
+void thread_mutex_lock    (ThreadMutex *mutex) { EnterCriticalSection(mutex); }
+void thread_mutex_unlock  (ThreadMutex *mutex) { LeaveCriticalSection(mutex); }
+
+void thread_cond_init     (ThreadCond *cond) { InitializeConditionVariable(cond); }
+void thread_cond_destroy  (ThreadCond *cond) { (void) cond; }
+void thread_cond_wait     (ThreadCond *cond, ThreadMutex *mutex) { SleepConditionVariableCS(cond, mutex, INFINITE); }
+void thread_cond_signal   (ThreadCond *cond) { WakeConditionVariable(cond); }
+
+#else
+
+static void *thread_main (void *param)
+{
+  ThreadStart start = *(ThreadStart *) param;
+
+  free(param);
+  start.func(start.arg);
+  return NULL;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Starts a thread running func(arg)
+ ************************************************************************
+ */
+void thread_create (ThreadHandle *thread, ThreadFunc func, void *arg)
+{
+  ThreadStart *start;
+
+  if ((start = (ThreadStart *) malloc(sizeof(ThreadStart))) == NULL)
+    no_mem_exit("thread_create: start");
+  start->func = func;
+  start->arg  = arg;
+
+  if (pthread_create(thread, NULL, thread_main, start) != 0)
+    error("thread_create: could not create thread", 500);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Waits for a thread to finish and releases it
+ ************************************************************************
+ */
+void thread_join (ThreadHandle thread)
+{
+  pthread_join(thread, NULL);
+}
+
+void thread_mutex_init (ThreadMutex *mutex)
+{
+  if (pthread_mutex_init(mutex, NULL) != 0)
+    error("thread_mutex_init: could not create mutex", 500);
+}
+
+void thread_mutex_destroy (ThreadMutex *mutex) { pthread_mutex_destroy(mutex); }
+void thread_mutex_lock    (ThreadMutex *mutex) { pthread_mutex_lock(mutex); }
+void thread_mutex_unlock  (ThreadMutex *mutex) { pthread_mutex_unlock(mutex); }
+
+void thread_cond_init (ThreadCond *cond)
+{
+  if (pthread_cond_init(cond, NULL) != 0)
+    error("thread_cond_init: could not create condition variable", 500);
+}
+
+void thread_cond_destroy  (ThreadCond *cond) { pthread_cond_destroy(cond); }
+void thread_cond_wait     (ThreadCond *cond, ThreadMutex *mutex) { pthread_cond_wait(cond, mutex); }
+void thread_cond_signal   (ThreadCond *cond) { pthread_cond_signal(cond); }
+
+#endif
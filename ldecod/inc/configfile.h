@@ -54,6 +54,13 @@ Mapping Map[] = {
     {"Silent",                   &cfgparams.silent,                       0,   0.0,                       1,  0.0,              1.0,                             },
     {"IntraProfileDeblocking",   &cfgparams.intra_profile_deblocking,     0,   1.0,                       1,  0.0,              1.0,                             },
     {"DecFrmNum",                &cfgparams.iDecFrmNum,                   0,   0.0,                       2,  0.0,              0.0,                             },
+    {"RowDeblocking",            &cfgparams.iRowDeblocking,               0,   0.0,                       1,  0.0,              1.0,                             },
+    {"FullDecode",               &cfgparams.iFullDecode,                  0,   0.0,                       1,  0.0,              1.0,                             },
+    {"ProfileMode",              &cfgparams.ProfileMode,                  0,   0.0,                       1,  0.0,              2.0,                             },
+    {"ProfileFile",              &cfgparams.ProfileFile,                  1,   0.0,                       0,  0.0,              0.0,             FILE_NAME_SIZE, },
+    {"MBInfoFile",               &cfgparams.MBInfoFile,                   1,   0.0,                       0,  0.0,              0.0,             FILE_NAME_SIZE, },
+    {"MVDRewriteFile",           &cfgparams.MVDRewriteFile,               1,   0.0,                       0,  0.0,              0.0,             FILE_NAME_SIZE, },
+    {"ExtractFrmRng",            &cfgparams.ExtractFrmRng,                1,   0.0,                       0,  0.0,              0.0,             FILE_NAME_SIZE, },
 #if (MVC_EXTENSION_ENABLE)
     {"DecodeAllLayers",          &cfgparams.DecodeAllLayers,              0,   0.0,                       1,  0.0,              1.0,                             },
 #endif
@@ -0,0 +1,77 @@
+/*!
+ **************************************************************************
+ *  \file dec_profile.h
+ *
+ *  \brief
+ *     Per-stage decoder profiling (timing of the main decoding stages
+ *     per picture, written as CSV or JSON lines)
+ *
+ *  Stages are timed with self-time accounting: a stage nested inside
+ *  another one (e.g. output inside DPB management, transform inside
+ *  intra prediction) is charged only to the innermost stage, so the
+ *  per-stage values of one picture add up to its total decoding time.
+ *
+ *  The instrumentation compiles to nothing if ENABLE_DEC_PROFILE is 0;
+ *  otherwise each probe costs a single pointer test while profiling is
+ *  switched off (ProfileMode = 0).
+ *
+ **************************************************************************
+ */
+
+#ifndef _DEC_PROFILE_H_
+#define _DEC_PROFILE_H_
+#include "global.h"
+
+#define PROF_MAX_DEPTH   16
+
+typedef enum
+{
+  PROF_OTHER = 0,        //!< time not covered by any of the stages below
+  PROF_NAL_READ,         //!< NAL unit reading (Annex B / RTP)
+  PROF_EBSP,             //!< EBSP to RBSP conversion
+  PROF_SLICE_HEADER,     //!< slice header parsing and parameter set activation
+  PROF_ENTROPY,          //!< macroblock layer entropy decoding (CAVLC/CABAC)
+  PROF_MC,               //!< inter prediction / motion compensation
+  PROF_INTRA,            //!< intra prediction (including the interleaved intra 4x4/8x8 residual)
+  PROF_TRANSFORM,        //!< inverse transform and reconstruction
+  PROF_DEBLOCK,          //!< deblocking filter
+  PROF_DPB,              //!< decoded picture buffer management
+  PROF_OUTPUT,           //!< picture output (writing the YUV file)
+  PROF_NUM_STAGES
+} ProfStage;
+
+typedef enum
+{
+  PROF_MODE_OFF  = 0,
+  PROF_MODE_CSV  = 1,
+  PROF_MODE_JSON = 2
+} ProfMode;
+
+typedef struct dec_prof_parameters
+{
+  int    mode;                           //!< output format (ProfMode)
+  FILE  *p_out;                          //!< profile output file
+  int64  t_last;                         //!< time stamp of the last stage switch (ns)
+  int    stack[PROF_MAX_DEPTH];          //!< stage stack
+  int    depth;                          //!< stage stack depth
+  int    frame_ctr;                      //!< number of reported pictures
+  int64  frame_ns[PROF_NUM_STAGES];      //!< per stage time of the current picture (ns)
+  int64  total_ns[PROF_NUM_STAGES];      //!< per stage time of the whole sequence (ns)
+} DecProfParameters;
+
+extern void init_dec_profile  (VideoParameters *p_Vid, InputParameters *p_Inp);
+extern void free_dec_profile  (VideoParameters *p_Vid);
+extern void dec_prof_push     (DecProfParameters *prof, int stage);
+extern void dec_prof_pop      (DecProfParameters *prof);
+extern void dec_prof_picture  (VideoParameters *p_Vid, int poc, int slice_type, int structure);
+
+#if (ENABLE_DEC_PROFILE)
+#define PROF_PUSH(p_Vid, stage)  do { if ((p_Vid)->dec_prof) dec_prof_push((p_Vid)->dec_prof, (stage)); } while (0)
+#define PROF_POP(p_Vid)          do { if ((p_Vid)->dec_prof) dec_prof_pop ((p_Vid)->dec_prof);          } while (0)
+#else
+#define PROF_PUSH(p_Vid, stage)
+#define PROF_POP(p_Vid)
+#endif
+
+#endif
+
@@ -48,6 +48,8 @@
 
 #define MVC_EXTENSION_ENABLE      1    //!< enable support for the Multiview High Profile
 #define ENABLE_DEC_STATS          0    //!< enable decoder statistics collection
+#define ENABLE_DEC_PROFILE        1    //!< compile in the per-stage decoder profiler (see ProfileMode)
+#define JM_SIMD_DISTORTION        1    //!< Enables the SSE4.1/AVX2 SSE kernels of find_snr (x86 only, selected at run time)
 
 #define MVC_INIT_VIEW_ID          -1
 #define MAX_VIEW_NUM              1024   
@@ -42,6 +42,8 @@
 #include "distortion.h"
 #include "io_video.h"
 #include "nalucommon.h"
+#include "frm_rng.h"
+#include "thread_util.h"
 
 
 typedef struct bit_stream_dec Bitstream;
@@ -572,6 +574,7 @@ typedef struct slice
   void (*update_direct_mv_info    )    (Macroblock *currMB);
   void (*read_coeff_4x4_CAVLC     )    (Macroblock *currMB, int block_type, int i, int j, int levarr[16], int runarr[16], int *number_coefficients);
 
+  struct mvd_rewrite_nalu *mvd_rw_nalu;      //!< queued NAL unit of this slice for the MVD rewriter, NULL if not rewritten
 } Slice;
 
 typedef struct decodedpic_t
@@ -888,6 +891,9 @@ typedef struct video_par
   ImageData tempData3;
   DecodedPicList *pDecOuputPic;
   int iDeblockMode;  //0: deblock in picture, 1: deblock in slice;
+  int bRowDeblock;                            //!< deblock MB row N-1 as soon as row N has been decoded
+  int iDeblockNextMb;                         //!< next MB address expected by the row-delayed deblocking
+  int iDeblockRowsDone;                       //!< number of MB rows of the current picture already deblocked
   struct nalu_t *nalu;  //NAL unit
   int iLumaPadX;
   int iLumaPadY;
@@ -955,6 +961,13 @@ typedef struct video_par
 /******************* end deprecative variables; ***************************************/
 
   struct dec_stat_parameters *dec_stats;
+  struct dec_prof_parameters *dec_prof;      //!< per-stage profiler, NULL if profiling is off
+  FILE *p_mb_info;                           //!< macroblock info file (MBInfoFile), NULL if not written
+  struct mvd_rewrite_parameters *p_mvd_rw;   //!< bitstream domain MVD rewriter (MVDRewriteFile), NULL if off
+  FrameRangeSet ext_frm_rng;                 //!< frames (coding order) to extract and rewrite (ExtractFrmRng)
+  int ext_frame_ctr;                         //!< coding order number of the current frame, -1 before the first one
+  int ext_in_range;                          //!< the current picture belongs to ExtractFrmRng
+  int ext_done;                              //!< last frame of ExtractFrmRng finished: the remaining NAL units are passed through
 } VideoParameters;
 
 
@@ -967,6 +980,14 @@ typedef struct snr_par
   float snra[3];                               //!< Average component SNR (dB) remaining frames
   float sse[3];                                //!< component SSE 
   float msse[3];                                //!< Average component SSE 
+  unsigned char *ref_buf[2];                   //!< reference file frame buffers (the next frame is prefetched into the other one)
+  int64 ref_buf_size;                          //!< size of ref_buf[] in bytes
+  int64 ref_bytes[2];                          //!< number of bytes read into ref_buf[] (-1 if the seek failed)
+  int   ref_frame_no[2];                       //!< frame number held by ref_buf[] (-1 if none)
+  ThreadHandle ref_thread;                     //!< helper thread reading frame ref_frame_no[ref_next] into ref_buf[ref_next]
+  int   ref_prefetching;                       //!< ref_thread is running or has not been joined yet
+  int   ref_next;                              //!< buffer being filled by ref_thread
+  int   ref_file;                              //!< reference file read by ref_thread
 } SNRParameters;
 
 // input parameters from configuration file
@@ -1024,6 +1045,13 @@ char ExtractionLogFile[FILE_NAME_SIZE];
   int export_views;
   
   int iDecFrmNum;
+  int iRowDeblocking;                         //!< 0: deblock after the whole picture is decoded, 1: row-delayed deblocking in the MB loop
+  int iFullDecode;                            //!< 0: parse and extract MVD key records only, 1: also reconstruct the pictures
+  int ProfileMode;                            //!< per-stage profiling output: 0: off, 1: CSV, 2: JSON lines
+  char ProfileFile[FILE_NAME_SIZE];           //!< per-stage profiling output file
+  char MBInfoFile[FILE_NAME_SIZE];            //!< macroblock info output file (coding decisions for re-encoding)
+  char MVDRewriteFile[FILE_NAME_SIZE];        //!< output of the bitstream domain MVD rewriter (CAVLC only)
+  char ExtractFrmRng[FILE_NAME_SIZE];         //!< frames (coding order) to extract and rewrite, e.g. "4~30" ("": all frames)
 
   int bDisplayDecParams;
   int dpb_plus[2];
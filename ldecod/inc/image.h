@@ -16,6 +16,7 @@
 
 extern void calculate_frame_no(VideoParameters *p_Vid, StorablePicture *p);
 extern void find_snr          (VideoParameters *p_Vid, StorablePicture *p, int *p_ref);
+extern void wait_ref_prefetch (SNRParameters *snr);
 extern int  picture_order     ( Slice *pSlice );
 
 extern void decode_one_slice  (Slice *currSlice);
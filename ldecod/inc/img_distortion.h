@@ -0,0 +1,27 @@
+
+/*!
+ ************************************************************************
+ * \file img_distortion.h
+ *
+ * \brief
+ *    Picture distortion (SSE) kernels
+ *
+ ************************************************************************
+ */
+
+#ifndef _IMG_DISTORTION_H_
+#define _IMG_DISTORTION_H_
+
+//! instruction set extensions used by the SSE kernels
+typedef enum
+{
+  SIMD_NONE  = 0,   //!< C kernel
+  SIMD_SSE41 = 1,   //!< SSE4.1 kernel
+  SIMD_AVX2  = 2    //!< AVX2 kernel
+} SIMDLevel;
+
+extern int   init_distortion_kernels (void);
+extern int64 compute_SSE             (imgpel **imgRef, imgpel **imgSrc, int xRef, int xSrc, int ySize, int xSize);
+
+#endif
+
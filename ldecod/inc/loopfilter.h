@@ -14,6 +14,8 @@
 #include "mbuffer.h"
 
 extern void DeblockPicture(VideoParameters *p_Vid, StorablePicture *p) ;
+extern void DeblockMbRows (VideoParameters *p_Vid, StorablePicture *p, int start_row, int end_row);
+extern void DeblockRowDelayed(VideoParameters *p_Vid, StorablePicture *p, int MbAddr);
 
 void  init_Deblock(VideoParameters *p_Vid, int mb_aff_frame_flag);
 #endif //_LOOPFILTER_H_
@@ -0,0 +1,55 @@
+
+/*!
+ ************************************************************************
+ * \file mvd_rewrite.h
+ *
+ * \brief
+ *    Bitstream domain MVD scrambling of CAVLC streams (MVDRewriteFile)
+ *
+ ************************************************************************
+ */
+
+#ifndef _MVD_REWRITE_H_
+#define _MVD_REWRITE_H_
+
+#include "global.h"
+#include "nalucommon.h"
+
+//! NAL unit waiting in the output queue of the rewriter
+typedef struct mvd_rewrite_nalu
+{
+  byte  *buf;                          //!< NAL unit header byte followed by the EBSP
+  int    len;                          //!< length of buf in bytes
+  int    startcodeprefix_len;          //!< start code length (3 or 4 bytes)
+  int    pending;                      //!< slice NAL unit waiting for 1: its slice header, 2: its rewritten slice data
+  struct mvd_rewrite_nalu *next;
+} MVDRewriteNalu;
+
+typedef struct mvd_rewrite_parameters
+{
+  FILE  *p_out;                        //!< rewritten bitstream
+  MVDRewriteNalu *head;                //!< oldest queued NAL unit
+  MVDRewriteNalu *tail;                //!< newest queued NAL unit
+
+  // SODB writer of the slice being rewritten
+  byte  *rbsp;                         //!< rewritten RBSP (slice header and slice data)
+  int    rbsp_size;                    //!< allocated size of rbsp in bytes
+  int    bits_written;                 //!< number of bits in rbsp
+  int    bits_copied;                  //!< next source bit to be copied
+
+  int    cabac_warned;                 //!< CABAC slice warning printed
+  int64  num_slices;                   //!< rewritten slices
+  int64  num_passed;                   //!< NAL units passed through unchanged
+  int64  num_mvd;                      //!< scrambled mvd pairs
+} MVDRewriteParameters;
+
+extern void init_mvd_rewrite     (VideoParameters *p_Vid, InputParameters *p_Inp);
+extern void free_mvd_rewrite     (VideoParameters *p_Vid);
+extern void mvd_rewrite_nalu     (VideoParameters *p_Vid, NALU_t *nalu);
+extern void mvd_rewrite_attach   (Slice *currSlice);
+extern void mvd_rewrite_start    (Slice *currSlice);
+extern void mvd_rewrite_pair     (Slice *currSlice, Bitstream *currStream, int bit_start, short mvd[2]);
+extern void mvd_rewrite_finish   (Slice *currSlice);
+extern void mvd_rewrite_release  (Slice *currSlice);
+
+#endif
@@ -24,6 +24,7 @@
 #include "transform.h"
 #include "quant.h"
 #include "memalloc.h"
+#include "dec_profile.h"
 
 /*!
  ***********************************************************************
@@ -732,6 +733,7 @@ void iTransform(Macroblock *currMB, ColorPlane pl, int smb)
   imgpel **curr_img;
   int uv = pl-1; 
 
+  PROF_PUSH(p_Vid, PROF_TRANSFORM);
   if ((currMB->cbp & 15) != 0 || smb)
   {
     if(currMB->luma_transform_size_8x8_flag == 0) // 4x4 inverse transform
@@ -833,6 +835,7 @@ void iTransform(Macroblock *currMB, ColorPlane pl, int smb)
       }
     }
   }
+  PROF_POP(p_Vid);
 }
 
 /*!
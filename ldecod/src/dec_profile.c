@@ -0,0 +1,242 @@
+/*!
+ ***********************************************************************
+ * \file
+ *    dec_profile.c
+ * \brief
+ *    Per-stage decoder profiling.
+ *
+ *    The time between two consecutive stage switches is charged to the
+ *    stage on top of the stage stack (PROF_OTHER if the stack is empty).
+ *    One record is written per decoded picture, followed by a summary
+ *    record when the decoder is closed.
+ ***********************************************************************
+ */
+
+#include "global.h"
+#include "memalloc.h"
+#include "dec_profile.h"
+
+static const char *prof_stage_name[PROF_NUM_STAGES] =
+{
+  "other", "nal_read", "ebsp", "slice_header", "entropy", "mc", "intra", "transform", "deblock", "dpb", "output"
+};
+
+/*!
+ ***********************************************************************
+ * \brief
+ *    returns a monotonic time stamp in nanoseconds
+ ***********************************************************************
+ */
+static int64 prof_time_ns(void)
+{
+#if defined(WIN32) || defined(WIN64)
+  static LARGE_INTEGER freq;
+  LARGE_INTEGER t;
+
+  if (freq.QuadPart == 0)
+    QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&t);
+  return (int64) ((double) t.QuadPart * 1e9 / (double) freq.QuadPart);
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64) ts.tv_sec * 1000000000 + (int64) ts.tv_nsec;
+#endif
+}
+
+/*!
+ ***********************************************************************
+ * \brief
+ *    charges the time elapsed since the last stage switch to the
+ *    currently active stage. Stages nested deeper than PROF_MAX_DEPTH
+ *    are not stored and are charged to the deepest stored stage.
+ ***********************************************************************
+ */
+static inline void prof_charge(DecProfParameters *prof)
+{
+  int64 now = prof_time_ns();
+  int depth = imin(prof->depth, PROF_MAX_DEPTH);
+  int stage = depth ? prof->stack[depth - 1] : PROF_OTHER;
+
+  prof->frame_ns[stage] += now - prof->t_last;
+  prof->t_last = now;
+}
+
+static const char *prof_slice_type_name(int slice_type)
+{
+  switch (slice_type)
+  {
+  case P_SLICE:  return "P";
+  case B_SLICE:  return "B";
+  case I_SLICE:  return "I";
+  case SP_SLICE: return "SP";
+  case SI_SLICE: return "SI";
+  default:       return "?";
+  }
+}
+
+static const char *prof_structure_name(int structure)
+{
+  return (structure == TOP_FIELD) ? "top" : (structure == BOTTOM_FIELD) ? "bottom" : "frame";
+}
+
+/*!
+ ***********************************************************************
+ * \brief
+ *    allocates the profiler and opens its output file if profiling
+ *    is enabled (ProfileMode != 0)
+ ***********************************************************************
+ */
+void init_dec_profile(VideoParameters *p_Vid, InputParameters *p_Inp)
+{
+  p_Vid->dec_prof = NULL;
+#if (ENABLE_DEC_PROFILE)
+  DecProfParameters *prof;
+  int i;
+
+  if (p_Inp->ProfileMode == PROF_MODE_OFF)
+    return;
+
+  if ((prof = (DecProfParameters *) calloc (1, sizeof (DecProfParameters))) == NULL)
+    no_mem_exit ("init_dec_profile: prof");
+
+  prof->mode = p_Inp->ProfileMode;
+  if (strlen(p_Inp->ProfileFile) == 0)
+    strcpy(p_Inp->ProfileFile, (prof->mode == PROF_MODE_CSV) ? "dec_profile.csv" : "dec_profile.json");
+  if ((prof->p_out = fopen(p_Inp->ProfileFile, "w")) == NULL)
+  {
+    snprintf(errortext, ET_SIZE, "Error open profile file %s", p_Inp->ProfileFile);
+    error(errortext, 500);
+  }
+
+  if (prof->mode == PROF_MODE_CSV)
+  {
+    fprintf(prof->p_out, "frame,poc,type,structure");
+    for (i = 0; i < PROF_NUM_STAGES; i++)
+      fprintf(prof->p_out, ",%s_us", prof_stage_name[i]);
+    fprintf(prof->p_out, ",total_us\n");
+  }
+
+  prof->t_last = prof_time_ns();
+  p_Vid->dec_prof = prof;
+#endif
+}
+
+/*!
+ ***********************************************************************
+ * \brief
+ *    enters a decoding stage
+ ***********************************************************************
+ */
+void dec_prof_push(DecProfParameters *prof, int stage)
+{
+  prof_charge(prof);
+  if (prof->depth < PROF_MAX_DEPTH)
+    prof->stack[prof->depth] = stage;
+  ++prof->depth;
+}
+
+/*!
+ ***********************************************************************
+ * \brief
+ *    leaves the current decoding stage
+ ***********************************************************************
+ */
+void dec_prof_pop(DecProfParameters *prof)
+{
+  prof_charge(prof);
+  if (prof->depth > 0)
+    --prof->depth;
+}
+
+static void prof_write_stages(DecProfParameters *prof, int64 *stage_ns)
+{
+  int i;
+  int64 total = 0;
+
+  for (i = 0; i < PROF_NUM_STAGES; i++)
+    total += stage_ns[i];
+
+  if (prof->mode == PROF_MODE_CSV)
+  {
+    for (i = 0; i < PROF_NUM_STAGES; i++)
+      fprintf(prof->p_out, ",%.3f", (double) stage_ns[i] * 1e-3);
+    fprintf(prof->p_out, ",%.3f\n", (double) total * 1e-3);
+  }
+  else
+  {
+    fprintf(prof->p_out, "\"stages_us\":{");
+    for (i = 0; i < PROF_NUM_STAGES; i++)
+      fprintf(prof->p_out, "%s\"%s\":%.3f", i ? "," : "", prof_stage_name[i], (double) stage_ns[i] * 1e-3);
+    fprintf(prof->p_out, "},\"total_us\":%.3f}\n", (double) total * 1e-3);
+  }
+}
+
+/*!
+ ***********************************************************************
+ * \brief
+ *    writes the profile record of a completely decoded picture and
+ *    starts timing the next one
+ ***********************************************************************
+ */
+void dec_prof_picture(VideoParameters *p_Vid, int poc, int slice_type, int structure)
+{
+  DecProfParameters *prof = p_Vid->dec_prof;
+  int i;
+
+  if (prof == NULL)
+    return;
+
+  prof_charge(prof);
+
+  if (prof->mode == PROF_MODE_CSV)
+    fprintf(prof->p_out, "%d,%d,%s,%s", prof->frame_ctr, poc, prof_slice_type_name(slice_type), prof_structure_name(structure));
+  else
+    fprintf(prof->p_out, "{\"frame\":%d,\"poc\":%d,\"type\":\"%s\",\"structure\":\"%s\",",
+      prof->frame_ctr, poc, prof_slice_type_name(slice_type), prof_structure_name(structure));
+  prof_write_stages(prof, prof->frame_ns);
+
+  for (i = 0; i < PROF_NUM_STAGES; i++)
+  {
+    prof->total_ns[i] += prof->frame_ns[i];
+    prof->frame_ns[i] = 0;
+  }
+  ++prof->frame_ctr;
+}
+
+/*!
+ ***********************************************************************
+ * \brief
+ *    writes the summary record, closes the profile file and frees
+ *    the profiler
+ ***********************************************************************
+ */
+void free_dec_profile(VideoParameters *p_Vid)
+{
+  DecProfParameters *prof = p_Vid->dec_prof;
+  int64 total = 0;
+  int i;
+
+  if (prof == NULL)
+    return;
+
+  // time spent after the last picture (final DPB flush etc.)
+  prof_charge(prof);
+  for (i = 0; i < PROF_NUM_STAGES; i++)
+  {
+    prof->total_ns[i] += prof->frame_ns[i];
+    total += prof->total_ns[i];
+  }
+
+  if (prof->mode == PROF_MODE_CSV)
+    fprintf(prof->p_out, "total,,,");
+  else
+    fprintf(prof->p_out, "{\"summary\":{\"frames\":%d,\"fps\":%.3f},",
+      prof->frame_ctr, total > 0 ? (double) prof->frame_ctr * 1e9 / (double) total : 0.0);
+  prof_write_stages(prof, prof->total_ns);
+
+  fclose(prof->p_out);
+  free(prof);
+  p_Vid->dec_prof = NULL;
+}
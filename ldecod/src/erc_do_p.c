@@ -29,17 +29,17 @@
 
 // static function declarations
 static int concealByCopy(frame *recfr, int currMBNum, objectBuffer_t *object_list, int picSizeX);
-static int concealByTrial(frame *recfr, imgpel *predMB,
+static int concealByTrial(frame *recfr, imgpel *predMB, imgpel **tmp_block,
                           int currMBNum, objectBuffer_t *object_list, int predBlocks[],
                           int picSizeX, int picSizeY, char *yCondition);
-static int edgeDistortion (int predBlocks[], int currYBlockNum, imgpel *predMB,
-                           imgpel *recY, int picSizeX, int regionSize);
+static int edgeDistortionMC (VideoParameters *p_Vid, int predBlocks[], int *mv, int x, int y,
+                             imgpel **imgY, imgpel **tmp_block);
 static void copyBetweenFrames (frame *recfr, int currYBlockNum, int picSizeX, int regionSize);
-static void buildPredRegionYUV(VideoParameters *p_Vid, int *mv, int x, int y, imgpel *predMB);
+static void buildPredRegionYUV(VideoParameters *p_Vid, int *mv, int x, int y, imgpel *predMB, imgpel **tmp_block);
 
 // picture error concealment
 static void buildPredblockRegionYUV(VideoParameters *p_Vid, int *mv,
-                                    int x, int y, imgpel *predMB, int list, int mb);
+                                    int x, int y, imgpel *predMB, int list, int mb, imgpel **tmp_block);
 static void CopyImgData(imgpel **inputY, imgpel ***inputUV, imgpel **outputY, imgpel ***outputUV, 
                         int img_width, int img_height, int img_width_cr, int img_height_cr);
 
@@ -79,6 +79,7 @@ int ercConcealInterFrame(frame *recfr, objectBuffer_t *object_list,
   int lastCorruptedRow = -1, firstCorruptedRow = -1;
   int currRow = 0, row, column, columnInd, areaHeight = 0, i = 0;
   imgpel *predMB;
+  imgpel **tmp_block;
 
   /* if concealment is on */
   if ( errorVar && errorVar->concealment )
@@ -93,6 +94,9 @@ int ercConcealInterFrame(frame *recfr, objectBuffer_t *object_list,
 
       if ( predMB == NULL ) no_mem_exit("ercConcealInterFrame: predMB");
 
+      // luma prediction scratch: rows 0..15 hold a prediction region, rows 16..31 a 4x4 block
+      get_mem2Dpel(&tmp_block, 2 * MB_BLOCK_SIZE, MB_BLOCK_SIZE);
+
       lastRow = (int) (picSizeY>>4);
       lastColumn = (int) (picSizeX>>4);
 
@@ -129,7 +133,7 @@ int ercConcealInterFrame(frame *recfr, objectBuffer_t *object_list,
                   errorVar->yCondition, (lastRow<<1), (lastColumn<<1), 2, 0);
 
                 if(p_Vid->erc_mvperMB >= MVPERMB_THR)
-                  concealByTrial(recfr, predMB,
+                  concealByTrial(recfr, predMB, tmp_block,
                     currRow*lastColumn+column, object_list, predBlocks,
                     picSizeX, picSizeY,
                     errorVar->yCondition);
@@ -151,7 +155,7 @@ int ercConcealInterFrame(frame *recfr, objectBuffer_t *object_list,
                   errorVar->yCondition, (lastRow<<1), (lastColumn<<1), 2, 0);
 
                 if(p_Vid->erc_mvperMB >= MVPERMB_THR)
-                  concealByTrial(recfr, predMB,
+                  concealByTrial(recfr, predMB, tmp_block,
                     currRow*lastColumn+column, object_list, predBlocks,
                     picSizeX, picSizeY,
                     errorVar->yCondition);
@@ -192,7 +196,7 @@ int ercConcealInterFrame(frame *recfr, objectBuffer_t *object_list,
                   errorVar->yCondition, (lastRow<<1), (lastColumn<<1), 2, 0);
 
                 if(p_Vid->erc_mvperMB >= MVPERMB_THR)
-                  concealByTrial(recfr, predMB,
+                  concealByTrial(recfr, predMB, tmp_block,
                     currRow*lastColumn+column, object_list, predBlocks,
                     picSizeX, picSizeY,
                     errorVar->yCondition);
@@ -210,6 +214,7 @@ int ercConcealInterFrame(frame *recfr, objectBuffer_t *object_list,
         }
       }
 
+      free_mem2Dpel(tmp_block);
       free(predMB);
     }
     return 1;
@@ -271,32 +276,29 @@ static void copyBetweenFrames (frame *recfr, int currYBlockNum, int picSizeX, in
 {
   VideoParameters *p_Vid = recfr->p_Vid;
   StorablePicture *dec_picture = p_Vid->dec_picture;
-  int j, k, location, xmin, ymin;
+  int j, xmin, ymin, xmin_cr, size_cr;
   StorablePicture* refPic = p_Vid->ppSliceList[0]->listX[0][0];
 
   /* set the position of the region to be copied */
   xmin = (xPosYBlock(currYBlockNum,picSizeX)<<3);
   ymin = (yPosYBlock(currYBlockNum,picSizeX)<<3);
 
+  // the picture planes are padded, so copy through the row pointers and not
+  // through the (unpadded) frame buffer pointers of recfr
   for (j = ymin; j < ymin + regionSize; j++)
-    for (k = xmin; k < xmin + regionSize; k++)
-    {
-      location = j * picSizeX + k;
-//th      recfr->yptr[location] = dec_picture->imgY[j][k];
-      recfr->yptr[location] = refPic->imgY[j][k];
-    }
+    memcpy(&dec_picture->imgY[j][xmin], &refPic->imgY[j][xmin], regionSize * sizeof(imgpel));
 
-    for (j = ymin >> uv_div[1][dec_picture->chroma_format_idc]; j < (ymin + regionSize) >> uv_div[1][dec_picture->chroma_format_idc]; j++)
-      for (k = xmin >> uv_div[0][dec_picture->chroma_format_idc]; k < (xmin + regionSize) >> uv_div[0][dec_picture->chroma_format_idc]; k++)
-      {
-//        location = j * picSizeX / 2 + k;
-        location = ((j * picSizeX) >> uv_div[0][dec_picture->chroma_format_idc]) + k;
+  if (dec_picture->chroma_format_idc != YUV400)
+  {
+    xmin_cr = xmin >> uv_div[0][dec_picture->chroma_format_idc];
+    size_cr = regionSize >> uv_div[0][dec_picture->chroma_format_idc];
 
-//th        recfr->uptr[location] = dec_picture->imgUV[0][j][k];
-//th        recfr->vptr[location] = dec_picture->imgUV[1][j][k];
-        recfr->uptr[location] = refPic->imgUV[0][j][k];
-        recfr->vptr[location] = refPic->imgUV[1][j][k];
-      }
+    for (j = ymin >> uv_div[1][dec_picture->chroma_format_idc]; j < (ymin + regionSize) >> uv_div[1][dec_picture->chroma_format_idc]; j++)
+    {
+      memcpy(&dec_picture->imgUV[0][j][xmin_cr], &refPic->imgUV[0][j][xmin_cr], size_cr * sizeof(imgpel));
+      memcpy(&dec_picture->imgUV[1][j][xmin_cr], &refPic->imgUV[1][j][xmin_cr], size_cr * sizeof(imgpel));
+    }
+  }
 }
 
 /*!
@@ -304,7 +306,9 @@ static void copyBetweenFrames (frame *recfr, int currYBlockNum, int picSizeX, in
  * \brief
  *      It conceals a given MB by using the motion vectors of one reliable neighbor. That MV of a
  *      neighbor is selected wich gives the lowest pixel difference at the edges of the MB
- *      (see function edgeDistortion). This corresponds to a spatial smoothness criteria.
+ *      (see function edgeDistortionMC). This corresponds to a spatial smoothness criteria.
+ *      Only the boundary strips of the candidates are predicted; the MB itself is built
+ *      and copied once, for the selected MV.
  * \return
  *      Always zero (0).
  * \param recfr
@@ -312,6 +316,8 @@ static void copyBetweenFrames (frame *recfr, int currYBlockNum, int picSizeX, in
  * \param predMB
  *      memory area for storing temporary pixel values for a macroblock
  *      the Y,U,V planes are concatenated y = predMB, u = predMB+256, v = predMB+320
+ * \param tmp_block
+ *      luma prediction scratch (2 * MB_BLOCK_SIZE rows of MB_BLOCK_SIZE pixels)
  * \param currMBNum
  *      current MB index
  * \param object_list
@@ -326,7 +332,7 @@ static void copyBetweenFrames (frame *recfr, int currYBlockNum, int picSizeX, in
  *      array for conditions of Y blocks from ercVariables_t
  ************************************************************************
  */
-static int concealByTrial(frame *recfr, imgpel *predMB,
+static int concealByTrial(frame *recfr, imgpel *predMB, imgpel **tmp_block,
                           int currMBNum, objectBuffer_t *object_list, int predBlocks[],
                           int picSizeX, int picSizeY, char *yCondition)
 {
@@ -430,8 +436,6 @@ static int concealByTrial(frame *recfr, imgpel *predMB,
 
                   mvPred[0] = mvPred[1] = 0;
                   mvPred[2] = 0;
-
-                  buildPredRegionYUV(p_Vid->erc_img, mvPred, currRegion->xMin, currRegion->yMin, predMB);
                 }
               }
               /* build motion using the neighbour's Motion Parameters */
@@ -446,16 +450,13 @@ static int concealByTrial(frame *recfr, imgpel *predMB,
                 mvPred[0] = mvptr[0];
                 mvPred[1] = mvptr[1];
                 mvPred[2] = mvptr[2];
-
-                buildPredRegionYUV(p_Vid->erc_img, mvPred, currRegion->xMin, currRegion->yMin, predMB);
               }
 
               /* measure absolute boundary pixel difference */
-              currDist = edgeDistortion(predBlocks,
-                MBNum2YBlock(currMBNum,comp,picSizeX),
-                predMB, recfr->yptr, picSizeX, regionSize);
+              currDist = edgeDistortionMC(p_Vid->erc_img, predBlocks, mvPred,
+                currRegion->xMin, currRegion->yMin, p_Vid->dec_picture->imgY, tmp_block);
 
-              /* if so far best -> store the pixels as the best concealment */
+              /* if so far best -> store the MV as the best concealment */
               if (currDist < minDist || !fInterNeighborExists)
               {
 
@@ -468,9 +469,6 @@ static int concealByTrial(frame *recfr, imgpel *predMB,
                   (isBlock(object_list, predMBNum, compPred, INTER_COPY)) ?
                   ((regionSize == 16) ? REGMODE_INTER_COPY : REGMODE_INTER_COPY_8x8) :
                   ((regionSize == 16) ? REGMODE_INTER_PRED : REGMODE_INTER_PRED_8x8);
-
-                copyPredMB(MBNum2YBlock(currMBNum,comp,picSizeX), predMB, recfr,
-                  picSizeX, regionSize);
               }
 
               fInterNeighborExists = 1;
@@ -489,11 +487,8 @@ static int concealByTrial(frame *recfr, imgpel *predMB,
       mvPred[0] = mvPred[1] = 0;
       mvPred[2] = 0;
 
-      buildPredRegionYUV(p_Vid->erc_img, mvPred, currRegion->xMin, currRegion->yMin, predMB);
-
-      currDist = edgeDistortion(predBlocks,
-        MBNum2YBlock(currMBNum,comp,picSizeX),
-        predMB, recfr->yptr, picSizeX, regionSize);
+      currDist = edgeDistortionMC(p_Vid->erc_img, predBlocks, mvPred,
+        currRegion->xMin, currRegion->yMin, p_Vid->dec_picture->imgY, tmp_block);
 
       if (currDist < minDist || !fInterNeighborExists)
       {
@@ -504,12 +499,14 @@ static int concealByTrial(frame *recfr, imgpel *predMB,
 
         currRegion->regionMode =
           ((regionSize == 16) ? REGMODE_INTER_COPY : REGMODE_INTER_COPY_8x8);
-
-        copyPredMB(MBNum2YBlock(currMBNum,comp,picSizeX), predMB, recfr,
-          picSizeX, regionSize);
       }
     }
 
+    /* build and store the pixels of the best concealment */
+    buildPredRegionYUV(p_Vid->erc_img, mvBest, currRegion->xMin, currRegion->yMin, predMB, tmp_block);
+    copyPredMB(MBNum2YBlock(currMBNum,comp,picSizeX), predMB, recfr,
+      picSizeX, regionSize);
+
     for (i=0; i<3; i++)
       currRegion->mv[i] = mvBest[i];
 
@@ -522,6 +519,78 @@ static int concealByTrial(frame *recfr, imgpel *predMB,
     return 0;
 }
 
+/*!
+************************************************************************
+* \brief
+*      Prepares the macroblock covering pixel position (x, y) for building a
+*      concealment prediction and returns it.
+************************************************************************
+*/
+static Macroblock *setupConcealMB(VideoParameters *p_Vid, int x, int y)
+{
+  int mb_nr = y/16*(p_Vid->width/16)+x/16; ///currSlice->current_mb_nr;
+  Macroblock *currMB = &p_Vid->mb_data[mb_nr];   // intialization code deleted, see below, StW  
+
+  /* Update coordinates of the current concealed macroblock */
+  currMB->mb.x = (short) (x/MB_BLOCK_SIZE);
+  currMB->mb.y = (short) (y/MB_BLOCK_SIZE);
+  currMB->block_y = currMB->mb.y * BLOCK_SIZE;
+  currMB->pix_c_y = currMB->mb.y * p_Vid->mb_cr_size_y;
+  currMB->block_x = currMB->mb.x * BLOCK_SIZE;
+  currMB->pix_c_x = currMB->mb.x * p_Vid->mb_cr_size_x;
+
+  return currMB;
+}
+
+/*!
+************************************************************************
+* \brief
+*      Builds the luma motion prediction of a size_x x size_y region (multiples of
+*      BLOCK_SIZE) at pixel position (x, y) into rows 0..size_y-1 of tmp_block.
+*      The result is identical to predicting the region 4x4 block by 4x4 block:
+*      if the reference position clipping of get_block_luma() does not affect
+*      any of the 4x4 blocks, the whole region is interpolated with one call,
+*      otherwise it is predicted per 4x4 block via rows 16..19 of tmp_block.
+************************************************************************
+*/
+static void getLumaPredRegion(VideoParameters *p_Vid, Macroblock *currMB, int *mv,
+                              int x, int y, int size_x, int size_y, imgpel **tmp_block)
+{
+  StorablePicture *dec_picture = p_Vid->dec_picture;
+  Slice *currSlice = currMB->p_Slice;
+  StorablePicture *ref_pic = currSlice->listX[0][imax (mv[2], 0)]; // !!KS: quick fix, we sometimes seem to get negative ref_pic here
+  int max_x = dec_picture->size_x_m1;
+  int max_y = (currMB->mb_field) ? (dec_picture->size_y >> 1) - 1 : dec_picture->size_y_m1;
+  int pos_x = (x << 2) + mv[0];
+  int pos_y = (y << 2) + mv[1];
+  int i, j;
+
+  if ((pos_x >> 2) >= -18 && (pos_x >> 2) + size_x - BLOCK_SIZE <= max_x + 2 &&
+      (pos_y >> 2) >= -10 && (pos_y >> 2) + size_y - BLOCK_SIZE <= max_y + 2)
+  {
+    get_block_luma(ref_pic, pos_x, pos_y, size_x, size_y, tmp_block,
+      dec_picture->iLumaStride, max_x, max_y, currSlice->tmp_res,
+      p_Vid->max_pel_value_comp[PLANE_Y], (imgpel) p_Vid->dc_pred_value_comp[PLANE_Y], currMB);
+  }
+  else
+  {
+    for (j = 0; j < size_y; j += BLOCK_SIZE)
+    {
+      for (i = 0; i < size_x; i += BLOCK_SIZE)
+      {
+        int jj;
+
+        get_block_luma(ref_pic, pos_x + (i << 2), pos_y + (j << 2), BLOCK_SIZE, BLOCK_SIZE, &tmp_block[MB_BLOCK_SIZE],
+          dec_picture->iLumaStride, max_x, max_y, currSlice->tmp_res,
+          p_Vid->max_pel_value_comp[PLANE_Y], (imgpel) p_Vid->dc_pred_value_comp[PLANE_Y], currMB);
+
+        for (jj = 0; jj < BLOCK_SIZE; jj++)
+          memcpy(&tmp_block[j + jj][i], tmp_block[MB_BLOCK_SIZE + jj], BLOCK_SIZE * sizeof(imgpel));
+      }
+    }
+  }
+}
+
 /*!
 ************************************************************************
 * \brief
@@ -540,20 +609,19 @@ static int concealByTrial(frame *recfr, imgpel *predMB,
 * \param predMB
 *      memory area for storing temporary pixel values for a macroblock
 *      the Y,U,V planes are concatenated y = predMB, u = predMB+256, v = predMB+320
+* \param tmp_block
+*      luma prediction scratch (2 * MB_BLOCK_SIZE rows of MB_BLOCK_SIZE pixels)
 ************************************************************************
 */
-static void buildPredRegionYUV(VideoParameters *p_Vid, int *mv, int x, int y, imgpel *predMB)
+static void buildPredRegionYUV(VideoParameters *p_Vid, int *mv, int x, int y, imgpel *predMB, imgpel **tmp_block)
 {
-  imgpel **tmp_block;
   int i=0, j=0, ii=0, jj=0,i1=0,j1=0,j4=0,i4=0;
   int uv;
-  int vec1_x=0,vec1_y=0;
   int ioff,joff;
   imgpel *pMB = predMB;
   Slice *currSlice;// = p_Vid->currentSlice;
   StorablePicture *dec_picture = p_Vid->dec_picture;
   int ii0,jj0,ii1,jj1,if1,jf1,if0,jf0;
-  int mv_mul;
 
   //FRExt
   int f1_x, f1_y, f2_x, f2_y, f3, f4;
@@ -561,59 +629,19 @@ static void buildPredRegionYUV(VideoParameters *p_Vid, int *mv, int x, int y, im
   int yuv = dec_picture->chroma_format_idc - 1;
 
   int ref_frame = imax (mv[2], 0); // !!KS: quick fix, we sometimes seem to get negative ref_pic here, so restrict to zero and above
-  int mb_nr = y/16*(p_Vid->width/16)+x/16; ///currSlice->current_mb_nr;
-  int **tmp_res = NULL;
-  
-  Macroblock *currMB = &p_Vid->mb_data[mb_nr];   // intialization code deleted, see below, StW  
-  currSlice = currMB->p_Slice;
-  tmp_res = currSlice->tmp_res;
 
-  // This should be allocated only once. 
-  get_mem2Dpel(&tmp_block, MB_BLOCK_SIZE, MB_BLOCK_SIZE);
-
-  /* Update coordinates of the current concealed macroblock */
-  currMB->mb.x = (short) (x/MB_BLOCK_SIZE);
-  currMB->mb.y = (short) (y/MB_BLOCK_SIZE);
-  currMB->block_y = currMB->mb.y * BLOCK_SIZE;
-  currMB->pix_c_y = currMB->mb.y * p_Vid->mb_cr_size_y;
-  currMB->block_x = currMB->mb.x * BLOCK_SIZE;
-  currMB->pix_c_x = currMB->mb.x * p_Vid->mb_cr_size_x;
-
-  mv_mul=4;
+  Macroblock *currMB = setupConcealMB(p_Vid, x, y);
+  currSlice = currMB->p_Slice;
 
   // luma *******************************************************
 
-  for(j=0;j<MB_BLOCK_SIZE/BLOCK_SIZE;j++)
-  {
-    joff=j*4;
-    j4=currMB->block_y+j;
-    for(i=0;i<MB_BLOCK_SIZE/BLOCK_SIZE;i++)
-    {
-      ioff=i*4;
-      i4=currMB->block_x+i;
-
-      vec1_x = i4*4*mv_mul + mv[0];
-      vec1_y = j4*4*mv_mul + mv[1];
-
-      get_block_luma(currSlice->listX[0][ref_frame], vec1_x, vec1_y, BLOCK_SIZE, BLOCK_SIZE,
-        tmp_block,
-        dec_picture->iLumaStride,dec_picture->size_x_m1,
-        (currMB->mb_field) ? (dec_picture->size_y >> 1) - 1 : dec_picture->size_y_m1,tmp_res,
-        p_Vid->max_pel_value_comp[PLANE_Y],(imgpel) p_Vid->dc_pred_value_comp[PLANE_Y], currMB);
-
-      for(ii=0;ii<BLOCK_SIZE;ii++)
-        for(jj=0;jj<MB_BLOCK_SIZE/BLOCK_SIZE;jj++)
-          currSlice->mb_pred[LumaComp][jj+joff][ii+ioff]=tmp_block[jj][ii];
-    }
-  }
-
+  getLumaPredRegion(p_Vid, currMB, mv, currMB->block_x * BLOCK_SIZE, currMB->block_y * BLOCK_SIZE,
+    MB_BLOCK_SIZE, MB_BLOCK_SIZE, tmp_block);
 
   for (j = 0; j < 16; j++)
   {
-    for (i = 0; i < 16; i++)
-    {
-      pMB[j*16+i] = currSlice->mb_pred[LumaComp][j][i];
-    }
+    memcpy(currSlice->mb_pred[LumaComp][j], tmp_block[j], MB_BLOCK_SIZE * sizeof(imgpel));
+    memcpy(&pMB[j*16], tmp_block[j], MB_BLOCK_SIZE * sizeof(imgpel));
   }
   pMB += 256;
 
@@ -678,8 +706,6 @@ static void buildPredRegionYUV(VideoParameters *p_Vid, int *mv, int x, int y, im
 
     }
   }
-  // We should allocate this memory only once.
-  free_mem2Dpel(tmp_block); 
 }
 /*!
  ************************************************************************
@@ -744,38 +770,72 @@ static void copyPredMB (int currYBlockNum, imgpel *predMB, frame *recfr,
 /*!
  ************************************************************************
  * \brief
- *      Calculates a weighted pixel difference between edge Y pixels of the macroblock stored in predMB
- *      and the pixels in the given Y plane of a frame (recY) that would become neighbor pixels if
- *      predMB was placed at currYBlockNum block position into the frame. This "edge distortion" value
- *      is used to determine how well the given macroblock in predMB would fit into the frame when
- *      considering spatial smoothness. If there are correctly received neighbor blocks (status stored
- *      in predBlocks) only they are used in calculating the edge distorion; otherwise also the already
- *      concealed neighbor blocks can also be used.
+ *      Sum of absolute differences between n horizontally adjacent pixels
+ ************************************************************************
+ */
+static inline int edgeSADRow (imgpel *pred, imgpel *rec, int n)
+{
+  int i, sad = 0;
+
+  for (i = 0; i < n; i++)
+    sad += iabs((int) pred[i] - (int) rec[i]);
+
+  return sad;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *      Sum of absolute differences between n vertically adjacent pixels
+ *      (column pred_x of pred, column rec_x of rec starting at row rec_y)
+ ************************************************************************
+ */
+static inline int edgeSADCol (imgpel **pred, int pred_x, imgpel **rec, int rec_y, int rec_x, int n)
+{
+  int i, sad = 0;
+
+  for (i = 0; i < n; i++)
+    sad += iabs((int) pred[i][pred_x] - (int) rec[rec_y + i][rec_x]);
+
+  return sad;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *      Calculates a weighted pixel difference between the edge Y pixels of the motion
+ *      compensated prediction of the 16x16 region at (x, y) with motion vector mv and the
+ *      pixels of the picture (imgY) that are neighbors of the region. This
+ *      "edge distortion" value is used to determine how well the prediction would fit into
+ *      the frame when considering spatial smoothness. If there are correctly received neighbor
+ *      blocks (status stored in predBlocks) only they are used in calculating the edge
+ *      distorion; otherwise also the already concealed neighbor blocks can also be used.
+ *      Only the 4 pixel wide prediction strips along the used edges are interpolated,
+ *      the rest of the region is never built.
  * \return
- *      The calculated weighted pixel difference at the edges of the MB.
+ *      The calculated weighted pixel difference at the edges of the region.
+ * \param p_Vid
+ *      The pointer of video_par structure of current frame
  * \param predBlocks
  *      status array of the neighboring blocks (if they are OK, concealed or lost)
- * \param currYBlockNum
- *      index of the block (8x8) in the Y plane
- * \param predMB
- *      memory area where the temporary pixel values are stored
- *      the Y,U,V planes are concatenated y = predMB, u = predMB+256, v = predMB+320
- * \param recY
- *      pointer to a Y plane of a YUV frame
- * \param picSizeX
- *      picture width in pixels
- * \param regionSize
- *      can be 16 or 8 to tell the dimension of the region to copy
+ * \param mv
+ *      candidate motion vector and reference index
+ * \param x
+ *      The x-coordinate of the above-left corner pixel of the region
+ * \param y
+ *      The y-coordinate of the above-left corner pixel of the region
+ * \param imgY
+ *      luma plane of the picture being concealed
+ * \param tmp_block
+ *      luma prediction scratch (2 * MB_BLOCK_SIZE rows of MB_BLOCK_SIZE pixels)
  ************************************************************************
  */
-static int edgeDistortion (int predBlocks[], int currYBlockNum, imgpel *predMB,
-                           imgpel *recY, int picSizeX, int regionSize)
+static int edgeDistortionMC (VideoParameters *p_Vid, int predBlocks[], int *mv, int x, int y,
+                             imgpel **imgY, imgpel **tmp_block)
 {
-  int i, j, distortion, numOfPredBlocks, threshold = ERC_BLOCK_OK;
-  imgpel *currBlock = NULL, *neighbor = NULL;
-  int currBlockOffset = 0;
-
-  currBlock = recY + (yPosYBlock(currYBlockNum,picSizeX)<<3)*picSizeX + (xPosYBlock(currYBlockNum,picSizeX)<<3);
+  int j, distortion, numOfPredBlocks, threshold = ERC_BLOCK_OK;
+  int regionSize = MB_BLOCK_SIZE;
+  Macroblock *currMB = setupConcealMB(p_Vid, x, y);
 
   do
   {
@@ -792,34 +852,20 @@ static int edgeDistortion (int predBlocks[], int currYBlockNum, imgpel *predMB,
         switch (j)
         {
         case 4:
-          neighbor = currBlock - picSizeX;
-          for ( i = 0; i < regionSize; i++ )
-          {
-            distortion += iabs((int)(predMB[i] - neighbor[i]));
-          }
+          getLumaPredRegion(p_Vid, currMB, mv, x, y, regionSize, BLOCK_SIZE, tmp_block);
+          distortion += edgeSADRow(tmp_block[0], &imgY[y - 1][x], regionSize);
           break;
         case 5:
-          neighbor = currBlock - 1;
-          for ( i = 0; i < regionSize; i++ )
-          {
-            distortion += iabs((int)(predMB[i*16] - neighbor[i*picSizeX]));
-          }
+          getLumaPredRegion(p_Vid, currMB, mv, x, y, BLOCK_SIZE, regionSize, tmp_block);
+          distortion += edgeSADCol(tmp_block, 0, imgY, y, x - 1, regionSize);
           break;
         case 6:
-          neighbor = currBlock + regionSize*picSizeX;
-          currBlockOffset = (regionSize-1)*16;
-          for ( i = 0; i < regionSize; i++ )
-          {
-            distortion += iabs((int)(predMB[i+currBlockOffset] - neighbor[i]));
-          }
+          getLumaPredRegion(p_Vid, currMB, mv, x, y + regionSize - BLOCK_SIZE, regionSize, BLOCK_SIZE, tmp_block);
+          distortion += edgeSADRow(tmp_block[BLOCK_SIZE - 1], &imgY[y + regionSize][x], regionSize);
           break;
         case 7:
-          neighbor = currBlock + regionSize;
-          currBlockOffset = regionSize-1;
-          for ( i = 0; i < regionSize; i++ )
-          {
-            distortion += iabs((int)(predMB[i*16+currBlockOffset] - neighbor[i*picSizeX]));
-          }
+          getLumaPredRegion(p_Vid, currMB, mv, x + regionSize - BLOCK_SIZE, y, BLOCK_SIZE, regionSize, tmp_block);
+          distortion += edgeSADCol(tmp_block, BLOCK_SIZE - 1, imgY, y, x + regionSize, regionSize);
           break;
         }
 
@@ -852,9 +898,8 @@ static int edgeDistortion (int predBlocks[], int currYBlockNum, imgpel *predMB,
 *************************************************************************
 */
 static void buildPredblockRegionYUV(VideoParameters *p_Vid, int *mv,
-                                    int x, int y, imgpel *predMB, int list, int current_mb_nr)
+                                    int x, int y, imgpel *predMB, int list, int current_mb_nr, imgpel **tmp_block)
 {
-  imgpel **tmp_block;
   int i=0,j=0,ii=0,jj=0,i1=0,j1=0,j4=0,i4=0;
   int uv;
   int vec1_x=0,vec1_y=0;
@@ -876,8 +921,6 @@ static void buildPredblockRegionYUV(VideoParameters *p_Vid, int *mv,
   Macroblock *currMB = &p_Vid->mb_data[mb_nr];   // intialization code deleted, see below, StW  
   Slice *currSlice = currMB->p_Slice;
 
-  get_mem2Dpel(&tmp_block, MB_BLOCK_SIZE, MB_BLOCK_SIZE);
-
   /* Update coordinates of the current concealed macroblock */
 
   currMB->mb.x = (short) (x/BLOCK_SIZE);
@@ -965,7 +1008,6 @@ static void buildPredblockRegionYUV(VideoParameters *p_Vid, int *mv,
 
     }
   }
-  free_mem2Dpel(tmp_block);
 }
 
 /*!
@@ -1059,18 +1101,16 @@ static inline int compare_pic_by_poc_desc( const void *arg1, const void *arg2 )
 static void CopyImgData(imgpel **inputY, imgpel ***inputUV, imgpel **outputY, imgpel ***outputUV, 
                         int img_width, int img_height, int img_width_cr, int img_height_cr)
 {
-  int x, y;
+  int y;
 
   for (y=0; y<img_height; y++)
-    for (x=0; x<img_width; x++)
-      outputY[y][x] = inputY[y][x];
+    memcpy(outputY[y], inputY[y], img_width * sizeof(imgpel));
 
   for (y=0; y<img_height_cr; y++)
-    for (x=0; x<img_width_cr; x++)
-    {
-      outputUV[0][y][x] = inputUV[0][y][x];
-      outputUV[1][y][x] = inputUV[1][y][x];
-    }
+  {
+    memcpy(outputUV[0][y], inputUV[0][y], img_width_cr * sizeof(imgpel));
+    memcpy(outputUV[1][y], inputUV[1][y], img_width_cr * sizeof(imgpel));
+  }
 }
 
 /*!
@@ -1116,6 +1156,7 @@ static void copy_to_conceal(StorablePicture *src, StorablePicture *dst, VideoPar
   int mv[3];
   int multiplier;
   imgpel *predMB, *storeYUV;
+  imgpel **tmp_block;
   int j, y, x, mb_height, mb_width, ii=0, jj=0;
   int uv;
   int mm, nn;
@@ -1169,6 +1210,7 @@ static void copy_to_conceal(StorablePicture *src, StorablePicture *dst, VideoPar
     {
       storeYUV = (imgpel *) malloc (16  * sizeof (imgpel));
     }
+    get_mem2Dpel(&tmp_block, MB_BLOCK_SIZE, MB_BLOCK_SIZE);
 
     p_Vid->erc_img = p_Vid;
 
@@ -1213,7 +1255,7 @@ static void copy_to_conceal(StorablePicture *src, StorablePicture *dst, VideoPar
         if ((mm%16==0) && (nn%16==0))
           current_mb_nr++;
 
-        buildPredblockRegionYUV(p_Vid->erc_img, mv, x, y, storeYUV, LIST_0, current_mb_nr);
+        buildPredblockRegionYUV(p_Vid->erc_img, mv, x, y, storeYUV, LIST_0, current_mb_nr, tmp_block);
 
         predMB = storeYUV;
 
@@ -1244,6 +1286,7 @@ static void copy_to_conceal(StorablePicture *src, StorablePicture *dst, VideoPar
         }
       }
     }
+    free_mem2Dpel(tmp_block);
     free(storeYUV);
   }
 }
@@ -60,6 +60,10 @@
 #include "fast_memory.h"
 
 #include "mc_prediction.h"
+#include "dec_profile.h"
+#include "io_mbinfo.h"
+#include "mvd_rewrite.h"
+#include "img_distortion.h"
 extern int testEndian(void);
 void reorder_lists(Slice *currSlice);
 
@@ -193,6 +197,12 @@ static void init_picture(VideoParameters *p_Vid, Slice *currSlice, InputParamete
     // this may only happen on slice loss
     exit_picture(p_Vid, &p_Vid->dec_picture);
   }
+
+  // coding order frame number for ExtractFrmRng; the second field of a pair belongs to the frame of the first one
+  if (currSlice->structure == FRAME || p_Dpb->last_picture == NULL)
+    ++p_Vid->ext_frame_ctr;
+  p_Vid->ext_in_range = frame_in_range_set(&p_Vid->ext_frm_rng, p_Vid->ext_frame_ctr);
+
   p_Vid->dpb_layer_id = currSlice->layer_id;
   //set buffers;
   setup_buffers(p_Vid, currSlice->layer_id);
@@ -670,7 +680,18 @@ static void init_picture_decoding(VideoParameters *p_Vid)
     assert(p_Vid->ppSliceList[j]->view_id == i);
 #endif
   }
+  // there is nothing to filter if the pictures are not reconstructed
+  if (!p_Vid->p_Inp->iFullDecode)
+    iDeblockMode = 1;
   p_Vid->iDeblockMode = iDeblockMode;
+
+  // row-delayed deblocking needs a plain raster scan of frame MBs
+  p_Vid->bRowDeblock = p_Vid->p_Inp->iRowDeblocking && !iDeblockMode
+    && (p_Vid->bDeblockEnable & (1 << p_Vid->dec_picture->used_for_reference))
+    && !pSlice->mb_aff_frame_flag && (p_Vid->separate_colour_plane_flag == 0)
+    && (p_Vid->active_pps->num_slice_groups_minus1 == 0);
+  p_Vid->iDeblockNextMb   = 0;
+  p_Vid->iDeblockRowsDone = 0;
 }
 
 void init_slice(VideoParameters *p_Vid, Slice *currSlice)
@@ -733,6 +754,15 @@ void init_slice(VideoParameters *p_Vid, Slice *currSlice)
 
 void decode_slice(Slice *currSlice, int current_header)
 {
+  VideoParameters *p_Vid = currSlice->p_Vid;
+  // pictures outside ExtractFrmRng are only parsed if they are reconstructed
+  int parse = (current_header == SOP || current_header == SOS) && currSlice->ei_flag == 0
+    && (p_Vid->ext_in_range || p_Vid->p_Inp->iFullDecode);
+
+  // slices outside ExtractFrmRng keep their original MVDs
+  if (currSlice->mvd_rw_nalu && (!parse || !p_Vid->ext_in_range))
+    mvd_rewrite_release(currSlice);
+
   if (currSlice->active_pps->entropy_coding_mode_flag)
   {
     init_contexts  (currSlice);
@@ -745,9 +775,17 @@ void decode_slice(Slice *currSlice, int current_header)
   //printf("frame picture %d %d %d\n",currSlice->structure,currSlice->ThisPOC,currSlice->direct_spatial_mv_pred_flag);
 
   // decode main slice information
-  if ((current_header == SOP || current_header == SOS) && currSlice->ei_flag == 0)
+  if (parse)
+  {
+    if (currSlice->mvd_rw_nalu)
+      mvd_rewrite_start(currSlice);
+
     decode_one_slice(currSlice);
 
+    if (currSlice->mvd_rw_nalu)
+      mvd_rewrite_finish(currSlice);
+  }
+
   // setMB-Nr in case this slice was lost
   // if(currSlice->ei_flag)
   //   p_Vid->current_mb_nr = currSlice->last_mb_nr + 1;
@@ -952,6 +990,10 @@ int decode_one_frame(DecoderParams *pDecoder)
     p_Vid->num_dec_mb += currSlice->num_dec_mb;
     p_Vid->erc_mvperMB += currSlice->erc_mvperMB;
   }
+
+  // a picture outside ExtractFrmRng that was not parsed still completes (extraction only)
+  if (!p_Vid->ext_in_range && !p_Inp->iFullDecode)
+    p_Vid->num_dec_mb = p_Vid->PicSizeInMbs;
 	
 #if MVC_EXTENSION_ENABLE
   p_Vid->last_dec_view_id = p_Vid->dec_picture->view_id;
@@ -964,6 +1006,11 @@ int decode_one_frame(DecoderParams *pDecoder)
     p_Vid->last_dec_poc = p_Vid->dec_picture->bottom_poc;
   exit_picture(p_Vid, &p_Vid->dec_picture);
   p_Vid->previous_frame_num = ppSliceList[0]->frame_num;
+
+  // nothing is left to extract after the last frame of ExtractFrmRng (and its second field)
+  if (!p_Inp->iFullDecode && p_Vid->ext_frame_ctr >= frame_range_set_last(&p_Vid->ext_frm_rng)
+    && ppSliceList[0]->p_Dpb->last_picture == NULL)
+    p_Vid->ext_done = 1;
 	
   return (iRet);	//current_header
 }
@@ -1078,29 +1125,6 @@ void buffer2img (imgpel** imgX, unsigned char* buf, int size_x, int size_y, int
 }
 
 
-/*!
- ***********************************************************************
- * \brief
- *    compute generic SSE
- ***********************************************************************
- */
-int64 compute_SSE(imgpel **imgRef, imgpel **imgSrc, int xRef, int xSrc, int ySize, int xSize)
-{
-  int i, j;
-  imgpel *lineRef, *lineSrc;
-  int64 distortion = 0;
-
-  for (j = 0; j < ySize; j++)
-  {
-    lineRef = &imgRef[j][xRef];    
-    lineSrc = &imgSrc[j][xSrc];
-
-    for (i = 0; i < xSize; i++)
-      distortion += iabs2( *lineRef++ - *lineSrc++ );
-  }
-  return distortion;
-}
-
 /*!
  ************************************************************************
  * \brief
@@ -1123,11 +1147,90 @@ void calculate_frame_no(VideoParameters *p_Vid, StorablePicture *p)
 }
 
 
+/*!
+************************************************************************
+* \brief
+*    Reads frame frame_no of the reference file into buf.
+* \return
+*    number of bytes read, -1 if the frame could not be seeked to
+************************************************************************
+*/
+static int64 read_ref_frame(int p_ref, unsigned char *buf, int frame_no, int64 framesize_in_bytes)
+{
+  int64 bytes = 0;
+  int ret;
+
+  if (lseek (p_ref, framesize_in_bytes * frame_no, SEEK_SET) == -1)
+    return -1;
+
+  while (bytes < framesize_in_bytes)
+  {
+    ret = read(p_ref, buf + bytes, (unsigned int) (framesize_in_bytes - bytes));
+    if (ret <= 0)
+      break;
+    bytes += ret;
+  }
+  return bytes;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Body of the reference file prefetch thread: reads frame
+*    ref_frame_no[ref_next] into ref_buf[ref_next].
+************************************************************************
+*/
+static void ref_prefetch_thread(void *arg)
+{
+  SNRParameters *snr = (SNRParameters *) arg;
+  int k = snr->ref_next;
+
+  snr->ref_bytes[k] = read_ref_frame(snr->ref_file, snr->ref_buf[k], snr->ref_frame_no[k], snr->ref_buf_size);
+}
+
+/*!
+************************************************************************
+* \brief
+*    Waits for the reference file prefetch thread started by find_snr()
+*    to finish. Must be called before the reference file is closed.
+************************************************************************
+*/
+void wait_ref_prefetch(SNRParameters *snr)
+{
+  if (snr != NULL && snr->ref_prefetching)
+  {
+    thread_join(snr->ref_thread);
+    snr->ref_prefetching = 0;
+  }
+}
+
+/*!
+************************************************************************
+* \brief
+*    Converts rows [y0, y1) of a reference file plane and returns their
+*    SSE against the decoded plane.
+************************************************************************
+*/
+static int64 ref_rows_sse(imgpel **imgRef, imgpel **imgSrc, unsigned char *buf, int y0, int y1, int size_x, int symbol_size_in_bytes)
+{
+  if (y1 <= y0)
+    return 0;
+
+  buffer2img(&imgRef[y0], buf + (int64) y0 * size_x * symbol_size_in_bytes, size_x, y1 - y0, symbol_size_in_bytes);
+  return compute_SSE(&imgRef[y0], &imgSrc[y0], 0, 0, y1 - y0, size_x);
+}
+
 /*!
 ************************************************************************
 * \brief
 *    Find PSNR for all three components.Compare decoded frame with
 *    the original sequence. Read p_Inp->jumpd frames to reflect frame skipping.
+*
+*    The reference frames are double buffered: while the SSE of the
+*    current frame is computed and the next pictures are decoded, a
+*    helper thread reads the next frame of the reference file into the
+*    other buffer. With OPENMP the SSE of the two luma halves and of the
+*    chroma planes is computed concurrently.
 * \param p_Vid
 *      video encoding parameters for current picture
 * \param p
@@ -1144,12 +1247,16 @@ void find_snr(VideoParameters *p_Vid,
   SNRParameters   *snr   = p_Vid->snr;
 
   int k;
-  int ret;
   int64 diff_comp[3] = {0};
-  int64  status;
+  int64 diff_luma_bottom = 0;
   int symbol_size_in_bytes = (p_Vid->pic_unit_bitsize_on_disk >> 3);
   int comp_size_x[3], comp_size_y[3];
+  int64 comp_offset[3];
   int64 framesize_in_bytes;
+  int num_comp = (p->chroma_format_idc != YUV400) ? 3 : 1;
+  int num_valid, luma_half;
+  int frame_no = p_Vid->frame_no;
+  int cur, nxt;
 
   unsigned int max_pix_value_sqd[3];
 
@@ -1160,6 +1267,9 @@ void find_snr(VideoParameters *p_Vid,
   // picture error concealment
   char yuv_types[4][6]= {"4:0:0","4:2:0","4:2:2","4:4:4"};
 
+  // the buffers and the file are only used again once the prefetch thread is done
+  wait_ref_prefetch(snr);
+
   max_pix_value_sqd[0] = iabs2(p_Vid->max_pel_value_comp[0]);
   max_pix_value_sqd[1] = iabs2(p_Vid->max_pel_value_comp[1]);
   max_pix_value_sqd[2] = iabs2(p_Vid->max_pel_value_comp[2]);
@@ -1179,45 +1289,87 @@ void find_snr(VideoParameters *p_Vid,
 
   framesize_in_bytes = (((int64) comp_size_x[0] * comp_size_y[0]) + ((int64) comp_size_x[1] * comp_size_y[1] ) * 2) * symbol_size_in_bytes;
 
-  // KS: this buffer should actually be allocated only once, but this is still much faster than the previous version
-  buf = malloc ( comp_size_x[0] * comp_size_y[0] * symbol_size_in_bytes );
+  // position of the components within a frame of the reference file (RGB files are stored as G, B, R)
+  comp_offset[0] = rgb_output ? framesize_in_bytes / 3 : 0;
+  comp_offset[1] = comp_offset[0] + (int64) comp_size_x[0] * comp_size_y[0] * symbol_size_in_bytes;
+  comp_offset[2] = rgb_output ? 0 : comp_offset[1] + (int64) comp_size_x[1] * comp_size_y[1] * symbol_size_in_bytes;
+
+  if (snr->ref_buf_size != framesize_in_bytes)
+  {
+    for (k = 0; k < 2; ++k)
+    {
+      free (snr->ref_buf[k]);
+      if ((snr->ref_buf[k] = malloc ((size_t) framesize_in_bytes)) == NULL)
+        no_mem_exit("find_snr: ref_buf");
+      snr->ref_frame_no[k] = -1;
+    }
+    snr->ref_buf_size = framesize_in_bytes;
+  }
 
-  if (NULL == buf)
+  // use the prefetched frame if there is one, read it otherwise
+  if (snr->ref_frame_no[0] == frame_no)
+    cur = 0;
+  else if (snr->ref_frame_no[1] == frame_no)
+    cur = 1;
+  else
   {
-    no_mem_exit("find_snr: buf");
+    cur = 0;
+    snr->ref_bytes[cur] = read_ref_frame(*p_ref, snr->ref_buf[cur], frame_no, framesize_in_bytes);
+    snr->ref_frame_no[cur] = frame_no;
   }
+  nxt = 1 - cur;
+  buf = snr->ref_buf[cur];
 
-  status = lseek (*p_ref, framesize_in_bytes * p_Vid->frame_no, SEEK_SET);
-  if (status == -1)
+  if (snr->ref_bytes[cur] == -1)
   {
-    fprintf(stderr, "Warning: Could not seek to frame number %d in reference file. Shown PSNR might be wrong.\n", p_Vid->frame_no);
-    free (buf);
+    fprintf(stderr, "Warning: Could not seek to frame number %d in reference file. Shown PSNR might be wrong.\n", frame_no);
+    snr->ref_frame_no[cur] = -1;
     return;
   }
 
-  if(rgb_output)
-    lseek (*p_ref, framesize_in_bytes/3, SEEK_CUR);
-
-  for (k = 0; k < ((p->chroma_format_idc != YUV400) ? 3 : 1); ++k)
+  for (num_valid = 0; num_valid < num_comp; ++num_valid)
   {
+    if (comp_offset[num_valid] + (int64) comp_size_x[num_valid] * comp_size_y[num_valid] * symbol_size_in_bytes > snr->ref_bytes[cur])
+      break;
+  }
 
-    if(rgb_output && k == 2)
-      lseek (*p_ref, -framesize_in_bytes, SEEK_CUR);
+  // only prefetch while the reference file has not ended
+  if ((num_valid == num_comp) && (snr->ref_frame_no[nxt] != frame_no + 1))
+  {
+    snr->ref_frame_no[nxt] = frame_no + 1;
+    snr->ref_next = nxt;
+    snr->ref_file = *p_ref;
+    snr->ref_prefetching = 1;
+    thread_create(&snr->ref_thread, ref_prefetch_thread, snr);
+  }
+  luma_half = num_valid > 0 ? comp_size_y[0] >> 1 : 0;
 
-    ret = read(*p_ref, buf, comp_size_x[k] * comp_size_y[k] * symbol_size_in_bytes);
-    if (ret != comp_size_x[k] * comp_size_y[k] * symbol_size_in_bytes)
+#if defined(OPENMP)
+#pragma omp parallel sections
+#endif
+  {
+#if defined(OPENMP)
+#pragma omp section
+#endif
+    diff_comp[0] = ref_rows_sse(cur_ref[0], cur_comp[0], buf + comp_offset[0], 0, luma_half, comp_size_x[0], symbol_size_in_bytes);
+#if defined(OPENMP)
+#pragma omp section
+#endif
+    if (num_valid > 0)
+      diff_luma_bottom = ref_rows_sse(cur_ref[0], cur_comp[0], buf + comp_offset[0], luma_half, comp_size_y[0], comp_size_x[0], symbol_size_in_bytes);
+#if defined(OPENMP)
+#pragma omp section
+#endif
     {
-      printf ("Warning: could not read from reconstructed file\n");
-      fast_memset (buf, 0, comp_size_x[k] * comp_size_y[k] * symbol_size_in_bytes);
-      close(*p_ref);
-      *p_ref = -1;
-      break;
+      int uv;
+      for (uv = 1; uv < num_valid; ++uv)
+        diff_comp[uv] = ref_rows_sse(cur_ref[uv], cur_comp[uv], buf + comp_offset[uv], 0, comp_size_y[uv], comp_size_x[uv], symbol_size_in_bytes);
     }
-    buffer2img(cur_ref[k], buf, comp_size_x[k], comp_size_y[k], symbol_size_in_bytes);
-
-    // Compute SSE
-    diff_comp[k] = compute_SSE(cur_ref[k], cur_comp[k], 0, 0, comp_size_y[k], comp_size_x[k]);
+  }
+  diff_comp[0] += diff_luma_bottom;
 
+  for (k = 0; k < num_valid; ++k)
+  {
     // Collecting SNR statistics
     snr->snr[k] = psnr( max_pix_value_sqd[k], comp_size_x[k] * comp_size_y[k], (float) diff_comp[k]);   
 
@@ -1231,10 +1383,12 @@ void find_snr(VideoParameters *p_Vid,
     }
   }
 
-  if(rgb_output)
-    lseek (*p_ref, framesize_in_bytes * 2 / 3, SEEK_CUR);
-
-  free (buf);
+  if (num_valid < num_comp)
+  {
+    printf ("Warning: could not read from reconstructed file\n");
+    close(*p_ref);
+    *p_ref = -1;
+  }
 
   // picture error concealment
   if(p->concealed_pic)
@@ -1507,6 +1661,7 @@ process_nalu:
       // the parameter set ID of the SLice header.  Hence, read the pic_parameter_set_id
       // of the slice header first, then setup the active parameter sets, and then read
       // the rest of the slice header
+      PROF_PUSH(p_Vid, PROF_SLICE_HEADER);
       //ͷ﷨
       BitsUsedByHeader = FirstPartOfSliceHeader(currSlice);  //ȡͷ﷨Ԫ(first_mb_in_slice~pps_id)
       UseParameterSet (currSlice);	//ò
@@ -1516,6 +1671,7 @@ process_nalu:
       currSlice->chroma444_not_separate = (p_Vid->active_sps->chroma_format_idc==YUV444)&&((p_Vid->separate_colour_plane_flag == 0));
 
       BitsUsedByHeader = RestOfSliceHeader (currSlice);	//BitsUsedByHeaderslice_header﷨Ԫصλ
+      PROF_POP(p_Vid);
 
 			/* record slice_header used bits *///p_Dec->cur_nal_start_pos+1+BitsUsedByHeader/8ʼΪǰĵһ
 #if (MVC_EXTENSION_ENABLE)
@@ -1565,6 +1721,9 @@ process_nalu:
         arideco_start_decoding (&currSlice->partArr[0].de_cabac, currStream->streamBuffer, ByteStartPosition, &currStream->read_len);
       }
 
+      if (p_Vid->p_mvd_rw)
+        mvd_rewrite_attach(currSlice);
+
       //FreeNALU(nalu);
       p_Vid->recovery_point = 0;
 
@@ -1599,6 +1758,7 @@ process_nalu:
       currSlice->anchor_pic_flag = currSlice->idr_flag;
 #endif
 
+      PROF_PUSH(p_Vid, PROF_SLICE_HEADER);
       BitsUsedByHeader = FirstPartOfSliceHeader(currSlice);
       UseParameterSet (currSlice);
       currSlice->active_sps = p_Vid->active_sps;
@@ -1607,6 +1767,7 @@ process_nalu:
       currSlice->chroma444_not_separate = (p_Vid->active_sps->chroma_format_idc==YUV444)&&((p_Vid->separate_colour_plane_flag == 0));
 
       BitsUsedByHeader += RestOfSliceHeader (currSlice);
+      PROF_POP(p_Vid);
 #if MVC_EXTENSION_ENABLE
       currSlice->p_Dpb = p_Vid->p_Dpb_layer[currSlice->view_id];
 #endif
@@ -1964,6 +2125,11 @@ void exit_picture(VideoParameters *p_Vid, StorablePicture **dec_picture)
       p_Vid->ppSliceList[0]->colour_plane_id = colour_plane_id;
       make_frame_picture_JV(p_Vid);
     }
+    else if (p_Vid->iDeblockRowsDone > 0)
+    {
+      // rows already filtered in the MB loop; finish the remaining ones
+      DeblockMbRows( p_Vid, *dec_picture, p_Vid->iDeblockRowsDone, (*dec_picture)->PicSizeInMbs / (*dec_picture)->PicWidthInMbs );
+    }
     else
     {
       DeblockPicture( p_Vid, *dec_picture );
@@ -2000,11 +2166,16 @@ void exit_picture(VideoParameters *p_Vid, StorablePicture **dec_picture)
   is_idr     = (*dec_picture)->idr_flag;
 
   chroma_format_idc = (*dec_picture)->chroma_format_idc;
+  PROF_PUSH(p_Vid, PROF_DPB);
 #if MVC_EXTENSION_ENABLE
   store_picture_in_dpb(p_Vid->p_Dpb_layer[(*dec_picture)->view_id], *dec_picture);
 #else
   store_picture_in_dpb(p_Vid->p_Dpb_layer[0], *dec_picture);
 #endif
+  PROF_POP(p_Vid);
+#if (ENABLE_DEC_PROFILE)
+  dec_prof_picture(p_Vid, frame_poc, slice_type, structure);
+#endif
 
   *dec_picture=NULL;
 
@@ -2469,7 +2640,51 @@ static void init_cur_imgy(Slice *currSlice, VideoParameters *p_Vid)
   }
 }
 
+/*!
+ ************************************************************************
+ * \brief
+ *    stores the parsed coding decisions of a macroblock in the
+ *    macroblock info file (MBInfoFile)
+ ************************************************************************
+ */
+static void write_mb_info_record(Macroblock *currMB)
+{
+  Slice *currSlice = currMB->p_Slice;
+  PicMotionParams **mv_info = currSlice->dec_picture->mv_info;
+  MBInfoRecord rec;
+  int i, j, list, blk;
+
+  memset(&rec, 0, sizeof(MBInfoRecord));
+  rec.poc           = currSlice->ThisPOC;
+  rec.mb_addr       = currMB->mbAddrX;
+  rec.mb_type       = currMB->mb_type;
+  rec.cbp           = (short) currMB->cbp;
+  rec.slice_type    = (char) currSlice->slice_type;
+  rec.qp            = (char) currMB->qp;
+  rec.transform_8x8 = (char) currMB->luma_transform_size_8x8_flag;
+  rec.i16mode       = (char) currMB->i16mode;
+  rec.c_ipred_mode  = currMB->c_ipred_mode;
+  memcpy(rec.b8mode, currMB->b8mode, 4 * sizeof(char));
+  memcpy(rec.b8pdir, currMB->b8pdir, 4 * sizeof(char));
+
+  for (j = 0; j < BLOCK_SIZE; j++)
+  {
+    for (i = 0; i < BLOCK_SIZE; i++)
+    {
+      PicMotionParams *mv = &mv_info[currMB->block_y + j][currMB->block_x + i];
+      blk = j * BLOCK_SIZE + i;
+      rec.ipredmode[blk] = currSlice->ipredmode[currMB->block_y + j][currMB->block_x + i];
+      for (list = LIST_0; list <= LIST_1; list++)
+      {
+        rec.ref_idx[list][blk] = mv->ref_idx[list];
+        rec.mv[list][blk][0]   = mv->mv[list].mv_x;
+        rec.mv[list][blk][1]   = mv->mv[list].mv_y;
+      }
+    }
+  }
 
+  write_mb_info(currSlice->p_Vid->p_mb_info, &rec);
+}
 
 /*!
  ************************************************************************
@@ -2535,7 +2750,15 @@ void decode_one_slice(Slice *currSlice)
     //ؽ룺͡ԤģʽMVDCBP
     //в
     //read_one_macroblock_i_slice_cabac read_one_macroblock_i_slice_cavlc 
+    PROF_PUSH(p_Vid, PROF_ENTROPY);
     currSlice->read_one_macroblock(currMB);
+    PROF_POP(p_Vid);
+
+    // the motion of B_Skip / B_Direct_16x16 macroblocks is only derived when they are predicted;
+    // without reconstruction it is derived here, for the motion vector prediction of the next
+    // macroblocks, the co-located motion of later pictures and the macroblock info file
+    if (!p_Vid->p_Inp->iFullDecode && currSlice->slice_type == B_SLICE && currMB->mb_type == 0)
+      currSlice->update_direct_mv_info(currMB);
     
     switch(currMB->mb_type)
     {
@@ -2564,9 +2787,15 @@ void decode_one_slice(Slice *currSlice)
     
     mbNumber++; 
 
-	#if 0
-   //任˶任˶ع
-   decode_one_macroblock(currMB, currSlice->dec_picture);
+    // pixel reconstruction is skipped in extraction-only mode (FullDecode = 0)
+    if (p_Vid->p_Inp->iFullDecode)
+    {
+      //任˶任˶ع
+      decode_one_macroblock(currMB, currSlice->dec_picture);
+    }
+
+    if (p_Vid->p_mb_info)
+      write_mb_info_record(currMB);
 
     if(currSlice->mb_aff_frame_flag && currMB->mb_field)
     {
@@ -2576,9 +2805,12 @@ void decode_one_slice(Slice *currSlice)
 
 #if (DISABLE_ERC == 0)
     //д8*8Ԥģʽ˶ر
-    ercWriteMBMODEandMV(currMB);
+    if (p_Vid->p_Inp->iFullDecode)
+      ercWriteMBMODEandMV(currMB);
 #endif
-	#endif
+
+    if (p_Vid->bRowDeblock)
+      DeblockRowDelayed(p_Vid, currSlice->dec_picture, currMB->mbAddrX);
 	
 	//ÿһ飬ú,жǷһ
     end_of_slice = exit_macroblock(currSlice, (!currSlice->mb_aff_frame_flag|| currSlice->current_mb_nr%2));
@@ -0,0 +1,202 @@
+/*!
+ *************************************************************************************
+ * \file img_distortion.c
+ *
+ * \brief
+ *    Sum of squared errors of two pictures (find_snr()).
+ *
+ *    A portable C kernel is always available. On x86 CPUs SSE4.1 and AVX2
+ *    versions are selected at run time (see init_distortion_kernels()).
+ *    All kernels return exactly the same sums.
+ *
+ *************************************************************************************
+ */
+#include "contributors.h"
+
+#include "global.h"
+#include "img_distortion.h"
+
+#if (JM_SIMD_DISTORTION) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#  define SIMD_X86      1
+#  define TARGET_SSE41  __attribute__((target("sse4.1")))
+#  define TARGET_AVX2   __attribute__((target("avx2")))
+#elif (JM_SIMD_DISTORTION) && defined(_MSC_VER) && (_MSC_VER >= 1700) && (defined(_M_X64) || defined(_M_IX86))
+#  define SIMD_X86      1
+#  define TARGET_SSE41
+#  define TARGET_AVX2
+#else
+#  define SIMD_X86      0
+#endif
+
+#if (SIMD_X86)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+//! SSE of one line of width samples
+static int64 (*line_sse) (imgpel *ref, imgpel *src, int width);
+
+static int64 line_sse_c (imgpel *ref, imgpel *src, int width)
+{
+  int64 distortion = 0;
+  int i;
+
+  for (i = 0; i < width; i++)
+    distortion += iabs2( ref[i] - src[i] );
+  return distortion;
+}
+
+#if (SIMD_X86)
+/*
+ * x86 kernels
+ *
+ * Samples are processed as 16 bit integers for both 8 bit (IMGTYPE 0) and
+ * 16 bit imgpel. With at most 14 bits per sample the differences fit into
+ * 16 bits and the sum of two squared differences into 32 bits; the sums
+ * are accumulated in 64 bit lanes, so any picture width is exact.
+ */
+
+#if (IMGTYPE == 0)
+static inline TARGET_SSE41 __m128i load_pel8 (imgpel *p)
+{
+  return _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i *) p));
+}
+
+static inline TARGET_AVX2 __m256i load_pel16 (imgpel *p)
+{
+  return _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) p));
+}
+#else
+static inline TARGET_SSE41 __m128i load_pel8 (imgpel *p)
+{
+  return _mm_loadu_si128((__m128i *) p);
+}
+
+static inline TARGET_AVX2 __m256i load_pel16 (imgpel *p)
+{
+  return _mm256_loadu_si256((__m256i *) p);
+}
+#endif
+
+static inline TARGET_SSE41 int64 hsum_epi64 (__m128i v)
+{
+  int64 sum[2];
+
+  _mm_storeu_si128((__m128i *) sum, v);
+  return sum[0] + sum[1];
+}
+
+static TARGET_SSE41 int64 line_sse_sse41 (imgpel *ref, imgpel *src, int width)
+{
+  __m128i acc = _mm_setzero_si128();
+  int x;
+
+  for (x = 0; x + 8 <= width; x += 8)
+  {
+    __m128i d  = _mm_sub_epi16(load_pel8(ref + x), load_pel8(src + x));
+    __m128i sq = _mm_madd_epi16(d, d);
+
+    acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(sq));
+    acc = _mm_add_epi64(acc, _mm_cvtepu32_epi64(_mm_srli_si128(sq, 8)));
+  }
+  return hsum_epi64(acc) + line_sse_c(ref + x, src + x, width - x);
+}
+
+static TARGET_AVX2 int64 line_sse_avx2 (imgpel *ref, imgpel *src, int width)
+{
+  __m256i acc = _mm256_setzero_si256();
+  int x;
+
+  for (x = 0; x + 16 <= width; x += 16)
+  {
+    __m256i d  = _mm256_sub_epi16(load_pel16(ref + x), load_pel16(src + x));
+    __m256i sq = _mm256_madd_epi16(d, d);
+
+    acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(sq)));
+    acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(sq, 1)));
+  }
+  return hsum_epi64(_mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)))
+    + line_sse_sse41(ref + x, src + x, width - x);
+}
+
+/*!
+***********************************************************************
+* \brief
+*    Returns the instruction set extensions supported by the CPU
+*    (SIMD_NONE, SIMD_SSE41 or SIMD_AVX2)
+***********************************************************************
+*/
+static int get_simd_level (void)
+{
+#if defined(_MSC_VER)
+  int info[4];
+  int max_id;
+
+  __cpuid(info, 0);
+  max_id = info[0];
+  __cpuid(info, 1);
+  if (!(info[2] & (1 << 19)))
+    return SIMD_NONE;
+  // AVX2 also requires the OS to save the YMM registers (OSXSAVE, AVX and XCR0 bits 1 and 2)
+  if (max_id >= 7 && (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 0x06) == 0x06))
+  {
+    __cpuidex(info, 7, 0);
+    if (info[1] & (1 << 5))
+      return SIMD_AVX2;
+  }
+  return SIMD_SSE41;
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return SIMD_AVX2;
+  if (__builtin_cpu_supports("sse4.1"))
+    return SIMD_SSE41;
+  return SIMD_NONE;
+#endif
+}
+#endif
+
+/*!
+***********************************************************************
+* \brief
+*    Selects the fastest SSE kernel supported by the CPU.
+*    Returns the selected level.
+***********************************************************************
+*/
+int init_distortion_kernels (void)
+{
+  int level = SIMD_NONE;
+
+  line_sse = line_sse_c;
+
+#if (SIMD_X86)
+  level = get_simd_level();
+
+  if (level >= SIMD_SSE41)
+    line_sse = line_sse_sse41;
+  if (level >= SIMD_AVX2)
+    line_sse = line_sse_avx2;
+#endif
+
+  return level;
+}
+
+/*!
+ ***********************************************************************
+ * \brief
+ *    compute generic SSE
+ ***********************************************************************
+ */
+int64 compute_SSE(imgpel **imgRef, imgpel **imgSrc, int xRef, int xSrc, int ySize, int xSize)
+{
+  int j;
+  int64 distortion = 0;
+
+  for (j = 0; j < ySize; j++)
+    distortion += line_sse(&imgRef[j][xRef], &imgSrc[j][xSrc], xSize);
+
+  return distortion;
+}
@@ -69,6 +69,10 @@
 #include "output.h"
 #include "h264decoder.h"
 #include "dec_statistics.h"
+#include "dec_profile.h"
+#include "io_mbinfo.h"
+#include "mvd_rewrite.h"
+#include "img_distortion.h"
 
 #define LOGFILE     "log.dec"
 #define DATADECFILE "dataDec.txt"
@@ -256,6 +260,8 @@ static void free_img( VideoParameters *p_Vid)
     }    
     if (p_Vid->snr != NULL)
     {
+      free (p_Vid->snr->ref_buf[0]);
+      free (p_Vid->snr->ref_buf[1]);
       free (p_Vid->snr);
       p_Vid->snr = NULL;
     }
@@ -1134,6 +1140,7 @@ int OpenDecoder(InputParameters *p_Inp)
     return (iRet|DEC_ERRMASK);
   }
   init_time();
+  init_distortion_kernels();
 
   pDecoder = p_Dec;
   //Configure (pDecoder->p_Vid, pDecoder->p_Inp, argc, argv);
@@ -1224,6 +1231,15 @@ int OpenDecoder(InputParameters *p_Inp)
  
   init_out_buffer(pDecoder->p_Vid);
 
+  init_dec_profile(pDecoder->p_Vid, pDecoder->p_Inp);
+
+  pDecoder->p_Vid->p_mb_info = (strlen(pDecoder->p_Inp->MBInfoFile) > 0) ? open_mb_info_file(pDecoder->p_Inp->MBInfoFile, 1) : NULL;
+  init_mvd_rewrite(pDecoder->p_Vid, pDecoder->p_Inp);
+  parse_frame_range_set(&pDecoder->p_Vid->ext_frm_rng, pDecoder->p_Inp->ExtractFrmRng);
+  pDecoder->p_Vid->ext_frame_ctr = -1;
+  pDecoder->p_Vid->ext_in_range  = 1;
+  pDecoder->p_Vid->ext_done      = 0;
+
 #if (MVC_EXTENSION_ENABLE)
   pDecoder->p_Vid->active_sps = NULL;
   pDecoder->p_Vid->active_subset_sps = NULL;
@@ -1303,6 +1319,10 @@ int CloseDecoder()
     return DEC_CLOSE_NOERR;
   
   Report  (pDecoder->p_Vid);
+  free_dec_profile(pDecoder->p_Vid);
+  close_mb_info_file(pDecoder->p_Vid->p_mb_info);
+  free_mvd_rewrite(pDecoder->p_Vid);
+  free_frame_range_set(&pDecoder->p_Vid->ext_frm_rng);
   FmoFinit(pDecoder->p_Vid);
   free_layer_buffers(pDecoder->p_Vid, 0);
   free_layer_buffers(pDecoder->p_Vid, 1);
@@ -1331,6 +1351,7 @@ int CloseDecoder()
     close(pDecoder->p_Vid->p_out);
 #endif
 
+  wait_ref_prefetch(pDecoder->p_Vid->snr);
   if (pDecoder->p_Vid->p_ref != -1)
     close(pDecoder->p_Vid->p_ref);
 
@@ -25,6 +25,7 @@
 #include "mb_access.h"
 #include "loopfilter.h"
 #include "loop_filter.h"
+#include "dec_profile.h"
 
 static void DeblockMb      (VideoParameters *p_Vid, StorablePicture *p, int MbQAddr);
 static void perform_db     (VideoParameters *p_Vid, StorablePicture *p, int MbQAddr);
@@ -46,6 +47,7 @@ extern void get_strength_hor_MBAff     (byte *Strength, Macroblock *MbQ, int edg
 void DeblockPicture(VideoParameters *p_Vid, StorablePicture *p)
 {
   unsigned i;
+  PROF_PUSH(p_Vid, PROF_DEBLOCK);
   if (p->mb_aff_frame_flag)
   {
     for (i = 0; i < p->PicSizeInMbs; ++i)
@@ -67,6 +69,7 @@ void DeblockPicture(VideoParameters *p_Vid, StorablePicture *p)
     }
     
   }
+  PROF_POP(p_Vid);
 }
 #else
 static void DeblockParallel(VideoParameters *p_Vid, StorablePicture *p, unsigned int column, int block, int n_last)
@@ -95,6 +98,9 @@ void DeblockPicture(VideoParameters *p_Vid, StorablePicture *p)
 
 #if defined(OPENMP)
   int j;
+#endif
+  PROF_PUSH(p_Vid, PROF_DEBLOCK);
+#if defined(OPENMP)
     #pragma omp parallel for
 #endif
   for (j = 0; j < p->PicSizeInMbs; ++j)
@@ -114,9 +120,63 @@ void DeblockPicture(VideoParameters *p_Vid, StorablePicture *p)
     for (nn = n_start; nn < n_last; nn += GROUP_SIZE)
       DeblockParallel(p_Vid, p, i, nn, n_last);
   }
+  PROF_POP(p_Vid);
 }
 #endif
 
+/*!
+ *****************************************************************************************
+ * \brief
+ *    Filter the macroblock rows [start_row, end_row) of a non-MBAFF picture.
+ *****************************************************************************************
+ */
+void DeblockMbRows(VideoParameters *p_Vid, StorablePicture *p, int start_row, int end_row)
+{
+  int i;
+  int first_mb = start_row * p->PicWidthInMbs;
+  int last_mb  = end_row   * p->PicWidthInMbs;
+
+  PROF_PUSH(p_Vid, PROF_DEBLOCK);
+  for (i = first_mb; i < last_mb; ++i)
+  {
+    get_db_strength( p_Vid, p, i ) ;
+  }
+  for (i = first_mb; i < last_mb; ++i)
+  {
+    perform_db( p_Vid, p, i ) ;
+  }
+  PROF_POP(p_Vid);
+  p_Vid->iDeblockRowsDone = end_row;
+}
+
+/*!
+ *****************************************************************************************
+ * \brief
+ *    Row-delayed deblocking, called after macroblock MbAddr has been decoded.
+ *    Once MB row N is complete, row N-1 is filtered while its samples are still
+ *    cache resident. Row N-1 can not be filtered earlier since intra prediction
+ *    of row N uses its unfiltered samples. Any MB decoded out of raster order
+ *    (lost slices, ASO) stops the row mode; the remaining rows are then left to
+ *    exit_picture().
+ *****************************************************************************************
+ */
+void DeblockRowDelayed(VideoParameters *p_Vid, StorablePicture *p, int MbAddr)
+{
+  if (MbAddr != p_Vid->iDeblockNextMb)
+  {
+    p_Vid->bRowDeblock = 0;
+    return;
+  }
+
+  ++p_Vid->iDeblockNextMb;
+  if ((p_Vid->iDeblockNextMb % p->PicWidthInMbs) == 0)
+  {
+    int row = p_Vid->iDeblockNextMb / p->PicWidthInMbs - 1;
+    if (row > 0)
+      DeblockMbRows(p_Vid, p, row - 1, row);
+  }
+}
+
 // likely already set - see testing via asserts
 static void init_neighbors(VideoParameters *p_Vid)
 {
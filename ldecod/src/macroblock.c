@@ -44,6 +44,7 @@
 #include "mb_prediction.h"
 #include "fast_memory.h"
 #include "filehandle.h"
+#include "mvd_rewrite.h"
 
 
 #if TRACE
@@ -527,7 +528,7 @@ void analysis_bitoffset(int* bitoffset, int* byteoffset)
 
 void write_mvd2keyfile(int offset, int len, int mvd)
 {
-	if(g_encrypt_fileh)
+	if(g_encrypt_fileh && p_Dec->p_Vid->ext_in_range)
 	{
 		int ByteOffset = 0;		
 		int BitOffset = offset;
@@ -602,6 +603,9 @@ static void readMBMotionVectors (SyntaxElement *currSE, DataPartition *dP, Macro
       curr_mvd[1] = (short) currSE->value1;              
 
 		write_mvd2keyfile(dP->bitstream->frame_bitoffset-currSE->len, currSE->len,curr_mvd[1]);			
+
+      if (currMB->p_Slice->mvd_rw_nalu)
+        mvd_rewrite_pair(currMB->p_Slice, dP->bitstream, offset, curr_mvd);
 		
 		curr_mv.mv_x = (short)(curr_mvd[0] + pred_mv.mv_x);  // compute motion vector x
 		curr_mv.mv_y = (short)(curr_mvd[1] + pred_mv.mv_y);  // compute motion vector y            
@@ -642,7 +646,7 @@ static void readMBMotionVectors (SyntaxElement *currSE, DataPartition *dP, Macro
     PicMotionParams **mv_info = currMB->p_Slice->dec_picture->mv_info;
     PixelPos block[4]; // neighbor blocks
 
-    int i, j, i0, j0, kk, k;
+    int i, j, i0, j0, kk, k, bit_start;
     for (j0=0; j0<4; j0+=step_v0)
     {
       for (i0=0; i0<4; i0+=step_h0)
@@ -674,6 +678,7 @@ static void readMBMotionVectors (SyntaxElement *currSE, DataPartition *dP, Macro
               // first get MV predictor
               currMB->GetMVPredictor (currMB, block, &pred_mv, cur_ref_idx, mv_info, list, BLOCK_SIZE * i, BLOCK_SIZE * j, step_h4, step_v4);
 
+              bit_start = dP->bitstream->frame_bitoffset;
               for (k=0; k < 2; ++k)
               {
 #if TRACE
@@ -686,6 +691,9 @@ static void readMBMotionVectors (SyntaxElement *currSE, DataPartition *dP, Macro
 				write_mvd2keyfile(dP->bitstream->frame_bitoffset-currSE->len, currSE->len,curr_mvd[k]);
               }
 
+              if (currMB->p_Slice->mvd_rw_nalu)
+                mvd_rewrite_pair(currMB->p_Slice, dP->bitstream, bit_start, curr_mvd);
+
               curr_mv.mv_x = (short)(curr_mvd[0] + pred_mv.mv_x);  // compute motion vector 
               curr_mv.mv_y = (short)(curr_mvd[1] + pred_mv.mv_y);  // compute motion vector 
 
@@ -798,9 +806,7 @@ void start_macroblock(Slice *currSlice, Macroblock **currMB)
   (*currMB)->slice_nr = (short) currSlice->current_slice_nr;
 
   //жںĿ
-  #if 0
   CheckAvailabilityOfNeighbors(*currMB);
-  #endif
 
   // Select appropriate MV predictor function
   //Ϊmvdؽͼռ
@@ -34,6 +34,7 @@
 #include "intra16x16_pred.h"
 #include "mv_prediction.h"
 #include "mb_prediction.h"
+#include "dec_profile.h"
 
 extern int  get_colocated_info_8x8 (Macroblock *currMB, StorablePicture *list1, int i, int j);
 extern int  get_colocated_info_4x4 (Macroblock *currMB, StorablePicture *list1, int i, int j);
@@ -49,6 +50,7 @@ int mb_pred_intra4x4(Macroblock *currMB, ColorPlane curr_plane, imgpel **currImg
   int block8x8;   // needed for ABT
   currMB->itrans_4x4 = (currMB->is_lossless == FALSE) ? itrans4x4 : Inv_Residual_trans_4x4;    
 
+  PROF_PUSH(currMB->p_Vid, PROF_INTRA);
   for (block8x8 = 0; block8x8 < 4; block8x8++)
   {
     for (k = block8x8 * 4; k < block8x8 * 4 + 4; k ++)
@@ -66,7 +68,10 @@ int mb_pred_intra4x4(Macroblock *currMB, ColorPlane curr_plane, imgpel **currImg
       // PREDICTION
       //===== INTRA PREDICTION =====
       if (currSlice->intra_pred_4x4(currMB, curr_plane, ioff,joff,i4,j4) == SEARCH_SYNC)  /* make 4x4 prediction block mpr from given prediction p_Vid->mb_mode */
+      {
+        PROF_POP(currMB->p_Vid);
         return SEARCH_SYNC;                   /* bit error */
+      }
       // =============== 4x4 itrans ================
       // -------------------------------------------
       currMB->itrans_4x4  (currMB, curr_plane, ioff, joff);
@@ -83,6 +88,7 @@ int mb_pred_intra4x4(Macroblock *currMB, ColorPlane curr_plane, imgpel **currImg
 
   if (currMB->cbp != 0)
     currSlice->is_reset_coeff = FALSE;
+  PROF_POP(currMB->p_Vid);
   return 1;
 }
 
@@ -91,11 +97,14 @@ int mb_pred_intra16x16(Macroblock *currMB, ColorPlane curr_plane, StorablePictur
 {
   int yuv = dec_picture->chroma_format_idc - 1;
 
+  PROF_PUSH(currMB->p_Vid, PROF_INTRA);
   currMB->p_Slice->intra_pred_16x16(currMB, curr_plane, currMB->i16mode);
   currMB->ipmode_DPCM = (char) currMB->i16mode; //For residual DPCM
   // =============== 4x4 itrans ================
   // -------------------------------------------
+  PROF_PUSH(currMB->p_Vid, PROF_TRANSFORM);
   iMBtrans4x4(currMB, curr_plane, 0);
+  PROF_POP(currMB->p_Vid);
 
   // chroma decoding *******************************************************
   if ((dec_picture->chroma_format_idc != YUV400) && (dec_picture->chroma_format_idc != YUV444)) 
@@ -104,6 +113,7 @@ int mb_pred_intra16x16(Macroblock *currMB, ColorPlane curr_plane, StorablePictur
   }
 
   currMB->p_Slice->is_reset_coeff = FALSE;
+  PROF_POP(currMB->p_Vid);
   return 1;
 }
 
@@ -115,6 +125,7 @@ int mb_pred_intra8x8(Macroblock *currMB, ColorPlane curr_plane, imgpel **currImg
   int block8x8;   // needed for ABT
   currMB->itrans_8x8 = (currMB->is_lossless == FALSE) ? itrans8x8 : Inv_Residual_trans_8x8;
 
+  PROF_PUSH(currMB->p_Vid, PROF_INTRA);
   for (block8x8 = 0; block8x8 < 4; block8x8++)
   {
     //=========== 8x8 BLOCK TYPE ============
@@ -138,6 +149,7 @@ int mb_pred_intra8x8(Macroblock *currMB, ColorPlane curr_plane, imgpel **currImg
 
   if (currMB->cbp != 0)
     currSlice->is_reset_coeff = FALSE;
+  PROF_POP(currMB->p_Vid);
   return 1;
 }
 
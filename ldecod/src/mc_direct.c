@@ -27,9 +27,9 @@ static void update_direct_mv_info_temporal(Macroblock *currMB)
   VideoParameters *p_Vid = currMB->p_Vid;
   Slice *currSlice = currMB->p_Slice;
   int j,k;
-  int partmode        = ((currMB->mb_type == P8x8) ? 4 : currMB->mb_type);
-  int step_h0         = BLOCK_STEP [partmode][0];
-  int step_v0         = BLOCK_STEP [partmode][1];
+  // direct motion is derived per 8x8 block, also for B_Skip / B_Direct_16x16 (mb_type 0)
+  int step_h0         = BLOCK_STEP [4][0];
+  int step_v0         = BLOCK_STEP [4][1];
 
   int i0, j0, j6;
 
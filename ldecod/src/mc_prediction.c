@@ -22,6 +22,7 @@
 #include "macroblock.h"
 #include "memalloc.h"
 #include "dec_statistics.h"
+#include "dec_profile.h"
 
 int allocate_pred_mem(Slice *currSlice)
 {
@@ -904,7 +905,9 @@ void get_block_luma(StorablePicture *curr_ref, int x_pos, int y_pos, int block_s
 {
   if (curr_ref->no_ref) {
     //printf("list[ref_frame] is equal to 'no reference picture' before RAP\n");
-    memset(block[0],no_ref_value,block_size_y * block_size_x * sizeof(imgpel));
+    int j;
+    for (j = 0; j < block_size_y; j++)
+      memset(block[j],no_ref_value,block_size_x * sizeof(imgpel));
   }
   else
   {
@@ -1777,6 +1780,7 @@ void perform_mc(Macroblock *currMB, ColorPlane pl, StorablePicture *dec_picture,
 {
   Slice *currSlice = currMB->p_Slice;
   assert (pred_dir<=2);
+  PROF_PUSH(currMB->p_Vid, PROF_MC);
   if (pred_dir != 2)
   {
     if (currSlice->weighted_pred_flag)
@@ -1791,6 +1795,7 @@ void perform_mc(Macroblock *currMB, ColorPlane pl, StorablePicture *dec_picture,
     else
       perform_mc_bi(currMB, pl, dec_picture, i, j, block_size_x, block_size_y);
   }
+  PROF_POP(currMB->p_Vid);
 }
 
 
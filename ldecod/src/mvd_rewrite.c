@@ -0,0 +1,384 @@
+/*!
+ *************************************************************************************
+ * \file mvd_rewrite.c
+ *
+ * \brief
+ *    Bitstream domain MVD scrambling of CAVLC streams (MVDRewriteFile).
+ *
+ *    The slices are parsed with the regular syntax readers (FullDecode = 0
+ *    skips the reconstruction). Every mvd_l0/mvd_l1 pair gets the keyed
+ *    perturbation of the encoder (writeMotionVector8x8 with ExtractionOn = 1)
+ *    and is written again as se(v); all other bits of the slice, including
+ *    the slice header, are copied unchanged. The output is therefore the
+ *    stream the encoder would have produced with scrambling switched on,
+ *    without motion estimation, mode decision or reconstruction.
+ *
+ *    Non-slice NAL units, CABAC slices and data partitions are passed
+ *    through verbatim. NAL units are queued in read order, because all
+ *    slices of a picture (and possibly the following parameter sets) are
+ *    read before the slice data is parsed.
+ *
+ *************************************************************************************
+ */
+#include "contributors.h"
+
+#include "global.h"
+#include "memalloc.h"
+#include "mvd_rewrite.h"
+
+extern short Logisitc(void);
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Writes all NAL units at the head of the queue that are complete
+ ************************************************************************
+ */
+static void flush_queue(MVDRewriteParameters *p_rw, int flush_all)
+{
+  static const byte start_code[4] = { 0, 0, 0, 1 };
+
+  while (p_rw->head != NULL && (flush_all || !p_rw->head->pending))
+  {
+    MVDRewriteNalu *nal = p_rw->head;
+    int prefix_len = (nal->startcodeprefix_len == 3) ? 3 : 4;
+
+    if (fwrite(start_code + 4 - prefix_len, 1, prefix_len, p_rw->p_out) != (size_t) prefix_len ||
+      fwrite(nal->buf, 1, nal->len, p_rw->p_out) != (size_t) nal->len)
+    {
+      error("mvd_rewrite: error writing the rewritten bitstream", 500);
+    }
+    if (nal->pending)
+      ++p_rw->num_passed;
+
+    p_rw->head = nal->next;
+    if (p_rw->head == NULL)
+      p_rw->tail = NULL;
+    free(nal->buf);
+    free(nal);
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Appends n (<= 24) bits to the rewritten RBSP
+ ************************************************************************
+ */
+static void put_bits(MVDRewriteParameters *p_rw, unsigned int value, int n)
+{
+  int i;
+
+  if (((p_rw->bits_written + n + 7) >> 3) > p_rw->rbsp_size)
+  {
+    p_rw->rbsp_size = 2 * p_rw->rbsp_size + 64;
+    if ((p_rw->rbsp = (byte *) realloc(p_rw->rbsp, p_rw->rbsp_size)) == NULL)
+      no_mem_exit("mvd_rewrite: rbsp");
+  }
+
+  for (i = n - 1; i >= 0; --i)
+  {
+    int  byte_pos = p_rw->bits_written >> 3;
+    byte mask     = (byte) (0x80 >> (p_rw->bits_written & 0x07));
+
+    if (mask == 0x80)
+      p_rw->rbsp[byte_pos] = 0;
+    if ((value >> i) & 0x01)
+      p_rw->rbsp[byte_pos] |= mask;
+    ++p_rw->bits_written;
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Copies the source bits [p_rw->bits_copied, bit_end) of the slice
+ ************************************************************************
+ */
+static void copy_bits(MVDRewriteParameters *p_rw, byte *src, int bit_end)
+{
+  int pos = p_rw->bits_copied;
+
+  // leading bits up to the next byte boundary of the source
+  while (pos < bit_end && (pos & 0x07))
+  {
+    put_bits(p_rw, (src[pos >> 3] >> (7 - (pos & 0x07))) & 0x01, 1);
+    ++pos;
+  }
+  // whole bytes
+  while (pos + 8 <= bit_end)
+  {
+    put_bits(p_rw, src[pos >> 3], 8);
+    pos += 8;
+  }
+  // trailing bits
+  while (pos < bit_end)
+  {
+    put_bits(p_rw, (src[pos >> 3] >> (7 - (pos & 0x07))) & 0x01, 1);
+    ++pos;
+  }
+
+  p_rw->bits_copied = bit_end;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Writes a signed Exp-Golomb codeword se(v)
+ *    (same mapping as se_linfo() and symbol2vlc() of the encoder)
+ ************************************************************************
+ */
+static void write_se_v(MVDRewriteParameters *p_rw, int value)
+{
+  unsigned int code_num = (value > 0) ? (unsigned int) (2 * value - 1) : (unsigned int) (-2 * value);
+  unsigned int info     = code_num + 1;
+  int          nbits    = 0;
+
+  while ((info >> (nbits + 1)) != 0)
+    ++nbits;
+
+  // nbits leading zeros, then the nbits + 1 bits of code_num + 1
+  put_bits(p_rw, 0, nbits);
+  if (nbits + 1 > 24)
+  {
+    put_bits(p_rw, info >> 16, nbits + 1 - 16);
+    put_bits(p_rw, info & 0xFFFF, 16);
+  }
+  else
+    put_bits(p_rw, info, nbits + 1);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Opens the rewritten bitstream (MVDRewriteFile)
+ ************************************************************************
+ */
+void init_mvd_rewrite(VideoParameters *p_Vid, InputParameters *p_Inp)
+{
+  MVDRewriteParameters *p_rw;
+
+  p_Vid->p_mvd_rw = NULL;
+  if (strlen(p_Inp->MVDRewriteFile) == 0)
+    return;
+
+  if ((p_rw = (MVDRewriteParameters *) calloc(1, sizeof(MVDRewriteParameters))) == NULL)
+    no_mem_exit("init_mvd_rewrite: p_rw");
+
+  if ((p_rw->p_out = fopen(p_Inp->MVDRewriteFile, "wb")) == NULL)
+  {
+    snprintf(errortext, ET_SIZE, "Error opening MVD rewrite output file %s", p_Inp->MVDRewriteFile);
+    error(errortext, 500);
+  }
+
+  p_Vid->p_mvd_rw = p_rw;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Writes the remaining NAL units and closes the rewritten bitstream
+ ************************************************************************
+ */
+void free_mvd_rewrite(VideoParameters *p_Vid)
+{
+  MVDRewriteParameters *p_rw = p_Vid->p_mvd_rw;
+
+  if (p_rw == NULL)
+    return;
+
+  flush_queue(p_rw, 1);
+  fclose(p_rw->p_out);
+
+  fprintf(stdout, " MVD rewrite: %lld slices rewritten, %lld mvd pairs scrambled, %lld slices passed through\n",
+    (long long) p_rw->num_slices, (long long) p_rw->num_mvd, (long long) p_rw->num_passed);
+
+  free(p_rw->rbsp);
+  free(p_rw);
+  p_Vid->p_mvd_rw = NULL;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Queues a NAL unit as read from the bitstream (before the
+ *    EBSP to RBSP conversion)
+ ************************************************************************
+ */
+void mvd_rewrite_nalu(VideoParameters *p_Vid, NALU_t *nalu)
+{
+  MVDRewriteParameters *p_rw = p_Vid->p_mvd_rw;
+  MVDRewriteNalu *nal;
+
+  if ((nal = (MVDRewriteNalu *) calloc(1, sizeof(MVDRewriteNalu))) == NULL)
+    no_mem_exit("mvd_rewrite_nalu: nal");
+  if ((nal->buf = (byte *) malloc(nalu->len)) == NULL)
+    no_mem_exit("mvd_rewrite_nalu: nal->buf");
+
+  memcpy(nal->buf, nalu->buf, nalu->len);
+  nal->len = nalu->len;
+  nal->startcodeprefix_len = nalu->startcodeprefix_len;
+  nal->pending = (nalu->nal_unit_type == NALU_TYPE_SLICE || nalu->nal_unit_type == NALU_TYPE_IDR);
+
+  // a slice whose header was not processed (e.g. before the first IDR picture) is passed through
+  if (p_rw->tail && p_rw->tail->pending == 1)
+  {
+    p_rw->tail->pending = 0;
+    ++p_rw->num_passed;
+  }
+
+  if (p_rw->tail)
+    p_rw->tail->next = nal;
+  else
+    p_rw->head = nal;
+  p_rw->tail = nal;
+
+  flush_queue(p_rw, 0);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Marks the NAL unit just read as the slice to be rewritten once its
+ *    slice data is parsed (called after the slice header)
+ ************************************************************************
+ */
+void mvd_rewrite_attach(Slice *currSlice)
+{
+  MVDRewriteParameters *p_rw = currSlice->p_Vid->p_mvd_rw;
+
+  // a slice that was read but never parsed (e.g. a dropped redundant slice) is passed through
+  if (currSlice->mvd_rw_nalu != NULL)
+    mvd_rewrite_release(currSlice);
+
+  if (currSlice->active_pps->entropy_coding_mode_flag)
+  {
+    if (!p_rw->cabac_warned)
+    {
+      printf("Warning: MVD rewriting supports CAVLC only, CABAC slices are passed through unchanged.\n");
+      p_rw->cabac_warned = 1;
+    }
+    p_rw->tail->pending = 0;
+    ++p_rw->num_passed;
+    flush_queue(p_rw, 0);
+    return;
+  }
+
+  p_rw->tail->pending = 2;
+  currSlice->mvd_rw_nalu = p_rw->tail;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Starts rewriting the slice data of a slice
+ ************************************************************************
+ */
+void mvd_rewrite_start(Slice *currSlice)
+{
+  MVDRewriteParameters *p_rw = currSlice->p_Vid->p_mvd_rw;
+
+  p_rw->bits_written = 0;
+  p_rw->bits_copied  = 0;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Replaces the mvd pair just parsed (starting at bit_start of the
+ *    partition) by its scrambled value
+ ************************************************************************
+ */
+void mvd_rewrite_pair(Slice *currSlice, Bitstream *currStream, int bit_start, short mvd[2])
+{
+  MVDRewriteParameters *p_rw = currSlice->p_Vid->p_mvd_rw;
+  short key = Logisitc();
+  int   mvd_x, mvd_y;
+
+  // keyed perturbation of writeMotionVector8x8()
+  if ((key % 2) == 1)
+  {
+    mvd_x = mvd[0] + 10;
+    mvd_y = mvd[1] - 10;
+  }
+  else
+  {
+    mvd_x = mvd[0] - 10;
+    mvd_y = mvd[1] + 10;
+  }
+
+  copy_bits(p_rw, currStream->streamBuffer, bit_start);
+  write_se_v(p_rw, mvd_x);
+  write_se_v(p_rw, mvd_y);
+  p_rw->bits_copied = currStream->frame_bitoffset;
+  ++p_rw->num_mvd;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Completes the rewritten slice: copies the rest of the slice data,
+ *    appends the RBSP trailing bits and inserts the emulation
+ *    prevention bytes
+ ************************************************************************
+ */
+void mvd_rewrite_finish(Slice *currSlice)
+{
+  MVDRewriteParameters *p_rw = currSlice->p_Vid->p_mvd_rw;
+  MVDRewriteNalu *nal = currSlice->mvd_rw_nalu;
+  Bitstream *currStream = currSlice->partArr[0].bitstream;
+  byte *src = currStream->streamBuffer;
+  int last_byte = currStream->bitstream_length - 1;
+  int stop_bit, i, j, zero_count = 0;
+  byte *ebsp;
+
+  // position of the rbsp_stop_one_bit (RBSPtoSODB() leaves bitstream_length at its byte)
+  for (stop_bit = 0; stop_bit < 8 && !(src[last_byte] & (0x01 << stop_bit)); ++stop_bit)
+    ;
+  copy_bits(p_rw, src, (last_byte << 3) + 7 - stop_bit);
+
+  put_bits(p_rw, 1, 1);
+  if (p_rw->bits_written & 0x07)
+    put_bits(p_rw, 0, 8 - (p_rw->bits_written & 0x07));
+
+  // NAL unit header byte + EBSP
+  if ((ebsp = (byte *) malloc(1 + (p_rw->bits_written >> 3) * 3 / 2 + 1)) == NULL)
+    no_mem_exit("mvd_rewrite_finish: ebsp");
+  ebsp[0] = nal->buf[0];
+  for (i = 0, j = 1; i < (p_rw->bits_written >> 3); ++i)
+  {
+    if (zero_count == 2 && p_rw->rbsp[i] <= 0x03)
+    {
+      ebsp[j++] = 0x03;
+      zero_count = 0;
+    }
+    ebsp[j++] = p_rw->rbsp[i];
+    zero_count = (p_rw->rbsp[i] == 0) ? zero_count + 1 : 0;
+  }
+
+  free(nal->buf);
+  nal->buf = ebsp;
+  nal->len = j;
+  nal->pending = 0;
+  currSlice->mvd_rw_nalu = NULL;
+  ++p_rw->num_slices;
+
+  flush_queue(p_rw, 0);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Passes the NAL unit of a slice through unchanged (slice not parsed
+ *    or outside ExtractFrmRng)
+ ************************************************************************
+ */
+void mvd_rewrite_release(Slice *currSlice)
+{
+  MVDRewriteParameters *p_rw = currSlice->p_Vid->p_mvd_rw;
+
+  currSlice->mvd_rw_nalu->pending = 0;
+  currSlice->mvd_rw_nalu = NULL;
+  ++p_rw->num_passed;
+  flush_queue(p_rw, 0);
+}
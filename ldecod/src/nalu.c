@@ -17,6 +17,8 @@
 #include "nalu.h"
 #include "memalloc.h"
 #include "rtp.h"
+#include "mvd_rewrite.h"
+#include "dec_profile.h"
 #if (MVC_EXTENSION_ENABLE)
 #include "vlc.h"
 #endif
@@ -56,6 +58,18 @@ int read_next_nalu(VideoParameters *p_Vid, NALU_t *nalu)
   InputParameters *p_Inp = p_Vid->p_Inp;
   int ret;
 
+  // past the last frame of ExtractFrmRng: the remaining NAL units are copied without parsing
+  if (p_Vid->ext_done)
+  {
+    if (p_Vid->p_mvd_rw)
+    {
+      while ((p_Inp->FileFormat == PAR_OF_RTP ? GetRTPNALU(p_Vid, nalu, p_Vid->BitStreamFile) : get_annex_b_NALU(p_Vid, nalu, p_Vid->annex_b)) > 0)
+        mvd_rewrite_nalu(p_Vid, nalu);
+    }
+    return 0;
+  }
+
+  PROF_PUSH(p_Vid, PROF_NAL_READ);
   switch( p_Inp->FileFormat )
   {
   default:
@@ -74,6 +88,7 @@ int read_next_nalu(VideoParameters *p_Vid, NALU_t *nalu)
     ret = GetRTPNALU(p_Vid, nalu, p_Vid->BitStreamFile);
     break;   
   }
+  PROF_POP(p_Vid);
 
   if (ret < 0)
   {
@@ -90,13 +105,19 @@ int read_next_nalu(VideoParameters *p_Vid, NALU_t *nalu)
   //whether it is the first VCL NALU at this point, so only non-VCL NAL unit is checked here.
   CheckZeroByteNonVCL(p_Vid, nalu);
 
+  // the MVD rewriter keeps the NAL unit as read, before the conversion to RBSP
+  if (p_Vid->p_mvd_rw)
+    mvd_rewrite_nalu(p_Vid, nalu);
+
   //nalu->buf/nalu->lenתRBSPݼ
   /*
   *	SODBԭʼıݣûκθ
 	*	RBSP SODB Ļϼrbsp_stop_ont_bitbit ֵΪ 1 0 ֽڲλ
 	*	EBSP RBSP Ļ˷ֹαʼֽڣ0X03	
   */
+  PROF_PUSH(p_Vid, PROF_EBSP);
   ret = NALUtoRBSP(nalu);
+  PROF_POP(p_Vid);
 
   if (ret < 0)
     error ("Invalid startcode emulation prevention found.", 602);
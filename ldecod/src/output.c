@@ -21,6 +21,7 @@
 #include "sei.h"
 #include "input.h"
 #include "fast_memory.h"
+#include "dec_profile.h"
 
 static void write_out_picture(VideoParameters *p_Vid, StorablePicture *p, int p_out);
 static void img2buf_byte   (imgpel** imgX, unsigned char* buf, int size_x, int size_y, int symbol_size_in_bytes, int crop_left, int crop_right, int crop_top, int crop_bottom, int iOutStride);
@@ -520,7 +521,7 @@ static void write_out_picture(VideoParameters *p_Vid, StorablePicture *p, int p_
   if (p_out == -1)
     return;
 
-
+  PROF_PUSH(p_Vid, PROF_OUTPUT);
 
   // KS: this buffer should actually be allocated only once, but this is still much faster than the previous version
   pDecPic = get_one_avail_dec_pic_from_list(p_Vid->pDecOuputPic, 0, 0);
@@ -663,6 +664,7 @@ static void write_out_picture(VideoParameters *p_Vid, StorablePicture *p, int p_
  if(p_out >=0)
    pDecPic->bValid = 0;
 
+  PROF_POP(p_Vid);
   //  fsync(p_out);
 }
 
@@ -42,6 +42,10 @@
 #define MIN_BITS_TO_GO 0
 #define B_LOAD_MASK    0xFFFF      // ((1<<BITS_TO_LOAD) - 1)
 
+#define ENTROPY_BITS_PREC 15       // entropyBits[] are in units of 1/(1 << ENTROPY_BITS_PREC) bits
+
+extern const int entropyBits[128];
+
 extern int get_pic_bin_count(VideoParameters *p_Vid);
 extern void reset_pic_bin_count(VideoParameters *p_Vid);
 extern void set_pic_bin_count  (VideoParameters *p_Vid, EncodingEnvironmentPtr eep);
@@ -49,6 +53,7 @@ extern void set_pic_bin_count  (VideoParameters *p_Vid, EncodingEnvironmentPtr e
 extern void arienco_start_encoding(EncodingEnvironmentPtr eep, unsigned char *code_buffer, int *code_len);
 extern void arienco_reset_EC      (EncodingEnvironmentPtr eep);
 extern void arienco_done_encoding (Macroblock *currMB, EncodingEnvironmentPtr eep);
+extern void arienco_set_estimation(EncodingEnvironmentPtr eep, int estimate);
 extern void biari_init_context    (int qp, BiContextTypePtr ctx, const char* ini);
 extern void biari_encode_symbol   (EncodingEnvironmentPtr eep, int symbol, BiContextTypePtr bi_ct );
 extern void biari_encode_symbol_eq_prob(EncodingEnvironmentPtr eep, int symbol);
@@ -57,12 +62,14 @@ extern void biari_encode_symbol_final(EncodingEnvironmentPtr eep, int symbol);
 /*!
 ************************************************************************
 * \brief
-*    Returns the number of currently written bits
+*    Returns the number of currently written bits (including the
+*    estimated rate of the symbols coded in estimation mode)
 ************************************************************************
 */
 static inline int arienco_bits_written(EncodingEnvironmentPtr eep)
 {
-  return (((*eep->Ecodestrm_len) + eep->Epbuf + 1) << 3) + (eep->Echunks_outstanding * BITS_TO_LOAD) + BITS_TO_LOAD - eep->Ebits_to_go;
+  return (((*eep->Ecodestrm_len) + eep->Epbuf + 1) << 3) + (eep->Echunks_outstanding * BITS_TO_LOAD) + BITS_TO_LOAD - eep->Ebits_to_go
+    + (int) (eep->Efrac >> ENTROPY_BITS_PREC);
 }
 
 #endif  // BIARIENCOD_H
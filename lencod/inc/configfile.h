@@ -40,6 +40,7 @@ Mapping Map[] = {
     {"ExtractFrmRng",           &cfgparams.ExtractFrmRng,               1,  0,                  0, 0.0,		0.0,			EX_FRM_RNG_SIZE,},
     {"ExtKeyFile",		        &cfgparams.ExtKeyFile,			        1,	0.0,				0, 0.0,		0.0,			FILE_NAME_SIZE,},
     {"ExtKeyFileEnable",		&cfgparams.ExtKeyFileEnable,			0,	1.0,				0, 0.0,		0.0,			},
+    {"MBInfoFile",              &cfgparams.MBInfoFile,                  1,  0.0,                0, 0.0,		0.0,			FILE_NAME_SIZE,},
     
     {"IntraProfile",             &cfgparams.IntraProfile,                 0,   0.0,                       1,  0.0,              1.0,                             }, 
     {"LevelIDC",                 &cfgparams.LevelIDC,                     0,   (double) LEVEL_IDC,        0,  0.0,              0.0,                             },
@@ -92,9 +93,12 @@ Mapping Map[] = {
     {"MbLineIntraUpdate",        &cfgparams.intra_upd,                    0,   0.0,                       1,  0.0,              1.0,                             },
     {"SliceMode",                &cfgparams.slice_mode,                   0,   0.0,                       1,  0.0,              3.0,                             },
     {"SliceArgument",            &cfgparams.slice_argument,               0,   1.0,                       2,  1.0,              1.0,                             },
+    {"SliceThreads",             &cfgparams.SliceThreads,                 0,   0.0,                       2,  0.0,              0.0,                             },
     {"UseConstrainedIntraPred",  &cfgparams.UseConstrainedIntraPred,      0,   0.0,                       1,  0.0,              1.0,                             },
     {"InputFile",                &cfgparams.input_file1.fname,            1,   0.0,                       0,  0.0,              0.0,             FILE_NAME_SIZE, },
     {"InputHeaderLength",        &cfgparams.infile_header,                0,   0.0,                       2,  0.0,              1.0,                             },
+    {"PrefetchFrames",           &cfgparams.PrefetchFrames,               0,   0.0,                       1,  0.0,             32.0,                             },
+    {"InputMemoryMap",           &cfgparams.InputMemoryMap,               0,   0.0,                       1,  0.0,              1.0,                             },
     {"OutputFile",               &cfgparams.outfile,                      1,   0.0,                       0,  0.0,              0.0,             FILE_NAME_SIZE, },
     {"ReconFile",                &cfgparams.ReconFile,                    1,   0.0,                       0,  0.0,              0.0,             FILE_NAME_SIZE, },
     {"TraceFile",                &cfgparams.TraceFile,                    1,   0.0,                       0,  0.0,              0.0,             FILE_NAME_SIZE, },
@@ -170,6 +174,7 @@ Mapping Map[] = {
     {"DistortionSSIM",           &cfgparams.Distortion[SSIM],             0,   0.0,                       1,  0.0,              1.0,                             },
     {"DistortionMS_SSIM",        &cfgparams.Distortion[MS_SSIM],          0,   0.0,                       1,  0.0,              1.0,                             },
     {"SSIMOverlapSize",          &cfgparams.SSIMOverlapSize,              0,   1.0,                       2,  1.0,              1.0,                             },
+    {"SSIMThreads",              &cfgparams.SSIMThreads,                  0,   0.0,                       2,  0.0,              0.0,                             },
     {"DistortionYUVtoRGB",       &cfgparams.DistortionYUVtoRGB,           0,   0.0,                       1,  0.0,              1.0,                             },
     {"CtxAdptLagrangeMult",      &cfgparams.CtxAdptLagrangeMult,          0,   0.0,                       1,  0.0,              1.0,                             },
     {"FastCrIntraDecision",      &cfgparams.FastCrIntraDecision,          0,   0.0,                       1,  0.0,              1.0,                             },
@@ -177,6 +182,7 @@ Mapping Map[] = {
     {"DisableBSkipRDO",          &cfgparams.nobskip,                      0,   0.0,                       1,  0.0,              1.0,                             },
     {"BiasSkipRDO",              &cfgparams.BiasSkipRDO,                  0,   0.0,                       1,  0.0,              1.0,                             },
     {"ForceTrueRateRDO",         &cfgparams.ForceTrueRateRDO,             0,   0.0,                       1,  0.0,              2.0,                             },    
+    {"CABACRateEst",             &cfgparams.CABACRateEst,                 0,   0.0,                       1,  0.0,              1.0,                             },
     {"LossRateA",                &cfgparams.LossRateA,                    2,   0.0,                       2,  0.0,              0.0,                             },
     {"LossRateB",                &cfgparams.LossRateB,                    2,   0.0,                       2,  0.0,              0.0,                             },
     {"LossRateC",                &cfgparams.LossRateC,                    2,   0.0,                       2,  0.0,              0.0,                             },
@@ -191,6 +197,7 @@ Mapping Map[] = {
 #endif
     {"PicInterlace",             &cfgparams.PicInterlace,                 0,   0.0,                       1,  0.0,              3.0,                             },
     {"MbInterlace",              &cfgparams.MbInterlace,                  0,   0.0,                       1,  0.0,              3.0,                             },
+    {"PAFFThreads",              &cfgparams.PAFFThreads,                  0,   0.0,                       2,  0.0,              0.0,                             },
 
     {"IntraBottom",              &cfgparams.IntraBottom,                  0,   0.0,                       1,  0.0,              1.0,                             },
 
@@ -213,6 +220,7 @@ Mapping Map[] = {
     {"RDPictureDirectMode",      &cfgparams.RDPictureDirectMode,          0,   0.0,                       1,  0.0,              1.0,                             },
     {"RDPictureFrameQPPSlice",   &cfgparams.RDPictureFrameQPPSlice,       0,   0.0,                       1,  0.0,              1.0,                             },
     {"RDPictureFrameQPBSlice",   &cfgparams.RDPictureFrameQPBSlice,       0,   0.0,                       1,  0.0,              1.0,                             },
+    {"RDPictureThreads",         &cfgparams.RDPictureThreads,             0,   0.0,                       2,  0.0,              0.0,                             },
     {"SkipIntraInInterSlices",   &cfgparams.SkipIntraInInterSlices,       0,   0.0,                       1,  0.0,              1.0,                             },
     {"BReferencePictures",       &cfgparams.BRefPictures,                 0,   0.0,                       1,  0.0,              2.0,                             },
     {"HierarchicalCoding",       &cfgparams.HierarchicalCoding,           0,   0.0,                       1,  0.0,              3.0,                             },
@@ -281,6 +289,8 @@ Mapping Map[] = {
     {"Verbose",                  &cfgparams.Verbose,                      0,   1.0,                       1,  0.0,              4.0,                             },
     {"SkipGlobalStats",          &cfgparams.skip_gl_stats,                0,   0.0,                       1,  0.0,              1.0,                             },
     {"OnTheFlyFractMCP",         &cfgparams.OnTheFlyFractMCP,             0,   0.0,                       1,  0.0,              3.0,                             },
+    {"SubPelThreads",            &cfgparams.SubPelThreads,                0,   0.0,                       2,  0.0,              0.0,                             },
+    {"LazySubPel",               &cfgparams.LazySubPel,                   0,   0.0,                       1,  0.0,              1.0,                             },
     {"ChromaMCBuffer",           &cfgparams.ChromaMCBuffer,               0,   0.0,                       1,  0.0,              1.0,                             },
     {"ChromaMEEnable",           &cfgparams.ChromaMEEnable,               0,   0.0,                       1,  0.0,              2.0,                             },
     {"ChromaMEWeight",           &cfgparams.ChromaMEWeight,               0,   1.0,                       2,  0.0,              1.0,                             },    
@@ -289,6 +299,7 @@ Mapping Map[] = {
     {"MEDistortionHPel",         &cfgparams.MEErrorMetric[H_PEL],         0,   0.0,                       1,  0.0,              3.0,                             },
     {"MEDistortionQPel",         &cfgparams.MEErrorMetric[Q_PEL],         0,   2.0,                       1,  0.0,              3.0,                             },
     {"MDDistortion",             &cfgparams.ModeDecisionMetric,           0,   2.0,                       1,  0.0,              2.0,                             },
+    {"DistortionSIMD",           &cfgparams.DistortionSIMD,               0,   2.0,                       1,  0.0,              2.0,                             },
     {"SkipDeBlockNonRef",        &cfgparams.SkipDeBlockNonRef,            0,   0.0,                       1,  0.0,              1.0,                             },
 
     // Rate Control
@@ -400,10 +411,13 @@ Mapping Map[] = {
     {"PreferDispOrder",          &cfgparams.PreferDispOrder,              0,   1.0,                       1,  0.0,              1.0,                             },
     {"PreferPowerOfTwo",         &cfgparams.PreferPowerOfTwo,             0,   0.0,                       1,  0.0,              1.0,                             },
     {"FrmStructBufferLength",    &cfgparams.FrmStructBufferLength,        0,  16.0,                       1,  1.0,            128.0,                             },
+    {"LookAheadFrames",          &cfgparams.LookAheadFrames,              0,   0.0,                       1,  0.0,             32.0,                             },
+    {"LookAheadSceneCut",        &cfgparams.LookAheadSceneCut,            0, 100.0,                       1,  0.0,           1000.0,                             },
 
     // Fast Mode Decision
     {"EarlySkipEnable",          &cfgparams.EarlySkipEnable,              0,   0.0,                       1,  0.0,              1.0,                             },
     {"SelectiveIntraEnable",     &cfgparams.SelectiveIntraEnable,         0,   0.0,                       1,  0.0,              1.0,                             },
+    {"FastMDHigh",               &cfgparams.FastMDHigh,                   0,   0.0,                       1,  0.0,              2.0,                             },
 
     //================================
     // Motion Estimation (ME) Parameters
@@ -415,6 +429,8 @@ Mapping Map[] = {
     {"SetMVYLimit",              &cfgparams.SetMVYLimit,                  0,   0.0,                       1,  0.0,            512.0,                             },
     // Fast ME enable
     {"SearchMode",               &cfgparams.SearchMode[0],                0,   0.0,                       1, -1.0,              3.0,                             },
+    {"HMEEnable",                &cfgparams.HMEEnable,                    0,   0.0,                       1,  0.0,              1.0,                             },
+    {"MERefThreads",             &cfgparams.MERefThreads,                 0,   0.0,                       2,  0.0,              0.0,                             },
     // Parameters for UMHEX control
     {"UMHexDSR",                 &cfgparams.UMHexDSR,                     0,   1.0,                       1,  0.0,              1.0,                             },
     {"UMHexScale",               &cfgparams.UMHexScale,                   0,   1.0,                       0,  0.0,              0.0,                             },
@@ -467,6 +483,7 @@ Mapping Map[] = {
     {"RDOQ_CP_Mode",             &cfgparams.RDOQ_CP_Mode,                 0,   0.0,                       1,  0.0,              1.0,                             },
     {"RDOQ_CP_MV",               &cfgparams.RDOQ_CP_MV,                   0,   0.0,                       1,  0.0,              1.0,                             },
     {"RDOQ_Fast",                &cfgparams.RDOQ_Fast,                    0,   0.0,                       1,  0.0,              1.0,                             },
+    {"RDOQ_Prune",               &cfgparams.RDOQ_Prune,                   0,   0.0,                       1,  0.0,              1.0,                             },
     // VUI parameters
     {"GenerateSEIMessage",       &cfgparams.GenerateSEIMessage,           0,   0.0,                       1,  0.0,              1.0,                             },
     {"EnableVUISupport",         &cfgparams.EnableVUISupport,             0,   0.0,                       1,  0.0,              1.0,                             },
@@ -44,6 +44,7 @@
 #define USE_RND_COST              0    //!< Perform ME RD decision using a rounding estimate of the motion cost
 #define JM_INT_DIVIDE             1
 #define JM_MEM_DISTORTION         0
+#define JM_SIMD_DISTORTION        1    //!< Enables the SSE4.1/AVX2 distortion kernels (x86 only, selected at run time)
 #define JCOST_CALC_SCALEUP        1    //!< 1: J = (D<<LAMBDA_ACCURACY_BITS)+Lambda*R; 0: J = D + ((Lambda*R+Rounding)>>LAMBDA_ACCURACY_BITS)
 #define INTRA_RDCOSTCALC_ET       1    //!< Early termination 
 #define INTRA_RDCOSTCALC_NNZ      1    //1: to recover block's nzn after rdcost calculation;
@@ -95,7 +96,7 @@ enum {
 #include "types.h"
 
 #define FILE_NAME_SIZE  255
-#define EX_FRM_RNG_SIZE 20
+#define EX_FRM_RNG_SIZE 256
 
 #define INPUT_TEXT_SIZE 1024
 
@@ -122,6 +123,8 @@ enum {
 //#define IMG_PAD_SIZE_TIMES4    80 //!< Number of pixels padded around the reference frame in subpel units(>=16)
 #define IMG_PAD_SIZE_X         32 //!< Number of pixels padded around the reference frame (>=4)
 #define IMG_PAD_SIZE_Y         20 //!< Number of pixels padded around the reference frame (>=4)
+#define SUBPEL_BAND_HEIGHT     32 //!< Number of padded lines interpolated together (SubPelThreads, LazySubPel)
+#define SSIM_BAND_ROWS         16 //!< Number of SSIM window rows computed together (SSIMThreads)
 
 #define MAX_VALUE       999999   //!< used for start value for some variables
 #define INVALIDINDEX  (-135792468)
@@ -140,6 +143,7 @@ enum {
 
 #define  MAXSLICEPERPICTURE           100  //һ֡slice
 #define  MAX_REFERENCE_PICTURES        32
+#define  SLICE_ARENA_BLOCK_SIZE   (1 << 20)  //!< minimum block size of the slice memory arena of a picture
 
 #define BLOCK_SHIFT            2
 #define BLOCK_SIZE             4
@@ -112,6 +112,9 @@ struct encoding_environment
   int           *Ecodestrm_len;
   int           C;
   int           E;
+  int           Eest;           //!< 1: symbols only update the contexts and add their estimated rate to Efrac
+  int64         Efrac;          //!< estimated rate in units of 1/(1 << ENTROPY_BITS_PREC) bits
+  struct ctx_journal *journal;  //!< contexts written since the last RDO checkpoint (NULL: not logged)
 };
 
 //! struct for context management
@@ -122,6 +125,21 @@ struct bi_context_type
   unsigned char  MPS;           // Least Probable Symbol 0/1 CP  
 };
 
+//! contexts of a slice written since its RDO coding state checkpoints were taken
+typedef struct ctx_journal
+{
+  BiContextType *tex_base;      //!< slice texture contexts (indices 0 .. num_tex - 1)
+  BiContextType *mot_base;      //!< slice motion contexts (indices num_tex .. num_ctx - 1)
+  int            num_tex;
+  int            num_ctx;
+  int           *idx;           //!< touched context indices in touch order
+  int            num;           //!< entries in idx
+  int            size;          //!< capacity of idx
+  int           *stamp;         //!< epoch in which each context was last entered
+  int            epoch;         //!< advanced at every checkpoint store/reset
+  int            gen;           //!< advanced whenever the journal is cleared
+} CtxJournal;
+
 
 
 /**********************************************************************
@@ -218,8 +236,18 @@ typedef struct rd_params
 
   short  valid[MAXMODE];
   short  curr_mb_field;
+  short  prune_sub8x8;     //!< FastMDHigh sub-8x8 pruning level (0: search all sub-8x8 partitions)
+  distblk cost16x16;       //!< 16x16 motion estimation cost (FastMDHigh sub-8x8 pruning)
 } RD_PARAMS;
 
+//! learned margins of the fast high complexity mode decision (FastMDHigh)
+typedef struct fast_md_state
+{
+  int    mb_count;         //!< macroblocks decided so far
+  double inter[2];         //!< [P/B]: margin of the inter estimates (ratio to the lowest inter estimate)
+  double intra[2];         //!< [P/B]: margin of the intra estimate (ratio to the lowest inter estimate)
+} FastMDState;
+
 
 //! Set Explicit GOP Parameters.
 //! Currently only supports Enhancement GOP but could be easily extended
@@ -316,6 +344,7 @@ typedef struct me_block
   distblk (*computePredFPel)    (struct storable_picture *, struct me_block *, distblk , MotionVector * );
   distblk (*computePredHPel)    (struct storable_picture *, struct me_block *, distblk , MotionVector * );
   distblk (*computePredQPel)    (struct storable_picture *, struct me_block *, distblk , MotionVector * );
+  void    (*computeBatchPredFPel)(struct storable_picture *, struct me_block *, int, MotionVector *, distblk *, distblk * );
   distblk (*computeBiPredFPel)  (struct storable_picture *, struct storable_picture *, struct me_block *, distblk , MotionVector *, MotionVector *);
   distblk (*computeBiPredHPel)  (struct storable_picture *, struct storable_picture *, struct me_block *, distblk , MotionVector *, MotionVector *);
   distblk (*computeBiPredQPel)  (struct storable_picture *, struct storable_picture *, struct me_block *, distblk , MotionVector *, MotionVector *);
@@ -549,6 +578,36 @@ typedef struct rd_data
   char    ***refar;                   //!< reference frame array [list][y][x]
 } RD_DATA;
 
+#if TRACE
+//! trace output of a slice coded concurrently with other slices (SliceThreads),
+//! written to the trace file in slice order by trace_flush_buffer()
+typedef struct trace_buffer
+{
+  char *text;                 //!< trace text, symbol lines with the length of the symbol instead of the bit counter
+  int   size;                 //!< length of text
+  int   max_size;             //!< allocated size of text
+  int   bits;                 //!< number of bits traced into the buffer
+} TraceBuffer;
+#endif
+
+//! Extraction output of one macroblock, written when the slice is
+//! terminated (SliceThreads, see write_deferred_extraction())
+typedef struct ext_event
+{
+  int     mb_addr;
+  short   mb_type;
+  short   part;     //!< data partition of the mvd codewords, -1: macroblock log line
+  int     bit_pos;  //!< position of the mvd codewords in the partition bitstream
+  int     len;      //!< length of the (unperturbed) mvd codewords
+  short   mvd[2];
+#if TRACE
+  int     trace_pos;  //!< position of the mvd trace lines in the slice trace buffer, -1: not traced
+  short   list_idx;
+  short   org_mv[2];
+  short   pred_mv[2];
+#endif
+} ExtEvent;
+
  //! Slice
 typedef struct slice
 {
@@ -599,6 +658,13 @@ typedef struct slice
   int                 start_mb_nr;
   int                 max_part_nr;  //!< number of different partitions
   int                 num_mb;       //!< number of MBs in the slice
+  struct stat_parameters *cur_stats; //!< statistics the MBs of the slice are accounted to
+  ExtEvent           *ext_events;   //!< deferred Extraction output (NULL: written by the MB loop)
+#if TRACE
+  TraceBuffer        *trace;        //!< trace output of the slice (NULL: written to the trace file)
+#endif
+  int                 num_ext_events;
+  int                 max_ext_events;
 
   int                 cmp_cbp[3];
   int                 curr_cbp[2];
@@ -622,6 +688,7 @@ typedef struct slice
   DataPartition       *partArr;     //!< array of partitions
   MotionInfoContexts  *mot_ctx;     //!< pointer to struct of context models for use in CABAC
   TextureInfoContexts *tex_ctx;     //!< pointer to struct of context models for use in CABAC
+  CtxJournal          *ctx_journal; //!< contexts touched since the RDO checkpoints (CABAC with RDO only)
 
   int                 mvscale[6][MAX_REFERENCE_PICTURES];
   char                direct_spatial_mv_pred_flag;              //!< Direct Mode type to be used (0: Temporal, 1: Spatial)
@@ -694,6 +761,8 @@ typedef struct slice
   double norm_factor_8x8;
   int    norm_shift_4x4;
   int    norm_shift_8x8;
+  double est_err_4x4[6][16];   //!< distortion weights of the 4x4 level candidates (estErr4x4 / norm_factor_4x4)
+  double est_err_8x8[6][64];   //!< distortion weights of the 8x8 level candidates (estErr8x8 / norm_factor_8x8)
 
   //ǴYUVmpr_16x16[0/1/2] ->Y/U/V
   imgpel ****mpr_4x4;           //!< prediction samples for   4x4 intra prediction modes
@@ -711,6 +780,7 @@ typedef struct slice
 
   struct rdo_structure    *p_RDO;
   struct epzs_params      *p_EPZS;  
+  struct hme_params       *p_HME;
 
   // This should be the right location for this
   struct storable_picture **listX[6];
@@ -854,6 +924,7 @@ typedef struct distortion_params
   int        frame_ctr_v[2];                //!< number of coded frames for each view
   DistMetric metric_v[2][TOTAL_DIST_TYPES]; //!< Distortion metrics for each view
 #endif
+  struct ssim_buffers *p_SSIM;              //!< scratch buffers of the SSIM metrics (see img_dist_ssim.c)
 } DistortionParams;
 
 typedef struct picture
@@ -861,6 +932,7 @@ typedef struct picture
   int   no_slices;
   int   bits_per_picture;
   struct slice *slices[MAXSLICEPERPICTURE];
+  struct mem_arena *arena;   //!< scratch memory of the slices, released by free_slice_list()
 
   DistMetric distortion;
   byte  idr_flag;  //IDR֡ʶ
@@ -982,6 +1054,12 @@ typedef struct video_par
   int prevFrameNumOffset;     //!< POC type 1
   unsigned int prevFrameNum;  //!< POC type 1
   SeqStructure    *p_pred;
+  struct lookahead_params *p_LA;       //!< look-ahead pre-analysis (NULL if disabled)
+  struct picture_passes   *p_Passes;   //!< RD picture decision passes coded concurrently (NULL if disabled)
+  struct input_prefetch   *p_Prefetch; //!< source frame prefetch buffer (NULL if disabled)
+  FILE                    *p_mb_info;  //!< macroblock info file whose coding decisions are reused (NULL if not used)
+  struct mb_info_record   *mb_info;    //!< record of the current macroblock
+  FastMDState              fast_md;    //!< learned margins of the fast mode decision (FastMDHigh)
   FrameUnitStruct *p_curr_frm_struct;  //ָǰ֡
   PicStructure    *p_curr_pic;
   SliceStructure  *p_curr_slice;
@@ -1017,7 +1095,9 @@ typedef struct video_par
   struct image_structure imgREF1;
   struct image_structure imgRGB_src;
   struct image_structure imgRGB_ref;
-  int       **imgY_sub_tmp;           //!< Y picture temporary component (Quarter pel)
+  int       **imgY_sub_tmp;           //!< Y picture temporary component (Quarter pel), one band per interpolation thread
+  imgpel    **imgY_sub_line;          //!< discarded half-pel line, one per interpolation thread
+  int         num_sub_tmp;            //!< number of interpolation band buffers
   imgpel    **imgY_com;               //!< Encoded luma images
   imgpel   **imgUV_com[2];              //!< Encoded croma images
 
@@ -1574,6 +1654,11 @@ extern void free_mem_DCcoeff     (int***);
 #if TRACE
 extern void  trace2out(SyntaxElement *se);
 extern void  trace2out_cabac(SyntaxElement *se);
+extern void  trace_printf(const char *format, ...);
+extern void  trace_redirect(TraceBuffer *buf);
+extern int   trace_position(void);
+extern int   trace_replace_symbol(TraceBuffer *buf, int pos, SyntaxElement *sym);
+extern void  trace_flush_buffer(TraceBuffer *buf);
 #endif
 
 extern void error(char *text, int code);
@@ -18,6 +18,9 @@
 #define _IMAGE_H_
 
 #include "mbuffer.h"
+#if defined(OPENMP)
+#include "slice.h"
+#endif
 
 typedef struct coding_info {
   short type;
@@ -50,6 +53,51 @@ extern void    store_coding_and_rc_info( VideoParameters *p_Vid, CodingInfo *cod
 extern void    swap_frame_buffer     ( VideoParameters *p_Vid, int a, int b );
 extern void    frame_picture_mp_exit ( VideoParameters *p_Vid, CodingInfo *coding_info );
 
+#if defined(OPENMP)
+#define MAX_PICTURE_PASSES 3     //!< most RD picture decision passes coded concurrently
+
+//! macroblock buffers and Lagrangian tables of a picture coding pass
+typedef struct pass_buffers
+{
+  Macroblock    *mb_data;
+  int         ***nz_coeff;
+  char         **ipredmode;
+  char         **ipredmode8x8;
+  short         *intra_block;
+  LambdaParams **lambda;
+  double       **lambda_md;
+  double      ***lambda_me;
+  int         ***lambda_mf;
+  double       **lambda_rdoq;
+} PassBuffers;
+
+//! picture coding pass coded concurrently with others (see frame_picture_begin())
+typedef struct picture_pass
+{
+  Picture      *pic;
+  ImageData    *imgData;
+  int           structure;                         //!< FRAME or TOP_FIELD
+  PassBuffers  *buf;
+  SliceJobs     jobs;
+  byte         *MBAmap;                            //!< macroblock maps of the pass (FmoInit() of later passes replaces the ones of p_Vid)
+  byte         *MapUnitToSliceGroupMap;
+} PicturePass;
+
+//! concurrent picture coding passes (RDPictureThreads, PAFFThreads)
+typedef struct picture_passes
+{
+  int           num_passes;
+  PicturePass   pass[MAX_PICTURE_PASSES];
+  PassBuffers   main;                              //!< buffers of the encoder, used by the last pass
+  PassBuffers   buf[MAX_PICTURE_PASSES - 1];       //!< private buffers of the other passes
+} PicturePasses;
+
+extern int     init_picture_passes   ( VideoParameters *p_Vid, InputParameters *p_Inp );
+extern void    free_picture_passes   ( VideoParameters *p_Vid );
+extern void    frame_picture_begin   ( VideoParameters *p_Vid, Picture *frame, ImageData *imgData, int rd_pass, int last_pass );
+extern void    picture_passes_end    ( VideoParameters *p_Vid, CodingInfo *coding_info, int num_threads );
+#endif
+
 extern void GenerateImagePyramid(VideoParameters *p_Vid, int size_x, int size_y, imgpel ***p_hme_int_img, int offset_x, int offset_y);
 extern void OutputImage(char *pcPrefix, int iFrameNo, int iLevel, imgpel **pImg, int iWidth, int iHeight, int iXOffset, int iYOffset);
 extern void copy_params(VideoParameters *p_Vid, StorablePicture *enc_picture, seq_parameter_set_rbsp_t *active_sps);
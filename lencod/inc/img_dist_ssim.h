@@ -20,6 +20,52 @@
 #define _IMG_DIST_SSIM_H_
 #include "img_distortion.h"
 
+//! terms computed by compute_ssim_terms()
+#define SSIM_TERM_SSIM        1   //!< SSIM index
+#define SSIM_TERM_LUMINANCE   2   //!< luminance component
+#define SSIM_TERM_STRUCTURAL  4   //!< product of the contrast and structure components
+
+//! window sums kept per column of a window row
+enum
+{
+  SSIM_SUM_REF = 0,
+  SSIM_SUM_ENC,
+  SSIM_SQ_REF,
+  SSIM_SQ_ENC,
+  SSIM_CROSS,
+  SSIM_SUMS
+};
+
+//! average SSIM terms over the windows of an image
+typedef struct ssim_terms
+{
+  float ssim;
+  float luminance;
+  float structural;
+} SSIMTerms;
+
+//! scratch buffers of the SSIM and MS-SSIM computation, kept across frames
+typedef struct ssim_buffers
+{
+  int      threads;       //!< number of column sum sets
+  int      width;         //!< width of the column sums
+  int   ***col;           //!< column sums of the current window row [threads][SSIM_SUMS][width]
+  int   ***win;           //!< window sums of the current window row [threads][SSIM_SUMS][width]
+  float   *val;           //!< SSIM terms of the windows of the current window row [threads][3][width]
+  int      bands;         //!< number of band accumulators
+  double **band_sum;      //!< SSIM terms summed per band of window rows [bands][3]
+  int      ds_height;     //!< full resolution height the MS-SSIM buffers fit
+  int      ds_width;      //!< full resolution width the MS-SSIM buffers fit
+  imgpel **ds[2];         //!< downsampled reference and encoded images
+  int    **pad;           //!< symmetrically padded input of downsample()
+  int    **tmp;           //!< horizontally filtered samples of downsample()
+} SSIMBuffers;
+
+extern void init_ssim_kernels  (int level);
+extern SSIMBuffers *get_ssim_buffers (DistortionParams *p_Dist);
+extern void free_ssim_buffers  (DistortionParams *p_Dist);
+extern void compute_ssim_terms (VideoParameters *p_Vid, InputParameters *p_Inp, imgpel **refImg, imgpel **encImg, int height, int width,
+                                int win_height, int win_width, int comp, int unbiased, int terms, SSIMTerms *result);
 extern void find_ssim (VideoParameters *p_Vid, InputParameters *p_Inp, ImageStructure *imgREF, ImageStructure *imgSRC, DistMetric metricSSIM[3]);
 
 #endif
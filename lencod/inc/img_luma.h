@@ -25,6 +25,11 @@ static const int ONE_FOURTH_TAP[2][3] =
 };
 
 extern void getSubImagesLuma       ( VideoParameters *p_Vid, StorablePicture *s );
+extern void getSubImagesLumaLazy   ( VideoParameters *p_Vid, StorablePicture *s );
+extern void free_sub_pel_bands     ( StorablePicture *s );
+extern void init_luma_kernels      ( int level );
+extern int  init_luma_interpolation( VideoParameters *p_Vid, InputParameters *p_Inp );
+extern void free_luma_interpolation( VideoParameters *p_Vid );
 /*
 extern void getSubImageInteger     ( StorablePicture *s, imgpel **dstImg, imgpel **srcImg);
 extern void getSubImageInteger_s   ( StorablePicture *s, imgpel **dstImg, imgpel **srcImg);
@@ -0,0 +1,62 @@
+
+/*!
+ ************************************************************************
+ * \file
+ *     input_prefetch.h
+ *
+ * \brief
+ *    Headerfile for the source frame prefetch buffer
+ *
+ **************************************************************************
+ */
+
+#ifndef _INPUT_PREFETCH_H_
+#define _INPUT_PREFETCH_H_
+
+#include "thread_util.h"
+
+//! state of a prefetch slot
+typedef enum
+{
+  SLOT_FREE    = 0,            //!< holds no frame
+  SLOT_READING = 1,            //!< frame is being read and converted by the reader thread
+  SLOT_READY   = 2             //!< frame (or the failed attempt to read it) can be handed to the encoder
+} PrefetchSlotState;
+
+//! one prefetched (converted and padded) source frame
+typedef struct prefetch_slot
+{
+  int            frame;        //!< frame number in the source file (-1: free slot)
+  int            state;        //!< PrefetchSlotState
+  int            file_read;    //!< frame could be read
+  unsigned char *buf;          //!< raw frame data
+  unsigned char *ibuf;         //!< de-interleaving buffer
+  unsigned char *data;         //!< planar frame data (buf or memory mapped file)
+  imgpel       **frm_data[3];  //!< converted image planes
+} PrefetchSlot;
+
+//! source frame prefetch buffer, filled by a reader thread
+typedef struct input_prefetch
+{
+  int           num_slots;     //!< number of frames held
+  int           next_frame;    //!< first frame (in the source file) not considered for reading ahead yet
+  int           last_frame;    //!< first frame (in the source file) beyond the frames to be encoded
+  int           frame_step;    //!< distance between two encoded frames in the source file (frame skipping)
+  int           request;       //!< frame the encoder waits for that has not been read ahead (-1: none)
+  int           started;       //!< reader thread has been started
+  int           stop;          //!< reader thread has to terminate
+  char         *read_ahead;    //!< per encoded frame (frame / frame_step): already read (or being read)
+  PrefetchSlot *slot;          //!< buffered frames
+  VideoDataFile file;          //!< source file, with a file descriptor of its own
+  ThreadHandle  thread;        //!< reader thread
+  ThreadMutex   mutex;         //!< protects the slot states and the fields above
+  ThreadCond    reader_cond;   //!< signalled when the reader thread may have work to do
+  ThreadCond    encoder_cond;  //!< signalled when a slot has been filled
+} InputPrefetch;
+
+extern int  init_input_prefetch (VideoParameters *p_Vid, InputParameters *p_Inp);
+extern void free_input_prefetch (VideoParameters *p_Vid);
+extern int  read_prefetched_frame (VideoParameters *p_Vid, int FrameNoInFile, ImageData *imgData);
+
+#endif
+
@@ -0,0 +1,40 @@
+
+/*!
+ ************************************************************************
+ * \file
+ *     lookahead.h
+ *
+ * \brief
+ *    Headerfile for the look-ahead pre-analysis
+ *
+ **************************************************************************
+ */
+
+#ifndef _LOOKAHEAD_H_
+#define _LOOKAHEAD_H_
+
+//! search range of the pre-analysis (in samples of the 1/2 resolution plane)
+#define LA_SEARCH_RANGE  8
+
+//! look-ahead pre-analysis state
+typedef struct lookahead_params
+{
+  VideoParameters *p_Vid;
+  int      num_frames;         //!< frames read and analysed in one pass
+  int      next_frame;         //!< first frame (display order) that has not been analysed yet
+  int      width;              //!< width of the 1/2 resolution luma plane
+  int      height;             //!< height of the 1/2 resolution luma plane
+  imgpel **frm_data[3];        //!< input frame buffer
+  imgpel ***lowres;            //!< 1/2 resolution luma planes of one pass ([0]: last frame of the previous pass)
+  int64   *intra_cost;         //!< intra SATD of each frame
+  int64   *inter_cost;         //!< inter SATD of each frame (against the previous frame)
+  int64   *cost;               //!< sum of min(intra, inter) over the blocks of each frame
+  byte    *scene_cut;          //!< frames that start a new scene
+} LookAheadParameters;
+
+extern int    init_lookahead             (VideoParameters *p_Vid, InputParameters *p_Inp);
+extern void   free_lookahead             (VideoParameters *p_Vid);
+extern int    lookahead_scene_cut        (LookAheadParameters *p_LA, int frame);
+extern double lookahead_complexity_ratio (LookAheadParameters *p_LA, int frame, int ref_frame);
+
+#endif
@@ -104,6 +104,7 @@ extern int  write_b_slice_motion_info_to_NAL  (Macroblock* currMB,int Extraction
 extern int  write_p_slice_motion_info_to_NAL (Macroblock* currMB,int Extraction);
 extern int  writeReferenceFrame   (Macroblock *currMB, int i, int j, int list_idx, int  ref);
 extern int  writeMotionVector8x8  (Macroblock *currMB, int  i0, int  j0, int  i1, int  j1, int  refframe, int  list_idx, int  mv_mode, short bipred_me,int Extraction);
+extern void write_deferred_extraction (Slice *currSlice);
 
 extern int  writeCoeff4x4_CABAC   (Macroblock *currMB, ColorPlane, int, int, int);
 extern int  writeCoeff8x8_CABAC   (Macroblock* currMB, ColorPlane, int, int);
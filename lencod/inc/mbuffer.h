@@ -51,6 +51,23 @@ typedef struct pic_motion_params
 } PicMotionParams;
 
 
+//! state of a band of the luma sub-pel planes (LazySubPel)
+typedef enum
+{
+  SUBPEL_BAND_NONE = 0,   //!< integer samples only
+  SUBPEL_BAND_HALF = 1,   //!< half-pel planes interpolated
+  SUBPEL_BAND_DONE = 2    //!< all sub-pel planes interpolated
+} SubPelBandState;
+
+//! luma sub-pel planes interpolated band by band on first access (LazySubPel)
+typedef struct subpel_bands
+{
+  VideoParameters *p_Vid;
+  int    num_bands;
+  int    num_done;       //!< bands in state SUBPEL_BAND_DONE
+  byte  *state;          //!< SubPelBandState of each band
+} SubPelBands;
+
 //! definition a picture (field or frame)
 typedef struct storable_picture
 {
@@ -133,6 +150,7 @@ typedef struct storable_picture
 #endif
 
   int  bInterpolated;
+  SubPelBands *subpel_bands;   //!< non NULL while some luma sub-pel bands are not interpolated (LazySubPel)
   int  ref_pic_na[6];
   int  otf_flag;
   //int  separate_colour_plane_flag;
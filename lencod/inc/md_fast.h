@@ -0,0 +1,37 @@
+
+/*!
+ ************************************************************************
+ * \file
+ *     md_fast.h
+ *
+ * \brief
+ *    Headerfile for the fast high complexity mode decision (FastMDHigh)
+ *
+ **************************************************************************
+ */
+
+#ifndef _MD_FAST_H_
+#define _MD_FAST_H_
+
+//! fast mode decision data of the current macroblock
+typedef struct fast_md_mb
+{
+  int      active;                //!< FastMDHigh is used for this macroblock
+  int      prune;                 //!< 1: candidates may be pruned, 0: exhaustive (training) macroblock
+  distblk  est[MAXMODE];          //!< motion estimation cost (inter) or SATD (intra) of the candidates
+  distblk  min_inter;             //!< lowest inter estimate
+  char     order[10];             //!< candidate modes in evaluation order
+} FastMDMB;
+
+extern void init_fast_md             (VideoParameters *p_Vid, InputParameters *p_Inp);
+extern void merge_fast_md            (FastMDState *fmd, FastMDState *slice, FastMDState *base);
+extern void fast_md_start            (Macroblock *currMB, RD_PARAMS *enc_mb, FastMDMB *fmb, int intra);
+extern void fast_md_set_estimate     (FastMDMB *fmb, int mode, distblk cost);
+extern int  fast_md_skip_p8x8_search (Macroblock *currMB, RD_PARAMS *enc_mb, FastMDMB *fmb);
+extern void fast_md_order            (FastMDMB *fmb);
+extern int  fast_md_prune_mode       (Macroblock *currMB, FastMDMB *fmb, int mode);
+extern int  fast_md_prune_sub8x8     (Macroblock *currMB, RD_PARAMS *enc_mb, int cnt_nonz, distblk cost8x8);
+extern void fast_md_finish           (Macroblock *currMB, FastMDMB *fmb);
+extern const char *fast_md_preset_name (int preset);
+
+#endif
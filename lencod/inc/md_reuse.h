@@ -0,0 +1,20 @@
+
+/*!
+ ************************************************************************
+ * \file
+ *     md_reuse.h
+ *
+ * \brief
+ *    Headerfile for re-encoding with the coding decisions of a decoded stream
+ *
+ **************************************************************************
+ */
+
+#ifndef _MD_REUSE_H_
+#define _MD_REUSE_H_
+
+extern void init_mb_info_reuse  (VideoParameters *p_Vid, InputParameters *p_Inp);
+extern void free_mb_info_reuse  (VideoParameters *p_Vid);
+extern void setup_mb_info_reuse (Slice *currSlice);
+
+#endif
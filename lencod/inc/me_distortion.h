@@ -18,6 +18,38 @@
 #ifndef _ME_DISTORTION_H_
 #define _ME_DISTORTION_H_
 
+//! instruction set extensions used by the distortion kernels
+typedef enum
+{
+  SIMD_NONE  = 0,   //!< C kernels
+  SIMD_SSE41 = 1,   //!< SSE4.1 kernels
+  SIMD_AVX2  = 2    //!< AVX2 kernels (SSE4.1 kernels for blocks less than 16 samples wide)
+} SIMDLevel;
+
+//! maximum number of candidates evaluated by one batched distortion call
+#define ME_BATCH_SIZE  8
+
+//! block distortion kernels (see me_distortion_kernels.c)
+typedef struct distortion_kernels
+{
+  int     (*sad)        (imgpel *src, imgpel *ref, int ref_stride, int width, int height, int imin_cost);
+  int     (*sse)        (imgpel *src, imgpel *ref, int ref_stride, int width, int height, int imin_cost);
+  void    (*sad_multi)  (imgpel *src, imgpel **ref, int num, int ref_stride, int width, int height, int *imin_cost, int *mcost);
+  void    (*sse_multi)  (imgpel *src, imgpel **ref, int num, int ref_stride, int width, int height, int *imin_cost, int *mcost);
+  int     (*bi_sad)     (imgpel *src, imgpel *ref1, imgpel *ref2, int ref_stride, int width, int height, int imin_cost);
+  int     (*bi_sse)     (imgpel *src, imgpel *ref1, imgpel *ref2, int ref_stride, int width, int height, int imin_cost);
+  void    (*diff)       (imgpel *src, int src_stride, imgpel *ref, int ref_stride, int size, short *diff);
+  void    (*bi_diff)    (imgpel *src, int src_stride, imgpel *ref1, imgpel *ref2, int ref_stride, int size, short *diff);
+  int     (*diff_sad)   (short *diff, int num);
+  distblk (*diff_sse)   (short *diff, int num);
+  int     (*hadamard4x4)(short *diff);
+  int     (*hadamard8x8)(short *diff);
+} DistortionKernels;
+
+extern DistortionKernels dist_kernels;
+
+extern int init_distortion_kernels(int max_level);
+
 extern distblk distortion4x4SAD(short* diff, distblk min_mcost);
 extern distblk distortion4x4SSE(short* diff, distblk min_mcost);
 extern distblk distortion4x4SATD(short* diff, distblk min_cost);
@@ -25,8 +57,16 @@ extern distblk distortion8x8SAD(short* diff, distblk min_mcost);
 extern distblk distortion8x8SSE(short* diff, distblk min_mcost);
 extern distblk distortion8x8SATD(short* diff, distblk min_cost);
 
-extern int HadamardSAD4x4(short* diff);
-extern int HadamardSAD8x8(short* diff);
+static inline int HadamardSAD4x4(short* diff)
+{
+  return dist_kernels.hadamard4x4(diff);
+}
+
+static inline int HadamardSAD8x8(short* diff)
+{
+  return dist_kernels.hadamard8x8(diff);
+}
+
 // SAD functions
 extern distblk computeSAD         (StorablePicture *ref1, MEBlock*, distblk, MotionVector *);
 extern distblk computeSAD16x16    (StorablePicture *ref1, MEBlock*, distblk, MotionVector *);
@@ -63,6 +103,11 @@ extern distblk computeSAT4x4D     (StorablePicture *ref1, MEBlock*, distblk, Mot
 extern distblk computeSSE       (StorablePicture *ref1, MEBlock*, distblk, MotionVector *);
 extern distblk computeSSEWP     (StorablePicture *ref1, MEBlock*, distblk, MotionVector *);
 
+// Batched full pel functions (num <= ME_BATCH_SIZE candidates, per candidate limits, distortions)
+extern void computeUniPredBatch (StorablePicture *ref1, MEBlock*, int, MotionVector *, distblk *, distblk *);
+extern void computeSADBatch     (StorablePicture *ref1, MEBlock*, int, MotionVector *, distblk *, distblk *);
+extern void computeSSEBatch     (StorablePicture *ref1, MEBlock*, int, MotionVector *, distblk *, distblk *);
+
 // Bipred SAD
 extern distblk computeBiPredSAD1    (StorablePicture *ref1, StorablePicture *ref2, MEBlock*, distblk, MotionVector *, MotionVector *);
 extern distblk computeBiPred16x16SAD1 (StorablePicture *ref1, StorablePicture *ref2, MEBlock*, distblk, MotionVector *, MotionVector *);
@@ -0,0 +1,32 @@
+
+/*!
+ ************************************************************************
+ * \file
+ *     me_hme.h
+ *
+ * \brief
+ *    Headerfile for the hierarchical motion estimation pre-search
+ *
+ **************************************************************************
+ */
+
+#ifndef _ME_HME_H_
+#define _ME_HME_H_
+
+//! number of pyramid levels (full, 1/2 and 1/4 resolution)
+#define HME_LEVELS  3
+
+//! pre-search results of the current macroblock
+typedef struct hme_params
+{
+  int          mb_addr[6][MAX_LIST_SIZE];  //!< macroblock the cached vector belongs to (-1: none)
+  MotionVector mv     [6][MAX_LIST_SIZE];  //!< pre-search vector (in sub-pel units)
+} HMEParameters;
+
+extern void HMEStructInit          (Slice *currSlice);
+extern void HMEStructDelete        (Slice *currSlice);
+extern void generate_hme_pyramid   (VideoParameters *p_Vid, StorablePicture *s);
+extern void free_hme_pyramid       (StorablePicture *s);
+extern int  get_hme_predictor      (Macroblock *currMB, MEBlock *mv_block, MotionVector *pred_mv, int lambda_factor, MotionVector *hme_mv);
+
+#endif
@@ -50,6 +50,7 @@ extern distblk  rdcost_for_8x8blocks           (Macroblock *currMB, RD_8x8DATA *
 extern void rc_store_diff                  (int diff[16][16], imgpel **p_curImg, int cpix_x,imgpel **prediction);
 
 extern void init_enc_mb_params             (Macroblock* currMB, RD_PARAMS *enc_mb, int intra);
+extern void set_chroma_vector_adjustment   (Slice *currSlice);
 extern void list_prediction_cost           (Macroblock *currMB, int list, int block, int mode, RD_PARAMS *enc_mb, distblk bmcost[5], char best_ref[2]);
 extern void determine_prediction_list      (distblk [5], Info8x8 *, distblk *);
 extern void compute_mode_RD_cost           (Macroblock *currMB, RD_PARAMS *enc_mb, short mode, short *inter_skip);
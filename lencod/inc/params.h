@@ -35,6 +35,7 @@ struct inp_par_enc
     char ExtKeyFile[FILE_NAME_SIZE];     //!Կļ
     int ExtKeyFileEnable;
     char ExtractFrmRng[EX_FRM_RNG_SIZE]; //!ȡ֡ķΧ
+    char MBInfoFile[FILE_NAME_SIZE];     //!< macroblock info file of a decoded stream: reuse its coding decisions (no motion estimation / mode decision)
     
   int no_frames;                        //!< number of frames to be encoded
   int qp[NUM_SLICE_TYPES];              //!< QP values for all slice types
@@ -72,9 +73,12 @@ struct inp_par_enc
 
   int slice_mode;                       //!< Indicate what algorithm to use for setting slices
   int slice_argument;                   //!< Argument to the specified slice algorithm
+  int SliceThreads;                     //!< Number of threads encoding the slices of a picture in parallel (0/1: serial)
   int UseConstrainedIntraPred;          //!< 0: Inter MB pixels are allowed for intra prediction 1: Not allowed
   int  SetFirstAsLongTerm;              //!< Support for temporal considerations for CB plus encoding
   int  infile_header;                   //!< If input file has a header set this to the length of the header
+  int  PrefetchFrames;                  //!< Number of source frames read and converted ahead of the encoder (0: disabled)
+  int  InputMemoryMap;                  //!< Memory map the input file instead of reading it
   int  MultiSourceData;
   VideoDataFile   input_file2;          //!< Input video file2
   VideoDataFile   input_file3;          //!< Input video file3
@@ -169,6 +173,7 @@ struct inp_par_enc
   int RDPictureDirectMode;           //!< Whether to check the other direct mode for B slices
   int RDPictureFrameQPPSlice;        //!< Whether to check additional frame level QP values for P slices
   int RDPictureFrameQPBSlice;        //!< Whether to check additional frame level QP values for B slices
+  int RDPictureThreads;              //!< Number of threads coding independent RD picture decision passes concurrently (0/1: serial)
 
   int SkipIntraInInterSlices;        //!< Skip intra type checking in inter slices if best_mode is skip/direct
   int BRefPictures;                  //!< B coded reference pictures replace P pictures (0: not used, 1: used)
@@ -226,6 +231,7 @@ struct inp_par_enc
   int Distortion[TOTAL_DIST_TYPES];
   double VisualResWavPSNR;
   int SSIMOverlapSize;
+  int SSIMThreads;              //!< Number of threads computing the SSIM metrics (0/1: serial)
   int DistortionYUVtoRGB;
   int CtxAdptLagrangeMult;    //!< context adaptive lagrangian multiplier
   int FastCrIntraDecision;
@@ -233,6 +239,7 @@ struct inp_par_enc
   int nobskip;
   int BiasSkipRDO;
   int ForceTrueRateRDO;
+  int CABACRateEst;             //!< Estimate the CABAC rate of the RDO trials from the context states instead of coding them
 
 #ifdef _LEAKYBUCKET_
   int  NumberLeakyBuckets;
@@ -242,6 +249,7 @@ struct inp_par_enc
 
   int PicInterlace;           //!< picture adaptive frame/field  ͼ񽻴
   int MbInterlace;            //!< macroblock adaptive frame/field
+  int PAFFThreads;            //!< Number of threads coding the frame and the top field of adaptive frame/field coding concurrently (0/1: serial)
   int IntraBottom;            //!< Force Intra Bottom at GOP periods.
 
   // Error resilient RDO parameters
@@ -257,6 +265,8 @@ struct inp_par_enc
   int RandomIntraMBRefresh;     //!< Number of pseudo-random intra-MBs per picture
 
   int OnTheFlyFractMCP;         //!< On the fly interpolation mode
+  int SubPelThreads;            //!< Number of threads interpolating the luma sub-pel planes (0/1: serial)
+  int LazySubPel;               //!< Interpolate the luma sub-pel planes band by band when motion estimation first reads them
 
   // Chroma interpolation and buffering
   int ChromaMCBuffer;
@@ -265,6 +275,7 @@ struct inp_par_enc
   int MESoftenSSEMetric;
   int MEErrorMetric[3];
   int ModeDecisionMetric;
+  int DistortionSIMD;           //!< Instruction set extensions used by the distortion kernels (0: none, 1: SSE4.1, 2: AVX2)
   int SkipDeBlockNonRef;
   
   //  Deblocking Filter parameters
@@ -323,6 +334,8 @@ struct inp_par_enc
 
   // Search Algorithm
   SearchType SearchMode[2];
+  int HMEEnable;                //!< Hierarchical (1/2, 1/4 resolution) pre-search seeding EPZS / UMHexagon
+  int MERefThreads;             //!< Number of threads searching the references of a partition concurrently (0/1: serial)
   
   // UMHEX related parameters
   int UMHexDSR;
@@ -386,6 +399,7 @@ struct inp_par_enc
   // Fast Mode Decision
   int EarlySkipEnable;
   int SelectiveIntraEnable;
+  int FastMDHigh;               //!< Fast high complexity mode decision (0: exhaustive, 1: fast, 2: faster)
   int DisposableP;
   int DispPQPOffset;
 
@@ -402,6 +416,8 @@ struct inp_par_enc
   int PreferDispOrder;       //!< Prefer display order when building the prediction structure as opposed to coding order
   int PreferPowerOfTwo;      //!< Prefer prediction structures that have lengths expressed as powers of two
   int FrmStructBufferLength; //!< Number of frames that is populated every time populate_frm_struct is called
+  int LookAheadFrames;       //!< Number of frames read and analysed ahead by the look-ahead pre-analysis (0: disabled)
+  int LookAheadSceneCut;     //!< Scene cut threshold of the look-ahead pre-analysis, inter to intra cost ratio in percent (0: no scene cut detection)
   // support for "soft" 3:2 pulldown
   int rc_cpb_size;
   int SEIVUI32Pulldown;                //!< Enable 3:2 pulldown through VUI and SEI metadata signalling. Three methods are supported.
@@ -418,6 +434,7 @@ struct inp_par_enc
   int RDOQ_CP_Mode;
   int RDOQ_CP_MV;
   int RDOQ_Fast;
+  int RDOQ_Prune;
 
   int EnableVUISupport;
   // VUI parameters
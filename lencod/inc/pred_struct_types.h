@@ -139,6 +139,8 @@ typedef struct seq_struct
   PredStructAtom *p_prd; // regular prediction structure
   PredStructAtom *p_gop; // IDR GOPs
   PredStructAtom *p_intra_gop; // Intra GOPs
+
+  struct lookahead_params *p_LA; // look-ahead pre-analysis (scene cuts), NULL if disabled
 } SeqStructure;
 
 #endif
@@ -0,0 +1,48 @@
+
+/*!
+ ************************************************************************
+ * \file
+ *     quant_kernels.h
+ *
+ * \brief
+ *    Headerfile for the forward transform and quantization kernels
+ *
+ **************************************************************************
+ */
+
+#ifndef _QUANT_KERNELS_H_
+#define _QUANT_KERNELS_H_
+
+#include "quant_params.h"
+
+//! block quantized by the quantization kernel
+typedef struct quant_block
+{
+  int   **tblock;             //!< transform coefficients, replaced by the reconstructed (dequantized) coefficients
+  int   **fadjust;            //!< adaptive rounding adjustments (NULL: not updated)
+  int    *level;              //!< signed levels in raster order (size * size)
+  LevelQuantParams **q_params;
+  int     block_x;
+  int     size;               //!< 4 or 8
+  int     q_bits;
+  int     qp_per;
+  int     dq_bits;            //!< rounding shift of the dequantization (4: 4x4, 6: 8x8)
+  int     level_limit;        //!< largest level magnitude
+  int     adapt_rnd_weight;
+} QuantBlock;
+
+//! forward transform and quantization kernels (see quant_kernels.c)
+typedef struct transform_quant_kernels
+{
+  void   (*forward4x4)(int **block, int **tblock, int pos_y, int pos_x);
+  void   (*forward8x8)(int **block, int **tblock, int pos_y, int pos_x);
+  uint64 (*quant)     (QuantBlock *qb);
+} TransformQuantKernels;
+
+extern TransformQuantKernels tq_kernels;
+
+extern void init_quant_kernels (int level);
+extern void init_quant_block   (QuantBlock *qb, int **tblock, QuantMethods *q_method, int size, int qp_per, int level_limit, int *level);
+extern void quant_pack_levels  (QuantBlock *qb, uint64 nz, const byte (*pos_scan)[2], int num, int *ACL, int *ACR, const byte *c_cost, int *coeff_cost);
+
+#endif
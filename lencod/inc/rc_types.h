@@ -68,6 +68,7 @@ typedef struct rc_quadratic
   int    MyInitialQp;
   int    PAverageQp;
   double PreviousPictureMAD;
+  int    PPictureFrameNo;       //!< frame_no of the picture of PPictureMAD[0] (look-ahead pre-analysis)
   double MADPictureC1;
   double MADPictureC2;
   double PMADPictureC1;
@@ -94,6 +94,7 @@ extern void alloc_rd8x8data (RD_8x8DATA *rd_data);
 extern void free_rd8x8data  (RD_8x8DATA *rd_data);
 
 extern void restore_nz_coeff(Macroblock *currMB);
+extern void prepare_ipcm_mode(Macroblock *currMB);
 
 extern void end_encode_one_macroblock(Macroblock *currMB);
 
@@ -29,6 +29,8 @@ struct coding_state {
   // contexts for binary arithmetic coding
   MotionInfoContexts   *mot_ctx;
   TextureInfoContexts  *tex_ctx;
+  int                   jpos;   //!< journal position at which the contexts were last synchronized
+  int                   jgen;   //!< journal generation of jpos (-1: contexts not synchronized)
 
   // bit counter
   BitCounter            bits;
@@ -49,5 +51,43 @@ extern void init_coding_state_methods(Slice *currSlice);  //!< Init methods give
 extern void store_coding_state_cavlc (Macroblock *currMB, CSobj *cs);
 extern void reset_coding_state_cavlc (Macroblock *currMB, CSobj *cs);
 
+extern CtxJournal *create_ctx_journal (Slice *currSlice);
+extern void        delete_ctx_journal (CtxJournal *jrnl);
+extern void        clear_ctx_journal  (CtxJournal *jrnl);
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Enters a context written by the arithmetic coder in the journal
+ *    (once per checkpoint epoch)
+ ************************************************************************
+ */
+static inline void ctx_journal_add(CtxJournal *jrnl, BiContextType *bi_ct)
+{
+  int k;
+
+  if (bi_ct >= jrnl->tex_base && bi_ct < jrnl->tex_base + jrnl->num_tex)
+    k = (int) (bi_ct - jrnl->tex_base);
+  else if (bi_ct >= jrnl->mot_base && bi_ct < jrnl->mot_base + (jrnl->num_ctx - jrnl->num_tex))
+    k = jrnl->num_tex + (int) (bi_ct - jrnl->mot_base);
+  else
+  {
+    // not a context of the slice: checkpoints fall back to full copies
+    clear_ctx_journal(jrnl);
+    return;
+  }
+
+  if (jrnl->stamp[k] != jrnl->epoch)
+  {
+    if (jrnl->num == jrnl->size)
+    {
+      clear_ctx_journal(jrnl);
+      return;
+    }
+    jrnl->stamp[k] = jrnl->epoch;
+    jrnl->idx[jrnl->num++] = k;
+  }
+}
+
 #endif
 
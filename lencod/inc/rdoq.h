@@ -18,6 +18,12 @@
 #define _RDOQ_H_
 
 #include <math.h>
+#if (JM_SIMD_DISTORTION) && (defined(__SSE2__) || defined(_M_X64))
+#  define RDOQ_SSE2     1
+#include <emmintrin.h>
+#else
+#  define RDOQ_SSE2     0
+#endif
 
 
 #define SIGN_BITS    1
@@ -148,7 +154,47 @@ typedef struct level_data_struct
 } levelDataStruct;
 
 
+/*!
+ ************************************************************************
+ * \brief
+ *    Rounding remainder from which a coefficient quantized to zero gets a
+ *    level 1 candidate: half a quantization step, or 5/8 of a step with
+ *    RDOQ_Prune (such coefficients are practically never coded)
+ ************************************************************************
+ */
+static inline int rdoq_zero_offset(InputParameters *p_Inp, int q_offset)
+{
+  return p_Inp->RDOQ_Prune ? q_offset + (q_offset >> 2) : q_offset;
+}
+
 extern void init_rdoq_slice(Slice *currSlice);
+/*!
+****************************************************************************
+* \brief
+*    Weighted squared quantization error of the level candidates of a
+*    coefficient (the candidate pair in one SSE2 operation)
+****************************************************************************
+*/
+static inline void rdoq_level_errors(levelDataStruct *dataLevel, int scaled_coeff, int q_bits, double estErr)
+{
+  int k = 0;
+  double err;
+
+#if (RDOQ_SSE2)
+  if (dataLevel->noLevels > 1)
+  {
+    __m128d err2 = _mm_sub_pd(_mm_cvtepi32_pd(_mm_setr_epi32(dataLevel->level[0] << q_bits, dataLevel->level[1] << q_bits, 0, 0)),
+                              _mm_set1_pd((double) scaled_coeff));
+    _mm_storeu_pd(dataLevel->errLevel, _mm_mul_pd(_mm_mul_pd(err2, err2), _mm_set1_pd(estErr)));
+    k = 2;
+  }
+#endif
+  for (; k < dataLevel->noLevels; k++)
+  {
+    err = (double)(dataLevel->level[k] << q_bits) - (double)scaled_coeff;
+    dataLevel->errLevel[k] = (err * err * estErr);
+  }
+}
 
 /*----------CAVLC related functions----------*/
 extern void est_RunLevel_CAVLC(Macroblock *currMB, levelDataStruct *levelData, int *levelTrellis, int block_type, 
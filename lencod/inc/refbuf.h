@@ -12,17 +12,26 @@
 
 #include "mbuffer.h"
 
+extern void get_sub_images_luma_rows (StorablePicture *s, int y0, int y1);
+
 /*!
  ************************************************************************
  * \brief
  *    Yields a pel line _pointer_ from one of the 16 sub-images
  *    Input does not require subpixel image indices
+ *    (the lines of a block, up to MB_BLOCK_SIZE lines, are interpolated
+ *    first if the picture is interpolated on demand)
  ************************************************************************
  */
 static inline imgpel *UMVLine4X (StorablePicture *ref, int y, int x)
 {
+  int y_int = iClip3( -IMG_PAD_SIZE_Y, ref->size_y_pad, y >> 2);
+
+  if (ref->subpel_bands != NULL && ((y | x) & 0x03))
+    get_sub_images_luma_rows(ref, y_int, y_int + MB_BLOCK_SIZE - 1);
+
   //return &(ref->p_curr_img_sub[(y & 0x03)][(x & 0x03)][iClip3( 0, ref->size_y_pad, y >> 2)][iClip3( 0, ref->size_x_pad, x >> 2)]);
-  return &(ref->p_curr_img_sub[(y & 0x03)][(x & 0x03)][iClip3( -IMG_PAD_SIZE_Y, ref->size_y_pad, y >> 2)][iClip3(-IMG_PAD_SIZE_X, ref->size_x_pad, x >> 2)]);
+  return &(ref->p_curr_img_sub[(y & 0x03)][(x & 0x03)][y_int][iClip3(-IMG_PAD_SIZE_X, ref->size_x_pad, x >> 2)]);
 }
 
 /*!
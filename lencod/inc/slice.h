@@ -36,6 +36,41 @@ static const int QP2QUANT[40]=
 
 extern int  encode_one_slice       ( VideoParameters *p_Vid, int SliceGroupId, int TotalCodedMBs );
 extern int  encode_one_slice_MBAFF ( VideoParameters *p_Vid, int SliceGroupId, int TotalCodedMBs );
+
+//! slices of a picture coded concurrently (see prepare_slices_parallel())
+typedef struct slice_jobs
+{
+  int               num_slices;
+  Slice           **slices;
+  Macroblock      **last_mb;       //!< last coded macroblock of each slice
+  int              *coded_mbs;
+  VideoParameters  *vid_copy;      //!< private VideoParameters of each slice
+  StatParameters   *mb_stats;      //!< macroblock statistics of each slice
+  StatParameters   *vid_stats;     //!< private p_Vid->p_Stats of each slice
+  Block8x8Info     *b8x8info;
+  distblk       *****motion_cost;
+#if TRACE
+  TraceBuffer      *trace;         //!< trace output of each slice
+#endif
+
+  // state of the shared VideoParameters before the slices
+  Block8x8Info     *main_b8x8info;
+  distblk        ****main_motion_cost;
+  StatParameters   *main_stats;
+  int               SumFrameQP;
+  int               NumberofCodedMacroBlocks;
+  int               intras;
+  int               iInterViewMBs;
+  int64             me_time;
+  int64             me_tot_time;
+  FastMDState       fast_md;
+} SliceJobs;
+
+extern int  encode_slices_parallel  ( VideoParameters *p_Vid, int SliceGroupId, int TotalCodedMBs );
+extern void prepare_slices_parallel ( VideoParameters *p_Vid, int SliceGroupId, int TotalCodedMBs, SliceJobs *jobs );
+extern void encode_slice_jobs       ( SliceJobs **jobs, int num_pictures, int num_threads );
+extern int  close_slices_parallel   ( VideoParameters *p_Vid, SliceJobs *jobs, int TotalCodedMBs );
+
 extern void init_slice             ( VideoParameters *p_Vid, Slice **currSlice, int start_mb_addr );
 extern void init_slice_lite        ( VideoParameters *p_Vid, Slice **currSlice, int start_mb_addr );
 extern void free_slice_list        ( Picture *currPic );
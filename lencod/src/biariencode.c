@@ -19,10 +19,32 @@
 
 #include "global.h"
 #include "biariencode.h"
+#include "rdopt_coding_state.h"
 
 // Range table for LPS
 static const byte renorm_table_32[32]={6,5,4,4,3,3,3,3,2,2,2,2,2,2,2,2,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1};
 
+// Rate of a bin in 1/32768 bits, indexed by 63 - state for the MPS and 64 + state for the LPS
+const int entropyBits[128]= 
+{
+     895,    943,    994,   1048,   1105,   1165,   1228,   1294, 
+    1364,   1439,   1517,   1599,   1686,   1778,   1875,   1978, 
+    2086,   2200,   2321,   2448,   2583,   2725,   2876,   3034, 
+    3202,   3380,   3568,   3767,   3977,   4199,   4435,   4684, 
+    4948,   5228,   5525,   5840,   6173,   6527,   6903,   7303, 
+    7727,   8178,   8658,   9169,   9714,  10294,  10914,  11575, 
+   12282,  13038,  13849,  14717,  15650,  16653,  17734,  18899, 
+   20159,  21523,  23005,  24617,  26378,  28306,  30426,  32768, 
+   32768,  35232,  37696,  40159,  42623,  45087,  47551,  50015, 
+   52479,  54942,  57406,  59870,  62334,  64798,  67262,  69725, 
+   72189,  74653,  77117,  79581,  82044,  84508,  86972,  89436, 
+   91900,  94363,  96827,  99291, 101755, 104219, 106683, 109146, 
+  111610, 114074, 116538, 119002, 121465, 123929, 126393, 128857, 
+  131321, 133785, 136248, 138712, 141176, 143640, 146104, 148568, 
+  151031, 153495, 155959, 158423, 160887, 163351, 165814, 168278, 
+  170742, 173207, 175669, 178134, 180598, 183061, 185525, 187989
+};
+
 
 void reset_pic_bin_count(VideoParameters *p_Vid)
 {
@@ -174,6 +196,21 @@ void arienco_start_encoding(EncodingEnvironmentPtr eep,
   eep->Erange = HALF;
 }
 
+/*!
+ ************************************************************************
+ * \brief
+ *    Switches the EncodingEnvironment between arithmetic coding and
+ *    rate estimation. In estimation mode the symbols only update their
+ *    contexts and add the table rate of their state to Efrac; the coding
+ *    interval and the bitstream are left untouched.
+ ************************************************************************
+ */
+void arienco_set_estimation(EncodingEnvironmentPtr eep, int estimate)
+{
+  eep->Eest  = estimate;
+  eep->Efrac = 0;
+}
+
 /*!
 ************************************************************************
 * \brief
@@ -356,10 +393,30 @@ void biari_encode_symbol(EncodingEnvironmentPtr eep, int symbol, BiContextTypePt
   int bl = eep->Ebits_to_go;
   unsigned int rLPS = rLPS_table_64x4[bi_ct->state][(range>>6) & 3]; 
 
+  bi_ct->count += eep->p_Vid->cabac_encoding;
+  if (eep->journal != NULL)
+    ctx_journal_add(eep->journal, bi_ct);
+
+  if (eep->Eest)
+  {
+    if ((symbol != 0) == bi_ct->MPS)
+    {
+      eep->Efrac += entropyBits[63 - bi_ct->state];
+      bi_ct->state = AC_next_state_MPS_64[bi_ct->state];
+    }
+    else
+    {
+      eep->Efrac += entropyBits[64 + bi_ct->state];
+      if (!bi_ct->state)
+        bi_ct->MPS ^= 0x01;
+      bi_ct->state = AC_next_state_LPS_64[bi_ct->state];
+    }
+    return;
+  }
+
   range -= rLPS;
 
   ++(eep->C);
-  bi_ct->count += eep->p_Vid->cabac_encoding;
 
   /* covers all cases where code does not bother to shift down symbol to be 
   * either 0 or 1, e.g. in some cases for cbp, mb_Type etc the code simply 
@@ -440,6 +497,13 @@ void biari_encode_symbol(EncodingEnvironmentPtr eep, int symbol, BiContextTypePt
 void biari_encode_symbol_eq_prob(EncodingEnvironmentPtr eep, int symbol)
 {
   unsigned int low = eep->Elow;
+
+  if (eep->Eest)
+  {
+    eep->Efrac += 1 << ENTROPY_BITS_PREC;
+    return;
+  }
+
   --(eep->Ebits_to_go);  
   ++(eep->C);
 
@@ -486,6 +550,14 @@ void biari_encode_symbol_final(EncodingEnvironmentPtr eep, int symbol)
   unsigned int low = eep->Elow;
   int bl = eep->Ebits_to_go; 
 
+  if (eep->Eest)
+  {
+    // the terminating bin costs about 7 bits when it is set and nothing otherwise
+    if (symbol != 0)
+      eep->Efrac += 7 << ENTROPY_BITS_PREC;
+    return;
+  }
+
   ++(eep->C);
 
   if (symbol == 0) // MPS
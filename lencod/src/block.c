@@ -37,6 +37,7 @@
 #include "q_offsets.h"
 #include "q_matrix.h"
 #include "quant4x4.h"
+#include "quant_kernels.h"
 #include "quantChroma.h"
 #include "md_common.h"
 #include "transform8x8.h"
@@ -266,7 +267,7 @@ int residual_transform_quant_luma_16x16(Macroblock *currMB, ColorPlane pl)
   {
     for (i = 0;i < 16; i+=4)
     {
-      forward4x4(currSlice->tblk16x16, currSlice->tblk16x16, j, i);
+      tq_kernels.forward4x4(currSlice->tblk16x16, currSlice->tblk16x16, j, i);
     }
   }
 
@@ -697,7 +698,7 @@ int residual_transform_quant_luma_4x4(Macroblock *currMB, ColorPlane pl, int blo
     currMB->subblock_y = (b8<2)        ? ((b4<2)       ? 0: 4) : ((b4<2)       ? 8: 12); // vert.  position for coeff_count context
 
     //  Forward 4x4 transform
-    forward4x4(mb_ores, currSlice->tblk16x16, block_y, block_x);
+    tq_kernels.forward4x4(mb_ores, currSlice->tblk16x16, block_y, block_x);
 
     // Quantization process
     nonzero = currSlice->quant_4x4(currMB, &currSlice->tblk16x16[block_y], &quant_methods);
@@ -1021,7 +1022,7 @@ int residual_transform_quant_chroma_4x4(Macroblock *currMB, int uv, int cr_cbp)
       }
       else
       {
-        forward4x4(mb_ores, mb_rres, n2, n1);
+        tq_kernels.forward4x4(mb_ores, mb_rres, n2, n1);
         //empty_block = FALSE;
       }
     }
@@ -737,6 +737,57 @@ void read_slice_group_info(VideoParameters *p_Vid, InputParameters *p_Inp)
   fclose(sgfile);
 }
 
+/*!
+ ***********************************************************************
+ * \brief
+ *    Checks whether picture coding passes can be coded concurrently
+ *    (RDPictureThreads, PAFFThreads): the passes are coded on private
+ *    macroblock buffers and may not share state updated in coding order
+ *
+ * \return
+ *    TRUE if supported, FALSE otherwise (a warning is printed)
+ ***********************************************************************
+ */
+static int test_picture_threads (InputParameters *p_Inp, char *name)
+{
+#if defined(OPENMP)
+  if (p_Inp->slice_mode > 1)
+  {
+    printf("Warning: %s requires SliceMode = 0 or 1. Process Disabled.\n", name);
+    return FALSE;
+  }
+  if (p_Inp->num_slice_groups_minus1 != 0 || p_Inp->separate_colour_plane_flag != 0 || p_Inp->num_of_views > 1)
+  {
+    printf("Warning: %s not supported with FMO, separate colour planes or MVC. Process Disabled.\n", name);
+    return FALSE;
+  }
+  if (p_Inp->RCEnable || p_Inp->AdaptiveRounding || p_Inp->WPIterMC || p_Inp->ExtractionOn || p_Inp->ExtractionPrint)
+  {
+    printf("Warning: %s not supported with RateControlEnable, AdaptiveRounding, WPIterMC, ExtractionOn or ExtractionPrint. Process Disabled.\n", name);
+    return FALSE;
+  }
+  if ((p_Inp->SearchMode[0] != FULL_SEARCH && p_Inp->SearchMode[0] != EPZS) || p_Inp->rdopt == 3)
+  {
+    printf("Warning: %s requires SearchMode = -1 or 3 and RDOptimization != 3. Process Disabled.\n", name);
+    return FALSE;
+  }
+  if (p_Inp->FastMDHigh || p_Inp->CtxAdptLagrangeMult || p_Inp->RestrictRef || p_Inp->RandomIntraMBRefresh || p_Inp->sp_periodicity || p_Inp->si_frame_indicator)
+  {
+    printf("Warning: %s not supported with FastMDHigh, CtxAdptLagrangeMult, RestrictRefFrames, RandomIntraMBRefresh or SP/SI slices. Process Disabled.\n", name);
+    return FALSE;
+  }
+#if TRACE
+  printf("Warning: %s not supported with trace output (TRACE in defines.h). Process Disabled.\n", name);
+  return FALSE;
+#else
+  return TRUE;
+#endif
+#else
+  printf("Warning: %s requires OpenMP support (define OPENMP in win32.h and build with OPENMP=1). Process Disabled.\n", name);
+  return FALSE;
+#endif
+}
+
 /*!
  ***********************************************************************
  * \brief
@@ -932,6 +983,121 @@ static void PatchInp (VideoParameters *p_Vid, InputParameters *p_Inp)
   }
 #endif
 
+  // Parallel slice encoding: the slices must be independent of each other
+  // and of any state that is updated in macroblock coding order
+  if (p_Inp->SliceThreads > 1)
+  {
+    if (p_Inp->slice_mode != 1)
+    {
+      printf("Warning: SliceThreads requires SliceMode = 1. Process Disabled.\n");
+      p_Inp->SliceThreads = 0;
+    }
+    else if (p_Inp->num_slice_groups_minus1 != 0 || p_Inp->MbInterlace != 0 || p_Inp->separate_colour_plane_flag != 0 || p_Inp->num_of_views > 1)
+    {
+      printf("Warning: SliceThreads not supported with FMO, MBAFF, separate colour planes or MVC. Process Disabled.\n");
+      p_Inp->SliceThreads = 0;
+    }
+    else if (p_Inp->RCEnable || p_Inp->AdaptiveRounding || p_Inp->WPIterMC)
+    {
+      printf("Warning: SliceThreads not supported with RateControlEnable, AdaptiveRounding or WPIterMC. Process Disabled.\n");
+      p_Inp->SliceThreads = 0;
+    }
+    else if (p_Inp->ExtractionOn && p_Inp->symbol_mode == CABAC)
+    {
+      // the perturbed mvds are rewritten in the bitstream of each slice
+      printf("Warning: SliceThreads with ExtractionOn requires SymbolMode = 0 (CAVLC). Process Disabled.\n");
+      p_Inp->SliceThreads = 0;
+    }
+    else if ((p_Inp->SearchMode[0] != FULL_SEARCH && p_Inp->SearchMode[0] != EPZS) || p_Inp->rdopt == 3)
+    {
+      printf("Warning: SliceThreads requires SearchMode = -1 or 3 and RDOptimization != 3. Process Disabled.\n");
+      p_Inp->SliceThreads = 0;
+    }
+  }
+
+  // Concurrent RD picture decision passes: the passes are coded on private
+  // macroblock buffers and may not share state updated in coding order
+  if (p_Inp->RDPictureThreads > 1)
+  {
+    if (!p_Inp->RDPictureDecision || p_Inp->PicInterlace != 0 || p_Inp->MbInterlace != 0)
+    {
+      printf("Warning: RDPictureThreads requires RDPictureDecision = 1 and progressive coding. Process Disabled.\n");
+      p_Inp->RDPictureThreads = 0;
+    }
+    else if (!test_picture_threads(p_Inp, "RDPictureThreads"))
+      p_Inp->RDPictureThreads = 0;
+  }
+
+  // Concurrent frame and top field coding of adaptive frame/field coding
+  if (p_Inp->PAFFThreads > 1)
+  {
+    if (p_Inp->PicInterlace != ADAPTIVE_CODING || p_Inp->MbInterlace != 0 || p_Inp->RDPictureDecision)
+    {
+      printf("Warning: PAFFThreads requires PicInterlace = 2, MbInterlace = 0 and RDPictureDecision = 0. Process Disabled.\n");
+      p_Inp->PAFFThreads = 0;
+    }
+    else if (!test_picture_threads(p_Inp, "PAFFThreads"))
+      p_Inp->PAFFThreads = 0;
+  }
+
+  // Concurrent motion search in the references of a partition: only the full
+  // searches keep no state across the references (EPZS and UMHexagon do)
+  if (p_Inp->MERefThreads > 1)
+  {
+    if ((p_Inp->SearchMode[0] != FULL_SEARCH && p_Inp->SearchMode[0] != FAST_FULL_SEARCH)
+      || (p_Inp->num_of_views == 2 && p_Inp->SearchMode[1] != FULL_SEARCH && p_Inp->SearchMode[1] != FAST_FULL_SEARCH)
+      || p_Inp->OnTheFlyFractMCP || p_Inp->rdopt == 0)
+    {
+      printf("Warning: MERefThreads requires SearchMode = -1 or 0, OnTheFlyFractMCP = 0 and RDOptimization != 0. Process Disabled.\n");
+      p_Inp->MERefThreads = 0;
+    }
+  }
+
+  // Band wise luma interpolation: the on demand interpolation is done from
+  // UMVLine4X(), so every sub-pel read has to go through it in coding order
+  if (p_Inp->LazySubPel)
+  {
+    if (p_Inp->OnTheFlyFractMCP || p_Inp->WPIterMC || p_Inp->SliceThreads > 1 || p_Inp->RDPictureThreads > 1 || p_Inp->PAFFThreads > 1 || p_Inp->MERefThreads > 1 || (p_Inp->yuv_format == YUV444 && !p_Inp->separate_colour_plane_flag))
+    {
+      printf("Warning: LazySubPel not supported with OnTheFlyFractMCP, WPIterMC, SliceThreads, RDPictureThreads, PAFFThreads, MERefThreads or 4:4:4 coding with joined colour planes. Process Disabled.\n");
+      p_Inp->LazySubPel = 0;
+    }
+    else if (p_Inp->SubPelThreads > 1)
+    {
+      printf("Warning: LazySubPel interpolates the bands on demand in a single thread. SubPelThreads Disabled.\n");
+      p_Inp->SubPelThreads = 0;
+    }
+  }
+#if !defined(OPENMP)
+  if (p_Inp->SubPelThreads > 1)
+  {
+    printf("Warning: SubPelThreads requires OpenMP support (define OPENMP in win32.h and build with OPENMP=1). Process Disabled.\n");
+    p_Inp->SubPelThreads = 0;
+  }
+  if (p_Inp->SSIMThreads > 1)
+  {
+    printf("Warning: SSIMThreads requires OpenMP support (define OPENMP in win32.h and build with OPENMP=1). Process Disabled.\n");
+    p_Inp->SSIMThreads = 0;
+  }
+  if (p_Inp->MERefThreads > 1)
+  {
+    printf("Warning: MERefThreads requires OpenMP support (define OPENMP in win32.h and build with OPENMP=1). Process Disabled.\n");
+    p_Inp->MERefThreads = 0;
+  }
+#endif
+
+  if (p_Inp->CABACRateEst && (p_Inp->symbol_mode != CABAC || p_Inp->rdopt == 0))
+  {
+    printf("Warning: CABACRateEst requires CABAC and RDOptimization. Process Disabled.\n");
+    p_Inp->CABACRateEst = 0;
+  }
+
+  if (p_Inp->FastMDHigh && p_Inp->rdopt != 1)
+  {
+    printf("Warning: FastMDHigh requires RDOptimization = 1. Process Disabled.\n");
+    p_Inp->FastMDHigh = 0;
+  }
+
   
   
   if ((p_Inp->slice_mode == 1)&&(p_Inp->MbInterlace != 0))
@@ -1336,6 +1502,32 @@ static void PatchInp (VideoParameters *p_Vid, InputParameters *p_Inp)
     )
     p_Inp->EPZSSubPelGrid = 0;
 
+  if (p_Inp->HMEEnable && (p_Inp->separate_colour_plane_flag != 0 || (p_Inp->SearchMode[0] <= FAST_FULL_SEARCH
+#if (MVC_EXTENSION_ENABLE)
+    && (!p_Inp->SepViewInterSearch || p_Inp->SearchMode[1] <= FAST_FULL_SEARCH)
+#endif
+    )))
+  {
+    printf("Warning: HMEEnable requires SearchMode = 1, 2 or 3 and no separate colour planes. Process Disabled.\n");
+    p_Inp->HMEEnable = 0;
+  }
+
+  if (p_Inp->PrefetchFrames && p_Inp->enable_32_pulldown)
+  {
+    printf("Warning: PrefetchFrames is not supported with 3:2 pulldown. Process Disabled.\n");
+    p_Inp->PrefetchFrames = 0;
+  }
+
+  if (p_Inp->LookAheadFrames && (p_Inp->enable_32_pulldown
+#if (MVC_EXTENSION_ENABLE)
+    || p_Inp->num_of_views > 1
+#endif
+    ))
+  {
+    printf("Warning: LookAheadFrames is not supported with 3:2 pulldown or multiple views. Process Disabled.\n");
+    p_Inp->LookAheadFrames = 0;
+  }
+
   if (p_Inp->redundant_pic_flag)
   {
     if (p_Inp->PicInterlace || p_Inp->MbInterlace)
@@ -1422,6 +1614,27 @@ static void PatchInp (VideoParameters *p_Vid, InputParameters *p_Inp)
     p_Inp->RDOQ_CP_Mode = 0;
   }
 
+  // Re-encoding with the coding decisions of a decoded stream: every macroblock
+  // is coded exactly once, in coding order, with the recorded QP
+  if (strlen(p_Inp->MBInfoFile) > 0)
+  {
+    if (p_Inp->PicInterlace || p_Inp->MbInterlace || p_Inp->separate_colour_plane_flag || p_Inp->yuv_format == YUV444 || p_Inp->sp_periodicity)
+    {
+      snprintf(errortext, ET_SIZE, "MBInfoFile is not supported with interlaced coding, 4:4:4 or SP pictures.");
+      error (errortext, 500);
+    }
+    if (p_Inp->RCEnable || p_Inp->RDPictureDecision || p_Inp->RDOQ_QP_Num > 1 || p_Inp->SliceThreads)
+    {
+      printf("Warning: RateControlEnable, RDPictureDecision, RDOQ_QP_Num > 1 and SliceThreads are not supported with MBInfoFile. Processes Disabled.\n");
+      p_Inp->RCEnable = 0;
+      p_Inp->RDPictureDecision = 0;
+      p_Inp->RDOQ_QP_Num = 1;
+      p_Inp->RDOQ_CP_MV = 0;
+      p_Inp->RDOQ_CP_Mode = 0;
+      p_Inp->SliceThreads = 0;
+    }
+  }
+
   if(p_Inp->num_slice_groups_minus1 > 0 && (p_Inp->GenerateMultiplePPS ==1 && p_Inp->RDPictureDecision == 1))
   {
     printf("Warning: Weighted Prediction may not function correctly for multiple slices\n"); 
@@ -1519,6 +1732,7 @@ static void PatchInp (VideoParameters *p_Vid, InputParameters *p_Inp)
     p_Inp->RDPictureDirectMode    = 0;
     p_Inp->RDPictureFrameQPPSlice = 0;
     p_Inp->RDPictureFrameQPBSlice = 0;
+    p_Inp->RDPictureThreads       = 0;
   }
 }
 
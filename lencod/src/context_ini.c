@@ -22,6 +22,7 @@
 #include "ctx_tables.h"
 #include "biariencode.h"
 #include "memalloc.h"
+#include "rdopt_coding_state.h"
 
 #define DEFAULT_CTX_MODEL   0
 #define RELIABLE_COUNT      32.0
@@ -193,6 +194,10 @@ void init_contexts (Slice *currSlice)
     BIARI_CTX_INIT2 (qp, NUM_BLOCK_TYPES, NUM_LAST_CTX, tc->last_contexts[1], INIT_FLD_LAST_P[model_number]);
 #endif
   }
+
+  // checkpoints taken before the initialization are stale
+  if (currSlice->ctx_journal != NULL)
+    clear_ctx_journal(currSlice->ctx_journal);
 }
 
 
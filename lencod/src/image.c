@@ -40,6 +40,7 @@
 #include "intrarefresh.h"
 #include "slice.h"
 #include "fmo.h"
+#include "macroblock.h"
 #include "sei.h"
 #include "memalloc.h"
 #include "fast_memory.h"
@@ -67,6 +68,8 @@
 //#include "resize.h"
 #include "md_common.h"
 #include "me_epzs_common.h"
+#include "me_hme.h"
+#include "input_prefetch.h"
 
 extern void UpdateDecoders            (VideoParameters *p_Vid, InputParameters *p_Inp, StorablePicture *enc_pic);
 
@@ -74,6 +77,12 @@ extern void DeblockFrame              (VideoParameters *p_Vid, imgpel **, imgpel
 
 static void code_a_picture            (VideoParameters *p_Vid, Picture *pic);
 static void field_picture             (VideoParameters *p_Vid, Picture *top, Picture *bottom);
+static void init_top_field            (VideoParameters *p_Vid);
+static void end_top_field             (VideoParameters *p_Vid, Picture *top);
+static void code_bottom_field         (VideoParameters *p_Vid, Picture *top, Picture *bottom);
+#if defined(OPENMP)
+static void frame_and_field_pictures  (VideoParameters *p_Vid);
+#endif
 static void prepare_enc_frame_picture (VideoParameters *p_Vid, StorablePicture **stored_pic);
 #if (MVC_EXTENSION_ENABLE)
 static void writeout_picture          (VideoParameters *p_Vid, Picture *pic, int is_bottom);
@@ -175,15 +184,14 @@ void set_slice_type(VideoParameters *p_Vid, InputParameters *p_Inp, int slice_ty
   p_Vid->RCMaxQP = p_Inp->RCMaxQP[p_Vid->type];
 }
 
-extern int  *g_ExtractFrmRng;
-extern int  g_ExtFrmRngSize;
-
-static void code_a_plane(VideoParameters *p_Vid, InputParameters *p_Inp)
+/*!
+ ************************************************************************
+ * \brief
+ *    Picture level initialization of the coding of a plane
+ ************************************************************************
+ */
+static void init_plane_coding(VideoParameters *p_Vid, InputParameters *p_Inp)
 {
-  unsigned int NumberOfCodedMBs = 0;
-  int SliceGroup = 0;  //SliceGroup ID
-  DistMetric distortion; 
-
   // The slice_group_change_cycle can be changed here.
   // FmoInit() is called before coding each picture, frame or field
   p_Vid->slice_group_change_cycle=1;
@@ -201,6 +209,56 @@ static void code_a_plane(VideoParameters *p_Vid, InputParameters *p_Inp)
 
   reset_pic_bin_count(p_Vid);
   p_Vid->bytes_in_picture = 0;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Completes the coding of a plane (deblocking)
+ ************************************************************************
+ */
+static void end_plane_coding(VideoParameters *p_Vid, InputParameters *p_Inp)
+{
+  DistMetric distortion; 
+
+  FmoEndPicture ();
+
+  if ((p_Inp->SkipDeBlockNonRef == 0) || (p_Vid->nal_reference_idc != 0))
+  {
+    if(p_Inp->RDPictureDeblocking && !p_Vid->TurnDBOff)
+    {
+      find_distortion(p_Vid, &p_Vid->imgData);
+      distortion.value[0] = p_Vid->p_Dist->metric[SSE].value[0];
+      distortion.value[1] = p_Vid->p_Dist->metric[SSE].value[1];
+      distortion.value[2] = p_Vid->p_Dist->metric[SSE].value[2];
+    }
+    else
+      distortion.value[0] = distortion.value[1] = distortion.value[2] = 0;
+
+    //ȥ˲
+    DeblockFrame (p_Vid, p_Vid->enc_picture->imgY, p_Vid->enc_picture->imgUV); //comment out to disable deblocking filter
+
+    if(p_Inp->RDPictureDeblocking && !p_Vid->TurnDBOff)
+    {
+      find_distortion(p_Vid, &p_Vid->imgData);
+      if(distortion.value[0]+distortion.value[1]+distortion.value[2] < 
+        p_Vid->p_Dist->metric[SSE].value[0]+
+        p_Vid->p_Dist->metric[SSE].value[1]+
+        p_Vid->p_Dist->metric[SSE].value[2])
+      {
+        p_Vid->EvaluateDBOff = 1; 
+      }
+    }
+  }
+
+}
+
+static void code_a_plane(VideoParameters *p_Vid, InputParameters *p_Inp)
+{
+  unsigned int NumberOfCodedMBs = 0;
+  int SliceGroup = 0;  //SliceGroup ID
+
+  init_plane_coding(p_Vid, p_Inp);
 
     int i;
     
@@ -214,6 +272,12 @@ static void code_a_plane(VideoParameters *p_Vid, InputParameters *p_Inp)
     while (!FmoSliceGroupCompletelyCoded (p_Vid, SliceGroup))
     {
       // Encode the current slice
+      if (p_Inp->SliceThreads > 1 && !p_Vid->mb_aff_frame_flag)
+      {
+        // all remaining slices of the slice group at once
+        NumberOfCodedMBs += encode_slices_parallel (p_Vid, SliceGroup, NumberOfCodedMBs);
+      }
+      else
       if (!p_Vid->mb_aff_frame_flag)
       {     
         NumberOfCodedMBs += encode_one_slice (p_Vid, SliceGroup, NumberOfCodedMBs);
@@ -232,37 +296,26 @@ static void code_a_plane(VideoParameters *p_Vid, InputParameters *p_Inp)
     // Proceed to next SliceGroup
     SliceGroup++;
   }
-  FmoEndPicture ();
 
-  if ((p_Inp->SkipDeBlockNonRef == 0) || (p_Vid->nal_reference_idc != 0))
-  {
-    if(p_Inp->RDPictureDeblocking && !p_Vid->TurnDBOff)
-    {
-      find_distortion(p_Vid, &p_Vid->imgData);
-      distortion.value[0] = p_Vid->p_Dist->metric[SSE].value[0];
-      distortion.value[1] = p_Vid->p_Dist->metric[SSE].value[1];
-      distortion.value[2] = p_Vid->p_Dist->metric[SSE].value[2];
-    }
-    else
-      distortion.value[0] = distortion.value[1] = distortion.value[2] = 0;
+  end_plane_coding(p_Vid, p_Inp);
+}
 
-    //ȥ˲
-    DeblockFrame (p_Vid, p_Vid->enc_picture->imgY, p_Vid->enc_picture->imgUV); //comment out to disable deblocking filter
+/*!
+ ************************************************************************
+ * \brief
+ *    Picture level initialization of code_a_picture()
+ ************************************************************************
+ */
+static void init_picture_coding(VideoParameters *p_Vid, Picture *pic)
+{
+  p_Vid->currentPicture = pic;  //ǰͼ
+  p_Vid->currentPicture->idr_flag = get_idr_flag(p_Vid);
 
-    if(p_Inp->RDPictureDeblocking && !p_Vid->TurnDBOff)
-    {
-      find_distortion(p_Vid, &p_Vid->imgData);
-      if(distortion.value[0]+distortion.value[1]+distortion.value[2] < 
-        p_Vid->p_Dist->metric[SSE].value[0]+
-        p_Vid->p_Dist->metric[SSE].value[1]+
-        p_Vid->p_Dist->metric[SSE].value[2])
-      {
-        p_Vid->EvaluateDBOff = 1; 
-      }
-    }
-  }
+  pic->no_slices = 0;
 
+  RandomIntraNewPicture (p_Vid);     //! Allocates forced INTRA MBs (even for fields!)
 }
+
 /*!
  ************************************************************************
  * \brief
@@ -280,12 +333,7 @@ static void code_a_picture(VideoParameters *p_Vid, Picture *pic)
   InputParameters *p_Inp = p_Vid->p_Inp;
   int pl;
 
-  p_Vid->currentPicture = pic;  //ǰͼ
-  p_Vid->currentPicture->idr_flag = get_idr_flag(p_Vid);
-
-  pic->no_slices = 0;
-
-  RandomIntraNewPicture (p_Vid);     //! Allocates forced INTRA MBs (even for fields!)
+  init_picture_coding(p_Vid, pic);
   if( (p_Inp->separate_colour_plane_flag != 0) )
   {
     for( pl=0; pl<MAX_PLANE; pl++ )
@@ -384,6 +432,10 @@ void update_global_stats(InputParameters *p_Inp, StatParameters *gl_stats, StatP
       gl_stats->intra_chroma_mode[i]    += cur_stats->intra_chroma_mode[i];
     }
 
+    gl_stats->md_tested        += cur_stats->md_tested;
+    gl_stats->md_pruned        += cur_stats->md_pruned;
+    gl_stats->md_sub8x8_pruned += cur_stats->md_sub8x8_pruned;
+
     for (i = 0; i < 5; i++)
     {
       gl_stats->quant[i]                 += cur_stats->quant[i];
@@ -750,7 +802,10 @@ static int read_input_data(VideoParameters *p_Vid)
     else
 #endif
     {
-      file_read = read_one_frame (p_Vid, &p_Inp->input_file1, p_Vid->frm_no_in_file, p_Inp->infile_header, &p_Inp->source, &p_Inp->output, p_Vid->imgData0.frm_data);
+      if (p_Vid->p_Prefetch != NULL)
+        file_read = read_prefetched_frame (p_Vid, p_Vid->frm_no_in_file, &p_Vid->imgData0);
+      else
+        file_read = read_one_frame (p_Vid, &p_Inp->input_file1, p_Vid->frm_no_in_file, p_Inp->infile_header, &p_Inp->source, &p_Inp->output, p_Vid->imgData0.frm_data);
       if ( !file_read )
       {
         // end of file or stream found: trigger error handling
@@ -805,6 +860,14 @@ void perform_encode_frame(VideoParameters *p_Vid)
 
   p_Vid->active_pps = p_Vid->PicParSet[0];
 
+#if defined(OPENMP)
+  if (p_Inp->PAFFThreads > 1)
+  {
+    frame_and_field_pictures (p_Vid);
+    return;
+  }
+#endif
+
 #if (MVC_EXTENSION_ENABLE)
   if(p_Vid->view_id != 1 || !p_Vid->sec_view_force_fld) //view_id 0~1
   {
@@ -1626,11 +1689,10 @@ static void calc_picture_bits(Picture *frame)
 /*!
  ************************************************************************
  * \brief
- *    Encodes a frame picture
- *  frame: output parameter
+ *    Sets up the coding of a frame picture (see frame_picture())
  ************************************************************************
  */
-void frame_picture (VideoParameters *p_Vid, Picture *frame, ImageData *imgData, int rd_pass)
+static void init_frame_picture (VideoParameters *p_Vid, int rd_pass)
 {
   int nplane;
   InputParameters *p_Inp = p_Vid->p_Inp;
@@ -1661,9 +1723,17 @@ void frame_picture (VideoParameters *p_Vid, Picture *frame, ImageData *imgData,
   }
 
   p_Vid->fld_flag = FALSE;
-  code_a_picture(p_Vid, frame);
+}
 
-  if( (p_Inp->separate_colour_plane_flag != 0) )
+/*!
+ ************************************************************************
+ * \brief
+ *    Computes the size and distortion of a coded frame picture
+ ************************************************************************
+ */
+static void end_frame_picture (VideoParameters *p_Vid, Picture *frame, ImageData *imgData)
+{
+  if( (p_Vid->p_Inp->separate_colour_plane_flag != 0) )
   {
     make_frame_picture_JV(p_Vid);
   }
@@ -1677,6 +1747,388 @@ void frame_picture (VideoParameters *p_Vid, Picture *frame, ImageData *imgData,
   }
 }
 
+/*!
+ ************************************************************************
+ * \brief
+ *    Encodes a frame picture
+ *  frame: output parameter
+ ************************************************************************
+ */
+void frame_picture (VideoParameters *p_Vid, Picture *frame, ImageData *imgData, int rd_pass)
+{
+  init_frame_picture(p_Vid, rd_pass);
+  code_a_picture(p_Vid, frame);
+  end_frame_picture(p_Vid, frame, imgData);
+}
+
+#if defined(OPENMP)
+/*!
+ ************************************************************************
+ * \brief
+ *    Allocates the private buffers of the RD picture decision passes
+ *    coded concurrently (RDPictureThreads)
+ ************************************************************************
+ */
+int init_picture_passes (VideoParameters *p_Vid, InputParameters *p_Inp)
+{
+  PicturePasses *p_Passes;
+  int qp_scale = p_Vid->bitdepth_luma_qp_scale;
+  int k, memory_size = 0;
+
+  if ((p_Passes = (PicturePasses *) calloc(1, sizeof(PicturePasses))) == NULL)
+    no_mem_exit("init_picture_passes: p_Passes");
+
+  for (k = 0; k < MAX_PICTURE_PASSES - 1; ++k)
+  {
+    PassBuffers *buf = &p_Passes->buf[k];
+
+    if ((buf->mb_data = alloc_mbs(p_Vid, p_Vid->FrameSizeInMbs, p_Vid->num_of_layers)) == NULL)
+      no_mem_exit("init_picture_passes: buf->mb_data");
+    memory_size += get_mem3Dint(&buf->nz_coeff, p_Vid->FrameSizeInMbs, 4, 4 + p_Vid->num_blk8x8_uv);
+    memory_size += get_mem2D((byte ***) &buf->ipredmode, p_Vid->height_blk, p_Vid->width_blk);
+    memory_size += get_mem2D((byte ***) &buf->ipredmode8x8, p_Vid->height_blk, p_Vid->width_blk);
+    memset(&buf->ipredmode[0][0], -1, p_Vid->height_blk * p_Vid->width_blk * sizeof(char));
+    memset(&buf->ipredmode8x8[0][0], -1, p_Vid->height_blk * p_Vid->width_blk * sizeof(char));
+    if (p_Inp->UseConstrainedIntraPred)
+    {
+      if ((buf->intra_block = (short *) calloc(p_Vid->FrameSizeInMbs, sizeof(short))) == NULL)
+        no_mem_exit("init_picture_passes: buf->intra_block");
+    }
+
+    memory_size += get_mem2Dolm     (&buf->lambda,    10, 52 + qp_scale, qp_scale);
+    memory_size += get_mem2Dodouble (&buf->lambda_md, 10, 52 + qp_scale, qp_scale);
+    memory_size += get_mem3Dodouble (&buf->lambda_me, 10, 52 + qp_scale, 3, qp_scale);
+    memory_size += get_mem3Doint    (&buf->lambda_mf, 10, 52 + qp_scale, 3, qp_scale);
+    if (p_Inp->UseRDOQuant)
+      memory_size += get_mem2Dodouble (&buf->lambda_rdoq, 10, 52 + qp_scale, qp_scale);
+  }
+
+  p_Vid->p_Passes = p_Passes;
+
+  return memory_size;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Frees the private buffers of the RD picture decision passes
+ ************************************************************************
+ */
+void free_picture_passes (VideoParameters *p_Vid)
+{
+  PicturePasses *p_Passes = p_Vid->p_Passes;
+  int qp_scale = p_Vid->bitdepth_luma_qp_scale;
+  int k;
+
+  if (p_Passes == NULL)
+    return;
+
+  for (k = 0; k < MAX_PICTURE_PASSES - 1; ++k)
+  {
+    PassBuffers *buf = &p_Passes->buf[k];
+
+    free_mbs(buf->mb_data, p_Vid->FrameSizeInMbs);
+    free_mem3Dint(buf->nz_coeff);
+    free_mem2D((byte **) buf->ipredmode);
+    free_mem2D((byte **) buf->ipredmode8x8);
+    free_pointer(buf->intra_block);
+
+    free_mem2Dolm     (buf->lambda, qp_scale);
+    free_mem2Dodouble (buf->lambda_md, qp_scale);
+    free_mem3Dodouble (buf->lambda_me, 10, 52 + qp_scale, qp_scale);
+    free_mem3Doint    (buf->lambda_mf, 10, 52 + qp_scale, qp_scale);
+    if (buf->lambda_rdoq)
+      free_mem2Dodouble (buf->lambda_rdoq, qp_scale);
+  }
+  free(p_Passes);
+
+  p_Vid->p_Passes = NULL;
+}
+
+static void get_pass_buffers (VideoParameters *p_Vid, PassBuffers *buf)
+{
+  buf->mb_data      = p_Vid->mb_data;
+  buf->nz_coeff     = p_Vid->nz_coeff;
+  buf->ipredmode    = p_Vid->ipredmode;
+  buf->ipredmode8x8 = p_Vid->ipredmode8x8;
+  buf->intra_block  = p_Vid->intra_block;
+  buf->lambda       = p_Vid->lambda;
+  buf->lambda_md    = p_Vid->lambda_md;
+  buf->lambda_me    = p_Vid->lambda_me;
+  buf->lambda_mf    = p_Vid->lambda_mf;
+  buf->lambda_rdoq  = p_Vid->lambda_rdoq;
+}
+
+static void set_pass_buffers (VideoParameters *p_Vid, PassBuffers *buf)
+{
+  p_Vid->mb_data      = buf->mb_data;
+  p_Vid->nz_coeff     = buf->nz_coeff;
+  p_Vid->ipredmode    = buf->ipredmode;
+  p_Vid->ipredmode8x8 = buf->ipredmode8x8;
+  p_Vid->intra_block  = buf->intra_block;
+  p_Vid->lambda       = buf->lambda;
+  p_Vid->lambda_md    = buf->lambda_md;
+  p_Vid->lambda_me    = buf->lambda_me;
+  p_Vid->lambda_mf    = buf->lambda_mf;
+  p_Vid->lambda_rdoq  = buf->lambda_rdoq;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Copies the Lagrangian tables, so that a pass only recomputes
+ *    the ones of its slice type as with the tables of the encoder
+ ************************************************************************
+ */
+static void copy_lambda_tables (VideoParameters *p_Vid, PassBuffers *dst, PassBuffers *src)
+{
+  int qp_scale = p_Vid->bitdepth_luma_qp_scale;
+  int j, qp;
+
+  memcpy(&dst->lambda[0][-qp_scale], &src->lambda[0][-qp_scale], 10 * (52 + qp_scale) * sizeof(LambdaParams));
+  memcpy(&dst->lambda_md[0][-qp_scale], &src->lambda_md[0][-qp_scale], 10 * (52 + qp_scale) * sizeof(double));
+  if (src->lambda_rdoq)
+    memcpy(&dst->lambda_rdoq[0][-qp_scale], &src->lambda_rdoq[0][-qp_scale], 10 * (52 + qp_scale) * sizeof(double));
+
+  for (j = 0; j < 10; ++j)
+  {
+    for (qp = -qp_scale; qp < 52; ++qp)
+    {
+      memcpy(dst->lambda_me[j][qp], src->lambda_me[j][qp], 3 * sizeof(double));
+      memcpy(dst->lambda_mf[j][qp], src->lambda_mf[j][qp], 3 * sizeof(int));
+    }
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Selects the buffers of the next concurrently coded pass
+ ************************************************************************
+ */
+static PicturePass *picture_pass_buffers (VideoParameters *p_Vid, Picture *pic, ImageData *imgData, int structure, int last_pass)
+{
+  PicturePasses *p_Passes = p_Vid->p_Passes;
+  PicturePass *pass = &p_Passes->pass[p_Passes->num_passes];
+  unsigned int i;
+
+  if (p_Passes->num_passes == 0)
+    get_pass_buffers(p_Vid, &p_Passes->main);
+
+  pass->pic       = pic;
+  pass->imgData   = imgData;
+  pass->structure = structure;
+  if (last_pass)
+    pass->buf = &p_Passes->main;
+  else
+  {
+    pass->buf = &p_Passes->buf[p_Passes->num_passes];
+    copy_lambda_tables(p_Vid, pass->buf, &p_Passes->main);
+    for (i = 0; i < p_Vid->FrameSizeInMbs; ++i)
+      pass->buf->mb_data[i].slice_nr = -1;
+  }
+  set_pass_buffers(p_Vid, pass->buf);
+
+  return pass;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Sets up the slices of a concurrently coded pass, as code_a_picture()
+ *    does up to the macroblock loops
+ ************************************************************************
+ */
+static void picture_pass_slices (VideoParameters *p_Vid, PicturePass *pass)
+{
+  int i;
+
+  init_picture_coding(p_Vid, pass->pic);
+  init_plane_coding(p_Vid, p_Vid->p_Inp);
+  prepare_slices_parallel(p_Vid, 0, 0, &pass->jobs);
+
+  // FmoInit() of the next pass replaces the macroblock maps
+  if ((pass->MBAmap = (byte *) malloc(p_Vid->PicSizeInMbs * sizeof(byte))) == NULL)
+    no_mem_exit("picture_pass_slices: pass->MBAmap");
+  if ((pass->MapUnitToSliceGroupMap = (byte *) malloc(p_Vid->PicSizeInMapUnits * sizeof(byte))) == NULL)
+    no_mem_exit("picture_pass_slices: pass->MapUnitToSliceGroupMap");
+  memcpy(pass->MBAmap, p_Vid->MBAmap, p_Vid->PicSizeInMbs * sizeof(byte));
+  memcpy(pass->MapUnitToSliceGroupMap, p_Vid->MapUnitToSliceGroupMap, p_Vid->PicSizeInMapUnits * sizeof(byte));
+  for (i = 0; i < pass->jobs.num_slices; ++i)
+  {
+    pass->jobs.vid_copy[i].MBAmap                 = pass->MBAmap;
+    pass->jobs.vid_copy[i].MapUnitToSliceGroupMap = pass->MapUnitToSliceGroupMap;
+  }
+
+  // proceed to the next slice as code_a_plane() does
+  FmoSetLastMacroblockInSlice (p_Vid, p_Vid->current_mb_nr);
+  p_Vid->current_slice_nr++;
+  p_Vid->p_Stats->bit_slice = 0;
+
+  p_Vid->p_Passes->num_passes++;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Sets up a frame picture coding pass whose macroblocks are coded
+ *    concurrently with the ones of other passes (RDPictureThreads,
+ *    PAFFThreads)
+ *
+ * \par
+ *    Everything of frame_picture() before the macroblock loops runs
+ *    here, in coding order. A pass works on private macroblock buffers
+ *    and Lagrangian tables, except for the last pass of the batch which
+ *    uses the ones of the encoder as the serial passes do. The passes
+ *    are coded and completed by picture_passes_end().
+ ************************************************************************
+ */
+void frame_picture_begin (VideoParameters *p_Vid, Picture *frame, ImageData *imgData, int rd_pass, int last_pass)
+{
+  PicturePass *pass = picture_pass_buffers(p_Vid, frame, imgData, FRAME, last_pass);
+
+  init_frame_picture(p_Vid, rd_pass);
+  picture_pass_slices(p_Vid, pass);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Sets up the top field coding pass of field_picture() to be coded
+ *    concurrently with other passes (see frame_picture_begin())
+ ************************************************************************
+ */
+static void top_field_begin (VideoParameters *p_Vid, Picture *top, int last_pass)
+{
+  PicturePass *pass = picture_pass_buffers(p_Vid, top, &p_Vid->imgData, TOP_FIELD, last_pass);
+
+  init_top_field(p_Vid);
+  picture_pass_slices(p_Vid, pass);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Codes the macroblocks of all passes set up by frame_picture_begin()
+ *    at once and completes the passes in coding order
+ *
+ * \par
+ *    On return the encoder is in the state after the last pass, as
+ *    after the serial passes. The coding info of each pass is stored
+ *    in coding_info[].
+ ************************************************************************
+ */
+void picture_passes_end (VideoParameters *p_Vid, CodingInfo *coding_info, int num_threads)
+{
+  InputParameters *p_Inp = p_Vid->p_Inp;
+  PicturePasses *p_Passes = p_Vid->p_Passes;
+  SliceJobs *jobs[MAX_PICTURE_PASSES];
+  byte  *MBAmap                   = p_Vid->MBAmap;
+  byte  *MapUnitToSliceGroupMap   = p_Vid->MapUnitToSliceGroupMap;
+  int    NumberofCodedMacroBlocks = p_Vid->NumberofCodedMacroBlocks;
+  int64  me_time                  = p_Vid->me_time;
+  int64  me_tot_time              = p_Vid->me_tot_time;
+  int k;
+
+  for (k = 0; k < p_Passes->num_passes; ++k)
+    jobs[k] = &p_Passes->pass[k].jobs;
+
+  encode_slice_jobs (jobs, p_Passes->num_passes, num_threads);
+
+  for (k = 0; k < p_Passes->num_passes; ++k)
+  {
+    PicturePass *pass = &p_Passes->pass[k];
+
+    close_slices_parallel (p_Vid, &pass->jobs, 0);
+    NumberofCodedMacroBlocks += p_Vid->NumberofCodedMacroBlocks - pass->jobs.NumberofCodedMacroBlocks;
+    me_time                  += p_Vid->me_time - pass->jobs.me_time;
+    me_tot_time              += p_Vid->me_tot_time - pass->jobs.me_tot_time;
+
+    FmoSetLastMacroblockInSlice (p_Vid, p_Vid->current_mb_nr);
+    p_Vid->current_slice_nr++;
+    p_Vid->p_Stats->bit_slice = 0;
+
+    end_plane_coding(p_Vid, p_Inp);
+    if (pass->structure == FRAME)
+      end_frame_picture(p_Vid, pass->pic, pass->imgData);
+    else
+      end_top_field(p_Vid, pass->pic);
+    store_coding_info(p_Vid, &coding_info[k]);
+
+    p_Vid->MBAmap                 = MBAmap;
+    p_Vid->MapUnitToSliceGroupMap = MapUnitToSliceGroupMap;
+    free(pass->MBAmap);
+    free(pass->MapUnitToSliceGroupMap);
+  }
+
+  p_Vid->NumberofCodedMacroBlocks = NumberofCodedMacroBlocks;
+  p_Vid->me_time                  = me_time;
+  p_Vid->me_tot_time              = me_tot_time;
+  p_Passes->num_passes = 0;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Adaptive frame/field coding with the frame picture and the top
+ *    field coded concurrently (PAFFThreads), see perform_encode_frame()
+ *
+ * \par
+ *    The bottom field uses the top field as reference and is coded
+ *    serially afterwards.
+ ************************************************************************
+ */
+static void frame_and_field_pictures (VideoParameters *p_Vid)
+{
+  InputParameters *p_Inp = p_Vid->p_Inp;
+  CodingInfo pass_info[2];
+  DecRefPicMarking_t *tmp_drpm;
+  int frame_type;
+#if (MVC_EXTENSION_ENABLE)
+  Picture **field_pic = p_Vid->field_pic_ptr;
+#else
+  Picture **field_pic = p_Vid->field_pic;
+#endif
+
+  frame_picture_begin(p_Vid, p_Vid->frame_pic[0], &p_Vid->imgData, 0, FALSE);
+  p_Vid->p_frame_pic = p_Vid->frame_pic[0];
+
+  p_Vid->write_macroblock = FALSE;
+  p_Vid->bot_MB = FALSE;
+
+  frame_type = p_Vid->type;
+
+  p_Vid->field_picture = 1;  // we encode fields
+
+  //Free frame based dec_ref_pic_marking_buffer
+  while (p_Vid->dec_ref_pic_marking_buffer)
+  {
+    tmp_drpm = p_Vid->dec_ref_pic_marking_buffer;
+    p_Vid->dec_ref_pic_marking_buffer = tmp_drpm->Next;
+    free(tmp_drpm);
+  }
+
+  top_field_begin(p_Vid, field_pic[0], TRUE);
+  picture_passes_end(p_Vid, pass_info, p_Inp->PAFFThreads);
+  code_bottom_field(p_Vid, field_pic[0], field_pic[1]);
+
+  p_Vid->fld_flag = picture_structure_decision (p_Vid, p_Vid->frame_pic[0], field_pic[0], field_pic[1]);
+#if (MVC_EXTENSION_ENABLE)
+  p_Vid->sec_view_force_fld = p_Vid->fld_flag;
+#endif
+
+  if ( p_Vid->fld_flag==0 )
+  {
+    p_Vid->type = (short) frame_type;
+    p_Vid->SumFrameQP = pass_info[0].sumFrameQP;
+    p_Vid->num_ref_idx_l0_active = pass_info[0].num_ref_idx_l0;
+    p_Vid->num_ref_idx_l1_active = pass_info[0].num_ref_idx_l1;
+  }
+
+  update_field_frame_contexts (p_Vid, p_Vid->fld_flag);
+}
+#endif
+
 
 /*!
  ************************************************************************
@@ -1685,10 +2137,23 @@ void frame_picture (VideoParameters *p_Vid, Picture *frame, ImageData *imgData,
  ************************************************************************
  */
 static void field_picture (VideoParameters *p_Vid, Picture *top, Picture *bottom)
+{
+  init_top_field(p_Vid);
+  code_a_picture(p_Vid, top);
+  end_top_field(p_Vid, top);
+
+  code_bottom_field(p_Vid, top, bottom);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Picture level initialization of the top field of field_picture()
+ ************************************************************************
+ */
+static void init_top_field (VideoParameters *p_Vid)
 {
   InputParameters *p_Inp = p_Vid->p_Inp;
-  //Rate control
-  int TopFieldBits;
 
   p_Vid->SumFrameQP = 0;
   p_Vid->num_ref_idx_l0_active = 0;
@@ -1729,8 +2194,19 @@ static void field_picture (VideoParameters *p_Vid, Picture *top, Picture *bottom
   //Rate control
   if(p_Inp->RCEnable && p_Inp->RCUpdateMode <= MAX_RC_MODE)
     rc_init_top_field(p_Vid, p_Inp);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Completes the top field of field_picture() (stores it as reference
+ *    of the bottom field)
+ ************************************************************************
+ */
+static void end_top_field (VideoParameters *p_Vid, Picture *top)
+{
+  InputParameters *p_Inp = p_Vid->p_Inp;
 
-  code_a_picture(p_Vid, top);
   p_Vid->enc_picture->structure = TOP_FIELD;
   store_picture_in_dpb(p_Vid->p_Dpb_layer[p_Vid->view_id], p_Vid->enc_field_picture[0], &p_Inp->output);
 
@@ -1742,9 +2218,19 @@ static void field_picture (VideoParameters *p_Vid, Picture *top, Picture *bottom
   }
 #endif
   calc_picture_bits(top);
+}
 
+/*!
+ ************************************************************************
+ * \brief
+ *    Encodes the bottom field of field_picture()
+ ************************************************************************
+ */
+static void code_bottom_field (VideoParameters *p_Vid, Picture *top, Picture *bottom)
+{
+  InputParameters *p_Inp = p_Vid->p_Inp;
   //Rate control
-  TopFieldBits=top->bits_per_picture;
+  int TopFieldBits = top->bits_per_picture;
 
   //  Bottom field
   p_Vid->enc_field_picture[1]  = alloc_storable_picture (p_Vid, (PictureStructure) p_Vid->structure, p_Vid->width, p_Vid->height, p_Vid->width_cr, p_Vid->height_cr);
@@ -2151,6 +2637,38 @@ static void init_field (VideoParameters *p_Vid, InputParameters *p_Inp)
   }
 }
 
+/*!
+ ************************************************************************
+ * \brief
+ *    Generates the lower resolution levels of the image pyramid used by
+ *    the hierarchical motion estimation pre-search (see me_hme.c).
+ *    Level 0 holds the picture (starting at offset_x, offset_y), every
+ *    further level is obtained by 2x2 averaging of the previous one.
+ ************************************************************************
+ */
+void GenerateImagePyramid(VideoParameters *p_Vid, int size_x, int size_y, imgpel ***p_hme_int_img, int offset_x, int offset_y)
+{
+  int level, i, j;
+
+  for (level = 1; level < HME_LEVELS; ++level)
+  {
+    int width  = size_x >> level;
+    int height = size_y >> level;
+    int src_x  = (level == 1) ? offset_x : 0;
+    int src_y  = (level == 1) ? offset_y : 0;
+    imgpel **src = p_hme_int_img[level - 1];
+    imgpel **dst = p_hme_int_img[level];
+
+    for (j = 0; j < height; ++j)
+    {
+      imgpel *src0 = &src[src_y + 2 * j][src_x];
+      imgpel *src1 = &src[src_y + 2 * j + 1][src_x];
+      for (i = 0; i < width; ++i)
+        dst[j][i] = (imgpel) ((src0[2 * i] + src0[2 * i + 1] + src1[2 * i] + src1[2 * i + 1] + 2) >> 2);
+    }
+  }
+}
+
 /*!
  ************************************************************************
  * \brief
@@ -2179,7 +2697,11 @@ void UnifiedOneForthPix ( VideoParameters *p_Vid, StorablePicture *s)
   //if (p_Inp->intra_period != 1)
   if ( (!p_Inp->OnTheFlyFractMCP) || (p_Inp->OnTheFlyFractMCP==OTF_L1) ) // JLT : on-the-fly
   {
-    getSubImagesLuma ( p_Vid, s );
+    // luma sub-pel bands may be left until motion estimation reads them
+    if (p_Inp->LazySubPel)
+      getSubImagesLumaLazy ( p_Vid, s );
+    else
+      getSubImagesLuma ( p_Vid, s );
     // and the sub-images for U and V
     if ( ((p_Vid->yuv_format != YUV400) && (p_Inp->ChromaMCBuffer)) || p_Vid->P444_joined )
     {
@@ -2215,6 +2737,10 @@ void UnifiedOneForthPix ( VideoParameters *p_Vid, StorablePicture *s)
     OtfCompatibility_copyWithPadding( s->imgUV[0], s->imgUV[0], s->size_x_cr, s->size_y_cr, p_Vid->pad_size_uv_x,p_Vid->pad_size_uv_y ) ;
     OtfCompatibility_copyWithPadding( s->imgUV[1], s->imgUV[1], s->size_x_cr, s->size_y_cr, p_Vid->pad_size_uv_x, p_Vid->pad_size_uv_y ) ;
   }
+
+  // lower resolution planes for the hierarchical motion estimation pre-search
+  if (p_Inp->HMEEnable)
+    generate_hme_pyramid(p_Vid, s);
 }
 
 /*!
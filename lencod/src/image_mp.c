@@ -101,6 +101,83 @@ void frame_picture_mp_exit(VideoParameters *p_Vid, CodingInfo *coding_info)
 }
 
 
+#if defined(OPENMP)
+/*!
+ ************************************************************************
+ * \brief
+ *    Codes the initial pass and the frame QP pass concurrently
+ *    (RDPictureThreads) and keeps the better one in frame_pic[0]
+ *
+ * \return
+ *    1 if the frame QP pass is selected, 0 otherwise
+ ************************************************************************
+ */
+static int frame_picture_mp_frame_qp_par(VideoParameters *p_Vid, int frame_qp, int rd_qp, CodingInfo *coding_info)
+{
+  CodingInfo pass_info[2];
+  int selection;
+
+  frame_picture_begin(p_Vid, p_Vid->frame_pic[0], &p_Vid->imgData, 0, FALSE);
+
+  // frame QP pass
+  p_Vid->active_pps = p_Vid->PicParSet[0];
+  p_Vid->qp = iClip3( p_Vid->RCMinQP, p_Vid->RCMaxQP, frame_qp );
+  p_Vid->write_macroblock = FALSE;
+  p_Vid->p_curr_frm_struct->qp = p_Vid->qp;
+  frame_picture_begin(p_Vid, p_Vid->frame_pic[1], &p_Vid->imgData, 1, TRUE);
+
+  picture_passes_end(p_Vid, pass_info, p_Vid->p_Inp->RDPictureThreads);
+
+  selection = picture_coding_decision(p_Vid, p_Vid->frame_pic[0], p_Vid->frame_pic[1], rd_qp);
+#if (DBG_IMAGE_MP)
+  printf("frame QP, rd_pass = 1, selection = %d\n", selection);
+#endif
+  if (selection)
+    swap_frame_buffer(p_Vid, 0, 1);
+  *coding_info = pass_info[selection];
+
+  return selection;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Codes the QP, QP-1 and QP+1 passes of an I slice concurrently
+ *    (RDPictureThreads) and keeps the best one in frame_pic[0]
+ ************************************************************************
+ */
+static void frame_picture_mp_i_slice_par(VideoParameters *p_Vid, InputParameters *p_Inp)
+{
+  int   qp = p_Vid->qp;
+  int   num_passes = imin(p_Inp->RDPictureMaxPassISlice, MAX_PICTURE_PASSES);
+  CodingInfo pass_info[MAX_PICTURE_PASSES];
+  int rd_pass, best = 0;
+
+  // initial pass, then QP-1 and QP+1
+  frame_picture_begin(p_Vid, p_Vid->frame_pic[0], &p_Vid->imgData, 0, FALSE);
+  for (rd_pass = 1; rd_pass < num_passes; ++rd_pass)
+  {
+    p_Vid->qp = iClip3( p_Vid->RCMinQP, p_Vid->RCMaxQP, rd_pass == 1 ? qp - 1 : qp + 1 );
+    p_Vid->write_macroblock = FALSE;
+    p_Vid->p_curr_frm_struct->qp = p_Vid->qp;
+    frame_picture_begin(p_Vid, p_Vid->frame_pic[rd_pass], &p_Vid->imgData, rd_pass, rd_pass == num_passes - 1);
+  }
+
+  picture_passes_end(p_Vid, pass_info, p_Inp->RDPictureThreads);
+
+  for (rd_pass = 1; rd_pass < num_passes; ++rd_pass)
+  {
+    if (picture_coding_decision(p_Vid, p_Vid->frame_pic[0], p_Vid->frame_pic[rd_pass], qp))
+    {
+      swap_frame_buffer(p_Vid, 0, rd_pass);
+      best = rd_pass;
+    }
+  }
+
+  frame_picture_mp_exit(p_Vid, &pass_info[best]);
+}
+#endif
+
 void frame_picture_mp_p_slice(VideoParameters *p_Vid, InputParameters *p_Inp)
 {
   int   rd_pass = 0;
@@ -114,6 +191,18 @@ void frame_picture_mp_p_slice(VideoParameters *p_Vid, InputParameters *p_Inp)
   int apply_wp = 0;
   int selection;
 
+#if defined(OPENMP)
+  // without WP, frame type and deblocking passes the frame QP pass does
+  // not depend on the initial one
+  if (p_Vid->p_Passes && p_Inp->RDPictureMaxPassPSlice > 1 && p_Inp->RDPictureFrameQPPSlice && !p_Inp->GenerateMultiplePPS
+    && !p_Inp->RDPSliceITest && !p_Inp->RDPSliceBTest && !p_Inp->RDPictureDeblocking)
+  {
+    frame_picture_mp_frame_qp_par(p_Vid, p_Vid->nal_reference_idc==0 ? rd_qp+1:rd_qp-1, rd_qp, &coding_info);
+    frame_picture_mp_exit(p_Vid, &coding_info);
+    return;
+  }
+#endif
+
   frame_picture (p_Vid, p_Vid->frame_pic[rd_pass], &p_Vid->imgData, rd_pass);
   store_coding_and_rc_info(p_Vid, &coding_info);
 
@@ -377,6 +466,14 @@ void frame_picture_mp_i_slice(VideoParameters *p_Vid, InputParameters *p_Inp)
   CodingInfo coding_info; 
   int selection;
 
+#if defined(OPENMP)
+  if (p_Vid->p_Passes && p_Inp->RDPictureMaxPassISlice > 1)
+  {
+    frame_picture_mp_i_slice_par(p_Vid, p_Inp);
+    return;
+  }
+#endif
+
   // initial pass encoding
   frame_picture (p_Vid, p_Vid->frame_pic[rd_pass], &p_Vid->imgData, rd_pass);
   store_coding_and_rc_info(p_Vid, &coding_info);
@@ -460,14 +557,28 @@ void frame_picture_mp_b_slice(VideoParameters *p_Vid, InputParameters *p_Inp)
   FrameCodingMethod best_method = REGULAR;
   int apply_wp = 0;
   int selection;
+  int frame_qp_done = FALSE;
   Slice *dummy_slice = NULL;
 
 #if (DBG_IMAGE_MP)
   printf("pass0_wp = %d\n", p_Vid->pass0_wp);
 #endif  
 
-  frame_picture (p_Vid, p_Vid->frame_pic[rd_pass], &p_Vid->imgData, rd_pass);
-  store_coding_and_rc_info(p_Vid, &coding_info);
+#if defined(OPENMP)
+  // without WP passes the frame QP pass does not depend on the initial one
+  if (p_Vid->p_Passes && p_Inp->RDPictureMaxPassBSlice > 1 && p_Inp->RDPictureFrameQPBSlice && !p_Inp->GenerateMultiplePPS)
+  {
+    if (frame_picture_mp_frame_qp_par(p_Vid, p_Vid->nal_reference_idc==0 ? rd_qp + 1 : rd_qp, rd_qp, &coding_info))
+      best_method = FRAME_QP;
+    rd_pass = 1;
+    frame_qp_done = TRUE;
+  }
+  else
+#endif
+  {
+    frame_picture (p_Vid, p_Vid->frame_pic[rd_pass], &p_Vid->imgData, rd_pass);
+    store_coding_and_rc_info(p_Vid, &coding_info);
+  }
   
   if(p_Inp->WPIterMC)
     p_Vid->frameOffsetAvail = 1; 
@@ -590,7 +701,7 @@ void frame_picture_mp_b_slice(VideoParameters *p_Vid, InputParameters *p_Inp)
     }
   }
 
-  if(p_Inp->RDPictureFrameQPBSlice)
+  if(p_Inp->RDPictureFrameQPBSlice && !frame_qp_done)
   {
     // frame QP pass
     p_Vid->active_pps = best_method == EXP_WP ? p_Vid->PicParSet[1]:best_method==IMP_WP?p_Vid->PicParSet[2]:p_Vid->PicParSet[0];
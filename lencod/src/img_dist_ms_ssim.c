@@ -6,6 +6,10 @@
  * \brief
  *    Compute structural similarity (SSIM) index using the encoded image and the reference image
  *
+ *    The SSIM terms of every scale are computed by compute_ssim_terms()
+ *    (see img_dist_ssim.c). The downsampled images and the downsampling
+ *    buffers are kept across scales, components and frames.
+ *
  * \author
  *    Main contributors (see contributors.h for copyright, address and affiliation details)
  *     - Woo-Shik Kim                    <wooshik.kim@usc.edu>
@@ -17,13 +21,12 @@
 #include "contributors.h"
 #include "global.h"
 #include "img_distortion.h"
+#include "img_dist_ssim.h"
 #include "enc_statistics.h"
 #include "memalloc.h"
 #include "math.h"
 
-#ifndef UNBIASED_VARIANCE
-  #define UNBIASED_VARIANCE // unbiased estimation of the variance
-#endif
+#define MS_SSIM_UNBIASED TRUE // unbiased estimation of the variance
 
 #define MS_SSIM_PAD  6
 #define MS_SSIM_PAD2 3
@@ -36,124 +39,7 @@
 
 #define MAX_SSIM_LEVELS 5
 
-//Computes the product of the contrast and structure componenents of the structural similarity metric.
-float compute_structural_components (VideoParameters *p_Vid, InputParameters *p_Inp, imgpel **refImg, imgpel **encImg, int height, int width, int win_height, int win_width, int comp)
-{
-  static const float K2 = 0.03f;
-  float max_pix_value_sqd;
-  float C2;
-  float win_pixels = (float) (win_width * win_height);
-#ifdef UNBIASED_VARIANCE
-  float win_pixels_bias = win_pixels - 1;
-#else
-  float win_pixels_bias = win_pixels;
-#endif
-  float mb_ssim, meanOrg, meanEnc;
-  float varOrg, varEnc, covOrgEnc;
-  int imeanOrg, imeanEnc, ivarOrg, ivarEnc, icovOrgEnc;
-  float cur_distortion = 0.0;
-  int i, j, n, m, win_cnt = 0;
-  int overlapSize = p_Inp->SSIMOverlapSize;
-
-  max_pix_value_sqd = (float) (p_Vid->max_pel_value_comp[comp] * p_Vid->max_pel_value_comp[comp]);
-  C2 = K2 * K2 * max_pix_value_sqd;
-
-  for (j = 0; j <= height - win_height; j += overlapSize)
-  {
-    for (i = 0; i <= width - win_width; i += overlapSize)
-    {
-      imeanOrg = 0;
-      imeanEnc = 0; 
-      ivarOrg  = 0;
-      ivarEnc  = 0;
-      icovOrgEnc = 0;
-
-      for ( n = j;n < j + win_height;n ++)
-      {
-        for (m = i;m < i + win_width;m ++)
-        {
-          imeanOrg   += refImg[n][m];
-          imeanEnc   += encImg[n][m];
-          ivarOrg    += refImg[n][m] * refImg[n][m];
-          ivarEnc    += encImg[n][m] * encImg[n][m];
-          icovOrgEnc += refImg[n][m] * encImg[n][m];
-        }
-      }
-
-      meanOrg = (float) imeanOrg / win_pixels;
-      meanEnc = (float) imeanEnc / win_pixels;
-
-      varOrg    = ((float) ivarOrg - ((float) imeanOrg) * meanOrg) / win_pixels_bias;
-      varEnc    = ((float) ivarEnc - ((float) imeanEnc) * meanEnc) / win_pixels_bias;
-      covOrgEnc = ((float) icovOrgEnc - ((float) imeanOrg) * meanEnc) / win_pixels_bias;
-
-      mb_ssim  = (float) (2.0 * covOrgEnc + C2);
-      mb_ssim /= (float) (varOrg + varEnc + C2);
-
-      cur_distortion += mb_ssim;
-      win_cnt++;
-    }
-  }
-
-  cur_distortion /= (float) win_cnt;
-
-  if (cur_distortion >= 1.0 && cur_distortion < 1.01) // avoid float accuracy problem at very low QP(e.g.2)
-    cur_distortion = 1.0;
-
-  return cur_distortion;
-}
-
-float compute_luminance_component (VideoParameters *p_Vid, InputParameters *p_Inp, imgpel **refImg, imgpel **encImg, int height, int width, int win_height, int win_width, int comp)
-{
-  static const float K1 = 0.01f;
-  float max_pix_value_sqd;
-  float C1;
-  float win_pixels = (float) (win_width * win_height);
-  float mb_ssim, meanOrg, meanEnc;
-  int imeanOrg, imeanEnc;
-  float cur_distortion = 0.0;
-  int i, j, n, m, win_cnt = 0;
-  int overlapSize = p_Inp->SSIMOverlapSize;
-
-  max_pix_value_sqd = (float) (p_Vid->max_pel_value_comp[comp] * p_Vid->max_pel_value_comp[comp]);
-  C1 = K1 * K1 * max_pix_value_sqd;
-
-  for (j = 0; j <= height - win_height; j += overlapSize)
-  {
-    for (i = 0; i <= width - win_width; i += overlapSize)
-    {
-      imeanOrg = 0;
-      imeanEnc = 0; 
-      
-      for ( n = j;n < j + win_height;n ++)
-      {
-        for (m = i;m < i + win_width;m ++)
-        {
-          imeanOrg   += refImg[n][m];
-          imeanEnc   += encImg[n][m];
-        }
-      }
-
-      meanOrg = (float) imeanOrg / win_pixels;
-      meanEnc = (float) imeanEnc / win_pixels;
-
-      mb_ssim  = (float) (2.0 * meanOrg * meanEnc + C1);
-      mb_ssim /= (float) (meanOrg * meanOrg + meanEnc * meanEnc + C1);
-
-      cur_distortion += mb_ssim;
-      win_cnt++;
-    }
-  }
-
-  cur_distortion /= (float) win_cnt;
-
-  if (cur_distortion >= 1.0 && cur_distortion < 1.01) // avoid float accuracy problem at very low QP(e.g.2)
-    cur_distortion = 1.0;
-
-  return cur_distortion;
-}
-
-void horizontal_symmetric_extension(int **buffer, int width, int height )
+static void horizontal_symmetric_extension(int **buffer, int width, int height )
 {
   int j;
   int* buf;
@@ -176,7 +62,7 @@ void horizontal_symmetric_extension(int **buffer, int width, int height )
   }
 }
 
-void vertical_symmetric_extension(int **buffer, int width, int height)
+static void vertical_symmetric_extension(int **buffer, int width, int height)
 {
   int i;
 
@@ -222,7 +108,42 @@ static void imgpel_to_padded_int(imgpel** src, int **buffer, int width, int heig
   }
 }
 
-void downsample(imgpel** src, imgpel** out, int height, int width)
+/*!
+ ************************************************************************
+ * \brief
+ *    Returns the SSIM scratch buffers, the MS-SSIM part of which is
+ *    (re)allocated to fit an image of the given size
+ ************************************************************************
+ */
+static SSIMBuffers *get_ms_ssim_buffers (DistortionParams *p_Dist, int height, int width)
+{
+  SSIMBuffers *buf = get_ssim_buffers(p_Dist);
+  int i;
+
+  if (height > buf->ds_height || width > buf->ds_width)
+  {
+    for (i = 0; i < 2; ++i)
+    {
+      if (buf->ds[i])
+        free_mem2Dpel(buf->ds[i]);
+    }
+    if (buf->pad)
+      free_mem2Dint(buf->pad);
+    if (buf->tmp)
+      free_mem2Dint(buf->tmp);
+
+    buf->ds_height = imax(height, buf->ds_height);
+    buf->ds_width  = imax(width, buf->ds_width);
+    for (i = 0; i < 2; ++i)
+      get_mem2Dpel(&buf->ds[i], imax(1, buf->ds_height >> 1), imax(1, buf->ds_width >> 1));
+    get_mem2Dint(&buf->pad, buf->ds_height + MS_SSIM_PAD, buf->ds_width + MS_SSIM_PAD);
+    get_mem2Dint(&buf->tmp, buf->ds_height + MS_SSIM_PAD, (buf->ds_width >> 1) + MS_SSIM_PAD);
+  }
+
+  return buf;
+}
+
+static void downsample(SSIMBuffers *buf, imgpel** src, imgpel** out, int height, int width)
 {
   int height2 = height >> 1;
   int width2  = width  >> 1;
@@ -233,12 +154,9 @@ void downsample(imgpel** src, imgpel** out, int height, int width)
   int* tmpDst;
   int* tmpSrc;
   
-  int** itemp;
-  int** dest;
+  int** itemp = buf->pad;
+  int** dest  = buf->tmp;
 
-  get_mem2Dint(&itemp, height + MS_SSIM_PAD, width + MS_SSIM_PAD);
-  get_mem2Dint(&dest, height + MS_SSIM_PAD, width2 + MS_SSIM_PAD);
-  
   imgpel_to_padded_int(src, itemp, width, height);
   horizontal_symmetric_extension(itemp, width, height);
 
@@ -272,53 +190,46 @@ void downsample(imgpel** src, imgpel** out, int height, int width)
       out[j][i] = (unsigned char) (tmp >> 6);   //Note: Should change for different bit depths
     }
   }
-  free_mem2Dint(itemp);
-  free_mem2Dint(dest);
 }
 
-float compute_ms_ssim(VideoParameters *p_Vid, InputParameters *p_Inp, imgpel **refImg, imgpel **encImg, int height, int width, int win_height, int win_width, int comp)
+static float compute_ms_ssim(VideoParameters *p_Vid, InputParameters *p_Inp, imgpel **refImg, imgpel **encImg, int height, int width, int win_height, int win_width, int comp)
 {
-  float structural[MAX_SSIM_LEVELS];
+  SSIMBuffers *buf = get_ms_ssim_buffers(p_Vid->p_Dist, height, width);
+  SSIMTerms terms;
   float cur_distortion;
-  float luminance;
-  imgpel** dsRef;
-  imgpel** dsEnc;
+  imgpel** dsRef = buf->ds[0];
+  imgpel** dsEnc = buf->ds[1];
   int m;
   static const int max_ssim_levels_minus_one = MAX_SSIM_LEVELS - 1;
   static const float exponent[5] = {(float)MS_SSIM_BETA0, (float)MS_SSIM_BETA1, (float)MS_SSIM_BETA2, (float)MS_SSIM_BETA3, (float)MS_SSIM_BETA4};
 
-  dsRef = NULL;
-  dsEnc = NULL;
-  get_mem2Dpel(&dsRef, height>>1, width>>1);
-  get_mem2Dpel(&dsEnc, height>>1, width>>1);
-
-  structural[0] = compute_structural_components(p_Vid, p_Inp, refImg, encImg, height, width, win_height, win_width, comp);
-  cur_distortion = (float)pow(structural[0], exponent[0]);
+  compute_ssim_terms(p_Vid, p_Inp, refImg, encImg, height, width, win_height, win_width, comp, MS_SSIM_UNBIASED, SSIM_TERM_STRUCTURAL, &terms);
+  cur_distortion = (float)pow(terms.structural, exponent[0]);
 
-  downsample(refImg, dsRef, height, width);
-  downsample(encImg, dsEnc, height, width);
+  downsample(buf, refImg, dsRef, height, width);
+  downsample(buf, encImg, dsEnc, height, width);
 
   for (m = 1; m < MAX_SSIM_LEVELS; m++)
   {
     height >>= 1;
     width >>= 1;
-    structural[m] = compute_structural_components(p_Vid, p_Inp, dsRef, dsEnc, height, width, imin(win_height,height), imin(win_width,width), comp);
-    cur_distortion *= (float)pow(structural[m], exponent[m]);
     if (m < max_ssim_levels_minus_one)
     {
-      downsample(dsRef, dsRef, height, width);
-      downsample(dsEnc, dsEnc, height, width);
+      compute_ssim_terms(p_Vid, p_Inp, dsRef, dsEnc, height, width, imin(win_height,height), imin(win_width,width), comp,
+        MS_SSIM_UNBIASED, SSIM_TERM_STRUCTURAL, &terms);
+      cur_distortion *= (float)pow(terms.structural, exponent[m]);
+      downsample(buf, dsRef, dsRef, height, width);
+      downsample(buf, dsEnc, dsEnc, height, width);
     }
     else
     {
-      luminance = compute_luminance_component(p_Vid, p_Inp, dsRef, dsEnc, height, width, imin(win_height,height), imin(win_width,width), comp);
-      cur_distortion *= (float)pow(luminance, exponent[m]);
+      // structural and luminance components of the coarsest scale in one pass
+      compute_ssim_terms(p_Vid, p_Inp, dsRef, dsEnc, height, width, imin(win_height,height), imin(win_width,width), comp,
+        MS_SSIM_UNBIASED, SSIM_TERM_STRUCTURAL | SSIM_TERM_LUMINANCE, &terms);
+      cur_distortion *= (float)pow(terms.structural, exponent[m]);
+      cur_distortion *= (float)pow(terms.luminance, exponent[m]);
     }
   }
-  free_mem2Dpel(dsRef);
-  free_mem2Dpel(dsEnc);
-  dsRef = NULL;
-  dsEnc = NULL;
 
   return cur_distortion;
 }
@@ -6,81 +6,626 @@
  * \brief
  *    Compute structural similarity (SSIM) index using the encoded image and the reference image
  *
+ *    The window sums are box filtered: the sums of one window row are kept
+ *    per column, so that moving down by SSIMOverlapSize lines only removes
+ *    and adds that many lines, and the windows of a row slide along these
+ *    column sums. The column sum and window term kernels have SSE4.1 and
+ *    AVX2 versions that are selected at run time (see init_ssim_kernels())
+ *    and give the same terms as the C versions. The window rows are
+ *    processed in bands of SSIM_BAND_ROWS rows, which can be computed by
+ *    several threads (SSIMThreads); the band results are combined in band
+ *    order, so the metrics do not depend on the number of threads.
+ *
  * \author
  *    Main contributors (see contributors.h for copyright, address and affiliation details)
  *     - Woo-Shik Kim                    <wooshik.kim@usc.edu>
- *     - Zhen Li                         <zli@dolby.com> 
+ *     - Zhen Li                         <zli@dolby.com>
  *     - Alexis Michael Tourapis         <alexismt@ieee.org>
  *************************************************************************************
  */
 #include "contributors.h"
 #include "global.h"
 #include "img_distortion.h"
+#include "img_dist_ssim.h"
 #include "enc_statistics.h"
+#include "memalloc.h"
+#include "me_distortion.h"
 
-//#define UNBIASED_VARIANCE // unbiased estimation of the variance
+#if (JM_SIMD_DISTORTION) && (IMGTYPE) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#  define SIMD_X86      1
+#  define TARGET_SSE41  __attribute__((target("sse4.1")))
+#  define TARGET_AVX2   __attribute__((target("avx2")))
+#elif (JM_SIMD_DISTORTION) && (IMGTYPE) && defined(_MSC_VER) && (_MSC_VER >= 1700) && (defined(_M_X64) || defined(_M_IX86))
+#  define SIMD_X86      1
+#  define TARGET_SSE41
+#  define TARGET_AVX2
+#else
+#  define SIMD_X86      0
+#endif
+
+#if (SIMD_X86)
+#include <immintrin.h>
+#endif
 
-float compute_ssim (VideoParameters *p_Vid, InputParameters *p_Inp, imgpel **refImg, imgpel **encImg, int height, int width, int win_height, int win_width, int comp)
+//! window geometry and constants of one compute_ssim_terms() call
+typedef struct ssim_setup
 {
+  int   win_height;
+  int   win_width;
+  int   step;                 //!< SSIMOverlapSize
+  int   rows;                 //!< number of window rows
+  int   cols;                 //!< number of windows per row
+  int   col_width;            //!< number of columns covered by the windows
+  int   terms;                //!< SSIM_TERM_* flags
+  float win_pixels;
+  float win_pixels_bias;
+  float C1;
+  float C2;
+} SSIMSetup;
 
-  static const float K1 = 0.01f, K2 = 0.03f;
-  float max_pix_value_sqd;
-  float C1, C2;
-  float win_pixels = (float) (win_width * win_height);
-#ifdef UNBIASED_VARIANCE
-  float win_pixels_bias = win_pixels - 1;
+//! column sum kernels of the SSIM computation
+typedef struct ssim_kernels
+{
+  void (*col_add)   (int **col, imgpel *ref, imgpel *enc, int width);
+  void (*col_slide) (int **col, imgpel *ref_out, imgpel *enc_out, imgpel *ref_in, imgpel *enc_in, int width);
+  void (*window_terms) (const SSIMSetup *s, int **win, float **val, int cols);
+} SSIMKernels;
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Adds the samples of a line to the column sums
+ ************************************************************************
+ */
+static void col_add (int **col, imgpel *ref, imgpel *enc, int width)
+{
+  int i;
+
+  for (i = 0; i < width; ++i)
+  {
+    int r = ref[i];
+    int e = enc[i];
+
+    col[SSIM_SUM_REF][i] += r;
+    col[SSIM_SUM_ENC][i] += e;
+    col[SSIM_SQ_REF ][i] += r * r;
+    col[SSIM_SQ_ENC ][i] += e * e;
+    col[SSIM_CROSS  ][i] += r * e;
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Moves the column sums down by one line: removes the samples of the
+ *    top line and adds those of the new bottom line
+ ************************************************************************
+ */
+static void col_slide (int **col, imgpel *ref_out, imgpel *enc_out, imgpel *ref_in, imgpel *enc_in, int width)
+{
+  int i;
+
+  for (i = 0; i < width; ++i)
+  {
+    int ro = ref_out[i], eo = enc_out[i];
+    int ri = ref_in[i],  ei = enc_in[i];
+
+    col[SSIM_SUM_REF][i] += ri - ro;
+    col[SSIM_SUM_ENC][i] += ei - eo;
+    col[SSIM_SQ_REF ][i] += ri * ri - ro * ro;
+    col[SSIM_SQ_ENC ][i] += ei * ei - eo * eo;
+    col[SSIM_CROSS  ][i] += ri * ei - ro * eo;
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Computes the SSIM terms (s->terms) of the windows of a window row
+ *    from their sums
+ ************************************************************************
+ */
+static void window_terms (const SSIMSetup *s, int **win, float **val, int cols)
+{
+  float meanOrg, meanEnc;
+  float varOrg = 0.0f, varEnc = 0.0f, covOrgEnc = 0.0f;
+  float mb_ssim;
+  int x;
+
+  for (x = 0; x < cols; ++x)
+  {
+    meanOrg = (float) win[SSIM_SUM_REF][x] / s->win_pixels;
+    meanEnc = (float) win[SSIM_SUM_ENC][x] / s->win_pixels;
+
+    if (s->terms & (SSIM_TERM_SSIM | SSIM_TERM_STRUCTURAL))
+    {
+      varOrg    = ((float) win[SSIM_SQ_REF][x] - ((float) win[SSIM_SUM_REF][x]) * meanOrg) / s->win_pixels_bias;
+      varEnc    = ((float) win[SSIM_SQ_ENC][x] - ((float) win[SSIM_SUM_ENC][x]) * meanEnc) / s->win_pixels_bias;
+      covOrgEnc = ((float) win[SSIM_CROSS ][x] - ((float) win[SSIM_SUM_REF][x]) * meanEnc) / s->win_pixels_bias;
+    }
+
+    if (s->terms & SSIM_TERM_SSIM)
+    {
+      mb_ssim  = (float) ((2.0 * meanOrg * meanEnc + s->C1) * (2.0 * covOrgEnc + s->C2));
+      mb_ssim /= (float) (meanOrg * meanOrg + meanEnc * meanEnc + s->C1) * (varOrg + varEnc + s->C2);
+      val[0][x] = mb_ssim;
+    }
+    if (s->terms & SSIM_TERM_LUMINANCE)
+    {
+      mb_ssim  = (float) (2.0 * meanOrg * meanEnc + s->C1);
+      mb_ssim /= (float) (meanOrg * meanOrg + meanEnc * meanEnc + s->C1);
+      val[1][x] = mb_ssim;
+    }
+    if (s->terms & SSIM_TERM_STRUCTURAL)
+    {
+      mb_ssim  = (float) (2.0 * covOrgEnc + s->C2);
+      mb_ssim /= (float) (varOrg + varEnc + s->C2);
+      val[2][x] = mb_ssim;
+    }
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Calls window_terms() for the windows from x on
+ ************************************************************************
+ */
+static void window_terms_tail (const SSIMSetup *s, int **win, float **val, int x, int cols)
+{
+  int   *w[SSIM_SUMS] = { &win[0][x], &win[1][x], &win[2][x], &win[3][x], &win[4][x] };
+  float *v[3]         = { &val[0][x], &val[1][x], &val[2][x] };
+
+  if (x < cols)
+    window_terms(s, w, v, cols - x);
+}
+
+static SSIMKernels ssim_kernels = { col_add, col_slide, window_terms };
+
+#if (SIMD_X86)
+/*!
+ ************************************************************************
+ * \brief
+ *    SSE4.1 version of col_add()
+ ************************************************************************
+ */
+TARGET_SSE41 static void col_add_sse41 (int **col, imgpel *ref, imgpel *enc, int width)
+{
+  int i;
+
+  for (i = 0; i + 4 <= width; i += 4)
+  {
+    __m128i r = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &ref[i]));
+    __m128i e = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &enc[i]));
+    __m128i *s;
+
+    s = (__m128i *) &col[SSIM_SUM_REF][i]; _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), r));
+    s = (__m128i *) &col[SSIM_SUM_ENC][i]; _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), e));
+    s = (__m128i *) &col[SSIM_SQ_REF ][i]; _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_mullo_epi32(r, r)));
+    s = (__m128i *) &col[SSIM_SQ_ENC ][i]; _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_mullo_epi32(e, e)));
+    s = (__m128i *) &col[SSIM_CROSS  ][i]; _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_mullo_epi32(r, e)));
+  }
+  if (i < width)
+  {
+    int *tail[SSIM_SUMS] = { &col[0][i], &col[1][i], &col[2][i], &col[3][i], &col[4][i] };
+    col_add(tail, &ref[i], &enc[i], width - i);
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    SSE4.1 version of col_slide()
+ ************************************************************************
+ */
+TARGET_SSE41 static void col_slide_sse41 (int **col, imgpel *ref_out, imgpel *enc_out, imgpel *ref_in, imgpel *enc_in, int width)
+{
+  int i;
+
+  for (i = 0; i + 4 <= width; i += 4)
+  {
+    __m128i ro = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &ref_out[i]));
+    __m128i eo = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &enc_out[i]));
+    __m128i ri = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &ref_in[i]));
+    __m128i ei = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &enc_in[i]));
+    __m128i *s;
+
+    s = (__m128i *) &col[SSIM_SUM_REF][i];
+    _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_sub_epi32(ri, ro)));
+    s = (__m128i *) &col[SSIM_SUM_ENC][i];
+    _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_sub_epi32(ei, eo)));
+    s = (__m128i *) &col[SSIM_SQ_REF ][i];
+    _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_sub_epi32(_mm_mullo_epi32(ri, ri), _mm_mullo_epi32(ro, ro))));
+    s = (__m128i *) &col[SSIM_SQ_ENC ][i];
+    _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_sub_epi32(_mm_mullo_epi32(ei, ei), _mm_mullo_epi32(eo, eo))));
+    s = (__m128i *) &col[SSIM_CROSS  ][i];
+    _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), _mm_sub_epi32(_mm_mullo_epi32(ri, ei), _mm_mullo_epi32(ro, eo))));
+  }
+  if (i < width)
+  {
+    int *tail[SSIM_SUMS] = { &col[0][i], &col[1][i], &col[2][i], &col[3][i], &col[4][i] };
+    col_slide(tail, &ref_out[i], &enc_out[i], &ref_in[i], &enc_in[i], width - i);
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    AVX2 version of col_add()
+ ************************************************************************
+ */
+TARGET_AVX2 static void col_add_avx2 (int **col, imgpel *ref, imgpel *enc, int width)
+{
+  int i;
+
+  for (i = 0; i + 8 <= width; i += 8)
+  {
+    __m256i r = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &ref[i]));
+    __m256i e = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &enc[i]));
+    __m256i *s;
+
+    s = (__m256i *) &col[SSIM_SUM_REF][i]; _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s), r));
+    s = (__m256i *) &col[SSIM_SUM_ENC][i]; _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s), e));
+    s = (__m256i *) &col[SSIM_SQ_REF ][i]; _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s), _mm256_mullo_epi32(r, r)));
+    s = (__m256i *) &col[SSIM_SQ_ENC ][i]; _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s), _mm256_mullo_epi32(e, e)));
+    s = (__m256i *) &col[SSIM_CROSS  ][i]; _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s), _mm256_mullo_epi32(r, e)));
+  }
+  if (i < width)
+  {
+    int *tail[SSIM_SUMS] = { &col[0][i], &col[1][i], &col[2][i], &col[3][i], &col[4][i] };
+    col_add_sse41(tail, &ref[i], &enc[i], width - i);
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    AVX2 version of col_slide()
+ ************************************************************************
+ */
+TARGET_AVX2 static void col_slide_avx2 (int **col, imgpel *ref_out, imgpel *enc_out, imgpel *ref_in, imgpel *enc_in, int width)
+{
+  int i;
+
+  for (i = 0; i + 8 <= width; i += 8)
+  {
+    __m256i ro = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &ref_out[i]));
+    __m256i eo = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &enc_out[i]));
+    __m256i ri = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &ref_in[i]));
+    __m256i ei = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &enc_in[i]));
+    __m256i *s;
+
+    s = (__m256i *) &col[SSIM_SUM_REF][i];
+    _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s), _mm256_sub_epi32(ri, ro)));
+    s = (__m256i *) &col[SSIM_SUM_ENC][i];
+    _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s), _mm256_sub_epi32(ei, eo)));
+    s = (__m256i *) &col[SSIM_SQ_REF ][i];
+    _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s), _mm256_sub_epi32(_mm256_mullo_epi32(ri, ri), _mm256_mullo_epi32(ro, ro))));
+    s = (__m256i *) &col[SSIM_SQ_ENC ][i];
+    _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s), _mm256_sub_epi32(_mm256_mullo_epi32(ei, ei), _mm256_mullo_epi32(eo, eo))));
+    s = (__m256i *) &col[SSIM_CROSS  ][i];
+    _mm256_storeu_si256(s, _mm256_add_epi32(_mm256_loadu_si256(s), _mm256_sub_epi32(_mm256_mullo_epi32(ri, ei), _mm256_mullo_epi32(ro, eo))));
+  }
+  if (i < width)
+  {
+    int *tail[SSIM_SUMS] = { &col[0][i], &col[1][i], &col[2][i], &col[3][i], &col[4][i] };
+    col_slide_sse41(tail, &ref_out[i], &enc_out[i], &ref_in[i], &enc_in[i], width - i);
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    SSE4.1 version of window_terms(): computes all three terms, with
+ *    the same single and double precision operations as window_terms()
+ ************************************************************************
+ */
+TARGET_SSE41 static void window_terms_sse41 (const SSIMSetup *s, int **win, float **val, int cols)
+{
+  const __m128  wp   = _mm_set1_ps(s->win_pixels);
+  const __m128  bias = _mm_set1_ps(s->win_pixels_bias);
+  const __m128  c1   = _mm_set1_ps(s->C1);
+  const __m128  c2   = _mm_set1_ps(s->C2);
+  const __m128d two  = _mm_set1_pd(2.0);
+  const __m128d c1d  = _mm_set1_pd((double) s->C1);
+  const __m128d c2d  = _mm_set1_pd((double) s->C2);
+  int x;
+
+  for (x = 0; x + 4 <= cols; x += 4)
+  {
+    __m128 sR = _mm_cvtepi32_ps(_mm_loadu_si128((__m128i *) &win[SSIM_SUM_REF][x]));
+    __m128 sE = _mm_cvtepi32_ps(_mm_loadu_si128((__m128i *) &win[SSIM_SUM_ENC][x]));
+    __m128 qR = _mm_cvtepi32_ps(_mm_loadu_si128((__m128i *) &win[SSIM_SQ_REF ][x]));
+    __m128 qE = _mm_cvtepi32_ps(_mm_loadu_si128((__m128i *) &win[SSIM_SQ_ENC ][x]));
+    __m128 cR = _mm_cvtepi32_ps(_mm_loadu_si128((__m128i *) &win[SSIM_CROSS  ][x]));
+    __m128 mO = _mm_div_ps(sR, wp);
+    __m128 mE = _mm_div_ps(sE, wp);
+    __m128 vO = _mm_div_ps(_mm_sub_ps(qR, _mm_mul_ps(sR, mO)), bias);
+    __m128 vE = _mm_div_ps(_mm_sub_ps(qE, _mm_mul_ps(sE, mE)), bias);
+    __m128 cv = _mm_div_ps(_mm_sub_ps(cR, _mm_mul_ps(sR, mE)), bias);
+    __m128 den_l  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(mO, mO), _mm_mul_ps(mE, mE)), c1);
+    __m128 den_cs = _mm_add_ps(_mm_add_ps(vO, vE), c2);
+    // 2.0 * meanOrg * meanEnc + C1 and 2.0 * covOrgEnc + C2 in double precision
+    __m128d l_lo  = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(two, _mm_cvtps_pd(mO)), _mm_cvtps_pd(mE)), c1d);
+    __m128d l_hi  = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(two, _mm_cvtps_pd(_mm_movehl_ps(mO, mO))), _mm_cvtps_pd(_mm_movehl_ps(mE, mE))), c1d);
+    __m128d cs_lo = _mm_add_pd(_mm_mul_pd(two, _mm_cvtps_pd(cv)), c2d);
+    __m128d cs_hi = _mm_add_pd(_mm_mul_pd(two, _mm_cvtps_pd(_mm_movehl_ps(cv, cv))), c2d);
+    __m128 ssim = _mm_movelh_ps(_mm_cvtpd_ps(_mm_mul_pd(l_lo, cs_lo)), _mm_cvtpd_ps(_mm_mul_pd(l_hi, cs_hi)));
+    __m128 lum  = _mm_movelh_ps(_mm_cvtpd_ps(l_lo), _mm_cvtpd_ps(l_hi));
+    __m128 cs   = _mm_movelh_ps(_mm_cvtpd_ps(cs_lo), _mm_cvtpd_ps(cs_hi));
+
+    _mm_storeu_ps(&val[0][x], _mm_div_ps(ssim, _mm_mul_ps(den_l, den_cs)));
+    _mm_storeu_ps(&val[1][x], _mm_div_ps(lum, den_l));
+    _mm_storeu_ps(&val[2][x], _mm_div_ps(cs, den_cs));
+  }
+  window_terms_tail(s, win, val, x, cols);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    AVX2 version of window_terms()
+ ************************************************************************
+ */
+TARGET_AVX2 static void window_terms_avx2 (const SSIMSetup *s, int **win, float **val, int cols)
+{
+  const __m256  wp   = _mm256_set1_ps(s->win_pixels);
+  const __m256  bias = _mm256_set1_ps(s->win_pixels_bias);
+  const __m256  c1   = _mm256_set1_ps(s->C1);
+  const __m256  c2   = _mm256_set1_ps(s->C2);
+  const __m256d two  = _mm256_set1_pd(2.0);
+  const __m256d c1d  = _mm256_set1_pd((double) s->C1);
+  const __m256d c2d  = _mm256_set1_pd((double) s->C2);
+  int x;
+
+  for (x = 0; x + 8 <= cols; x += 8)
+  {
+    __m256 sR = _mm256_cvtepi32_ps(_mm256_loadu_si256((__m256i *) &win[SSIM_SUM_REF][x]));
+    __m256 sE = _mm256_cvtepi32_ps(_mm256_loadu_si256((__m256i *) &win[SSIM_SUM_ENC][x]));
+    __m256 qR = _mm256_cvtepi32_ps(_mm256_loadu_si256((__m256i *) &win[SSIM_SQ_REF ][x]));
+    __m256 qE = _mm256_cvtepi32_ps(_mm256_loadu_si256((__m256i *) &win[SSIM_SQ_ENC ][x]));
+    __m256 cR = _mm256_cvtepi32_ps(_mm256_loadu_si256((__m256i *) &win[SSIM_CROSS  ][x]));
+    __m256 mO = _mm256_div_ps(sR, wp);
+    __m256 mE = _mm256_div_ps(sE, wp);
+    __m256 vO = _mm256_div_ps(_mm256_sub_ps(qR, _mm256_mul_ps(sR, mO)), bias);
+    __m256 vE = _mm256_div_ps(_mm256_sub_ps(qE, _mm256_mul_ps(sE, mE)), bias);
+    __m256 cv = _mm256_div_ps(_mm256_sub_ps(cR, _mm256_mul_ps(sR, mE)), bias);
+    __m256 den_l  = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mO, mO), _mm256_mul_ps(mE, mE)), c1);
+    __m256 den_cs = _mm256_add_ps(_mm256_add_ps(vO, vE), c2);
+    // 2.0 * meanOrg * meanEnc + C1 and 2.0 * covOrgEnc + C2 in double precision
+    __m256d l_lo  = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, _mm256_cvtps_pd(_mm256_castps256_ps128(mO))), _mm256_cvtps_pd(_mm256_castps256_ps128(mE))), c1d);
+    __m256d l_hi  = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, _mm256_cvtps_pd(_mm256_extractf128_ps(mO, 1))), _mm256_cvtps_pd(_mm256_extractf128_ps(mE, 1))), c1d);
+    __m256d cs_lo = _mm256_add_pd(_mm256_mul_pd(two, _mm256_cvtps_pd(_mm256_castps256_ps128(cv))), c2d);
+    __m256d cs_hi = _mm256_add_pd(_mm256_mul_pd(two, _mm256_cvtps_pd(_mm256_extractf128_ps(cv, 1))), c2d);
+    __m256 ssim = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_mul_pd(l_lo, cs_lo))), _mm256_cvtpd_ps(_mm256_mul_pd(l_hi, cs_hi)), 1);
+    __m256 lum  = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(l_lo)), _mm256_cvtpd_ps(l_hi), 1);
+    __m256 cs   = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(cs_lo)), _mm256_cvtpd_ps(cs_hi), 1);
+
+    _mm256_storeu_ps(&val[0][x], _mm256_div_ps(ssim, _mm256_mul_ps(den_l, den_cs)));
+    _mm256_storeu_ps(&val[1][x], _mm256_div_ps(lum, den_l));
+    _mm256_storeu_ps(&val[2][x], _mm256_div_ps(cs, den_cs));
+  }
+  window_terms_tail(s, win, val, x, cols);
+}
+#endif
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Selects the column sum kernels of the SSIM computation for the given
+ *    instruction set level (see init_distortion_kernels())
+ ************************************************************************
+ */
+void init_ssim_kernels (int level)
+{
+  ssim_kernels.col_add      = col_add;
+  ssim_kernels.col_slide    = col_slide;
+  ssim_kernels.window_terms = window_terms;
+
+#if (SIMD_X86)
+  if (level >= SIMD_SSE41)
+  {
+    ssim_kernels.col_add      = col_add_sse41;
+    ssim_kernels.col_slide    = col_slide_sse41;
+    ssim_kernels.window_terms = window_terms_sse41;
+  }
+  if (level >= SIMD_AVX2)
+  {
+    ssim_kernels.col_add      = col_add_avx2;
+    ssim_kernels.col_slide    = col_slide_avx2;
+    ssim_kernels.window_terms = window_terms_avx2;
+  }
 #else
-  float win_pixels_bias = win_pixels;
+  (void) level;
 #endif
-  float mb_ssim, meanOrg, meanEnc;
-  float varOrg, varEnc, covOrgEnc;
-  int imeanOrg, imeanEnc, ivarOrg, ivarEnc, icovOrgEnc;
-  float cur_distortion = 0.0;
-  int i, j, n, m, win_cnt = 0;
-  int overlapSize = p_Inp->SSIMOverlapSize;
+}
 
-  max_pix_value_sqd = (float) (p_Vid->max_pel_value_comp[comp] * p_Vid->max_pel_value_comp[comp]);
-  C1 = K1 * K1 * max_pix_value_sqd;
-  C2 = K2 * K2 * max_pix_value_sqd;
+/*!
+ ************************************************************************
+ * \brief
+ *    Returns the scratch buffers of the SSIM metrics (allocated on first use)
+ ************************************************************************
+ */
+SSIMBuffers *get_ssim_buffers (DistortionParams *p_Dist)
+{
+  if (p_Dist->p_SSIM == NULL)
+  {
+    if ((p_Dist->p_SSIM = (SSIMBuffers *) calloc(1, sizeof(SSIMBuffers))) == NULL)
+      no_mem_exit("get_ssim_buffers: p_SSIM");
+  }
+  return p_Dist->p_SSIM;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Makes sure the column and window sums and the band accumulators fit
+ *    the given number of threads, image width and number of bands
+ ************************************************************************
+ */
+static SSIMBuffers *get_band_buffers (DistortionParams *p_Dist, int threads, int width, int bands)
+{
+  SSIMBuffers *buf = get_ssim_buffers(p_Dist);
+
+  if (threads > buf->threads || width > buf->width)
+  {
+    if (buf->col)
+      free_mem3Dint(buf->col);
+    if (buf->win)
+      free_mem3Dint(buf->win);
+    free_pointer(buf->val);
+    buf->threads = imax(threads, buf->threads);
+    buf->width   = imax(width, buf->width);
+    get_mem3Dint(&buf->col, buf->threads, SSIM_SUMS, buf->width);
+    get_mem3Dint(&buf->win, buf->threads, SSIM_SUMS, buf->width);
+    if ((buf->val = (float *) calloc(buf->threads * 3 * buf->width, sizeof(float))) == NULL)
+      no_mem_exit("get_band_buffers: val");
+  }
+  if (bands > buf->bands)
+  {
+    if (buf->band_sum)
+      free_mem2Ddouble(buf->band_sum);
+    buf->bands = bands;
+    get_mem2Ddouble(&buf->band_sum, buf->bands, 3);
+  }
+
+  return buf;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Frees the scratch buffers of the SSIM metrics
+ ************************************************************************
+ */
+void free_ssim_buffers (DistortionParams *p_Dist)
+{
+  SSIMBuffers *buf = p_Dist->p_SSIM;
+  int i;
+
+  if (buf == NULL)
+    return;
+
+  if (buf->col)
+    free_mem3Dint(buf->col);
+  if (buf->win)
+    free_mem3Dint(buf->win);
+  free_pointer(buf->val);
+  if (buf->band_sum)
+    free_mem2Ddouble(buf->band_sum);
+  for (i = 0; i < 2; ++i)
+  {
+    if (buf->ds[i])
+      free_mem2Dpel(buf->ds[i]);
+  }
+  if (buf->pad)
+    free_mem2Dint(buf->pad);
+  if (buf->tmp)
+    free_mem2Dint(buf->tmp);
+
+  free_pointer(p_Dist->p_SSIM);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Computes the window sums of a window row from its column sums
+ ************************************************************************
+ */
+static void window_sums (const SSIMSetup *s, int **col, int **win)
+{
+  int x, k, n;
 
-  for (j = 0; j <= height - win_height; j += overlapSize)
+  for (k = 0; k < SSIM_SUMS; ++k)
   {
-    for (i = 0; i <= width - win_width; i += overlapSize)
+    int *c = col[k];
+    int *w = win[k];
+
+    for (x = 0; x < s->cols; ++x)
     {
-      imeanOrg = 0;
-      imeanEnc = 0; 
-      ivarOrg  = 0;
-      ivarEnc  = 0;
-      icovOrgEnc = 0;
+      int i = x * s->step;
 
-      for ( n = j;n < j + win_height;n ++)
+      if (x > 0 && s->step < s->win_width)
+      {
+        // slide the window to the right by step columns
+        w[x] = w[x - 1];
+        for (n = i - s->step; n < i; ++n)
+          w[x] += c[n + s->win_width] - c[n];
+      }
+      else
       {
-        for (m = i;m < i + win_width;m ++)
-        {
-          imeanOrg   += refImg[n][m];
-          imeanEnc   += encImg[n][m];
-          ivarOrg    += refImg[n][m] * refImg[n][m];
-          ivarEnc    += encImg[n][m] * encImg[n][m];
-          icovOrgEnc += refImg[n][m] * encImg[n][m];
-        }
+        w[x] = 0;
+        for (n = i; n < i + s->win_width; ++n)
+          w[x] += c[n];
       }
+    }
+  }
+}
 
-      meanOrg = (float) imeanOrg / win_pixels;
-      meanEnc = (float) imeanEnc / win_pixels;
+/*!
+ ************************************************************************
+ * \brief
+ *    Computes the windows of a band of SSIM_BAND_ROWS window rows with
+ *    the buffers of the given thread
+ ************************************************************************
+ */
+static void ssim_band (const SSIMSetup *s, SSIMBuffers *buf, int thread, imgpel **refImg, imgpel **encImg, int band)
+{
+  int   **col = buf->col[thread];
+  int   **win = buf->win[thread];
+  float  *val[3];
+  double *band_sum = buf->band_sum[band];
+  int first = band * SSIM_BAND_ROWS;
+  int last  = imin(first + SSIM_BAND_ROWS, s->rows);
+  int j, k, n, x;
+
+  for (k = 0; k < 3; ++k)
+    val[k] = &buf->val[(thread * 3 + k) * buf->width];
 
-      varOrg    = ((float) ivarOrg - ((float) imeanOrg) * meanOrg) / win_pixels_bias;
-      varEnc    = ((float) ivarEnc - ((float) imeanEnc) * meanEnc) / win_pixels_bias;
-      covOrgEnc = ((float) icovOrgEnc - ((float) imeanOrg) * meanEnc) / win_pixels_bias;
+  band_sum[0] = band_sum[1] = band_sum[2] = 0.0;
 
-      mb_ssim  = (float) ((2.0 * meanOrg * meanEnc + C1) * (2.0 * covOrgEnc + C2));
-      mb_ssim /= (float) (meanOrg * meanOrg + meanEnc * meanEnc + C1) * (varOrg + varEnc + C2);
+  for (k = first; k < last; ++k)
+  {
+    j = k * s->step;
 
-      cur_distortion += mb_ssim;
-      win_cnt++;
+    if (k > first && s->step < s->win_height)
+    {
+      // move the column sums down by step lines
+      for (n = j - s->step; n < j; ++n)
+        ssim_kernels.col_slide(col, refImg[n], encImg[n], refImg[n + s->win_height], encImg[n + s->win_height], s->col_width);
+    }
+    else
+    {
+      for (n = 0; n < SSIM_SUMS; ++n)
+        memset(col[n], 0, s->col_width * sizeof(int));
+      for (n = j; n < j + s->win_height; ++n)
+        ssim_kernels.col_add(col, refImg[n], encImg[n], s->col_width);
+    }
+
+    window_sums(s, col, win);
+    ssim_kernels.window_terms(s, win, val, s->cols);
+
+    for (n = 0; n < 3; ++n)
+    {
+      if (s->terms & (1 << n))
+      {
+        for (x = 0; x < s->cols; ++x)
+          band_sum[n] += val[n][x];
+      }
     }
   }
+}
 
-  cur_distortion /= (float) win_cnt;
+/*!
+ ************************************************************************
+ * \brief
+ *    Average of a term over the windows
+ ************************************************************************
+ */
+static float ssim_average (double sum, int win_cnt)
+{
+  float cur_distortion = (win_cnt > 0) ? (float) (sum / (double) win_cnt) : 1.0f;
 
   if (cur_distortion >= 1.0 && cur_distortion < 1.01) // avoid float accuracy problem at very low QP(e.g.2)
     cur_distortion = 1.0;
@@ -88,13 +633,89 @@ float compute_ssim (VideoParameters *p_Vid, InputParameters *p_Inp, imgpel **ref
   return cur_distortion;
 }
 
+/*!
+ ************************************************************************
+ * \brief
+ *    Computes the average SSIM terms (SSIM_TERM_* flags) over the windows
+ *    of an image, the windows being SSIMOverlapSize samples apart.
+ *    unbiased selects the unbiased estimation of the variances.
+ ************************************************************************
+ */
+void compute_ssim_terms (VideoParameters *p_Vid, InputParameters *p_Inp, imgpel **refImg, imgpel **encImg, int height, int width,
+                         int win_height, int win_width, int comp, int unbiased, int terms, SSIMTerms *result)
+{
+  static const float K1 = 0.01f, K2 = 0.03f;
+  int threads = imax(1, p_Inp->SSIMThreads);
+  float max_pix_value_sqd;
+  double sum[3] = { 0.0, 0.0, 0.0 };
+  SSIMBuffers *buf;
+  SSIMSetup s;
+  int num_bands, band, k;
+
+  s.win_height = win_height;
+  s.win_width  = win_width;
+  s.step       = p_Inp->SSIMOverlapSize;
+  s.rows       = (height >= win_height) ? (height - win_height) / s.step + 1 : 0;
+  s.cols       = (width  >= win_width ) ? (width  - win_width ) / s.step + 1 : 0;
+  s.col_width  = (s.cols > 0) ? (s.cols - 1) * s.step + win_width : 0;
+  s.terms      = terms;
+  s.win_pixels = (float) (win_width * win_height);
+  s.win_pixels_bias = unbiased ? s.win_pixels - 1 : s.win_pixels;
+
+  max_pix_value_sqd = (float) (p_Vid->max_pel_value_comp[comp] * p_Vid->max_pel_value_comp[comp]);
+  s.C1 = K1 * K1 * max_pix_value_sqd;
+  s.C2 = K2 * K2 * max_pix_value_sqd;
+
+  num_bands = (s.cols > 0) ? (s.rows + SSIM_BAND_ROWS - 1) / SSIM_BAND_ROWS : 0;
+  buf = get_band_buffers(p_Vid->p_Dist, threads, imax(1, s.col_width), imax(1, num_bands));
+
+#if defined(OPENMP)
+  if (threads > 1 && num_bands > 1)
+  {
+#pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+    for (band = 0; band < num_bands; ++band)
+      ssim_band(&s, buf, omp_get_thread_num(), refImg, encImg, band);
+  }
+  else
+#endif
+  {
+    for (band = 0; band < num_bands; ++band)
+      ssim_band(&s, buf, 0, refImg, encImg, band);
+  }
+
+  for (band = 0; band < num_bands; ++band)
+  {
+    for (k = 0; k < 3; ++k)
+      sum[k] += buf->band_sum[band][k];
+  }
+
+  result->ssim       = ssim_average(sum[0], s.rows * s.cols);
+  result->luminance  = ssim_average(sum[1], s.rows * s.cols);
+  result->structural = ssim_average(sum[2], s.rows * s.cols);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    SSIM index of an image (biased variance estimation)
+ ************************************************************************
+ */
+static float compute_ssim (VideoParameters *p_Vid, InputParameters *p_Inp, imgpel **refImg, imgpel **encImg, int height, int width, int win_height, int win_width, int comp)
+{
+  SSIMTerms terms;
+
+  compute_ssim_terms(p_Vid, p_Inp, refImg, encImg, height, width, win_height, win_width, comp, FALSE, SSIM_TERM_SSIM, &terms);
+
+  return terms.ssim;
+}
+
 /*!
  ************************************************************************
  * \brief
  *    Find SSIM for all three components
  ************************************************************************
  */
-void find_ssim (VideoParameters *p_Vid, InputParameters *p_Inp, ImageStructure *ref, ImageStructure *src, DistMetric *metricSSIM)
+void find_ssim (VideoParameters *p_Vid, InputParameters *p_Inp, ImageStructure *ref, ImageStructure *src, DistMetric metricSSIM[3])
 {
   DistortionParams *p_Dist = p_Vid->p_Dist;
   FrameFormat *format = &ref->format;
@@ -102,7 +723,7 @@ void find_ssim (VideoParameters *p_Vid, InputParameters *p_Inp, ImageStructure *
   metricSSIM->value[0] = compute_ssim (p_Vid, p_Inp, ref->data[0], src->data[0], format->height[0], format->width[0], BLOCK_SIZE_8x8, BLOCK_SIZE_8x8, 0);
   // Chroma.
   if (format->yuv_format != YUV400)
-  {     
+  {
     metricSSIM->value[1]  = compute_ssim (p_Vid, p_Inp, ref->data[1], src->data[1], format->height[1], format->width[1], p_Vid->mb_cr_size_y, p_Vid->mb_cr_size_x, 1);
     metricSSIM->value[2]  = compute_ssim (p_Vid, p_Inp, ref->data[2], src->data[2], format->height[1], format->width[1], p_Vid->mb_cr_size_y, p_Vid->mb_cr_size_x, 2);
   }
@@ -112,4 +733,3 @@ void find_ssim (VideoParameters *p_Vid, InputParameters *p_Inp, ImageStructure *
     accumulate_avslice(metricSSIM,  p_Vid->type, p_Vid->p_Stats->frame_ctr[p_Vid->type]);
   }
 }
-
@@ -5,6 +5,18 @@
 * \brief
 *    Luma interpolation functions
 *
+*    The padded picture is processed in bands of SUBPEL_BAND_HEIGHT lines:
+*      - the integer samples (and their padding) of all bands are copied first,
+*      - the half-pel planes of a band only read integer samples and a band
+*        local copy of the horizontally filtered (unclipped) samples,
+*      - the quarter-pel planes of a band also read the first half-pel line
+*        of the next band.
+*    The bands of each step can be processed by several threads
+*    (SubPelThreads) or on demand, when motion estimation first reads them
+*    (LazySubPel). The line filters have SSE4.1 and AVX2 versions that are
+*    selected at run time (see init_luma_kernels()). All versions give
+*    exactly the same samples.
+*
 * \author
 *    Main contributors (see contributors.h for copyright, address and affiliation details)
 *      - Alexis Michael Tourapis <alexis.tourapis@dolby.com>
@@ -22,577 +34,661 @@
 #include "image.h"
 #include "img_luma.h"
 #include "memalloc.h"
+#include "me_distortion.h"
+
+#if (JM_SIMD_DISTORTION) && (IMGTYPE) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#  define SIMD_X86      1
+#  define TARGET_SSE41  __attribute__((target("sse4.1")))
+#  define TARGET_AVX2   __attribute__((target("avx2")))
+#elif (JM_SIMD_DISTORTION) && (IMGTYPE) && defined(_MSC_VER) && (_MSC_VER >= 1700) && (defined(_M_X64) || defined(_M_IX86))
+#  define SIMD_X86      1
+#  define TARGET_SSE41
+#  define TARGET_AVX2
+#else
+#  define SIMD_X86      0
+#endif
+
+#if (SIMD_X86)
+#include <immintrin.h>
+#endif
+
+//! line filters of the luma interpolation
+typedef struct luma_kernels
+{
+  void (*hor_six_tap)    (imgpel *dst, int *tmp, imgpel *src, int width, int max_pel);
+  void (*ver_six_tap)    (imgpel *dst, imgpel *src[6], int width, int max_pel);
+  void (*ver_six_tap_tmp)(imgpel *dst, int *src[6], int width, int max_pel);
+  void (*bilinear)       (imgpel *dst, imgpel *src1, imgpel *src2, int width);
+} LumaKernels;
 
+//! sample positions A..F of the six tap filter: j, j-1, j-2, j+1, j+2, j+3
+static const int six_tap_pos[6] = { 0, -1, -2, 1, 2, 3 };
 
 /*!
  ************************************************************************
  * \brief
- *    Copy Integer Samples to image [0][0]
- *
- * \param s
- *    pointer to StorablePicture structure
- * \param dstImg
- *    destination image
- * \param srcImg
- *    source image
+ *    Horizontal six tap filter of the samples [i0, i1) of one padded line
+ *    of width samples. tmp receives the unclipped sums, dst the rounded
+ *    and clipped half-pel samples. Samples outside the line are replaced
+ *    by the first / last sample.
  ************************************************************************
  */
-static void getSubImageInteger( StorablePicture *s, imgpel **dstImg, imgpel **srcImg)
+static void hor_six_tap_range (imgpel *dst, int *tmp, imgpel *src, int width, int max_pel, int i0, int i1)
 {
-  int i, j;
-  int size_x_minus1 = s->size_x - 1;
-
-  imgpel *wBufSrc, *wBufDst;
+  const int tap0 = ONE_FOURTH_TAP[0][0];
+  const int tap1 = ONE_FOURTH_TAP[0][1];
+  const int tap2 = ONE_FOURTH_TAP[0][2];
+  int i, is;
 
-  // Copy top line
-  wBufDst = &( dstImg[-IMG_PAD_SIZE_Y][-IMG_PAD_SIZE_X] ); 
-  wBufSrc = srcImg[0];
-  // left IMG_PAD_SIZE
-  for (i = 0; i < IMG_PAD_SIZE_X; i++)
-    *(wBufDst++) = wBufSrc[0];
-  // center 0-(s->size_x)
-  memcpy(wBufDst, wBufSrc, s->size_x * sizeof(imgpel));
-  wBufDst += s->size_x;
-  // right IMG_PAD_SIZE
-  for (i = 0; i < IMG_PAD_SIZE_X; i++)
-    *(wBufDst++) = wBufSrc[size_x_minus1];
-
-  // Now copy remaining pad lines
-  for (j = -IMG_PAD_SIZE_Y+1; j < 1; ++j)
+  for (i = i0; i < i1; ++i)
   {
-    memcpy(dstImg[j]-IMG_PAD_SIZE_X, dstImg[j - 1]-IMG_PAD_SIZE_X, s->size_x_padded * sizeof(imgpel));
-  }
-
-  for (j = 1; j < s->size_y; j++)
-  {    
-    wBufDst = &( dstImg[j][-IMG_PAD_SIZE_X] ); 
-    wBufSrc = srcImg[j];
-    // left IMG_PAD_SIZE
-    for (i = 0; i < IMG_PAD_SIZE_X; i++)
-      *(wBufDst++) = wBufSrc[0];
-    // center 0-(s->size_x)
-    memcpy(wBufDst, wBufSrc, s->size_x * sizeof(imgpel));
-    wBufDst += s->size_x;
-    // right IMG_PAD_SIZE
-    for (i = 0; i < IMG_PAD_SIZE_X; i++)
-      *(wBufDst++) = wBufSrc[size_x_minus1];
-  }
-
-  // Replicate bottom pad lines
-  for (j = s->size_y; j < s->size_y+IMG_PAD_SIZE_Y; j++)
-  {    
-    memcpy(dstImg[j]-IMG_PAD_SIZE_X, dstImg[j - 1]-IMG_PAD_SIZE_X, s->size_x_padded * sizeof(imgpel));
+    if (i >= 2 && i < width - 3)
+    {
+      is =
+        (tap0 * (src[i    ] + src[i + 1]) +
+         tap1 * (src[i - 1] + src[i + 2]) +
+         tap2 * (src[i - 2] + src[i + 3]));
+    }
+    else
+    {
+      is =
+        (tap0 * (src[i              ] + src[imin(i + 1, width - 1)]) +
+         tap1 * (src[imax(i - 1, 0) ] + src[imin(i + 2, width - 1)]) +
+         tap2 * (src[imax(i - 2, 0) ] + src[imin(i + 3, width - 1)]));
+    }
+    tmp[i] = is;
+    dst[i] = (imgpel) iClip1 (max_pel, rshift_rnd_sf( is, 5 ) );
   }
 }
 
-static void getSubImageInteger_s( StorablePicture *s, imgpel **dstImg, imgpel **srcImg)
+/*!
+ ************************************************************************
+ * \brief
+ *    Horizontal six tap filter of one padded line
+ ************************************************************************
+ */
+static void hor_six_tap_line (imgpel *dst, int *tmp, imgpel *src, int width, int max_pel)
 {
-  int i, j;
-  int size_x_minus1 = s->size_x - 1;
+  hor_six_tap_range(dst, tmp, src, width, max_pel, 0, width);
+}
 
-  imgpel *wBufSrc, *wBufDst;
+/*!
+ ************************************************************************
+ * \brief
+ *    Vertical six tap filter of one line (src: lines A..F)
+ ************************************************************************
+ */
+static void ver_six_tap_line (imgpel *dst, imgpel *src[6], int width, int max_pel)
+{
+  const int tap0 = ONE_FOURTH_TAP[0][0];
+  const int tap1 = ONE_FOURTH_TAP[0][1];
+  const int tap2 = ONE_FOURTH_TAP[0][2];
+  int i, is;
 
-  // Copy top line
-  wBufDst = &( dstImg[-IMG_PAD_SIZE_Y][-IMG_PAD_SIZE_X] ); 
-  wBufSrc = srcImg[0];
-  // left IMG_PAD_SIZE
-  for (i = 0; i < IMG_PAD_SIZE_X; ++i)
-    *(wBufDst++) = wBufSrc[0];
-  // center 0-(s->size_x)
-  memcpy(wBufDst, wBufSrc, s->size_x * sizeof(imgpel));
-  wBufDst += s->size_x;
-  // right IMG_PAD_SIZE
-  for (i = 0; i < IMG_PAD_SIZE_X; ++i)
-    *(wBufDst++) = wBufSrc[size_x_minus1];
-
-  // Now copy remaining pad lines
-  for (j = -IMG_PAD_SIZE_Y+1; j < 1; ++j)
+  for (i = 0; i < width; ++i)
   {
-    memcpy(dstImg[j]-IMG_PAD_SIZE_X, dstImg[j - 1]-IMG_PAD_SIZE_X, s->size_x_padded * sizeof(imgpel));
-  }
-
-  for (j = 1; j < s->size_y; ++j)
-  {    
-    wBufDst = &( dstImg[j][-IMG_PAD_SIZE_X] ); 
-    wBufSrc = srcImg[j];
-    // left IMG_PAD_SIZE
-    for (i = 0; i < IMG_PAD_SIZE_X; ++i)
-      *(wBufDst++) = wBufSrc[0];
-    // center 0-(s->size_x)
-    //memcpy(wBufDst, wBufSrc, s->size_x * sizeof(imgpel));
-    wBufDst += s->size_x;
-    // right IMG_PAD_SIZE
-    for (i = 0; i < IMG_PAD_SIZE_X; ++i)
-      *(wBufDst++) = wBufSrc[size_x_minus1];
-  }
+    is =
+      (tap0 * (src[0][i] + src[3][i]) +
+       tap1 * (src[1][i] + src[4][i]) +
+       tap2 * (src[2][i] + src[5][i]));
 
-  // Replicate bottom pad lines
-  for (j = s->size_y; j < s->size_y+IMG_PAD_SIZE_Y; ++j)
-  {    
-    memcpy(dstImg[j]-IMG_PAD_SIZE_X, dstImg[j - 1]-IMG_PAD_SIZE_X, s->size_x_padded * sizeof(imgpel));
+    dst[i] = (imgpel) iClip1 (max_pel, rshift_rnd_sf( is, 5 ) );
   }
 }
 
 /*!
  ************************************************************************
  * \brief
- *    Does _horizontal_ interpolation using the SIX TAP filters
- *
- * \param p_Vid
- *    pointer to VideoParameters structure
- * \param s
- *    pointer to StorablePicture structure
- * \param dstImg
- *    destination image
- * \param srcImg
- *    source image
+ *    Vertical six tap filter of one line of horizontally filtered sums
  ************************************************************************
  */
-static void getHorSubImageSixTap( VideoParameters *p_Vid, StorablePicture *s, imgpel **dstImg, imgpel **srcImg)
+static void ver_six_tap_tmp_line (imgpel *dst, int *src[6], int width, int max_pel)
 {
-  int is, jpad, ipad;
-  int ypadded_size = s->size_y_padded;
-  int xpadded_size = s->size_x_padded;
-
-  imgpel *wBufSrc, *wBufDst;
-  imgpel *srcImgA, *srcImgB, *srcImgC, *srcImgD, *srcImgE, *srcImgF;
-  int *iBufDst;
   const int tap0 = ONE_FOURTH_TAP[0][0];
   const int tap1 = ONE_FOURTH_TAP[0][1];
   const int tap2 = ONE_FOURTH_TAP[0][2];
+  int i, is;
 
-  for (jpad = -IMG_PAD_SIZE_Y; jpad < ypadded_size-IMG_PAD_SIZE_Y; jpad++)
+  for (i = 0; i < width; ++i)
   {
-    wBufSrc = srcImg[jpad]-IMG_PAD_SIZE_X; 
-    wBufDst = dstImg[jpad]-IMG_PAD_SIZE_X; 
-    iBufDst = p_Vid->imgY_sub_tmp[jpad]-IMG_PAD_SIZE_X;
-
-    srcImgA = &wBufSrc[0];
-    srcImgB = &wBufSrc[0];      
-    srcImgC = &wBufSrc[0];
-    srcImgD = &wBufSrc[1];
-    srcImgE = &wBufSrc[2];
-    srcImgF = &wBufSrc[3];
-
-    // left padded area
     is =
-      (tap0 * (*srcImgA++ + *srcImgD++) +
-      tap1 *  (*srcImgB   + *srcImgE++) +
-      tap2 *  (*srcImgC   + *srcImgF++));
+      (tap0 * (src[0][i] + src[3][i]) +
+       tap1 * (src[1][i] + src[4][i]) +
+       tap2 * (src[2][i] + src[5][i]));
 
-    *iBufDst++ =  is;
-    *wBufDst++ = (imgpel) iClip1 ( p_Vid->max_imgpel_value, rshift_rnd_sf( is, 5 ) );      
+    dst[i] = (imgpel) iClip1 (max_pel, rshift_rnd_sf( is, 10 ) );
+  }
+}
 
-    is =
-      (tap0 * (*srcImgA++ + *srcImgD++) +
-      tap1 *  (*srcImgB++ + *srcImgE++) +
-      tap2 *  (*srcImgC   + *srcImgF++));
+/*!
+ ************************************************************************
+ * \brief
+ *    Bilinear (rounded average) filter of two lines
+ ************************************************************************
+ */
+static void bilinear_line (imgpel *dst, imgpel *src1, imgpel *src2, int width)
+{
+  int i;
 
-    *iBufDst++ =  is;
-    *wBufDst++ = (imgpel) iClip1 ( p_Vid->max_imgpel_value, rshift_rnd_sf( is, 5 ) );      
+  for (i = 0; i < width; ++i)
+    dst[i] = (imgpel) rshift_rnd_sf( src1[i] + src2[i], 1 );
+}
 
-    // center
-    for (ipad = 2; ipad < xpadded_size - 4; ipad++)
-    {
-      is =
-        (tap0 * (*srcImgA++ + *srcImgD++) +
-        tap1 *  (*srcImgB++ + *srcImgE++) +
-        tap2 *  (*srcImgC++ + *srcImgF++));
+static LumaKernels luma_kernels = { hor_six_tap_line, ver_six_tap_line, ver_six_tap_tmp_line, bilinear_line };
 
-      *iBufDst++ =  is;
-      *wBufDst++ = (imgpel) iClip1 ( p_Vid->max_imgpel_value, rshift_rnd_sf( is, 5 ) );      
-    }
+#if (SIMD_X86)
+/*!
+ ************************************************************************
+ * \brief
+ *    SSE4.1 version of hor_six_tap_line()
+ ************************************************************************
+ */
+TARGET_SSE41 static void hor_six_tap_line_sse41 (imgpel *dst, int *tmp, imgpel *src, int width, int max_pel)
+{
+  const __m128i tap0 = _mm_set1_epi32(ONE_FOURTH_TAP[0][0]);
+  const __m128i tap1 = _mm_set1_epi32(ONE_FOURTH_TAP[0][1]);
+  const __m128i rnd  = _mm_set1_epi32(16);
+  const __m128i maxv = _mm_set1_epi16((short) max_pel);
+  int i;
+
+  // the first two and last three samples read beyond the line
+  hor_six_tap_range(dst, tmp, src, width, max_pel, 0, 2);
+  for (i = 2; i + 4 <= width - 3; i += 4)
+  {
+    __m128i a = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &src[i - 2]));
+    __m128i b = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &src[i - 1]));
+    __m128i c = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &src[i    ]));
+    __m128i d = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &src[i + 1]));
+    __m128i e = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &src[i + 2]));
+    __m128i f = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &src[i + 3]));
+    __m128i is = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(tap0, _mm_add_epi32(c, d)),
+                                             _mm_mullo_epi32(tap1, _mm_add_epi32(b, e))), _mm_add_epi32(a, f));
+    __m128i r  = _mm_srai_epi32(_mm_add_epi32(is, rnd), 5);
+
+    _mm_storeu_si128((__m128i *) &tmp[i], is);
+    _mm_storel_epi64((__m128i *) &dst[i], _mm_min_epu16(_mm_packus_epi32(r, r), maxv));
+  }
+  hor_six_tap_range(dst, tmp, src, width, max_pel, i, width);
+}
 
-    is = (
-      tap0 * (*srcImgA++ + *srcImgD++) +
-      tap1 * (*srcImgB++ + *srcImgE++) +
-      tap2 * (*srcImgC++ + *srcImgF  ));
+/*!
+ ************************************************************************
+ * \brief
+ *    SSE4.1 version of ver_six_tap_line()
+ ************************************************************************
+ */
+TARGET_SSE41 static void ver_six_tap_line_sse41 (imgpel *dst, imgpel *src[6], int width, int max_pel)
+{
+  const __m128i tap0 = _mm_set1_epi32(ONE_FOURTH_TAP[0][0]);
+  const __m128i tap1 = _mm_set1_epi32(ONE_FOURTH_TAP[0][1]);
+  const __m128i rnd  = _mm_set1_epi32(16);
+  const __m128i maxv = _mm_set1_epi16((short) max_pel);
+  int i;
 
-    *iBufDst++ =  is;
-    *wBufDst++ = (imgpel) iClip1 ( p_Vid->max_imgpel_value, rshift_rnd_sf( is, 5 ) );      
+  for (i = 0; i + 4 <= width; i += 4)
+  {
+    __m128i a = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &src[0][i]));
+    __m128i b = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &src[1][i]));
+    __m128i c = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &src[2][i]));
+    __m128i d = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &src[3][i]));
+    __m128i e = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &src[4][i]));
+    __m128i f = _mm_cvtepu16_epi32(_mm_loadl_epi64((__m128i *) &src[5][i]));
+    __m128i is = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(tap0, _mm_add_epi32(a, d)),
+                                             _mm_mullo_epi32(tap1, _mm_add_epi32(b, e))), _mm_add_epi32(c, f));
+    __m128i r  = _mm_srai_epi32(_mm_add_epi32(is, rnd), 5);
+
+    _mm_storel_epi64((__m128i *) &dst[i], _mm_min_epu16(_mm_packus_epi32(r, r), maxv));
+  }
+  if (i < width)
+  {
+    imgpel *tail[6] = { src[0] + i, src[1] + i, src[2] + i, src[3] + i, src[4] + i, src[5] + i };
+    ver_six_tap_line(dst + i, tail, width - i, max_pel);
+  }
+}
 
-    // right padded area
-    is = (
-      tap0 * (*srcImgA++ + *srcImgD++) +
-      tap1 * (*srcImgB++ + *srcImgE) +
-      tap2 * (*srcImgC++ + *srcImgF));
+/*!
+ ************************************************************************
+ * \brief
+ *    SSE4.1 version of ver_six_tap_tmp_line()
+ ************************************************************************
+ */
+TARGET_SSE41 static void ver_six_tap_tmp_line_sse41 (imgpel *dst, int *src[6], int width, int max_pel)
+{
+  const __m128i tap0 = _mm_set1_epi32(ONE_FOURTH_TAP[0][0]);
+  const __m128i tap1 = _mm_set1_epi32(ONE_FOURTH_TAP[0][1]);
+  const __m128i rnd  = _mm_set1_epi32(512);
+  const __m128i maxv = _mm_set1_epi16((short) max_pel);
+  int i;
 
-    *iBufDst++ =  is;
-    *wBufDst++ = (imgpel) iClip1 ( p_Vid->max_imgpel_value, rshift_rnd_sf( is, 5 ) );      
+  for (i = 0; i + 4 <= width; i += 4)
+  {
+    __m128i a = _mm_loadu_si128((__m128i *) &src[0][i]);
+    __m128i b = _mm_loadu_si128((__m128i *) &src[1][i]);
+    __m128i c = _mm_loadu_si128((__m128i *) &src[2][i]);
+    __m128i d = _mm_loadu_si128((__m128i *) &src[3][i]);
+    __m128i e = _mm_loadu_si128((__m128i *) &src[4][i]);
+    __m128i f = _mm_loadu_si128((__m128i *) &src[5][i]);
+    __m128i is = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(tap0, _mm_add_epi32(a, d)),
+                                             _mm_mullo_epi32(tap1, _mm_add_epi32(b, e))), _mm_add_epi32(c, f));
+    __m128i r  = _mm_srai_epi32(_mm_add_epi32(is, rnd), 10);
+
+    _mm_storel_epi64((__m128i *) &dst[i], _mm_min_epu16(_mm_packus_epi32(r, r), maxv));
+  }
+  if (i < width)
+  {
+    int *tail[6] = { src[0] + i, src[1] + i, src[2] + i, src[3] + i, src[4] + i, src[5] + i };
+    ver_six_tap_tmp_line(dst + i, tail, width - i, max_pel);
+  }
+}
 
-    is = (
-      tap0 * (*srcImgA++ + *srcImgD) +
-      tap1 * (*srcImgB++ + *srcImgE) +
-      tap2 * (*srcImgC++ + *srcImgF));
+/*!
+ ************************************************************************
+ * \brief
+ *    SSE4.1 version of bilinear_line()
+ ************************************************************************
+ */
+TARGET_SSE41 static void bilinear_line_sse41 (imgpel *dst, imgpel *src1, imgpel *src2, int width)
+{
+  int i;
 
-    *iBufDst++ =  is;
-    *wBufDst++ = (imgpel) iClip1 ( p_Vid->max_imgpel_value, rshift_rnd_sf( is, 5 ) );      
+  for (i = 0; i + 8 <= width; i += 8)
+  {
+    __m128i a = _mm_loadu_si128((__m128i *) &src1[i]);
+    __m128i b = _mm_loadu_si128((__m128i *) &src2[i]);
+    _mm_storeu_si128((__m128i *) &dst[i], _mm_avg_epu16(a, b));
+  }
+  bilinear_line(dst + i, src1 + i, src2 + i, width - i);
+}
 
-    is = (
-      tap0 * (*srcImgA + *srcImgD) +
-      tap1 * (*srcImgB + *srcImgE) +
-      tap2 * (*srcImgC + *srcImgF));
+/*!
+ ************************************************************************
+ * \brief
+ *    Rounds, clips and packs eight 32 bit sums to imgpel
+ ************************************************************************
+ */
+TARGET_AVX2 static inline __m128i pack_clip_avx2 (__m256i is, __m256i rnd, int shift, __m128i maxv)
+{
+  __m256i r = _mm256_srai_epi32(_mm256_add_epi32(is, rnd), shift);
+  return _mm_min_epu16(_mm_packus_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1)), maxv);
+}
 
-    *iBufDst =  is;
-    *wBufDst = (imgpel) iClip1 ( p_Vid->max_imgpel_value, rshift_rnd_sf( is, 5 ) );      
+/*!
+ ************************************************************************
+ * \brief
+ *    AVX2 version of hor_six_tap_line()
+ ************************************************************************
+ */
+TARGET_AVX2 static void hor_six_tap_line_avx2 (imgpel *dst, int *tmp, imgpel *src, int width, int max_pel)
+{
+  const __m256i tap0 = _mm256_set1_epi32(ONE_FOURTH_TAP[0][0]);
+  const __m256i tap1 = _mm256_set1_epi32(ONE_FOURTH_TAP[0][1]);
+  const __m256i rnd  = _mm256_set1_epi32(16);
+  const __m128i maxv = _mm_set1_epi16((short) max_pel);
+  int i;
 
+  for (i = 2; i + 8 <= width - 3; i += 8)
+  {
+    __m256i a = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &src[i - 2]));
+    __m256i b = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &src[i - 1]));
+    __m256i c = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &src[i    ]));
+    __m256i d = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &src[i + 1]));
+    __m256i e = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &src[i + 2]));
+    __m256i f = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &src[i + 3]));
+    __m256i is = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(tap0, _mm256_add_epi32(c, d)),
+                                                   _mm256_mullo_epi32(tap1, _mm256_add_epi32(b, e))), _mm256_add_epi32(a, f));
+
+    _mm256_storeu_si256((__m256i *) &tmp[i], is);
+    _mm_storeu_si128((__m128i *) &dst[i], pack_clip_avx2(is, rnd, 5, maxv));
   }
+  // both ends and the remaining samples
+  hor_six_tap_range(dst, tmp, src, width, max_pel, 0, 2);
+  hor_six_tap_range(dst, tmp, src, width, max_pel, i, width);
 }
 
 /*!
  ************************************************************************
  * \brief
- *    Does _vertical_ interpolation using the SIX TAP filters
- *
- * \param p_Vid
- *    pointer to VideoParameters structure
- * \param s
- *    pointer to StorablePicture structure
- * \param dstImg
- *    pointer to target image
- * \param srcImg
- *    pointer to source image
+ *    AVX2 version of ver_six_tap_line()
  ************************************************************************
  */
-static void getVerSubImageSixTap( VideoParameters *p_Vid, StorablePicture *s, imgpel **dstImg, imgpel **srcImg)
+TARGET_AVX2 static void ver_six_tap_line_avx2 (imgpel *dst, imgpel *src[6], int width, int max_pel)
 {
-  int is, jpad, ipad;
-  int ypadded_size = s->size_y_padded;
-  int xpadded_size = s->size_x_padded;
-  int maxy = ypadded_size - 1-IMG_PAD_SIZE_Y;
-
-  imgpel *wxLineDst;
-  imgpel *srcImgA, *srcImgB, *srcImgC, *srcImgD, *srcImgE, *srcImgF;
-  const int tap0 = ONE_FOURTH_TAP[0][0];
-  const int tap1 = ONE_FOURTH_TAP[0][1];
-  const int tap2 = ONE_FOURTH_TAP[0][2];
+  const __m256i tap0 = _mm256_set1_epi32(ONE_FOURTH_TAP[0][0]);
+  const __m256i tap1 = _mm256_set1_epi32(ONE_FOURTH_TAP[0][1]);
+  const __m256i rnd  = _mm256_set1_epi32(16);
+  const __m128i maxv = _mm_set1_epi16((short) max_pel);
+  int i;
 
-  // branches within the j loop
-  // top
-  for (jpad = -IMG_PAD_SIZE_Y; jpad < 2-IMG_PAD_SIZE_Y; jpad++)
+  for (i = 0; i + 8 <= width; i += 8)
   {
-    wxLineDst = dstImg[jpad]-IMG_PAD_SIZE_X;
-    srcImgA = srcImg[jpad ]-IMG_PAD_SIZE_X;
-    srcImgB = srcImg[0-IMG_PAD_SIZE_Y]-IMG_PAD_SIZE_X;      
-    srcImgC = srcImg[0-IMG_PAD_SIZE_Y]-IMG_PAD_SIZE_X;
-    srcImgD = srcImg[jpad + 1]-IMG_PAD_SIZE_X;
-    srcImgE = srcImg[jpad + 2]-IMG_PAD_SIZE_X;
-    srcImgF = srcImg[jpad + 3]-IMG_PAD_SIZE_X;
-    for (ipad = 0; ipad < xpadded_size; ipad++)
-    {
-      is =
-        (tap0 * (*srcImgA++ + *srcImgD++) +
-        tap1 *  (*srcImgB++ + *srcImgE++) +
-        tap2 *  (*srcImgC++ + *srcImgF++));
-
-      wxLineDst[ipad] = (imgpel) iClip1 (p_Vid->max_imgpel_value, rshift_rnd_sf( is, 5 ) );
-    }
+    __m256i a = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &src[0][i]));
+    __m256i b = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &src[1][i]));
+    __m256i c = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &src[2][i]));
+    __m256i d = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &src[3][i]));
+    __m256i e = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &src[4][i]));
+    __m256i f = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *) &src[5][i]));
+    __m256i is = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(tap0, _mm256_add_epi32(a, d)),
+                                                   _mm256_mullo_epi32(tap1, _mm256_add_epi32(b, e))), _mm256_add_epi32(c, f));
+
+    _mm_storeu_si128((__m128i *) &dst[i], pack_clip_avx2(is, rnd, 5, maxv));
   }
-  // center
-  for (jpad = 2-IMG_PAD_SIZE_Y; jpad < ypadded_size - 3-IMG_PAD_SIZE_Y; jpad++)
+  if (i < width)
   {
-    wxLineDst = dstImg[jpad]-IMG_PAD_SIZE_X;
-    srcImgA = srcImg[jpad ]-IMG_PAD_SIZE_X;
-    srcImgB = srcImg[jpad - 1]-IMG_PAD_SIZE_X;      
-    srcImgC = srcImg[jpad - 2]-IMG_PAD_SIZE_X;
-    srcImgD = srcImg[jpad + 1]-IMG_PAD_SIZE_X;
-    srcImgE = srcImg[jpad + 2]-IMG_PAD_SIZE_X;
-    srcImgF = srcImg[jpad + 3]-IMG_PAD_SIZE_X;
-    for (ipad = 0; ipad < xpadded_size; ipad++)
-    {
-      is =
-        (tap0 * (*srcImgA++ + *srcImgD++) +
-        tap1 *  (*srcImgB++ + *srcImgE++) +
-        tap2 *  (*srcImgC++ + *srcImgF++));
-
-      wxLineDst[ipad] = (imgpel) iClip1 ( p_Vid->max_imgpel_value, rshift_rnd_sf( is, 5 ) );
-    }
+    imgpel *tail[6] = { src[0] + i, src[1] + i, src[2] + i, src[3] + i, src[4] + i, src[5] + i };
+    ver_six_tap_line_sse41(dst + i, tail, width - i, max_pel);
   }
+}
 
-  // bottom
-  for (jpad = ypadded_size - 3-IMG_PAD_SIZE_Y; jpad < ypadded_size-IMG_PAD_SIZE_Y; jpad++)
-  {
-    wxLineDst = dstImg[jpad]-IMG_PAD_SIZE_X;
-    srcImgA = srcImg[jpad ]-IMG_PAD_SIZE_X;
-    srcImgB = srcImg[jpad - 1]-IMG_PAD_SIZE_X;      
-    srcImgC = srcImg[jpad - 2]-IMG_PAD_SIZE_X;
-    srcImgD = srcImg[imin (maxy, jpad + 1)]-IMG_PAD_SIZE_X;
-    srcImgE = srcImg[maxy]-IMG_PAD_SIZE_X;
-    srcImgF = srcImg[maxy]-IMG_PAD_SIZE_X;
-    for (ipad = 0; ipad < xpadded_size; ipad++)
-    {
-      is =
-        (tap0 * (*srcImgA++ + *srcImgD++) +
-        tap1 *  (*srcImgB++ + *srcImgE++) +
-        tap2 *  (*srcImgC++ + *srcImgF++));
+/*!
+ ************************************************************************
+ * \brief
+ *    AVX2 version of ver_six_tap_tmp_line()
+ ************************************************************************
+ */
+TARGET_AVX2 static void ver_six_tap_tmp_line_avx2 (imgpel *dst, int *src[6], int width, int max_pel)
+{
+  const __m256i tap0 = _mm256_set1_epi32(ONE_FOURTH_TAP[0][0]);
+  const __m256i tap1 = _mm256_set1_epi32(ONE_FOURTH_TAP[0][1]);
+  const __m256i rnd  = _mm256_set1_epi32(512);
+  const __m128i maxv = _mm_set1_epi16((short) max_pel);
+  int i;
 
-      wxLineDst[ipad] = (imgpel) iClip1 ( p_Vid->max_imgpel_value, rshift_rnd_sf( is, 5 ) );
-    }
+  for (i = 0; i + 8 <= width; i += 8)
+  {
+    __m256i a = _mm256_loadu_si256((__m256i *) &src[0][i]);
+    __m256i b = _mm256_loadu_si256((__m256i *) &src[1][i]);
+    __m256i c = _mm256_loadu_si256((__m256i *) &src[2][i]);
+    __m256i d = _mm256_loadu_si256((__m256i *) &src[3][i]);
+    __m256i e = _mm256_loadu_si256((__m256i *) &src[4][i]);
+    __m256i f = _mm256_loadu_si256((__m256i *) &src[5][i]);
+    __m256i is = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(tap0, _mm256_add_epi32(a, d)),
+                                                   _mm256_mullo_epi32(tap1, _mm256_add_epi32(b, e))), _mm256_add_epi32(c, f));
+
+    _mm_storeu_si128((__m128i *) &dst[i], pack_clip_avx2(is, rnd, 10, maxv));
+  }
+  if (i < width)
+  {
+    int *tail[6] = { src[0] + i, src[1] + i, src[2] + i, src[3] + i, src[4] + i, src[5] + i };
+    ver_six_tap_tmp_line_sse41(dst + i, tail, width - i, max_pel);
   }
 }
 
 /*!
  ************************************************************************
  * \brief
- *    Does _vertical_ interpolation using the SIX TAP filters
- *
- * \param p_Vid
- *    pointer to VideoParameters structure
- * \param s
- *    pointer to StorablePicture structure
- * \param dstImg
- *    pointer to source image
+ *    AVX2 version of bilinear_line()
  ************************************************************************
  */
-static void getVerSubImageSixTapTmp( VideoParameters *p_Vid, StorablePicture *s, imgpel **dstImg)
+TARGET_AVX2 static void bilinear_line_avx2 (imgpel *dst, imgpel *src1, imgpel *src2, int width)
 {
-  int is, jpad, ipad;
-  int ypadded_size = s->size_y_padded;
-  int xpadded_size = s->size_x_padded;
-  int maxy = ypadded_size - 1-IMG_PAD_SIZE_Y;
-
-  imgpel *wxLineDst;
-  int *srcImgA, *srcImgB, *srcImgC, *srcImgD, *srcImgE, *srcImgF;
-  const int tap0 = ONE_FOURTH_TAP[0][0];
-  const int tap1 = ONE_FOURTH_TAP[0][1];
-  const int tap2 = ONE_FOURTH_TAP[0][2];
+  int i;
 
-  // top
-  for (jpad = -IMG_PAD_SIZE_Y; jpad < 2-IMG_PAD_SIZE_Y; jpad++)
+  for (i = 0; i + 16 <= width; i += 16)
   {
-    wxLineDst = dstImg[jpad]-IMG_PAD_SIZE_X;
-    srcImgA = p_Vid->imgY_sub_tmp[jpad ]-IMG_PAD_SIZE_X;
-    srcImgB = p_Vid->imgY_sub_tmp[0-IMG_PAD_SIZE_Y]-IMG_PAD_SIZE_X;     
-    srcImgC = p_Vid->imgY_sub_tmp[0-IMG_PAD_SIZE_Y]-IMG_PAD_SIZE_X;
-    srcImgD = p_Vid->imgY_sub_tmp[jpad + 1]-IMG_PAD_SIZE_X;
-    srcImgE = p_Vid->imgY_sub_tmp[jpad + 2]-IMG_PAD_SIZE_X;
-    srcImgF = p_Vid->imgY_sub_tmp[jpad + 3]-IMG_PAD_SIZE_X;
-
-    for (ipad = 0; ipad < xpadded_size; ipad++)
-    {
-      is =
-        (tap0 * (*srcImgA++ + *srcImgD++) +
-        tap1 *  (*srcImgB++ + *srcImgE++) +
-        tap2 *  (*srcImgC++ + *srcImgF++));
-
-      wxLineDst[ipad] = (imgpel) iClip1 ( p_Vid->max_imgpel_value, rshift_rnd_sf( is, 10 ) );
-    }
+    __m256i a = _mm256_loadu_si256((__m256i *) &src1[i]);
+    __m256i b = _mm256_loadu_si256((__m256i *) &src2[i]);
+    _mm256_storeu_si256((__m256i *) &dst[i], _mm256_avg_epu16(a, b));
   }
+  bilinear_line_sse41(dst + i, src1 + i, src2 + i, width - i);
+}
+#endif
 
-  // center
-  for (jpad = 2-IMG_PAD_SIZE_Y; jpad < ypadded_size - 3-IMG_PAD_SIZE_Y; jpad++)
-  {
-    wxLineDst = dstImg[jpad]-IMG_PAD_SIZE_X;
-    srcImgA = p_Vid->imgY_sub_tmp[jpad ]-IMG_PAD_SIZE_X;
-    srcImgB = p_Vid->imgY_sub_tmp[jpad - 1]-IMG_PAD_SIZE_X;     
-    srcImgC = p_Vid->imgY_sub_tmp[jpad - 2]-IMG_PAD_SIZE_X;
-    srcImgD = p_Vid->imgY_sub_tmp[jpad + 1]-IMG_PAD_SIZE_X;
-    srcImgE = p_Vid->imgY_sub_tmp[jpad + 2]-IMG_PAD_SIZE_X;
-    srcImgF = p_Vid->imgY_sub_tmp[jpad + 3]-IMG_PAD_SIZE_X;
-    for (ipad = 0; ipad < xpadded_size; ipad++)
-    {
-      is =
-        (tap0 * (*srcImgA++ + *srcImgD++) +
-        tap1 *  (*srcImgB++ + *srcImgE++) +
-        tap2 *  (*srcImgC++ + *srcImgF++));
+/*!
+ ************************************************************************
+ * \brief
+ *    Selects the line filters of the luma interpolation for the given
+ *    instruction set level (see init_distortion_kernels())
+ ************************************************************************
+ */
+void init_luma_kernels (int level)
+{
+  luma_kernels.hor_six_tap     = hor_six_tap_line;
+  luma_kernels.ver_six_tap     = ver_six_tap_line;
+  luma_kernels.ver_six_tap_tmp = ver_six_tap_tmp_line;
+  luma_kernels.bilinear        = bilinear_line;
 
-      wxLineDst[ipad] = (imgpel) iClip1 ( p_Vid->max_imgpel_value, rshift_rnd_sf( is, 10 ) );
-    }
+#if (SIMD_X86)
+  if (level >= SIMD_SSE41)
+  {
+    luma_kernels.hor_six_tap     = hor_six_tap_line_sse41;
+    luma_kernels.ver_six_tap     = ver_six_tap_line_sse41;
+    luma_kernels.ver_six_tap_tmp = ver_six_tap_tmp_line_sse41;
+    luma_kernels.bilinear        = bilinear_line_sse41;
   }
-
-  // bottom
-  for (jpad = ypadded_size - 3-IMG_PAD_SIZE_Y; jpad < ypadded_size-IMG_PAD_SIZE_Y; jpad++)
+  if (level >= SIMD_AVX2)
   {
-    wxLineDst = dstImg[jpad]-IMG_PAD_SIZE_X;
-    srcImgA = p_Vid->imgY_sub_tmp[jpad ]-IMG_PAD_SIZE_X;
-    srcImgB = p_Vid->imgY_sub_tmp[jpad - 1]-IMG_PAD_SIZE_X;      
-    srcImgC = p_Vid->imgY_sub_tmp[jpad - 2]-IMG_PAD_SIZE_X;
-    srcImgD = p_Vid->imgY_sub_tmp[imin (maxy, jpad + 1)]-IMG_PAD_SIZE_X;
-    srcImgE = p_Vid->imgY_sub_tmp[maxy]-IMG_PAD_SIZE_X;
-    srcImgF = p_Vid->imgY_sub_tmp[maxy]-IMG_PAD_SIZE_X;
-    for (ipad = 0; ipad < xpadded_size; ipad++)
-    {
-      is =
-        (tap0 * (*srcImgA++ + *srcImgD++) +
-        tap1 *  (*srcImgB++ + *srcImgE++) +
-        tap2 *  (*srcImgC++ + *srcImgF++));
-
-      wxLineDst[ipad] = (imgpel) iClip1 ( p_Vid->max_imgpel_value, rshift_rnd_sf( is, 10 ) );
-    }
+    luma_kernels.hor_six_tap     = hor_six_tap_line_avx2;
+    luma_kernels.ver_six_tap     = ver_six_tap_line_avx2;
+    luma_kernels.ver_six_tap_tmp = ver_six_tap_tmp_line_avx2;
+    luma_kernels.bilinear        = bilinear_line_avx2;
   }
+#else
+  (void) level;
+#endif
 }
 
 /*!
  ************************************************************************
  * \brief
- *    Does _horizontal_ interpolation using the BiLinear filter
- *
- * \param s
- *    pointer to StorablePicture structure
- * \param dstImg
- *    destination Image
- * \param srcImgL
- *    source left image
- * \param srcImgR
- *    source right image 
+ *    Allocates the band buffers of the luma interpolation, one set per
+ *    interpolation thread. Returns the allocated memory size.
  ************************************************************************
  */
-static void getSubImageBiLinear( StorablePicture *s, imgpel **dstImg, imgpel **srcImgL, imgpel **srcImgR)
+int init_luma_interpolation (VideoParameters *p_Vid, InputParameters *p_Inp)
 {
-  int jpad, ipad;
-  int ypadded_size = s->size_y_padded;
-  int xpadded_size = s->size_x_padded;
+  int memory_size = 0;
 
-  imgpel *wBufSrcL, *wBufSrcR, *wBufDst;
+  p_Vid->num_sub_tmp = imax(1, p_Inp->SubPelThreads);
+  memory_size += get_mem2Dint(&p_Vid->imgY_sub_tmp, p_Vid->num_sub_tmp, (SUBPEL_BAND_HEIGHT + 5) * (p_Vid->width + 2 * IMG_PAD_SIZE_X));
+  memory_size += get_mem2Dpel(&p_Vid->imgY_sub_line, p_Vid->num_sub_tmp, p_Vid->width + 2 * IMG_PAD_SIZE_X);
 
-  for (jpad = -IMG_PAD_SIZE_Y; jpad < ypadded_size-IMG_PAD_SIZE_Y; jpad++)
-  {
-    wBufSrcL = srcImgL[jpad]-IMG_PAD_SIZE_X; 
-    wBufSrcR = srcImgR[jpad]-IMG_PAD_SIZE_X; 
-    wBufDst  = dstImg[jpad]-IMG_PAD_SIZE_X;  
+  return memory_size;
+}
 
-    for (ipad = 0; ipad < xpadded_size; ipad++)
-    {
-      *wBufDst++ = (imgpel) rshift_rnd_sf( *wBufSrcL++ + *wBufSrcR++, 1 );
-    }
+/*!
+ ************************************************************************
+ * \brief
+ *    Frees the band buffers of the luma interpolation
+ ************************************************************************
+ */
+void free_luma_interpolation (VideoParameters *p_Vid)
+{
+  if (p_Vid->imgY_sub_tmp)
+  {
+    free_mem2Dint(p_Vid->imgY_sub_tmp);
+    p_Vid->imgY_sub_tmp = NULL;
+  }
+  if (p_Vid->imgY_sub_line)
+  {
+    free_mem2Dpel(p_Vid->imgY_sub_line);
+    p_Vid->imgY_sub_line = NULL;
   }
 }
 
+/*!
+ ************************************************************************
+ * \brief
+ *    Returns the number of bands of the padded picture
+ ************************************************************************
+ */
+static inline int get_num_bands (StorablePicture *s)
+{
+  return (s->size_y_padded + SUBPEL_BAND_HEIGHT - 1) / SUBPEL_BAND_HEIGHT;
+}
 
 /*!
  ************************************************************************
  * \brief
- *    Does _horizontal_ interpolation using the BiLinear filter
+ *    Copy Integer Samples of the lines [y0, y1) of the padded picture
+ *    to image [0][0]. Lines outside the picture repeat the first / last
+ *    line; with dstImg == srcImg only the padding is written.
  *
  * \param s
  *    pointer to StorablePicture structure
  * \param dstImg
- *    destination Image
- * \param srcImgL
- *    source left image
- * \param srcImgR
- *    source right image 
+ *    destination image
+ * \param srcImg
+ *    source image
+ * \param y0
+ *    first line
+ * \param y1
+ *    line after the last line
  ************************************************************************
  */
-static void getHorSubImageBiLinear( StorablePicture *s, imgpel **dstImg, imgpel **srcImgL, imgpel **srcImgR)
+static void getSubImageInteger( StorablePicture *s, imgpel **dstImg, imgpel **srcImg, int y0, int y1)
 {
-  int jpad, ipad;
-  int ypadded_size = s->size_y_padded;
-  int xpadded_size = s->size_x_padded - 1;
+  int i, j;
+  int size_x_minus1 = s->size_x - 1;
 
-  imgpel *wBufSrcL, *wBufSrcR, *wBufDst;
+  imgpel *wBufSrc, *wBufDst;
 
-  for (jpad = -IMG_PAD_SIZE_Y; jpad < ypadded_size-IMG_PAD_SIZE_Y; jpad++)
+  for (j = y0; j < y1; ++j)
   {
-    wBufSrcL = srcImgL[jpad]-IMG_PAD_SIZE_X; 
-    wBufSrcR = &srcImgR[jpad][1-IMG_PAD_SIZE_X]; 
-    wBufDst  = dstImg[jpad]-IMG_PAD_SIZE_X;     
+    int jsrc = iClip3(0, s->size_y - 1, j);
 
-    // left padded area + center
-    for (ipad = 0; ipad < xpadded_size; ipad++)
-    {
-      *wBufDst++ = (imgpel) rshift_rnd_sf( *wBufSrcL++ + *wBufSrcR++, 1 );
-    }
-    // right padded area
-      *wBufDst++ = (imgpel) rshift_rnd_sf( *wBufSrcL++ + wBufSrcR[-1], 1 );
+    wBufDst = &( dstImg[j][-IMG_PAD_SIZE_X] );
+    wBufSrc = srcImg[jsrc];
+    // left IMG_PAD_SIZE
+    for (i = 0; i < IMG_PAD_SIZE_X; ++i)
+      *(wBufDst++) = wBufSrc[0];
+    // center 0-(s->size_x)
+    if (wBufDst != wBufSrc)
+      memcpy(wBufDst, wBufSrc, s->size_x * sizeof(imgpel));
+    wBufDst += s->size_x;
+    // right IMG_PAD_SIZE
+    for (i = 0; i < IMG_PAD_SIZE_X; ++i)
+      *(wBufDst++) = wBufSrc[size_x_minus1];
   }
 }
 
-
 /*!
  ************************************************************************
  * \brief
- *    Does _vertical_ interpolation using the BiLinear filter
+ *    Half-pel planes [0][2], [2][0] and [2][2] of one band
  *
+ * \param p_Vid
+ *    pointer to VideoParameters structure
  * \param s
  *    pointer to StorablePicture structure
- * \param dstImg
- *    destination Image
- * \param srcImgT
- *    source top image
- * \param srcImgB
- *    source bottom image 
+ * \param band
+ *    band number
+ * \param thread
+ *    index of the band buffers to use
  ************************************************************************
  */
-static void getVerSubImageBiLinear( StorablePicture *s, imgpel **dstImg, imgpel **srcImgT, imgpel **srcImgB)
+static void getHalfPelBand( VideoParameters *p_Vid, StorablePicture *s, int band, int thread)
 {
-  int jpad, ipad;
-  int ypadded_size = s->size_y_padded - 1;
-  int xpadded_size = s->size_x_padded;  
-
-  imgpel *wBufSrcT, *wBufSrcB, *wBufDst;
-
-  // top
-  for (jpad = -IMG_PAD_SIZE_Y; jpad < ypadded_size-IMG_PAD_SIZE_Y; jpad++)
+  imgpel ****cImgSub = s->p_curr_img_sub;
+  int otf_shift  = ( p_Vid->p_Inp->OnTheFlyFractMCP == OTF_L1 ) ? (1) : (0) ;
+  int max_pel    = p_Vid->max_imgpel_value;
+  int width      = s->size_x_padded;
+  int maxy       = s->size_y_padded - 1 - IMG_PAD_SIZE_Y;
+  int y0         = band * SUBPEL_BAND_HEIGHT - IMG_PAD_SIZE_Y;
+  int y1         = imin(y0 + SUBPEL_BAND_HEIGHT, maxy + 1);
+  // lines of the horizontally filtered sums needed by the band
+  int ty0        = imax(y0 - 2, -IMG_PAD_SIZE_Y);
+  int ty1        = imin(y1 + 3, maxy + 1);
+  int *tmp       = p_Vid->imgY_sub_tmp[thread];
+  imgpel *junk   = p_Vid->imgY_sub_line[thread];
+  imgpel **img0  = cImgSub[0][0];
+  imgpel **img02 = cImgSub[0][2>>otf_shift];
+  imgpel **img20 = cImgSub[2>>otf_shift][0];
+  imgpel **img22 = cImgSub[2>>otf_shift][2>>otf_shift];
+  imgpel *src[6];
+  int    *src_tmp[6];
+  int j, k;
+
+  // sub-image 2 [0][2]: HOR interpolate (six-tap) sub-image [0][0]
+  for (j = ty0; j < ty1; ++j)
   {
-    wBufSrcT = srcImgT[jpad]-IMG_PAD_SIZE_X;           
-    wBufDst  = dstImg[jpad]-IMG_PAD_SIZE_X;            
-    wBufSrcB = srcImgB[jpad + 1]-IMG_PAD_SIZE_X;  
-
-    for (ipad = 0; ipad < xpadded_size; ipad++)
-    {
-      *wBufDst++ = (imgpel) rshift_rnd_sf(*wBufSrcT++ + *wBufSrcB++, 1);
-    }
+    luma_kernels.hor_six_tap((j >= y0 && j < y1) ? img02[j] - IMG_PAD_SIZE_X : junk, &tmp[(j - ty0) * width], img0[j] - IMG_PAD_SIZE_X, width, max_pel);
   }
-  // bottom
-  wBufSrcT = srcImgT[ypadded_size-IMG_PAD_SIZE_Y]-IMG_PAD_SIZE_X;           
-  wBufDst  = dstImg[ypadded_size-IMG_PAD_SIZE_Y]-IMG_PAD_SIZE_X;            
-  wBufSrcB = srcImgB[ypadded_size-IMG_PAD_SIZE_Y]-IMG_PAD_SIZE_X;           
 
-  for (ipad = 0; ipad < xpadded_size; ipad++)
+  for (j = y0; j < y1; ++j)
   {
-    *wBufDst++ = (imgpel) rshift_rnd_sf(*wBufSrcT++ + *wBufSrcB++, 1);
+    for (k = 0; k < 6; ++k)
+    {
+      int jk = iClip3(-IMG_PAD_SIZE_Y, maxy, j + six_tap_pos[k]);
+      src[k]     = img0[jk] - IMG_PAD_SIZE_X;
+      src_tmp[k] = &tmp[(jk - ty0) * width];
+    }
+    // sub-image 8 [2][0]: VER interpolate (six-tap) sub-image [0][0]
+    luma_kernels.ver_six_tap    (img20[j] - IMG_PAD_SIZE_X, src, width, max_pel);
+    // sub-image 10 [2][2]: VER interpolate (six-tap) sub-image [0][2]
+    luma_kernels.ver_six_tap_tmp(img22[j] - IMG_PAD_SIZE_X, src_tmp, width, max_pel);
   }
 }
 
+/*!
+ ************************************************************************
+ * \brief
+ *    Bilinear interpolation of one line, the second line shifted by one
+ *    sample to the right (the last sample is not shifted)
+ ************************************************************************
+ */
+static inline void bilinear_line_shifted (imgpel *dst, imgpel *src1, imgpel *src2, int width)
+{
+  luma_kernels.bilinear(dst, src1, src2 + 1, width - 1);
+  dst[width - 1] = (imgpel) rshift_rnd_sf( src1[width - 1] + src2[width - 1], 1 );
+}
 
 /*!
  ************************************************************************
  * \brief
- *    Does _diagonal_ interpolation using the BiLinear filter
+ *    Quarter-pel planes of one band (requires the half-pel planes of the
+ *    band and of the first line of the next band)
  *
  * \param s
  *    pointer to StorablePicture structure
- * \param dstImg
- *    destination Image
- * \param srcImgT
- *    source top/left image
- * \param srcImgB
- *    source bottom/right image 
+ * \param band
+ *    band number
  ************************************************************************
  */
-static void getDiagSubImageBiLinear( StorablePicture *s, imgpel **dstImg, imgpel **srcImgT, imgpel **srcImgB )
+static void getQuarterPelBand( StorablePicture *s, int band)
 {
-  int jpad, ipad;
-  int maxx = s->size_x_padded - 1-IMG_PAD_SIZE_X;
-  int maxy = s->size_y_padded - 1-IMG_PAD_SIZE_Y;
-
-  imgpel *wBufSrcL, *wBufSrcR, *wBufDst;
-
-  for (jpad = -IMG_PAD_SIZE_Y; jpad < maxy; jpad++)
-  {
-    wBufSrcL = srcImgT[jpad + 1]-IMG_PAD_SIZE_X; 
-    wBufSrcR = &srcImgB[jpad][1-IMG_PAD_SIZE_X]; 
-    wBufDst  = dstImg[jpad]-IMG_PAD_SIZE_X;      
-
-    for (ipad = -IMG_PAD_SIZE_X; ipad < maxx; ipad++)
-    {
-      *wBufDst++ = (imgpel) rshift_rnd_sf(*wBufSrcL++ + *wBufSrcR++, 1);
-    }
-
-    *wBufDst++ = (imgpel) rshift_rnd_sf(*wBufSrcL++ +  wBufSrcR[-1], 1);
-  }
+  imgpel ****cImgSub = s->p_curr_img_sub;
+  int width = s->size_x_padded;
+  int maxy  = s->size_y_padded - 1 - IMG_PAD_SIZE_Y;
+  int y0    = band * SUBPEL_BAND_HEIGHT - IMG_PAD_SIZE_Y;
+  int y1    = imin(y0 + SUBPEL_BAND_HEIGHT, maxy + 1);
+  int j;
 
-  wBufSrcL = srcImgT[maxy]-IMG_PAD_SIZE_X;     
-  wBufSrcR = &srcImgB[maxy][1-IMG_PAD_SIZE_X]; 
-  wBufDst = dstImg[maxy]-IMG_PAD_SIZE_X;       
+  //  0  1  2  3
+  //  4  5  6  7
+  //  8  9 10 11
+  // 12 13 14 15
 
-  for (ipad = -IMG_PAD_SIZE_X; ipad < maxx; ipad++)
+  for (j = y0; j < y1; ++j)
   {
-    *wBufDst++ = (imgpel) rshift_rnd_sf(*wBufSrcL++ + *wBufSrcR++, 1);
+    int jb = imin(j + 1, maxy);
+    imgpel *p00  = cImgSub[0][0][j ] - IMG_PAD_SIZE_X;
+    imgpel *p02  = cImgSub[0][2][j ] - IMG_PAD_SIZE_X;
+    imgpel *p20  = cImgSub[2][0][j ] - IMG_PAD_SIZE_X;
+    imgpel *p22  = cImgSub[2][2][j ] - IMG_PAD_SIZE_X;
+    imgpel *p00b = cImgSub[0][0][jb] - IMG_PAD_SIZE_X;
+    imgpel *p02b = cImgSub[0][2][jb] - IMG_PAD_SIZE_X;
+
+    // sub-images 1, 4, 5, 6, 9
+    luma_kernels.bilinear(cImgSub[0][1][j] - IMG_PAD_SIZE_X, p00, p02, width);
+    luma_kernels.bilinear(cImgSub[1][0][j] - IMG_PAD_SIZE_X, p00, p20, width);
+    luma_kernels.bilinear(cImgSub[1][1][j] - IMG_PAD_SIZE_X, p02, p20, width);
+    luma_kernels.bilinear(cImgSub[1][2][j] - IMG_PAD_SIZE_X, p02, p22, width);
+    luma_kernels.bilinear(cImgSub[2][1][j] - IMG_PAD_SIZE_X, p20, p22, width);
+
+    // sub-images 3, 7, 11: HOR bilinear with the next column
+    bilinear_line_shifted(cImgSub[0][3][j] - IMG_PAD_SIZE_X, p02, p00, width);
+    bilinear_line_shifted(cImgSub[1][3][j] - IMG_PAD_SIZE_X, p02, p20, width);
+    bilinear_line_shifted(cImgSub[2][3][j] - IMG_PAD_SIZE_X, p22, p20, width);
+
+    // sub-images 12, 13, 14: VER bilinear with the next line
+    luma_kernels.bilinear(cImgSub[3][0][j] - IMG_PAD_SIZE_X, p20, p00b, width);
+    luma_kernels.bilinear(cImgSub[3][1][j] - IMG_PAD_SIZE_X, p20, p02b, width);
+    luma_kernels.bilinear(cImgSub[3][2][j] - IMG_PAD_SIZE_X, p22, p02b, width);
+
+    // sub-image 15: DIAG bilinear
+    bilinear_line_shifted(cImgSub[3][3][j] - IMG_PAD_SIZE_X, p02b, p20, width);
   }
-
-    *wBufDst++ = (imgpel) rshift_rnd_sf(*wBufSrcL++ + wBufSrcR[-1], 1);
 }
 
 /*!
@@ -610,71 +706,137 @@ static void getDiagSubImageBiLinear( StorablePicture *s, imgpel **dstImg, imgpel
  */
 void getSubImagesLuma( VideoParameters *p_Vid, StorablePicture *s )
 {
-  imgpel ****cImgSub   = s->p_curr_img_sub;
-  int        otf_shift = ( p_Vid->p_Inp->OnTheFlyFractMCP == OTF_L1 ) ? (1) : (0) ;
+  int num_bands = get_num_bands(s);
+  int quarter   = !p_Vid->p_Inp->OnTheFlyFractMCP;
+  int band;
 
-  //  0  1  2  3
-  //  4  5  6  7
-  //  8  9 10 11
-  // 12 13 14 15
+#if defined(OPENMP)
+  if (p_Vid->p_Inp->SubPelThreads > 1)
+  {
+#pragma omp parallel num_threads(p_Vid->p_Inp->SubPelThreads)
+    {
+      int b;
+      int thread = omp_get_thread_num();
+
+#pragma omp for schedule(static)
+      for (b = 0; b < num_bands; ++b)
+      {
+        int y0 = b * SUBPEL_BAND_HEIGHT - IMG_PAD_SIZE_Y;
+        getSubImageInteger( s, s->p_curr_img_sub[0][0], s->p_curr_img, y0, imin(y0 + SUBPEL_BAND_HEIGHT, s->size_y + IMG_PAD_SIZE_Y));
+      }
+#pragma omp for schedule(static)
+      for (b = 0; b < num_bands; ++b)
+        getHalfPelBand( p_Vid, s, b, thread);
+      if (quarter)
+      {
+#pragma omp for schedule(static)
+        for (b = 0; b < num_bands; ++b)
+          getQuarterPelBand( s, b);
+      }
+    }
+    return;
+  }
+#endif
 
   //// INTEGER PEL POSITIONS ////
+  getSubImageInteger( s, s->p_curr_img_sub[0][0], s->p_curr_img, -IMG_PAD_SIZE_Y, s->size_y + IMG_PAD_SIZE_Y);
 
-  // sub-image 0 [0][0]
-  // simply copy the integer pels
-  if (cImgSub[0][0][0] != s->p_curr_img[0])
+  //// HALF-PEL POSITIONS: SIX-TAP FILTER, QUARTER-PEL POSITIONS: BI-LINEAR INTERPOLATION ////
+  // band after band, so that the lines are still in the cache
+  getHalfPelBand( p_Vid, s, 0, 0);
+  for (band = 0; band < num_bands; ++band)
   {
-    getSubImageInteger( s, cImgSub[0][0], s->p_curr_img);
+    if (band + 1 < num_bands)
+      getHalfPelBand( p_Vid, s, band + 1, 0);
+    if (quarter)
+      getQuarterPelBand( s, band);
   }
-  else
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Lazy version of getSubImagesLuma() (LazySubPel): only the integer
+ *    samples are copied. The half and quarter-pel bands are interpolated
+ *    by get_sub_images_luma_rows() when motion estimation or compensation
+ *    first reads them.
+ ************************************************************************
+ */
+void getSubImagesLumaLazy( VideoParameters *p_Vid, StorablePicture *s )
+{
+  SubPelBands *bands = s->subpel_bands;
+
+  getSubImageInteger( s, s->p_curr_img_sub[0][0], s->p_curr_img, -IMG_PAD_SIZE_Y, s->size_y + IMG_PAD_SIZE_Y);
+
+  if (bands == NULL)
   {
-    getSubImageInteger_s( s, cImgSub[0][0], s->p_curr_img);
+    if ((bands = (SubPelBands *) calloc(1, sizeof(SubPelBands))) == NULL)
+      no_mem_exit("getSubImagesLumaLazy: bands");
+    bands->num_bands = get_num_bands(s);
+    if ((bands->state = (byte *) calloc(bands->num_bands, sizeof(byte))) == NULL)
+      no_mem_exit("getSubImagesLumaLazy: bands->state");
+    s->subpel_bands = bands;
   }
+  else
+    memset(bands->state, 0, bands->num_bands * sizeof(byte));
 
-  //// HALF-PEL POSITIONS: SIX-TAP FILTER ////
-
-  // sub-image 2 [0][2]
-  // HOR interpolate (six-tap) sub-image [0][0]
-  getHorSubImageSixTap( p_Vid, s, cImgSub[0][2>>otf_shift], cImgSub[0][0] );
+  bands->p_Vid    = p_Vid;
+  bands->num_done = 0;
+}
 
-  // sub-image 8 [2][0]
-  // VER interpolate (six-tap) sub-image [0][0]
-  getVerSubImageSixTap( p_Vid, s, cImgSub[2>>otf_shift][0], cImgSub[0][0]);
+/*!
+ ************************************************************************
+ * \brief
+ *    Frees the band states of a lazily interpolated picture
+ ************************************************************************
+ */
+void free_sub_pel_bands (StorablePicture *s)
+{
+  if (s->subpel_bands != NULL)
+  {
+    free(s->subpel_bands->state);
+    free(s->subpel_bands);
+    s->subpel_bands = NULL;
+  }
+}
 
-  // sub-image 10 [2][2]
-  // VER interpolate (six-tap) sub-image [0][2]
-  getVerSubImageSixTapTmp( p_Vid, s, cImgSub[2>>otf_shift][2>>otf_shift]);
+/*!
+ ************************************************************************
+ * \brief
+ *    Interpolates the missing bands of a LazySubPel picture that contain
+ *    the luma lines [y0, y1] of the padded picture
+ ************************************************************************
+ */
+void get_sub_images_luma_rows (StorablePicture *s, int y0, int y1)
+{
+  SubPelBands *bands = s->subpel_bands;
+  int first = (iClip3(-IMG_PAD_SIZE_Y, s->size_y + IMG_PAD_SIZE_Y - 1, y0) + IMG_PAD_SIZE_Y) / SUBPEL_BAND_HEIGHT;
+  int last  = (iClip3(-IMG_PAD_SIZE_Y, s->size_y + IMG_PAD_SIZE_Y - 1, y1) + IMG_PAD_SIZE_Y) / SUBPEL_BAND_HEIGHT;
+  int band;
 
-  if( !p_Vid->p_Inp->OnTheFlyFractMCP )
+  for (band = first; band <= last; ++band)
   {
-    //// QUARTER-PEL POSITIONS: BI-LINEAR INTERPOLATION ////
-
-    // sub-image 1 [0][1]
-    getSubImageBiLinear    ( s, cImgSub[0][1], cImgSub[0][0], cImgSub[0][2]);
-    // sub-image 4 [1][0]
-    getSubImageBiLinear    ( s, cImgSub[1][0], cImgSub[0][0], cImgSub[2][0]);
-    // sub-image 5 [1][1]
-    getSubImageBiLinear    ( s, cImgSub[1][1], cImgSub[0][2], cImgSub[2][0]);
-    // sub-image 6 [1][2]
-    getSubImageBiLinear    ( s, cImgSub[1][2], cImgSub[0][2], cImgSub[2][2]);
-    // sub-image 9 [2][1]
-    getSubImageBiLinear    ( s, cImgSub[2][1], cImgSub[2][0], cImgSub[2][2]);
-
-    // sub-image 3  [0][3]
-    getHorSubImageBiLinear ( s, cImgSub[0][3], cImgSub[0][2], cImgSub[0][0]);
-    // sub-image 7  [1][3]
-    getHorSubImageBiLinear ( s, cImgSub[1][3], cImgSub[0][2], cImgSub[2][0]);
-    // sub-image 11 [2][3]
-    getHorSubImageBiLinear ( s, cImgSub[2][3], cImgSub[2][2], cImgSub[2][0]);
-
-    // sub-image 12 [3][0]
-    getVerSubImageBiLinear ( s, cImgSub[3][0], cImgSub[2][0], cImgSub[0][0]);
-    // sub-image 13 [3][1]
-    getVerSubImageBiLinear ( s, cImgSub[3][1], cImgSub[2][0], cImgSub[0][2]);
-    // sub-image 14 [3][2]
-    getVerSubImageBiLinear ( s, cImgSub[3][2], cImgSub[2][2], cImgSub[0][2]);
-
-    // sub-image 15 [3][3]
-    getDiagSubImageBiLinear( s, cImgSub[3][3], cImgSub[0][2], cImgSub[2][0]);
+    if (bands->state[band] == SUBPEL_BAND_DONE)
+      continue;
+
+    if (bands->state[band] == SUBPEL_BAND_NONE)
+    {
+      getHalfPelBand( bands->p_Vid, s, band, 0);
+      bands->state[band] = SUBPEL_BAND_HALF;
+    }
+    if (band + 1 < bands->num_bands && bands->state[band + 1] == SUBPEL_BAND_NONE)
+    {
+      getHalfPelBand( bands->p_Vid, s, band + 1, 0);
+      bands->state[band + 1] = SUBPEL_BAND_HALF;
+    }
+    getQuarterPelBand( s, band);
+    bands->state[band] = SUBPEL_BAND_DONE;
+
+    if (++bands->num_done == bands->num_bands)
+    {
+      // all bands interpolated: the picture is not checked any more
+      free_sub_pel_bands(s);
+      return;
+    }
   }
 }
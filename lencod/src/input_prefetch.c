@@ -0,0 +1,345 @@
+/*!
+*************************************************************************************
+* \file input_prefetch.c
+*
+* \brief
+*    Source frame prefetch buffer.
+*
+*    A reader thread reads and converts up to PrefetchFrames source frames
+*    ahead of the encoder into a ring of image planes. It reads the frames
+*    to be encoded in file order. The encoder requests them in coding
+*    order, which jumps forward in the file when B frames are used: a
+*    frame that has not been read ahead is read next, and if the buffer
+*    is full the frame furthest ahead is dropped to make room for it (it
+*    is read again later). The encoder only waits if its frame is still
+*    being read; a frame leaves the buffer once it has been handed to the
+*    encoder. Together with a memory mapped input file (InputMemoryMap)
+*    no read() calls are needed at all.
+*
+*    The reader thread uses a file descriptor of its own, so that other
+*    readers of the source file (look-ahead pre-analysis) are not
+*    disturbed.
+*
+*************************************************************************************
+*/
+
+#include "contributors.h"
+
+#include "global.h"
+#include "input.h"
+#include "img_io.h"
+#include "memalloc.h"
+#include "input_prefetch.h"
+
+/*!
+************************************************************************
+* \brief
+*    Allocate the source frame prefetch buffer. The reader thread is
+*    started with the first request.
+************************************************************************
+*/
+int init_input_prefetch (VideoParameters *p_Vid, InputParameters *p_Inp)
+{
+  InputPrefetch *p_Pre;
+  FrameFormat *source = &p_Inp->source;
+  int k, memory_size = 0;
+
+  if ((p_Pre = (InputPrefetch *) calloc(1, sizeof(InputPrefetch))) == NULL)
+    no_mem_exit("init_input_prefetch: p_Pre");
+
+  p_Pre->num_slots  = imax(1, imin(p_Inp->PrefetchFrames, p_Inp->no_frames));
+  p_Pre->frame_step = 1 + p_Inp->frame_skip;
+  p_Pre->next_frame = 0;
+  p_Pre->last_frame = p_Pre->frame_step * p_Inp->no_frames;
+  p_Pre->request    = -1;
+
+  if ((p_Pre->slot = (PrefetchSlot *) calloc(p_Pre->num_slots, sizeof(PrefetchSlot))) == NULL)
+    no_mem_exit("init_input_prefetch: p_Pre->slot");
+  if ((p_Pre->read_ahead = (char *) calloc(imax(1, p_Inp->no_frames), sizeof(char))) == NULL)
+    no_mem_exit("init_input_prefetch: p_Pre->read_ahead");
+
+  for (k = 0; k < p_Pre->num_slots; ++k)
+  {
+    PrefetchSlot *slot = &p_Pre->slot[k];
+
+    slot->frame = -1;
+    slot->state = SLOT_FREE;
+    // memory mapped input is converted directly from the mapping
+    if (p_Inp->input_file1.f_map == NULL)
+    {
+      if (NULL == (slot->buf = malloc (source->size * source->pic_unit_size_shift3)))
+        no_mem_exit("init_input_prefetch: slot->buf");
+      memory_size += source->size * source->pic_unit_size_shift3;
+      if (p_Inp->input_file1.is_interleaved)
+      {
+        if (NULL == (slot->ibuf = malloc (source->size * source->pic_unit_size_shift3)))
+          no_mem_exit("init_input_prefetch: slot->ibuf");
+        memory_size += source->size * source->pic_unit_size_shift3;
+      }
+    }
+
+    memory_size += get_mem2Dpel(&slot->frm_data[0], p_Vid->height, p_Vid->width);
+    if (p_Vid->yuv_format != YUV400)
+    {
+      memory_size += get_mem2Dpel(&slot->frm_data[1], p_Vid->height_cr, p_Vid->width_cr);
+      memory_size += get_mem2Dpel(&slot->frm_data[2], p_Vid->height_cr, p_Vid->width_cr);
+    }
+  }
+
+  // the mapping is shared, a read file gets a descriptor of its own
+  p_Pre->file = p_Inp->input_file1;
+  p_Pre->file.f_num = -1;
+  if (p_Pre->file.f_map == NULL)
+    OpenFiles(&p_Pre->file);
+
+  thread_mutex_init(&p_Pre->mutex);
+  thread_cond_init(&p_Pre->reader_cond);
+  thread_cond_init(&p_Pre->encoder_cond);
+
+  p_Vid->p_Prefetch = p_Pre;
+
+  return memory_size;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Stop the reader thread and free the source frame prefetch buffer
+************************************************************************
+*/
+void free_input_prefetch (VideoParameters *p_Vid)
+{
+  InputPrefetch *p_Pre = p_Vid->p_Prefetch;
+  int k;
+
+  if (p_Pre == NULL)
+    return;
+
+  if (p_Pre->started)
+  {
+    thread_mutex_lock(&p_Pre->mutex);
+    p_Pre->stop = 1;
+    thread_cond_signal(&p_Pre->reader_cond);
+    thread_mutex_unlock(&p_Pre->mutex);
+    thread_join(p_Pre->thread);
+  }
+  thread_cond_destroy(&p_Pre->encoder_cond);
+  thread_cond_destroy(&p_Pre->reader_cond);
+  thread_mutex_destroy(&p_Pre->mutex);
+
+  if (p_Pre->file.f_num != -1)
+    close(p_Pre->file.f_num);
+
+  for (k = 0; k < p_Pre->num_slots; ++k)
+  {
+    PrefetchSlot *slot = &p_Pre->slot[k];
+
+    free(slot->buf);
+    free(slot->ibuf);
+    free_mem2Dpel(slot->frm_data[0]);
+    if (slot->frm_data[1])
+    {
+      free_mem2Dpel(slot->frm_data[1]);
+      free_mem2Dpel(slot->frm_data[2]);
+    }
+  }
+  free(p_Pre->slot);
+  free(p_Pre->read_ahead);
+  free(p_Pre);
+
+  p_Vid->p_Prefetch = NULL;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Returns the slot holding (or reading) frame, -1 if there is none.
+*    frame = -1 returns a free slot.
+************************************************************************
+*/
+static int find_slot (InputPrefetch *p_Pre, int frame)
+{
+  int k;
+  for (k = 0; k < p_Pre->num_slots; ++k)
+  {
+    if (p_Pre->slot[k].frame == frame)
+      return k;
+  }
+  return -1;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Marks an encoded frame as read ahead (or not). Frames outside the
+*    frames to be encoded are only read on request and not tracked.
+************************************************************************
+*/
+static void set_read_ahead (InputPrefetch *p_Pre, int frame, char value)
+{
+  if (frame >= 0 && frame < p_Pre->last_frame && (frame % p_Pre->frame_step) == 0)
+    p_Pre->read_ahead[frame / p_Pre->frame_step] = value;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Returns the frame the reader thread reads next: the frame requested
+*    by the encoder, otherwise the next frame in file order that has not
+*    been read yet (-1 if there is none). Called with the mutex held.
+************************************************************************
+*/
+static int next_frame_to_read (InputPrefetch *p_Pre)
+{
+  int frame;
+
+  if (p_Pre->request >= 0)
+  {
+    frame = p_Pre->request;
+    p_Pre->request = -1;
+    return frame;
+  }
+
+  for (frame = p_Pre->next_frame; frame < p_Pre->last_frame; frame += p_Pre->frame_step)
+  {
+    if (!p_Pre->read_ahead[frame / p_Pre->frame_step])
+    {
+      p_Pre->next_frame = frame + p_Pre->frame_step;
+      return frame;
+    }
+  }
+  p_Pre->next_frame = p_Pre->last_frame;
+  return -1;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Reader thread: fills free slots until it is stopped
+************************************************************************
+*/
+static void prefetch_thread (void *arg)
+{
+  VideoParameters *p_Vid = (VideoParameters *) arg;
+  InputParameters *p_Inp = p_Vid->p_Inp;
+  InputPrefetch   *p_Pre = p_Vid->p_Prefetch;
+  PrefetchSlot    *slot;
+  int idx, frame;
+
+  thread_mutex_lock(&p_Pre->mutex);
+  while (!p_Pre->stop)
+  {
+    if ((idx = find_slot(p_Pre, -1)) < 0 || (frame = next_frame_to_read(p_Pre)) < 0)
+    {
+      thread_cond_wait(&p_Pre->reader_cond, &p_Pre->mutex);
+      continue;
+    }
+
+    slot = &p_Pre->slot[idx];
+    slot->frame = frame;
+    slot->state = SLOT_READING;
+    set_read_ahead(p_Pre, frame, 1);
+    thread_mutex_unlock(&p_Pre->mutex);
+
+    slot->file_read = read_frame_data (p_Vid, &p_Pre->file, frame, p_Inp->infile_header, &p_Inp->source, &slot->buf, &slot->ibuf, &slot->data);
+    if (slot->file_read)
+      convert_frame_data (p_Vid, &p_Inp->source, &p_Inp->output, slot->data, slot->frm_data);
+
+    thread_mutex_lock(&p_Pre->mutex);
+    slot->state = SLOT_READY;
+    thread_cond_signal(&p_Pre->encoder_cond);
+  }
+  thread_mutex_unlock(&p_Pre->mutex);
+}
+
+/*!
+************************************************************************
+* \brief
+*    Drops the read ahead frame with the highest frame number to free a
+*    slot; it will be read again. Called with the mutex held.
+************************************************************************
+*/
+static void drop_furthest_frame (InputPrefetch *p_Pre)
+{
+  PrefetchSlot *slot = NULL;
+  int k;
+
+  for (k = 0; k < p_Pre->num_slots; ++k)
+  {
+    if (p_Pre->slot[k].state == SLOT_READY && (slot == NULL || p_Pre->slot[k].frame > slot->frame))
+      slot = &p_Pre->slot[k];
+  }
+  if (slot == NULL)   // the only slot(s) are being read, wait for them
+    return;
+
+  set_read_ahead(p_Pre, slot->frame, 0);
+  if (slot->frame < p_Pre->last_frame)
+    p_Pre->next_frame = imin(p_Pre->next_frame, slot->frame);
+  slot->frame = -1;
+  slot->state = SLOT_FREE;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Hand one source frame from the prefetch buffer to imgData, waiting
+*    for the reader thread if the frame has not been read yet.
+*    The image planes of the slot and of imgData are swapped instead of
+*    copied; the slot keeps the previous planes of imgData for reuse.
+*    Returns 0 if the frame could not be read.
+************************************************************************
+*/
+int read_prefetched_frame (VideoParameters *p_Vid, int FrameNoInFile, ImageData *imgData)
+{
+  InputPrefetch *p_Pre = p_Vid->p_Prefetch;
+  PrefetchSlot  *slot;
+  imgpel **tmp;
+  int idx, k, j, file_read;
+  int num_planes = (p_Vid->yuv_format != YUV400) ? 3 : 1;
+
+  thread_mutex_lock(&p_Pre->mutex);
+  if (!p_Pre->started)
+  {
+    thread_create(&p_Pre->thread, prefetch_thread, p_Vid);
+    p_Pre->started = 1;
+  }
+
+  while ((idx = find_slot(p_Pre, FrameNoInFile)) < 0 || p_Pre->slot[idx].state != SLOT_READY)
+  {
+    if (idx < 0)
+    {
+      // not read ahead: the reader thread reads it next
+      p_Pre->request = FrameNoInFile;
+      if (find_slot(p_Pre, -1) < 0)
+        drop_furthest_frame(p_Pre);
+      thread_cond_signal(&p_Pre->reader_cond);
+    }
+    thread_cond_wait(&p_Pre->encoder_cond, &p_Pre->mutex);
+  }
+  slot = &p_Pre->slot[idx];
+  file_read = slot->file_read;
+
+  // both are allocated with get_mem2Dpel() at the frame (plane) size
+  for (k = 0; file_read && k < num_planes; ++k)
+  {
+    tmp = imgData->frm_data[k];
+    imgData->frm_data[k] = slot->frm_data[k];
+    slot->frm_data[k] = tmp;
+
+    // field planes (init_top_bot_planes) refer to the rows of the frame plane
+    if (imgData->top_data[k] != NULL)
+    {
+      for (j = 0; j < (imgData->format.height[k] >> 1); ++j)
+      {
+        imgData->top_data[k][j] = imgData->frm_data[k][2 * j    ];
+        imgData->bot_data[k][j] = imgData->frm_data[k][2 * j + 1];
+      }
+    }
+  }
+  slot->frame = -1;
+  slot->state = SLOT_FREE;
+  thread_cond_signal(&p_Pre->reader_cond);
+  thread_mutex_unlock(&p_Pre->mutex);
+
+  return file_read;
+}
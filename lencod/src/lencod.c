@@ -84,8 +84,14 @@
 #include "img_process.h"
 #include "q_offsets.h"
 #include "pred_struct.h"
+#include "lookahead.h"
+#include "input_prefetch.h"
+#include "md_reuse.h"
+#include "md_fast.h"
+#include "frm_rng.h"
 #include "blk_prediction.h"
 #include "img_luma.h"
+#include "img_dist_ssim.h"
 #include "img_chroma.h"
 #include "mc_prediction.h"
 #include "me_distortion.h"
@@ -121,8 +127,7 @@ int ExtractCent;
 int ExtractDisableScreen;
 char ExtractLogFile[FILE_NAME_SIZE];
 FILE * ExtractLogFileHandle;
-int  *g_ExtractFrmRng;  //ȫҪȡ֡
-int  g_ExtFrmRngSize;   //g_ExtractFrmRngĴС
+FrameRangeSet g_ExtractFrmRng;  //!< frames (coding order) with scrambled MVDs
 char g_ExtKeyFile[FILE_NAME_SIZE];
 FILE * g_ExtKeyFileHandle;
 
@@ -251,60 +256,6 @@ static void free_encoder (EncoderParams *p_Enc)
   free_pointer( p_Enc );
 }
 
-/*!
- ***********************************************************************
- * \brief
- *    Ҫȡ֡Χ
- *    ʽΪ:xxx~xxx
- ***********************************************************************
- */
-static void ext_prase_frm_rng(char *ss,int *top_half,int *btn_half)
-{
-    char *p = strtok(ss,"~");
-    if(p)
-    {
-        *top_half = atoi(p);
-    }
-    
-    p = strtok(NULL,"~");
-    if(p)
-    {
-        *btn_half = atoi(p);
-    }
-}
-
-/*!
- ***********************************************************************
- * \brief
- *    Ҫȡ֡Χ浽ȫg_ExtractFrmRng
- *  return: ȫg_ExtractFrmRngĳ
- ***********************************************************************
- */
-int ext_save_frm_rng(char *ss)
-{
-    int top_half,btn_half;
-    ext_prase_frm_rng(ss,&top_half,&btn_half);
-
-    static int len,total_len;
-    len = btn_half - top_half +1;
-    total_len += len;
-
-    if((g_ExtractFrmRng = (int *)realloc(g_ExtractFrmRng, sizeof(int)*total_len)) == NULL)
-    {
-        printf("realloc error\n");
-        return;
-    }
-    
-    int *tmp = g_ExtractFrmRng + (total_len - len);
-    int i;
-    for(i=0; i<len; i++,tmp++)
-    {
-        *tmp = top_half ++;
-    }
-
-    return total_len;
-}
-
 
 /*!
  ***********************************************************************
@@ -340,20 +291,7 @@ int main(int argc, char **argv)
 	strcpy(ExtractLogFile,p_Enc->p_Inp->ExtractionLogFile);
     strcpy(g_ExtKeyFile,p_Enc->p_Inp->ExtKeyFile);
 
-    if((g_ExtractFrmRng = (int *)malloc(sizeof(int))) == NULL)
-    {
-        printf("\n!!!!!!!!!!!!!g_ExtractFrmRng malloc fail\n\n");
-    }
-    g_ExtFrmRngSize = ext_save_frm_rng(p_Enc->p_Inp->ExtractFrmRng);
-    
-#if 1
-    int i = 0;
-    int *tmp = g_ExtractFrmRng;
-    for(;i<g_ExtFrmRngSize;i++)
-    {
-        //printf("@@@@@@@@@@: %d \n",*tmp++);
-    }
-#endif
+    parse_frame_range_set(&g_ExtractFrmRng, p_Enc->p_Inp->ExtractFrmRng);
 
 	if ((ExtractLogFileHandle = fopen(ExtractLogFile, "wb")) == NULL)    // append new statistic at the end
 	{
@@ -403,6 +341,7 @@ int main(int argc, char **argv)
 	fprintf(ExtractLogFileHandle,"End AT : %s \n",buf);
 	*/
 	fclose(ExtractLogFileHandle);
+  free_frame_range_set(&g_ExtractFrmRng);
   return 0;
 }
 
@@ -643,10 +582,14 @@ static void init_encoder(VideoParameters *p_Vid, InputParameters *p_Inp)
 
   // Open Files
   OpenFiles(&p_Inp->input_file1);
+  if (p_Inp->InputMemoryMap && !MapFrameFile(&p_Inp->input_file1))
+    printf("Warning: InputMemoryMap is not supported for this input file. The file is read instead.\n");
 #if (MVC_EXTENSION_ENABLE)
   if(p_Vid->num_of_layers==2)
   {
     OpenFiles(&p_Inp->input_file2);
+    if (p_Inp->InputMemoryMap)
+      MapFrameFile(&p_Inp->input_file2);
   }
   p_Vid->prev_view_is_anchor = 0;
   p_Vid->view_id = 0;  // initialise view_id
@@ -1602,6 +1545,7 @@ static void free_img (VideoParameters *p_Vid, InputParameters *p_Inp)
   free_pointer(p_Vid->p_Dpb_layer[0]);
   p_Vid->p_Dpb_layer[0] = p_Vid->p_Dpb_layer[1] = NULL;
   free_pointer (p_Vid->p_Stats);
+  free_ssim_buffers (p_Vid->p_Dist);
   free_pointer (p_Vid->p_Dist);
   //
   free_encode_parameters(p_Vid);
@@ -1644,6 +1588,7 @@ Picture *malloc_picture()
   Picture *pic;
   if ((pic = calloc (1, sizeof (Picture))) == NULL) no_mem_exit ("malloc_picture: Picture structure");
   //! Note: slice structures are allocated as needed in code_a_picture
+  pic->arena = new_mem_arena(SLICE_ARENA_BLOCK_SIZE);
   return pic;
 }
 
@@ -1660,6 +1605,7 @@ void free_picture(Picture *pic)
   if (pic != NULL)
   {
     free_slice_list(pic);
+    free_mem_arena(pic->arena);
     free_pointer (pic);
   }
 }
@@ -1924,7 +1870,7 @@ static int init_global_buffers(VideoParameters *p_Vid, InputParameters *p_Inp)
 
   if( !(p_Inp->OnTheFlyFractMCP) || (p_Inp->OnTheFlyFractMCP==OTF_L1) ) // JLT : on-the-fly compatibility
   {
-    memory_size += get_mem2Dint_pad (&p_Vid->imgY_sub_tmp, p_Vid->height, p_Vid->width, IMG_PAD_SIZE_Y, IMG_PAD_SIZE_X);
+    memory_size += init_luma_interpolation (p_Vid, p_Inp);
   }
 
   //if ( p_Inp->ChromaMCBuffer )
@@ -1954,6 +1900,20 @@ static int init_global_buffers(VideoParameters *p_Vid, InputParameters *p_Inp)
 
   memory_size += init_process_image( p_Vid, p_Inp );
 
+  if (p_Inp->PrefetchFrames)
+    memory_size += init_input_prefetch( p_Vid, p_Inp );
+
+  if (p_Inp->LookAheadFrames)
+    memory_size += init_lookahead( p_Vid, p_Inp );
+
+#if defined(OPENMP)
+  if (p_Inp->RDPictureThreads > 1 || p_Inp->PAFFThreads > 1)
+    memory_size += init_picture_passes( p_Vid, p_Inp );
+#endif
+
+  init_mb_info_reuse( p_Vid, p_Inp );
+  init_fast_md( p_Vid, p_Inp );
+
   p_Vid->p_pred = init_seq_structure( p_Vid, p_Inp, &memory_size );
 
   return memory_size;
@@ -2105,11 +2065,8 @@ static void free_global_buffers(VideoParameters *p_Vid, InputParameters *p_Inp)
     wpxFreeWPXObject(p_Vid);
   }
 
-  if (p_Vid->imgY_sub_tmp) // free temp quarter pel frame buffers
-  {
-    free_mem2Dint_pad (p_Vid->imgY_sub_tmp, IMG_PAD_SIZE_Y, IMG_PAD_SIZE_X);
-    p_Vid->imgY_sub_tmp = NULL;
-  }
+  // free temp quarter pel band buffers
+  free_luma_interpolation (p_Vid);
 
   // free mem, allocated in init_img()
   // free intra pred mode buffer for blocks
@@ -2250,6 +2207,12 @@ static void free_global_buffers(VideoParameters *p_Vid, InputParameters *p_Inp)
 
   clear_process_image( p_Vid, p_Inp );
   free_seq_structure( p_Vid->p_pred );
+  free_lookahead( p_Vid );
+#if defined(OPENMP)
+  free_picture_passes( p_Vid );
+#endif
+  free_input_prefetch( p_Vid );
+  free_mb_info_reuse( p_Vid );
 }
 
 
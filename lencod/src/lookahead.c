@@ -0,0 +1,381 @@
+/*!
+*************************************************************************************
+* \file lookahead.c
+*
+* \brief
+*    Look-ahead pre-analysis.
+*
+*    The input frames are read ahead of the encoder (LookAheadFrames at a time),
+*    downsampled to 1/2 resolution and for every 8x8 block (one macroblock of the
+*    full resolution frame) an intra cost (DC/H/V prediction) and an inter cost
+*    (small full search in the previous frame) are computed, both in SATD.
+*    The frame costs are used to
+*      - detect scene cuts, where an intra frame is inserted when building the
+*        prediction structure (no prediction atom, hence no B frame, straddles
+*        the cut),
+*      - scale the picture MAD predicted by the quadratic rate control model
+*        with the complexity change between the previous P and the current frame.
+*    No frame is encoded by the pre-analysis.
+*
+*************************************************************************************
+*/
+
+#include "contributors.h"
+
+#include <limits.h>
+
+#include "global.h"
+#include "image.h"
+#include "input.h"
+#include "memalloc.h"
+#include "me_distortion.h"
+#include "lookahead.h"
+
+/*!
+************************************************************************
+* \brief
+*    Allocate the look-ahead pre-analysis memory
+************************************************************************
+*/
+int init_lookahead (VideoParameters *p_Vid, InputParameters *p_Inp)
+{
+  LookAheadParameters *p_LA;
+  int k, memory_size = 0;
+
+  if ((p_LA = (LookAheadParameters *) calloc(1, sizeof(LookAheadParameters))) == NULL)
+    no_mem_exit("init_lookahead: p_LA");
+
+  p_LA->p_Vid      = p_Vid;
+  p_LA->num_frames = imin(p_Inp->LookAheadFrames, p_Inp->no_frames);
+  p_LA->next_frame = 0;
+  p_LA->width      = p_Vid->width  >> 1;
+  p_LA->height     = p_Vid->height >> 1;
+
+  memory_size += get_mem2Dpel(&p_LA->frm_data[0], p_Vid->height, p_Vid->width);
+  if (p_Vid->yuv_format != YUV400)
+  {
+    memory_size += get_mem2Dpel(&p_LA->frm_data[1], p_Vid->height_cr, p_Vid->width_cr);
+    memory_size += get_mem2Dpel(&p_LA->frm_data[2], p_Vid->height_cr, p_Vid->width_cr);
+  }
+
+  if ((p_LA->lowres = (imgpel ***) calloc(p_LA->num_frames + 1, sizeof(imgpel **))) == NULL)
+    no_mem_exit("init_lookahead: p_LA->lowres");
+  for (k = 0; k <= p_LA->num_frames; ++k)
+    memory_size += get_mem2Dpel(&p_LA->lowres[k], p_LA->height, p_LA->width);
+
+  if ((p_LA->intra_cost = (int64 *) calloc(p_Inp->no_frames, sizeof(int64))) == NULL)
+    no_mem_exit("init_lookahead: p_LA->intra_cost");
+  if ((p_LA->inter_cost = (int64 *) calloc(p_Inp->no_frames, sizeof(int64))) == NULL)
+    no_mem_exit("init_lookahead: p_LA->inter_cost");
+  if ((p_LA->cost = (int64 *) calloc(p_Inp->no_frames, sizeof(int64))) == NULL)
+    no_mem_exit("init_lookahead: p_LA->cost");
+  if ((p_LA->scene_cut = (byte *) calloc(p_Inp->no_frames, sizeof(byte))) == NULL)
+    no_mem_exit("init_lookahead: p_LA->scene_cut");
+  memory_size += p_Inp->no_frames * (3 * sizeof(int64) + sizeof(byte));
+
+  // the pre-analysis runs while the prediction structure is built, which
+  // may happen before select_distortion() set up the distortion kernels
+  init_distortion_kernels(p_Inp->DistortionSIMD);
+
+  p_Vid->p_LA = p_LA;
+
+  return memory_size;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Free the look-ahead pre-analysis memory
+************************************************************************
+*/
+void free_lookahead (VideoParameters *p_Vid)
+{
+  LookAheadParameters *p_LA = p_Vid->p_LA;
+  int k;
+
+  if (p_LA == NULL)
+    return;
+
+  free_mem2Dpel(p_LA->frm_data[0]);
+  if (p_LA->frm_data[1])
+  {
+    free_mem2Dpel(p_LA->frm_data[1]);
+    free_mem2Dpel(p_LA->frm_data[2]);
+  }
+  for (k = 0; k <= p_LA->num_frames; ++k)
+    free_mem2Dpel(p_LA->lowres[k]);
+  free(p_LA->lowres);
+  free(p_LA->intra_cost);
+  free(p_LA->inter_cost);
+  free(p_LA->cost);
+  free(p_LA->scene_cut);
+  free(p_LA);
+
+  p_Vid->p_LA = NULL;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Read one input frame and store its 1/2 resolution luma plane
+*    (2x2 average) in dst. Returns 0 if the frame could not be read.
+************************************************************************
+*/
+static int read_lowres_frame (LookAheadParameters *p_LA, int frame, imgpel **dst)
+{
+  VideoParameters *p_Vid = p_LA->p_Vid;
+  InputParameters *p_Inp = p_Vid->p_Inp;
+  imgpel **src = p_LA->frm_data[0];
+  int i, j;
+
+  if (!read_one_frame (p_Vid, &p_Inp->input_file1, (1 + p_Inp->frame_skip) * frame, p_Inp->infile_header, &p_Inp->source, &p_Inp->output, p_LA->frm_data))
+    return 0;
+  pad_borders (p_Inp->output, p_Vid->width, p_Vid->height, p_Vid->width_cr, p_Vid->height_cr, p_LA->frm_data);
+
+  for (j = 0; j < p_LA->height; ++j)
+  {
+    imgpel *src0 = src[2 * j];
+    imgpel *src1 = src[2 * j + 1];
+    for (i = 0; i < p_LA->width; ++i)
+      dst[j][i] = (imgpel) ((src0[2 * i] + src0[2 * i + 1] + src1[2 * i] + src1[2 * i + 1] + 2) >> 2);
+  }
+
+  return 1;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Intra cost (SATD) of the 8x8 block at (x, y): the best of the
+*    DC, vertical and horizontal predictions from the neighbouring
+*    source samples
+************************************************************************
+*/
+static int intra_block_cost (imgpel **img, int x, int y, int dc_default)
+{
+  imgpel pred[3][64];
+  short diff[64];
+  int i, j, mode, num_modes = 1;
+  int dc = 0, cnt = 0;
+  int cost, min_cost = INT_MAX;
+
+  if (y > 0)
+  {
+    for (i = 0; i < 8; ++i)
+      dc += img[y - 1][x + i];
+    cnt += 8;
+  }
+  if (x > 0)
+  {
+    for (j = 0; j < 8; ++j)
+      dc += img[y + j][x - 1];
+    cnt += 8;
+  }
+  dc = cnt ? (dc + (cnt >> 1)) / cnt : dc_default;
+
+  for (i = 0; i < 64; ++i)
+    pred[0][i] = (imgpel) dc;
+  if (y > 0)
+  {
+    for (j = 0; j < 8; ++j)
+      memcpy(&pred[num_modes][j * 8], &img[y - 1][x], 8 * sizeof(imgpel));
+    ++num_modes;
+  }
+  if (x > 0)
+  {
+    for (j = 0; j < 8; ++j)
+      for (i = 0; i < 8; ++i)
+        pred[num_modes][j * 8 + i] = img[y + j][x - 1];
+    ++num_modes;
+  }
+
+  for (mode = 0; mode < num_modes; ++mode)
+  {
+    for (j = 0; j < 8; ++j)
+      for (i = 0; i < 8; ++i)
+        diff[j * 8 + i] = (short) (img[y + j][x + i] - pred[mode][j * 8 + i]);
+    cost = dist_kernels.hadamard8x8(diff);
+    if (cost < min_cost)
+      min_cost = cost;
+  }
+
+  return min_cost;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Inter cost (SATD) of the 8x8 block at (x, y): full search of
+*    +-LA_SEARCH_RANGE in the previous frame, SAD for the search and
+*    SATD for the best position
+************************************************************************
+*/
+static int inter_block_cost (LookAheadParameters *p_LA, imgpel **img, imgpel **ref, int x, int y)
+{
+  imgpel org[64];
+  short diff[64];
+  int i, j;
+  int min_x = imax(0, x - LA_SEARCH_RANGE);
+  int max_x = imin(p_LA->width  - 8, x + LA_SEARCH_RANGE);
+  int min_y = imax(0, y - LA_SEARCH_RANGE);
+  int max_y = imin(p_LA->height - 8, y + LA_SEARCH_RANGE);
+  int best_x = x, best_y = y;
+  int sad, min_sad;
+
+  for (j = 0; j < 8; ++j)
+    memcpy(&org[j * 8], &img[y + j][x], 8 * sizeof(imgpel));
+
+  min_sad = dist_kernels.sad(org, &ref[y][x], p_LA->width, 8, 8, INT_MAX);
+  for (j = min_y; j <= max_y && min_sad > 0; ++j)
+  {
+    for (i = min_x; i <= max_x; ++i)
+    {
+      sad = dist_kernels.sad(org, &ref[j][i], p_LA->width, 8, 8, min_sad);
+      if (sad < min_sad)
+      {
+        min_sad = sad;
+        best_x  = i;
+        best_y  = j;
+      }
+    }
+  }
+
+  dist_kernels.diff(org, 8, &ref[best_y][best_x], p_LA->width, 8, diff);
+
+  return dist_kernels.hadamard8x8(diff);
+}
+
+/*!
+************************************************************************
+* \brief
+*    Compute the intra and inter costs of one frame
+*    (ref is NULL for the first frame of the sequence)
+************************************************************************
+*/
+static void analyse_frame (LookAheadParameters *p_LA, imgpel **img, imgpel **ref, int frame)
+{
+  int dc_default = 1 << (p_LA->p_Vid->bitdepth_luma - 1);
+  int64 intra_cost = 0, inter_cost = 0, cost = 0;
+  int x, y, intra, inter;
+
+  for (y = 0; y < p_LA->height; y += 8)
+  {
+    for (x = 0; x < p_LA->width; x += 8)
+    {
+      intra = intra_block_cost(img, x, y, dc_default);
+      inter = ref ? inter_block_cost(p_LA, img, ref, x, y) : intra;
+      intra_cost += intra;
+      inter_cost += inter;
+      cost       += imin(intra, inter);
+    }
+  }
+
+  p_LA->intra_cost[frame] = intra_cost;
+  p_LA->inter_cost[frame] = inter_cost;
+  p_LA->cost      [frame] = cost;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Read and analyse the next num_frames input frames. The frames are
+*    read sequentially; their costs are independent of each other and
+*    are computed in parallel when OpenMP is enabled.
+************************************************************************
+*/
+static void analyse_next_frames (LookAheadParameters *p_LA)
+{
+  InputParameters *p_Inp = p_LA->p_Vid->p_Inp;
+  int first = p_LA->next_frame;
+  int num = imin(p_LA->num_frames, p_Inp->no_frames - first);
+  int k, frame;
+  imgpel **tmp;
+
+  for (k = 0; k < num; ++k)
+  {
+    if (!read_lowres_frame(p_LA, first + k, p_LA->lowres[k + 1]))
+      break;
+  }
+  num = k;
+
+#if defined(OPENMP)
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+  for (k = 0; k < num; ++k)
+  {
+    analyse_frame(p_LA, p_LA->lowres[k + 1], (first + k) ? p_LA->lowres[k] : NULL, first + k);
+  }
+
+  // a scene cut is a frame that is predicted from the previous frame at least as badly
+  // (LookAheadSceneCut percent of the intra cost) as from itself; no cut is placed
+  // directly after another one (e.g. on flashes)
+  if (p_Inp->LookAheadSceneCut)
+  {
+    for (frame = imax(1, first); frame < first + num; ++frame)
+    {
+      if (!p_LA->scene_cut[frame - 1] && p_LA->inter_cost[frame] * 100 >= p_LA->intra_cost[frame] * p_Inp->LookAheadSceneCut)
+        p_LA->scene_cut[frame] = 1;
+    }
+  }
+
+  // keep the last frame as the reference of the next pass
+  if (num > 0)
+  {
+    tmp = p_LA->lowres[0];
+    p_LA->lowres[0] = p_LA->lowres[num];
+    p_LA->lowres[num] = tmp;
+  }
+
+  // stop analysing on read errors (they are reported by the encoder itself)
+  p_LA->next_frame = (num < imin(p_LA->num_frames, p_Inp->no_frames - first)) ? p_Inp->no_frames : first + num;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Make sure frames up to (and including) frame have been analysed
+************************************************************************
+*/
+static void lookahead_analyse (LookAheadParameters *p_LA, int frame)
+{
+  while (p_LA->next_frame <= frame && p_LA->next_frame < p_LA->p_Vid->p_Inp->no_frames)
+    analyse_next_frames(p_LA);
+}
+
+/*!
+************************************************************************
+* \brief
+*    Returns 1 if frame (display order) starts a new scene
+************************************************************************
+*/
+int lookahead_scene_cut (LookAheadParameters *p_LA, int frame)
+{
+  if (p_LA == NULL || frame <= 0 || frame >= p_LA->p_Vid->p_Inp->no_frames)
+    return 0;
+
+  lookahead_analyse(p_LA, frame);
+
+  return p_LA->scene_cut[frame];
+}
+
+/*!
+************************************************************************
+* \brief
+*    Ratio of the complexity of frame to the one of ref_frame
+*    (both in display order), clipped to [0.5, 2]
+************************************************************************
+*/
+double lookahead_complexity_ratio (LookAheadParameters *p_LA, int frame, int ref_frame)
+{
+  int no_frames = p_LA->p_Vid->p_Inp->no_frames;
+
+  if (ref_frame < 0 || ref_frame >= no_frames || frame < 0 || frame >= no_frames)
+    return 1.0;
+
+  lookahead_analyse(p_LA, imax(frame, ref_frame));
+
+  if (p_LA->cost[ref_frame] <= 0)
+    return 1.0;
+
+  return dClip3(0.5, 2.0, (double) p_LA->cost[frame] / (double) p_LA->cost[ref_frame]);
+}
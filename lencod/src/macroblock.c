@@ -47,6 +47,7 @@
 #include "mv_prediction.h"
 #include "rdopt.h"
 #include "transform.h"
+#include "frm_rng.h"
 
 #if TRACE
 #define TRACE_SE(trace,str)  snprintf(trace,TRACESTRING_SIZE,str)
@@ -61,8 +62,7 @@ extern int ExtractCent;
 extern char ExtractLogFile[FILE_NAME_SIZE];
 extern FILE * ExtractLogFileHandle;
 extern int ExtractDisableScreen; 
-extern int  *g_ExtractFrmRng;
-extern int g_ExtFrmRngSize;
+extern FrameRangeSet g_ExtractFrmRng;
 extern char g_ExtKeyFile[FILE_NAME_SIZE];
 extern FILE * g_ExtKeyFileHandle;
 
@@ -272,7 +272,7 @@ void next_macroblock(Macroblock *currMB)
   int slice_type = currSlice->slice_type;
   BitCounter *mbBits = &currMB->bits;
   int i;
-  StatParameters *cur_stats = &p_Vid->enc_picture->stats;
+  StatParameters *cur_stats = currSlice->cur_stats;
 
   if (mbBits->mb_total > p_Vid->max_bitCount)
     printf("Warning!!! Number of bits (%d) of macroblock_layer() data seems to exceed defined limit (%d).\n", mbBits->mb_total,p_Vid->max_bitCount);
@@ -436,6 +436,24 @@ void reset_macroblock(Macroblock *currMB)
 }
 
 
+/*!
+ ************************************************************************
+ * \brief
+ *    Switches the CABAC partitions of the slice between table based rate
+ *    estimation and arithmetic coding (CABACRateEst)
+ ************************************************************************
+ */
+static void set_cabac_rate_estimation(Slice *currSlice, int estimate)
+{
+  int i;
+
+  if (currSlice->symbol_mode == CABAC && currSlice->p_Inp->CABACRateEst)
+  {
+    for (i = 0; i < currSlice->max_part_nr; ++i)
+      arienco_set_estimation(&currSlice->partArr[i].ee_cabac, estimate);
+  }
+}
+
 /*!
  ************************************************************************
  * \brief
@@ -515,7 +533,9 @@ void start_macroblock(Slice *currSlice, Macroblock **currMB, int mb_addr, Boolea
 
   // Save the slice number of this macroblock. When the macroblock below
   // is coded it will use this to decide if prediction for above is possible
-  (*currMB)->slice_nr = currSlice->slice_nr;
+  // (encode_slices_parallel() sets it in advance, do not write it again then)
+  if ((*currMB)->slice_nr != currSlice->slice_nr)
+    (*currMB)->slice_nr = currSlice->slice_nr;
 
   // Initialize delta qp change from last macroblock. Feature may be used for future rate control
   // Rate control
@@ -544,7 +564,8 @@ void start_macroblock(Slice *currSlice, Macroblock **currMB, int mb_addr, Boolea
     mb_qp = p_Vid->qp;
   }
 
-  last_coded_mb = *currMB;   // save the address of the last coded MB
+  if (p_Inp->RCEnable)
+    last_coded_mb = *currMB;   // save the address of the last coded MB
   
   if ((*currMB)->mbAddrX == 0)
     p_Vid->BasicUnitQP = mb_qp;
@@ -606,6 +627,9 @@ void start_macroblock(Slice *currSlice, Macroblock **currMB, int mb_addr, Boolea
   if ((p_Inp->SearchMode[p_Vid->view_id] == FAST_FULL_SEARCH) && (!p_Inp->IntraProfile))
     reset_fast_full_search (p_Vid);
 
+  // the mode decision trials only estimate their CABAC rate
+  set_cabac_rate_estimation(currSlice, TRUE);
+
   // disable writing of trace file
 #if TRACE
   for (i=0; i<currSlice->max_part_nr; ++i )
@@ -2832,7 +2856,7 @@ void write_terminating_bit (Slice *currSlice, int bit)
 
   biari_encode_symbol_final(&(dataPart->ee_cabac), bit);
 #if TRACE
-  fprintf (p_Enc->p_trace, "      CABAC terminating bit = %d\n",bit);
+  trace_printf ("      CABAC terminating bit = %d\n",bit);
 #endif
 }
 
@@ -2946,6 +2970,9 @@ void write_macroblock (Macroblock* currMB, int eos_bit,int Extraction)
   BitCounter *mbBits = &currMB->bits;
   int i;
 
+  // the selected mode is coded for real
+  set_cabac_rate_estimation(currSlice, FALSE);
+
   // enable writing of trace file
 #if TRACE
   if ( currMB->prev_recode_mb == FALSE )
@@ -2990,10 +3017,7 @@ void write_macroblock (Macroblock* currMB, int eos_bit,int Extraction)
 
 #if TRACE
   // trace: write macroblock header
-  if (p_Enc->p_trace)
-  {
-    fprintf(p_Enc->p_trace, "\n*********** Pic: %i (I/P) MB: %i Slice: %i **********\n\n", p_Vid->frame_no, currMB->mbAddrX, currSlice->slice_nr);
-  }
+  trace_printf("\n*********** Pic: %i (I/P) MB: %i Slice: %i **********\n\n", p_Vid->frame_no, currMB->mbAddrX, currSlice->slice_nr);
 #endif
 
   p_Vid->cabac_encoding = 1;
@@ -3066,6 +3090,93 @@ int writeReferenceFrame (Macroblock* currMB, int i, int j, int list_idx, int  re
 }
 
 
+/*!
+ ************************************************************************
+ * \brief
+ *    Applies the keyed Extraction perturbation to the mvd of one
+ *    partition and writes its mask (log file) and key (key file)
+ ************************************************************************
+ */
+static void ext_scramble_mvd (Slice *currSlice, int mb_addr, short mvd[2])
+{
+  VideoParameters *p_Vid = currSlice->p_Vid;
+  static long extIndex = 0;
+  short log, lo, mask;
+  short testa, testb, loa, lob, maska, maskb;
+  char  szExtkey[200];
+
+  extIndex++;
+  log   = Logisitc();
+  lo    = (short) ((long) pow(2, ExtractCent) - 1);
+  mask  = log & lo;
+  testa = ExtractCent % 2;
+  testb = ExtractCent / 2;
+  loa   = (short) ((long) pow(2, testa + testb) - 1);
+  lob   = (short) ((long) pow(2, testb) - 1);
+  maska = mask & loa;
+  mask  = mask >> (testa + testb);
+  maskb = mask & lob;
+  maska = maska << 2;
+  maskb = maskb << 2;
+
+  if (ExtractLogFileHandle != NULL)
+    fwrite(&mask, sizeof(short), 1, ExtractLogFileHandle);
+
+  if ((log % 2) == 1)
+  {
+    mvd[0] = mvd[0] + 10;
+    mvd[1] = mvd[1] - 10;
+  }
+  else
+  {
+    mvd[0] = mvd[0] - 10;
+    mvd[1] = mvd[1] + 10;
+  }
+
+  if (p_Vid->p_Inp->ExtKeyFileEnable)
+  {
+    sprintf(szExtkey, "%d %d %d %d %d\n", p_Vid->frame_no, currSlice->slice_nr, mb_addr, maska, maskb);
+    ExtWrite2KeyFile(szExtkey);
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Writes the Extraction log line of an inter macroblock
+ ************************************************************************
+ */
+static void ext_print_mb (Slice *currSlice, Macroblock *currMB, short mb_type)
+{
+  sprintf(s, "%c Slice Marco x %d, y %d,type %d\n", currSlice->slice_type == B_SLICE ? 'B' : 'P', currMB->mb_x * 16, currMB->mb_y * 16, mb_type);
+  ExtPrintf(s, PRTOUT_LOGFILE);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Records an Extraction output of a macroblock for
+ *    write_deferred_extraction()
+ ************************************************************************
+ */
+static ExtEvent *add_ext_event (Macroblock *currMB, int part)
+{
+  Slice *currSlice = currMB->p_Slice;
+  ExtEvent *ev;
+
+  if (currSlice->num_ext_events == currSlice->max_ext_events)
+  {
+    currSlice->max_ext_events = imax(2 * currSlice->max_ext_events, 256);
+    if ((currSlice->ext_events = (ExtEvent *) realloc(currSlice->ext_events, currSlice->max_ext_events * sizeof(ExtEvent))) == NULL)
+      no_mem_exit("add_ext_event: currSlice->ext_events");
+  }
+  ev = &currSlice->ext_events[currSlice->num_ext_events++];
+  ev->mb_addr = currMB->mbAddrX;
+  ev->mb_type = currMB->mb_type;
+  ev->part    = (short) part;
+  return ev;
+}
+
 /*!
  ************************************************************************
  * \brief
@@ -3091,19 +3202,6 @@ int writeMotionVector8x8 (Macroblock *currMB, //<--  current Macroblock
 //extraction added 
     static int numberChange=0;
     static long ratetotal=0;
-
-    short ttt=0,start=0,starti=0,mask=0;
-    short testa;
-    short testb;
-    short loa;
-    short lob;
-    short maska;
-    short maskb;
-    static long extIndex=0;
-
-    short log=0;
-    short lo=0;
-    char  szExtkey[200];
 	
   PixelPos       block[4];  //neighbor mb
   int            i, j, k, l, m;
@@ -3124,6 +3222,7 @@ int writeMotionVector8x8 (Macroblock *currMB, //<--  current Macroblock
   //MotionVector   **final_mv = &motion->mv[list_idx][currMB->block_y];
   short mvd[2];  //˶ʸв
   short         (*currMB_mvd)[4][2] = currMB->mvd[list_idx];  //洢ǰMB˶ʸв
+  ExtEvent      *ext_ev;
   se.type   = SE_MVD;
 
   if (bipred_me && is_bipred_enabled(p_Vid, mv_mode) && refindex == 0)
@@ -3155,86 +3254,31 @@ int writeMotionVector8x8 (Macroblock *currMB, //<--  current Macroblock
       currMB->GetMVPredictor (currMB, block, &predMV, (short) refindex, p_Vid->enc_picture->mv_info, list_idx, (i<<2), (j<<2), step_h<<2, step_v<<2);
       //test_clip_mvs(p_Vid, cur_mv, currMB->write_mb);
       
-		if(ExtractOn)
-	 	{
-			if(Extraction==1)
-			{
-				extIndex++;
-				//if((extIndex%ExtractCent)==3)
-				{
-					log=Logisitc();
-					start=log%16;  //0~15ֳȡģʽ
-					lo=(short)((long)pow(2,ExtractCent)-1);  // x  y ex:15
-					mask=log&lo;
-					//lo=BitMove(lo, start);
-					testa=ExtractCent%2;  //0
-					testb=ExtractCent/2;  // 2
-					loa=(short)((long)pow(2,testa+testb)-1);
-					lob=(short)((long)pow(2,testb)-1);
-					maska=mask&loa;
-					mask=mask>>(testa+testb);
-					maskb=mask&lob;
-					maska=maska<<2;
-					maskb=maskb<<2;
-//printf("log %d, start %d testa %d, testb %d, loa %d, lob %d, maska %d,maskb %d mask %d\n",
-    //log,start,testa,testb,loa,lob,maska,maskb,mask);
-					if((log%2)==1)
-					{
-						mvd[0] = cur_mv->mv_x - predMV.mv_x;
-						mvd[1] = cur_mv->mv_y - predMV.mv_y;
-						//ttt=mvd[0];
-						//printf("ttt %d    %d,\n",extIndex, ttt);
-						if(ExtractLogFileHandle != NULL)
-							fwrite(&mask,sizeof(short),1,ExtractLogFileHandle);
-						//mvd[0] = (mvd[0] & (~lo))|lo;
-						mvd[0] = mvd[0] + 10;//maska;
-						mvd[1] = mvd[1] - 10;//maskb;
-
-    //sprintf(szExtkey,"frame_num:%06d slice_num:%04d mb_addr:%05d a:%05d b:%05d",\
-			//currSlice->frame_num,currSlice->slice_nr,currMB->mbAddrX,maska,maskb);
-			            if(p_Vid->p_Inp->ExtKeyFileEnable)
-			            {
-                            sprintf(szExtkey,"%d %d %d %d %d\n",\
-    			                    p_Vid->frame_no,currSlice->slice_nr,currMB->mbAddrX,maska,maskb);			
-                            ExtWrite2KeyFile(szExtkey);
-			            }
-					}
-					else
-					{
-						mvd[0] = cur_mv->mv_x - predMV.mv_x;
-						mvd[1] = cur_mv->mv_y - predMV.mv_y;
-						//ttt=mvd[1];
-						//printf("ttt %d    %d,\n",extIndex, ttt);
-						if(ExtractLogFileHandle != NULL)							
-							fwrite(&mask,sizeof(short),1,ExtractLogFileHandle);
-						//mvd[1] = (mvd[1] & (~lo))|lo;
-						mvd[0] = mvd[0] - 10;//maska;
-						mvd[1] = mvd[1] + 10;//maskb;
-                        if(p_Vid->p_Inp->ExtKeyFileEnable)
-			            {
-                            sprintf(szExtkey,"%d %d %d %d %d\n",\
-    			                p_Vid->frame_no,currSlice->slice_nr,currMB->mbAddrX,maska,maskb);
-                            ExtWrite2KeyFile(szExtkey);  
-                        }
-					}
-				}
-				//printf("writeMotionVector8x8 log %d mvd[0] %d mvd[1] %d\n",log,mvd[0],mvd[1]);
-				//write(SensetiveFile,mvd,4);
-				//mvd[0] = log;
-				//mvd[1] = log;
-			}
-			else
-			{
-				mvd[0] = cur_mv->mv_x - predMV.mv_x;
-				mvd[1] = cur_mv->mv_y - predMV.mv_y;
-			}
-	 	}
-		else
-		{
-			mvd[0] = cur_mv->mv_x - predMV.mv_x;
-			mvd[1] = cur_mv->mv_y - predMV.mv_y;
-		}
+      mvd[0] = cur_mv->mv_x - predMV.mv_x;
+      mvd[1] = cur_mv->mv_y - predMV.mv_y;
+      ext_ev = NULL;
 
+      if (ExtractOn && Extraction == 1 && frame_in_range_set(&g_ExtractFrmRng, p_Vid->number))
+      {
+        // with SliceThreads the mvd is perturbed when the slice is terminated
+        if (currSlice->ext_events != NULL)
+        {
+          ext_ev = add_ext_event(currMB, partMap[SE_MVD]);
+          ext_ev->bit_pos = bs_bitlength(dataPart->bitstream);
+          ext_ev->mvd[0]  = mvd[0];
+          ext_ev->mvd[1]  = mvd[1];
+#if TRACE
+          ext_ev->trace_pos  = trace_position();
+          ext_ev->list_idx   = (short) list_idx;
+          ext_ev->org_mv[0]  = cur_mv->mv_x;
+          ext_ev->org_mv[1]  = cur_mv->mv_y;
+          ext_ev->pred_mv[0] = predMV.mv_x;
+          ext_ev->pred_mv[1] = predMV.mv_y;
+#endif
+        }
+        else
+          ext_scramble_mvd(currSlice, currMB->mbAddrX, mvd);
+      }
 
       for (k=0; k<2; ++k)
       {
@@ -3251,7 +3295,7 @@ int writeMotionVector8x8 (Macroblock *currMB, //<--  current Macroblock
         
 		if(ExtractOn)
 		{
-			if(Extraction==1)
+			if(Extraction==1 && currSlice->ext_events == NULL)
 			{
 				numberChange++;
 			}
@@ -3271,23 +3315,24 @@ int writeMotionVector8x8 (Macroblock *currMB, //<--  current Macroblock
 
 		if(ExtractOn)
 		{
-			if(Extraction==1)
+			if(Extraction==1 && currSlice->ext_events == NULL)
 			{
 				ratetotal+=se.len;
 			}
 		}
 			
       }
-
             
-	if(Extraction==1)
+	if(Extraction==1 && ExtractDebug && currSlice->ext_events == NULL)
 	{
 		sprintf(s,"Slice:   %c  |  Frame_num (%06d)  |  MB(%05d,%05d)  |  mv:(%04d,%04d)  |  Ext_mv:(%04d,%04d)  |\n",\
 			currSlice->slice_type==P_SLICE ? 'P': 'B', currSlice->frame_num, currMB->pix_x,currMB->pix_y, \
 			cur_mv->mv_x,cur_mv->mv_y,mvd[0],mvd[1]);
 		ExtPrintf(s,PRTOUT_END);
 	}
-        
+
+      if (ext_ev != NULL)
+        ext_ev->len = bs_bitlength(dataPart->bitstream) - ext_ev->bit_pos;
     }
   }
 
@@ -3349,10 +3394,12 @@ int write_b_slice_motion_info_to_NAL (Macroblock* currMB,int Extraction)
 
     
 
-	if(Extraction==1)
+	if(Extraction==1 && ExtractDebug)
 	{
-		sprintf(s,"B Slice Marco x %d, y %d,type %d\n",currMB->mb_x*16,currMB->mb_y*16,currMB->mb_type);
-		ExtPrintf(s,PRTOUT_LOGFILE);
+		if (currSlice->ext_events != NULL)
+			add_ext_event(currMB, -1);
+		else
+			ext_print_mb(currSlice, currMB, currMB->mb_type);
 	}
 
     //printf("B slice_no = %d\n",currSlice->frame_num);
@@ -3428,10 +3475,12 @@ int write_p_slice_motion_info_to_NAL (Macroblock* currMB,int Extraction)
       }
     }
     
-	if(Extraction==1)
+	if(Extraction==1 && ExtractDebug)
 	{
-		sprintf(s,"P Slice Marco x %d, y %d,type %d\n",currMB->mb_x*16,currMB->mb_y*16,currMB->mb_type);
-		ExtPrintf(s,PRTOUT_LOGFILE);
+		if (currSlice->ext_events != NULL)
+			add_ext_event(currMB, -1);
+		else
+			ext_print_mb(currSlice, currMB, currMB->mb_type);
 	}
     //printf("P slice_no = %d\n",currSlice->frame_num);
 
@@ -3453,6 +3502,178 @@ int write_p_slice_motion_info_to_NAL (Macroblock* currMB,int Extraction)
   return no_bits;
 }
 
+/*!
+ ************************************************************************
+ * \brief
+ *    Copies the bits [from, to) of a bit buffer to a bitstream
+ ************************************************************************
+ */
+static void copy_bits (Bitstream *currStream, byte *buf, int from, int to)
+{
+  SyntaxElement se;
+  int i;
+
+  while (from < to)
+  {
+    se.len = imin(to - from, 16);
+    se.bitpattern = 0;
+    for (i = 0; i < se.len; ++i, ++from)
+      se.bitpattern = (se.bitpattern << 1) | ((buf[from >> 3] >> (7 - (from & 0x07))) & 0x01);
+    writeUVLC2buffer(&se, currStream);
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Replaces the recorded mvd codewords of one data partition by the
+ *    codewords of the perturbed mvds (CAVLC)
+ ************************************************************************
+ */
+static void rewrite_ext_mvds (Slice *currSlice, int part)
+{
+  Bitstream *currStream = currSlice->partArr[part].bitstream;
+  int total_bits = bs_bitlength(currStream);
+  int new_bits = total_bits;
+  int num_mvds = 0;
+  int pos = 0;
+  int k, c, len;
+  byte *old_buf;
+  SyntaxElement se;
+
+  for (k = 0; k < currSlice->num_ext_events; ++k)
+  {
+    ExtEvent *ev = &currSlice->ext_events[k];
+
+    if (ev->part == part)
+    {
+      for (c = 0; c < 2; ++c)
+      {
+        se_linfo (ev->mvd[c], 0, &se.len, &se.inf);
+        new_bits += se.len;
+      }
+      new_bits -= ev->len;
+      ++num_mvds;
+    }
+  }
+  if (num_mvds == 0)
+    return;
+
+  if (((new_bits + 7) >> 3) > currStream->buffer_size)
+  {
+    snprintf (errortext, ET_SIZE, "rewrite_ext_mvds: perturbed slice exceeds the bitstream buffer (%d bytes)", currStream->buffer_size);
+    error (errortext, 500);
+  }
+
+  if ((old_buf = (byte *) malloc(currStream->byte_pos + 1)) == NULL)
+    no_mem_exit("rewrite_ext_mvds: old_buf");
+  memcpy(old_buf, currStream->streamBuffer, currStream->byte_pos);
+  old_buf[currStream->byte_pos] = (byte) (currStream->byte_buf << currStream->bits_to_go);
+
+  currStream->byte_pos   = 0;
+  currStream->bits_to_go = 8;
+  currStream->byte_buf   = 0;
+
+  for (k = 0; k < currSlice->num_ext_events; ++k)
+  {
+    ExtEvent *ev = &currSlice->ext_events[k];
+
+    if (ev->part != part)
+      continue;
+
+    copy_bits(currStream, old_buf, pos, ev->bit_pos);
+    for (c = 0, len = 0; c < 2; ++c)
+    {
+      se_linfo (ev->mvd[c], 0, &se.len, &se.inf);
+      symbol2uvlc(&se);
+      writeUVLC2buffer(&se, currStream);
+      len += se.len;
+    }
+    currSlice->cur_stats->bit_use_mode[currSlice->slice_type][ev->mb_type] += len - ev->len;
+    pos = ev->bit_pos + ev->len;
+  }
+  copy_bits(currStream, old_buf, pos, total_bits);
+
+  free(old_buf);
+}
+
+#if TRACE
+/*!
+ ************************************************************************
+ * \brief
+ *    Replaces the trace lines of the perturbed mvds of a slice in its
+ *    trace buffer
+ ************************************************************************
+ */
+static void retrace_ext_mvds (Slice *currSlice)
+{
+  TraceBuffer *buf = currSlice->trace;
+  int shift = 0;   // the lines of later events move with the length of the replaced lines
+  int k, c, pos, size;
+  SyntaxElement se;
+
+  for (k = 0; k < currSlice->num_ext_events; ++k)
+  {
+    ExtEvent *ev = &currSlice->ext_events[k];
+
+    if (ev->part < 0 || ev->trace_pos < 0)
+      continue;
+
+    pos  = ev->trace_pos + shift;
+    size = buf->size;
+    for (c = 0; c < 2; ++c)
+    {
+      se.value1 = ev->mvd[c];
+      se_linfo (ev->mvd[c], 0, &se.len, &se.inf);
+      symbol2uvlc(&se);
+      snprintf(se.tracestring, TRACESTRING_SIZE, "mvd_l%d (%d) = %3d  (org_mv %3d pred_mv %3d)", ev->list_idx, c, ev->mvd[c], ev->org_mv[c], ev->pred_mv[c]);
+      pos = trace_replace_symbol(buf, pos, &se);
+    }
+    shift += buf->size - size;
+  }
+}
+#endif
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Writes the Extraction output of a slice whose macroblocks were
+ *    coded concurrently with other slices (SliceThreads)
+ *
+ * \par
+ *    The log lines, masks and keys are written and the mvds perturbed
+ *    in slice order, i.e. in the order of the serial encoder. Then the
+ *    mvd codewords of the slice are replaced by the perturbed ones
+ *    (CAVLC only, see PatchInp()), also in the trace of the slice.
+ *    currMB->mvd keeps the unperturbed mvds; it is only read for the
+ *    CABAC contexts.
+ ************************************************************************
+ */
+void write_deferred_extraction (Slice *currSlice)
+{
+  VideoParameters *p_Vid = currSlice->p_Vid;
+  int k;
+
+  for (k = 0; k < currSlice->num_ext_events; ++k)
+  {
+    ExtEvent *ev = &currSlice->ext_events[k];
+
+    if (ev->part < 0)
+      ext_print_mb (currSlice, &p_Vid->mb_data[ev->mb_addr], ev->mb_type);
+    else
+      ext_scramble_mvd (currSlice, ev->mb_addr, ev->mvd);
+  }
+
+  for (k = 0; k < currSlice->max_part_nr; ++k)
+    rewrite_ext_mvds (currSlice, k);
+#if TRACE
+  if (currSlice->trace != NULL)
+    retrace_ext_mvds (currSlice);
+#endif
+
+  currSlice->num_ext_events = 0;
+}
+
 
 /*!
  ************************************************************************
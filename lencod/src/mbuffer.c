@@ -26,6 +26,7 @@
 #include "img_luma.h"
 #include "img_chroma.h"
 #include "errdo.h"
+#include "me_hme.h"
 
 extern void SbSMuxBasic(ImageData *imgOut, ImageData *imgIn0, ImageData *imgIn1, int offset);
 extern void init_stats                   (InputParameters *p_Inp, StatParameters *stats);
@@ -617,6 +618,8 @@ static void free_frame_data_memory(StorablePicture *picture, int bFreeImage)
 {
   if(picture)
   {
+    free_sub_pel_bands(picture);
+
     if (picture->imgY_sub)
     {
       if(bFreeImage)
@@ -730,6 +733,7 @@ void free_storable_picture(VideoParameters *p_Vid, StorablePicture* p)
     }
 
     free_frame_data_memory(p, 1);
+    free_hme_pyramid(p);
 
     if( (p_Inp->separate_colour_plane_flag != 0) )
     {
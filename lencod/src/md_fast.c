@@ -0,0 +1,302 @@
+
+/*!
+ ***************************************************************************
+ * \file md_fast.c
+ *
+ * \brief
+ *    Fast high complexity mode decision (FastMDHigh).
+ *
+ *    The motion estimation costs of the inter partitions and the SATD of
+ *    the best 16x16 intra prediction serve as cheap estimates of the RD
+ *    cost of the candidates of encode_one_macroblock_high():
+ *     - the inter candidates are RD evaluated by increasing estimate, so
+ *       that the early termination of RDCost_for_macroblocks() triggers
+ *       more often,
+ *     - a candidate whose estimate exceeds the lowest inter estimate by
+ *       more than a learned margin is not RD evaluated at all,
+ *     - the sub-8x8 partitions of an 8x8 block are not searched when the
+ *       8x8 partition leaves little to gain.
+ *
+ *    The margins are learned on the fly: every N-th macroblock is decided
+ *    exhaustively and the estimate ratio of its winner (to the lowest inter
+ *    estimate) updates a running quantile of that ratio per slice type, so
+ *    that the winner stays within the margin in the given fraction of the
+ *    macroblocks. FastMDHigh=0 leaves the mode decision exhaustive and the
+ *    bitstream unchanged.
+ *
+ *    Slices coded concurrently (SliceThreads) all start from the margins
+ *    of the picture start; their updates are merged when the slices are
+ *    closed (merge_fast_md()). The decisions therefore differ from serial
+ *    slice coding, where a slice starts from the margins of the previous
+ *    one.
+ *
+ **************************************************************************
+ */
+
+#include "contributors.h"
+
+
+#include "global.h"
+#include "enc_statistics.h"
+#include "mode_decision.h"
+#include "md_fast.h"
+
+//! FastMDHigh presets
+typedef struct fast_md_preset
+{
+  const char *name;
+  double quantile;             //!< fraction of the winners the learned margins keep
+  int    train_period;         //!< every train_period-th macroblock is decided exhaustively
+  int    sub8x8;               //!< sub-8x8 pruning (1: 8x8 without residual, 2: also 8x8 not better than its 16x16 share)
+  int    skip_p8x8;            //!< no P8x8 search if 16x16 has the lowest cost of the large partitions
+} FastMDPreset;
+
+static const FastMDPreset fast_md_presets[3] =
+{
+  { "off",    1.00,  1, 0, 0 },
+  { "fast",   0.95, 16, 1, 0 },
+  { "faster", 0.85, 32, 2, 1 }
+};
+
+#define FAST_MD_STEP        0.04        //!< adaptation step of the learned margins
+#define FAST_MD_INIT_MARGIN 1.5         //!< margin before any training
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Returns the name of a FastMDHigh preset
+ ************************************************************************
+ */
+const char *fast_md_preset_name (int preset)
+{
+  return fast_md_presets[iClip3(0, 2, preset)].name;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Resets the learned margins
+ ************************************************************************
+ */
+void init_fast_md (VideoParameters *p_Vid, InputParameters *p_Inp)
+{
+  FastMDState *fmd = &p_Vid->fast_md;
+  int i;
+
+  memset(fmd, 0, sizeof(FastMDState));
+  for (i = 0; i < 2; ++i)
+  {
+    fmd->inter[i] = FAST_MD_INIT_MARGIN;
+    fmd->intra[i] = FAST_MD_INIT_MARGIN;
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Adds the updates a slice coded on a private copy of the state
+ *    (SliceThreads) made to the learned margins to fmd. base is the
+ *    state the copy started from.
+ ************************************************************************
+ */
+void merge_fast_md (FastMDState *fmd, FastMDState *slice, FastMDState *base)
+{
+  int i;
+
+  fmd->mb_count += slice->mb_count - base->mb_count;
+  for (i = 0; i < 2; ++i)
+  {
+    fmd->inter[i] = dmax(1.0, fmd->inter[i] + slice->inter[i] - base->inter[i]);
+    fmd->intra[i] = dmax(1.0, fmd->intra[i] + slice->intra[i] - base->intra[i]);
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Moves a margin towards the given quantile of the winner ratios
+ *    (stochastic quantile estimation)
+ ************************************************************************
+ */
+static void learn_margin (double *margin, double ratio, double quantile)
+{
+  if (ratio <= *margin)
+    *margin = dmax(1.0, *margin - FAST_MD_STEP * (1.0 - quantile));
+  else
+    *margin += FAST_MD_STEP * quantile;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Starts the fast mode decision of a macroblock
+ ************************************************************************
+ */
+void fast_md_start (Macroblock *currMB, RD_PARAMS *enc_mb, FastMDMB *fmb, int intra)
+{
+  InputParameters *p_Inp = currMB->p_Inp;
+  FastMDState *fmd = &currMB->p_Vid->fast_md;
+  int i;
+
+  fmb->active    = (p_Inp->FastMDHigh != 0) && !intra;
+  fmb->prune     = FALSE;
+  fmb->min_inter = DISTBLK_MAX;
+  for (i = 0; i < MAXMODE; ++i)
+    fmb->est[i] = DISTBLK_MAX;
+  memcpy(fmb->order, mb_mode_table, sizeof(fmb->order));
+
+  if (fmb->active)
+  {
+    const FastMDPreset *preset = &fast_md_presets[p_Inp->FastMDHigh];
+
+    fmb->prune = (fmd->mb_count++ % preset->train_period) != 0;
+    if (fmb->prune)
+      enc_mb->prune_sub8x8 = (short) preset->sub8x8;
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Sets the motion estimation cost of an inter candidate
+ ************************************************************************
+ */
+void fast_md_set_estimate (FastMDMB *fmb, int mode, distblk cost)
+{
+  fmb->est[mode] = cost;
+  if (cost < fmb->min_inter)
+    fmb->min_inter = cost;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Called before the P8x8 search: keeps the 16x16 cost for the
+ *    sub-8x8 pruning and returns 1 if the P8x8 search is skipped
+ ************************************************************************
+ */
+int fast_md_skip_p8x8_search (Macroblock *currMB, RD_PARAMS *enc_mb, FastMDMB *fmb)
+{
+  const FastMDPreset *preset = &fast_md_presets[currMB->p_Inp->FastMDHigh];
+  distblk *est = fmb->est;
+
+  enc_mb->cost16x16 = est[1];
+
+  if (fmb->prune && preset->skip_p8x8 && est[1] != DISTBLK_MAX
+    && (est[2] != DISTBLK_MAX || est[3] != DISTBLK_MAX) && est[1] <= est[2] && est[1] <= est[3])
+  {
+    currMB->p_Slice->cur_stats->md_pruned++;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Sorts the inter candidates (16x16, 16x8, 8x16, P8x8) by estimate;
+ *    skip/direct stays first and the intra candidates last
+ ************************************************************************
+ */
+void fast_md_order (FastMDMB *fmb)
+{
+  int i, j;
+
+  if (!fmb->active)
+    return;
+
+  for (i = 2; i <= 4; ++i)
+  {
+    char mode = fmb->order[i];
+
+    for (j = i; j > 1 && fmb->est[(int) fmb->order[j - 1]] > fmb->est[(int) mode]; --j)
+      fmb->order[j] = fmb->order[j - 1];
+    fmb->order[j] = mode;
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Returns 1 if the RD evaluation of a candidate is skipped
+ ************************************************************************
+ */
+int fast_md_prune_mode (Macroblock *currMB, FastMDMB *fmb, int mode)
+{
+  Slice *currSlice = currMB->p_Slice;
+  FastMDState *fmd = &currMB->p_Vid->fast_md;
+  int bslice = (currSlice->slice_type == B_SLICE);
+  int pruned = FALSE;
+
+  if (!fmb->active)
+    return FALSE;
+
+  if (mode == I16MB || mode == I4MB || mode == I8MB)
+  {
+    // one SATD estimate (best 16x16 prediction) for all intra candidates
+    if (fmb->est[I16MB] == DISTBLK_MAX)
+      fmb->est[I16MB] = currSlice->find_sad_16x16(currMB);
+
+    if (fmb->prune && fmb->min_inter != DISTBLK_MAX)
+      pruned = (double) fmb->est[I16MB] > fmd->intra[bslice] * (double) fmb->min_inter;
+  }
+  else if (mode != 0 && mode <= P8x8)
+  {
+    if (fmb->prune && fmb->est[mode] != DISTBLK_MAX && fmb->min_inter != DISTBLK_MAX)
+      pruned = (double) fmb->est[mode] > fmd->inter[bslice] * (double) fmb->min_inter;
+  }
+
+  if (pruned)
+    currSlice->cur_stats->md_pruned++;
+  else
+    currSlice->cur_stats->md_tested++;
+
+  return pruned;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Returns 1 if the sub-8x8 partitions of an 8x8 block are not
+ *    searched, given the result of the 8x8 partition
+ ************************************************************************
+ */
+int fast_md_prune_sub8x8 (Macroblock *currMB, RD_PARAMS *enc_mb, int cnt_nonz, distblk cost8x8)
+{
+  int pruned = (cnt_nonz == 0)
+    || (enc_mb->prune_sub8x8 >= 2 && enc_mb->cost16x16 != DISTBLK_MAX && cost8x8 >= (enc_mb->cost16x16 >> 2));
+
+  if (pruned)
+    currMB->p_Slice->cur_stats->md_sub8x8_pruned++;
+
+  return pruned;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Finishes the fast mode decision of a macroblock: the winner of an
+ *    exhaustive (training) macroblock updates the learned margins
+ ************************************************************************
+ */
+void fast_md_finish (Macroblock *currMB, FastMDMB *fmb)
+{
+  FastMDState *fmd = &currMB->p_Vid->fast_md;
+  const FastMDPreset *preset = &fast_md_presets[currMB->p_Inp->FastMDHigh];
+  int bslice = (currMB->p_Slice->slice_type == B_SLICE);
+  int mode = currMB->best_mode;
+
+  if (!fmb->active || fmb->prune || fmb->min_inter == DISTBLK_MAX || fmb->min_inter <= 0)
+    return;
+
+  if (mode == I16MB || mode == I4MB || mode == I8MB)
+  {
+    if (fmb->est[I16MB] != DISTBLK_MAX)
+      learn_margin(&fmd->intra[bslice], (double) fmb->est[I16MB] / (double) fmb->min_inter, preset->quantile);
+  }
+  else if (mode != 0 && mode <= P8x8)
+  {
+    if (fmb->est[mode] != DISTBLK_MAX)
+      learn_margin(&fmd->inter[bslice], (double) fmb->est[mode] / (double) fmb->min_inter, preset->quantile);
+  }
+}
@@ -28,6 +28,7 @@
 #include "vlc.h"
 #include "rdopt.h"
 #include "mv_search.h"
+#include "md_fast.h"
 
 /*!
 *************************************************************************************
@@ -64,6 +65,7 @@ void encode_one_macroblock_high (Macroblock *currMB)
   short       inter_skip = 0;
   BestMode    md_best;
   Info8x8     best;
+  FastMDMB    fmb;
 
 
   init_md_best(&md_best);  //ʼģʽ
@@ -79,6 +81,7 @@ void encode_one_macroblock_high (Macroblock *currMB)
 
   //===== Setup Macroblock encoding parameters =====
   init_enc_mb_params(currMB, &enc_mb, intra);
+  fast_md_start(currMB, &enc_mb, &fmb, intra);
   if (p_Inp->AdaptiveRounding)
   {
     reset_adaptive_rounding(p_Vid);
@@ -171,6 +174,7 @@ void encode_one_macroblock_high (Macroblock *currMB)
           if (mode>1 && block == 0)
             currSlice->set_ref_and_motion_vectors (currMB, motion, &best, block);
         } // for (block=0; block<(mode==1?1:2); block++)
+        fast_md_set_estimate(&fmb, mode, cost);
         if (cost < min_cost)
         {
           md_best.mode = (byte) mode;
@@ -186,6 +190,9 @@ void encode_one_macroblock_high (Macroblock *currMB)
     } // for (mode=1; mode<4; mode++)
 
     //P8x8˶(ֿԷֳ:8x8 8x4 4x8 4x4)
+    if (fmb.active && enc_mb.valid[P8x8] && fast_md_skip_p8x8_search(currMB, &enc_mb, &fmb))
+      enc_mb.valid[P8x8] = 0;
+
     if (enc_mb.valid[P8x8])
     {    
       currMB->valid_8x8 = FALSE;
@@ -229,6 +236,9 @@ void encode_one_macroblock_high (Macroblock *currMB)
             break;
           set_subblock8x8_info(b8x8info, P8x8, block, p_RDO->tr4x4);
         }
+        // direct sub-blocks have no motion cost: the P8x8 estimate of B slices is not comparable
+        if (currMB->valid_4x4 && !bslice)
+          fast_md_set_estimate(&fmb, P8x8, p_RDO->tr4x4->mb_p8x8_cost);
       }// if (p_Inp->Transform8x8Mode != 2)
 
       if (p_Inp->RCEnable)
@@ -246,6 +256,9 @@ void encode_one_macroblock_high (Macroblock *currMB)
   //Ƚɫ֡Ԥ,Ȼѡģʽ
   set_chroma_pred_mode(currMB, enc_mb, mb_available, chroma_pred_mode_range);
 
+  // FastMDHigh: inter candidates by increasing motion estimation cost
+  fast_md_order(&fmb);
+
   //min_rdcostѡһѵĺģʽ
   //========= C H O O S E   B E S T   M A C R O B L O C K   M O D E =========
   //-------------------------------------------------------------------------
@@ -287,7 +300,7 @@ void encode_one_macroblock_high (Macroblock *currMB)
     //ѭ9
     for (index=0; index < max_index; index++)
     {
-      mode = mb_mode_table[index];  //ӺģʽеõӦģʽֵ
+      mode = fmb.order[index];  //ӺģʽеõӦģʽֵ
       //printf("mode %d %7.3f", mode, (double) currMB->min_rdcost);
       if (enc_mb.valid[mode])
       {
@@ -323,6 +336,9 @@ void encode_one_macroblock_high (Macroblock *currMB)
           }
         }
 
+        if (fast_md_prune_mode(currMB, &fmb, mode))
+          continue;
+
         //compute the min_rdcost of all mode ={skip,I16x16 I16x8 I8x16 P8x8 I16MB I4MB I8MB IPCM}
         //ģʽСֵѭ9
         compute_mode_RD_cost(currMB, &enc_mb, (short) mode, &inter_skip);
@@ -334,6 +350,8 @@ void encode_one_macroblock_high (Macroblock *currMB)
 
   restore_nz_coeff(currMB);
 
+  fast_md_finish(currMB, &fmb);
+
   intra1 = is_intra(currMB);
 
   //=====  S E T   F I N A L   M A C R O B L O C K   P A R A M E T E R S ======
@@ -0,0 +1,483 @@
+
+/*!
+ ***************************************************************************
+ * \file md_reuse.c
+ *
+ * \brief
+ *    Macroblock coding with the coding decisions of a decoded stream.
+ *
+ *    The decoder writes the parsed decisions of every macroblock (type,
+ *    partitions, intra prediction modes, reference indices, motion vectors
+ *    and QP) to a macroblock info file (MBInfoFile). Re-encoding the same
+ *    source with the same configuration and this file skips motion
+ *    estimation and mode decision: every macroblock is predicted, transformed
+ *    and quantized only once, with the recorded decisions. This is used to
+ *    re-emit a stream with a different MVD perturbation (ExtractionOn) at a
+ *    fraction of the cost of a full encode.
+ *
+ **************************************************************************
+ */
+
+#include "contributors.h"
+
+#include "global.h"
+#include "io_mbinfo.h"
+#include "mb_access.h"
+#include "image.h"
+#include "macroblock.h"
+#include "mode_decision.h"
+#include "md_common.h"
+#include "mv_search.h"
+#include "q_around.h"
+#include "rdopt.h"
+#include "rd_intra_jm.h"
+#include "transform8x8.h"
+#include "intra4x4.h"
+#include "intra8x8.h"
+#include "intra16x16.h"
+#include "md_reuse.h"
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Opens the macroblock info file (MBInfoFile)
+ ************************************************************************
+ */
+void init_mb_info_reuse (VideoParameters *p_Vid, InputParameters *p_Inp)
+{
+  p_Vid->p_mb_info = NULL;
+  p_Vid->mb_info   = NULL;
+
+  if (strlen(p_Inp->MBInfoFile) == 0)
+    return;
+
+  p_Vid->p_mb_info = open_mb_info_file(p_Inp->MBInfoFile, 0);
+  if ((p_Vid->mb_info = (MBInfoRecord *) calloc(1, sizeof(MBInfoRecord))) == NULL)
+    no_mem_exit("init_mb_info_reuse: p_Vid->mb_info");
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Closes the macroblock info file
+ ************************************************************************
+ */
+void free_mb_info_reuse (VideoParameters *p_Vid)
+{
+  close_mb_info_file(p_Vid->p_mb_info);
+  free(p_Vid->mb_info);
+
+  p_Vid->p_mb_info = NULL;
+  p_Vid->mb_info   = NULL;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Reads the record of the current macroblock and applies its QP
+ ************************************************************************
+ */
+static void read_mb_info_record (Macroblock *currMB)
+{
+  VideoParameters *p_Vid = currMB->p_Vid;
+  Slice *currSlice = currMB->p_Slice;
+  MBInfoRecord *rec = p_Vid->mb_info;
+
+  if (!read_mb_info(p_Vid->p_mb_info, rec))
+  {
+    snprintf(errortext, ET_SIZE, "MBInfoFile: no record for macroblock %d of the picture with POC %d", currMB->mbAddrX, currSlice->ThisPOC);
+    error(errortext, 500);
+  }
+
+  if (rec->mb_addr != currMB->mbAddrX || rec->poc != currSlice->ThisPOC || rec->slice_type != currSlice->slice_type)
+  {
+    snprintf(errortext, ET_SIZE, "MBInfoFile: record of macroblock %d (POC %d, slice type %d) found for macroblock %d (POC %d, slice type %d).\n"
+      "The stream must be re-encoded with the configuration it was encoded with.",
+      rec->mb_addr, rec->poc, rec->slice_type, currMB->mbAddrX, currSlice->ThisPOC, currSlice->slice_type);
+    error(errortext, 500);
+  }
+
+  currMB->qp = (short) iClip3(-currSlice->bitdepth_luma_qp_scale, 51, rec->qp);
+  update_qp(currMB);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Sets the recorded partitions, reference indices and motion vectors
+ *    of an inter macroblock (b8x8info->best[mode] and all_mv)
+ ************************************************************************
+ */
+static void set_inter_decisions (Macroblock *currMB, short mode)
+{
+  VideoParameters *p_Vid = currMB->p_Vid;
+  Slice *currSlice = currMB->p_Slice;
+  MBInfoRecord *rec = p_Vid->mb_info;
+  Info8x8 *best = p_Vid->b8x8info->best[mode];
+  int list, k, i, j, blk;
+  int bslice = (currSlice->slice_type == B_SLICE);
+
+  if (bslice)
+    currSlice->Get_Direct_Motion_Vectors (currMB);
+
+  if (mode == 0)
+  {
+    // P_Skip motion vector; direct modes use the motion derived above
+    if (!bslice)
+    {
+      FindSkipModeMotionVector (currMB);
+      for (k = 0; k < 4; k++)
+      {
+        best[k] = init_info_8x8_struct();
+        currSlice->set_ref_and_motion_vectors (currMB, p_Vid->enc_picture->mv_info, &best[k], k);
+      }
+    }
+    return;
+  }
+
+  for (k = 0; k < 4; k++)
+  {
+    int b8_y = 2 * (k >> 1);
+    int b8_x = 2 * (k & 0x01);
+
+    best[k]        = init_info_8x8_struct();
+    best[k].mode   = (mode == P8x8) ? rec->b8mode[k] : (char) mode;
+    best[k].bipred = 0;
+
+    if (bslice && best[k].mode == 0)
+    {
+      best[k].pdir        = currSlice->direct_pdir   [currMB->block_y + b8_y][currMB->block_x + b8_x];
+      best[k].ref[LIST_0] = currSlice->direct_ref_idx[currMB->block_y + b8_y][currMB->block_x + b8_x][LIST_0];
+      best[k].ref[LIST_1] = currSlice->direct_ref_idx[currMB->block_y + b8_y][currMB->block_x + b8_x][LIST_1];
+    }
+    else
+    {
+      best[k].pdir = bslice ? rec->b8pdir[k] : 0;
+      for (list = LIST_0; list <= LIST_1; list++)
+      {
+        best[k].ref[list] = rec->ref_idx[list][b8_y * BLOCK_SIZE + b8_x];
+        if (best[k].ref[list] >= currSlice->listXsize[list + currMB->list_offset])
+        {
+          snprintf(errortext, ET_SIZE, "MBInfoFile: invalid reference index %d (list %d) in macroblock %d", best[k].ref[list], list, currMB->mbAddrX);
+          error(errortext, 500);
+        }
+      }
+    }
+  }
+
+  for (j = 0; j < BLOCK_SIZE; j++)
+  {
+    for (i = 0; i < BLOCK_SIZE; i++)
+    {
+      Info8x8 *b8 = &best[2 * (j >> 1) + (i >> 1)];
+      blk = j * BLOCK_SIZE + i;
+
+      if (b8->mode == 0)
+        continue;
+
+      for (list = LIST_0; list <= LIST_1; list++)
+      {
+        if (rec->ref_idx[list][blk] >= 0 && (b8->pdir == list || b8->pdir == BI_PRED))
+        {
+          MotionVector *mv = &currSlice->all_mv[list][(short) rec->ref_idx[list][blk]][(short) b8->mode][j][i];
+          mv->mv_x = rec->mv[list][blk][0];
+          mv->mv_y = rec->mv[list][blk][1];
+        }
+      }
+    }
+  }
+}
+
+/*!
+ *************************************************************************************
+ * \brief
+ *    Codes an intra 4x4 block with the recorded prediction mode
+ *************************************************************************************
+ */
+static int mode_decision_for_I4x4_blocks_reuse (Macroblock *currMB, int b8, int b4, int lambda, distblk *min_cost)
+{
+  VideoParameters *p_Vid = currMB->p_Vid;
+  InputParameters *p_Inp = currMB->p_Inp;
+  Slice *currSlice = currMB->p_Slice;
+
+  int  nonzero, dummy;
+  int  block_x     = ((b8 & 0x01) << 3) + ((b4 & 0x01) << 2);
+  int  block_y     = ((b8 >> 1) << 3)  + ((b4 >> 1) << 2);
+  int  pic_pix_x   = currMB->pix_x  + block_x;
+  int  pic_pix_y   = currMB->pix_y  + block_y;
+  int  pic_opix_y  = currMB->opix_y + block_y;
+  int  best_ipmode = p_Vid->mb_info->ipredmode[(block_y >> 2) * BLOCK_SIZE + (block_x >> 2)];
+  int  left_available, up_available, all_available;
+  int *mb_size = p_Vid->mb_size[IS_LUMA];
+
+  char upMode, leftMode;
+  int  mostProbableMode;
+  PixelPos left_block, top_block;
+
+  get4x4Neighbour(currMB, block_x - 1, block_y    , mb_size, &left_block);
+  get4x4Neighbour(currMB, block_x,     block_y - 1, mb_size, &top_block );
+
+  // constrained intra pred
+  if (p_Inp->UseConstrainedIntraPred)
+  {
+    left_block.available = left_block.available ? p_Vid->intra_block[left_block.mb_addr] : 0;
+    top_block.available  = top_block.available  ? p_Vid->intra_block[top_block.mb_addr]  : 0;
+  }
+
+  upMode            =  top_block.available ? p_Vid->ipredmode[top_block.pos_y ][top_block.pos_x ] : (char) -1;
+  leftMode          = left_block.available ? p_Vid->ipredmode[left_block.pos_y][left_block.pos_x] : (char) -1;
+
+  mostProbableMode  = (upMode < 0 || leftMode < 0) ? DC_PRED : upMode < leftMode ? upMode : leftMode;
+  *min_cost = 0;
+
+  currSlice->set_intrapred_4x4(currMB, PLANE_Y, pic_pix_x, pic_pix_y, &left_available, &up_available, &all_available);
+  get_intrapred_4x4(currMB, PLANE_Y, best_ipmode, block_x, block_y, left_available, up_available);
+
+  //===== set intra mode prediction =====
+  p_Vid->ipredmode[pic_pix_y >> 2][pic_pix_x >> 2] = (char) best_ipmode;
+  currMB->intra_pred_modes[4*b8+b4] = (char) (mostProbableMode == best_ipmode ? -1 : (best_ipmode < mostProbableMode ? best_ipmode : best_ipmode - 1));
+
+  // get prediction and prediction error
+  generate_pred_error_4x4(&p_Vid->pCurImg[pic_opix_y], currSlice->mpr_4x4[0][best_ipmode], &currSlice->mb_pred[0][block_y], &currSlice->mb_ores[0][block_y], pic_pix_x, block_x);
+
+  currMB->ipmode_DPCM = (short) best_ipmode;
+
+  select_transform(currMB);
+
+  nonzero = currMB->cr_cbp[0] = residual_transform_quant_luma_4x4 (currMB, PLANE_Y, block_x, block_y, &dummy, 1);
+
+  return nonzero;
+}
+
+/*!
+ *************************************************************************************
+ * \brief
+ *    Codes an intra 8x8 block with the recorded prediction mode
+ *************************************************************************************
+ */
+static int mode_decision_for_I8x8_blocks_reuse (Macroblock *currMB, int b8, int lambda, distblk *min_cost)
+{
+  VideoParameters *p_Vid = currMB->p_Vid;
+  InputParameters *p_Inp = currMB->p_Inp;
+  Slice *currSlice = currMB->p_Slice;
+
+  int  j, dummy;
+  int  block_x     = (b8 & 0x01) << 3;
+  int  block_y     = (b8 >> 1) << 3;
+  int  pic_pix_x   = currMB->pix_x + block_x;
+  int  pic_pix_y   = currMB->pix_y + block_y;
+  int  pic_opix_y  = currMB->opix_y + block_y;
+  int  mb_block_y  = (currMB->block_y) + (block_y >> 2);
+  int  mb_block_x  = (currMB->block_x) + (block_x >> 2);
+  int  best_ipmode = p_Vid->mb_info->ipredmode[(block_y >> 2) * BLOCK_SIZE + (block_x >> 2)];
+  int  left_available, up_available, all_available;
+  int *mb_size = p_Vid->mb_size[IS_LUMA];
+
+  char upMode, leftMode;
+  int  mostProbableMode;
+  PixelPos left_block, top_block;
+
+  get4x4Neighbour(currMB, block_x - 1, block_y    , mb_size, &left_block);
+  get4x4Neighbour(currMB, block_x,     block_y - 1, mb_size, &top_block );
+
+  if (p_Inp->UseConstrainedIntraPred)
+  {
+    top_block.available  = top_block.available ? p_Vid->intra_block [top_block.mb_addr] : 0;
+    left_block.available = left_block.available ? p_Vid->intra_block [left_block.mb_addr] : 0;
+  }
+
+  if(b8 >> 1)
+    upMode    =  top_block.available ? p_Vid->ipredmode8x8[top_block.pos_y ][top_block.pos_x ] : -1;
+  else
+    upMode    =  top_block.available ? p_Vid->ipredmode   [top_block.pos_y ][top_block.pos_x ] : -1;
+
+  if(b8 & 0x01)
+    leftMode  = left_block.available ? p_Vid->ipredmode8x8[left_block.pos_y][left_block.pos_x] : -1;
+  else
+    leftMode  = left_block.available ? p_Vid->ipredmode[left_block.pos_y][left_block.pos_x] : -1;
+
+  mostProbableMode  = (upMode < 0 || leftMode < 0) ? DC_PRED : upMode < leftMode ? upMode : leftMode;
+  *min_cost = 0;
+
+  currSlice->set_intrapred_8x8(currMB, PLANE_Y, pic_pix_x, pic_pix_y, &left_available, &up_available, &all_available);
+  get_intrapred_8x8(currMB, PLANE_Y, best_ipmode, left_available, up_available);
+
+  //===== set intra mode prediction =====
+  currMB->intra_pred_modes8x8[4*b8] = (char)((mostProbableMode == best_ipmode)
+    ? -1
+    : (best_ipmode < mostProbableMode ? best_ipmode : best_ipmode-1));
+
+  for(j = mb_block_y; j < mb_block_y + 2; j++)   //loop 4x4s in the subblock for 8x8 prediction setting
+    memset(&p_Vid->ipredmode8x8[j][mb_block_x], best_ipmode, 2 * sizeof(char));
+
+  // get prediction and prediction error
+  generate_pred_error_8x8(&p_Vid->pCurImg[pic_opix_y], currSlice->mpr_8x8[0][best_ipmode], &currSlice->mb_pred[0][block_y], &currSlice->mb_ores[0][block_y], pic_pix_x, block_x);
+  currMB->ipmode_DPCM = (short) best_ipmode;
+
+  return currMB->residual_transform_quant_luma_8x8 (currMB, PLANE_Y, b8, &dummy, 1);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Sets the intra 16x16 prediction of the recorded mode
+ ************************************************************************
+ */
+static distblk find_sad_16x16_reuse (Macroblock *currMB)
+{
+  Slice *currSlice = currMB->p_Slice;
+  int up_avail, left_avail, left_up_avail;
+
+  currMB->i16mode = currMB->p_Vid->mb_info->i16mode;
+
+  currSlice->set_intrapred_16x16(currMB, PLANE_Y, &left_avail, &up_avail, &left_up_avail);
+  get_intrapred_16x16(currMB, PLANE_Y, currMB->i16mode, left_avail, up_avail);
+
+  return 0;
+}
+
+/*!
+*************************************************************************************
+* \brief
+*    Codes a macroblock with the recorded coding decisions
+*************************************************************************************
+*/
+static void encode_one_macroblock_reuse (Macroblock *currMB)
+{
+  Slice *currSlice = currMB->p_Slice;
+  VideoParameters *p_Vid = currMB->p_Vid;
+  InputParameters *p_Inp = currMB->p_Inp;
+  MBInfoRecord *rec = p_Vid->mb_info;
+  char **ipredmodes = p_Vid->ipredmode;
+
+  RD_PARAMS enc_mb;
+  distblk   cost;
+  short     mode;
+  int       j;
+
+  read_mb_info_record(currMB);
+  mode = rec->mb_type;
+
+  init_enc_mb_params(currMB, &enc_mb, 0);
+  if (p_Inp->AdaptiveRounding)
+  {
+    reset_adaptive_rounding(p_Vid);
+  }
+
+  currMB->luma_transform_size_8x8_flag = FALSE;
+  currSlice->NoResidueDirect = 0;
+  currMB->best_mode = mode;
+  currMB->min_rdcost = 0;
+
+  if (mode == I4MB)
+  {
+    currMB->mb_type = currMB->ar_mode = I4MB;
+    currMB->cbp = mode_decision_for_I4x4_MB (currMB, enc_mb.lambda_mdfp, &cost);
+    currSlice->set_modes_and_refs_for_blocks (currMB, mode);
+  }
+  else if (mode == I8MB)
+  {
+    currMB->luma_transform_size_8x8_flag = TRUE;
+    currMB->mb_type = currMB->ar_mode = I8MB;
+    currMB->cbp = mode_decision_for_I8x8_MB (currMB, enc_mb.lambda_mdfp, &cost);
+    currSlice->set_modes_and_refs_for_blocks (currMB, mode);
+
+    memcpy(currMB->intra_pred_modes,currMB->intra_pred_modes8x8, MB_BLOCK_PARTITIONS * sizeof(char));
+    for(j = currMB->block_y; j < currMB->block_y + BLOCK_MULTIPLE; j++)
+      memcpy(&p_Vid->ipredmode[j][currMB->block_x],&p_Vid->ipredmode8x8[j][currMB->block_x], BLOCK_MULTIPLE * sizeof(char));
+  }
+  else if (mode == I16MB)
+  {
+    find_best_mode_I16x16_MB (currMB, enc_mb.lambda_mdfp, DISTBLK_MAX);
+    currSlice->set_modes_and_refs_for_blocks (currMB, mode);
+    currMB->cbp = currMB->residual_transform_quant_luma_16x16 (currMB, PLANE_Y);
+  }
+  else if (mode == IPCM)
+  {
+    currSlice->set_modes_and_refs_for_blocks (currMB, mode);
+    prepare_ipcm_mode(currMB);
+    currMB->cbp = 0;
+  }
+  else if (mode <= P8x8)
+  {
+    set_inter_decisions(currMB, mode);
+    currSlice->set_modes_and_refs_for_blocks (currMB, mode);
+
+    // direct macroblocks coded without residual (B_Skip)
+    currSlice->NoResidueDirect = (currSlice->slice_type == B_SLICE && mode == 0 && rec->cbp == 0);
+
+    currMB->luma_transform_size_8x8_flag = (byte) rec->transform_8x8;
+    currSlice->luma_residual_coding(currMB);
+
+    // the transform size of 8x8 blocks without coefficients is not signalled;
+    // drop the residual of blocks that were not coded in the original stream
+    for (j = 0; j < 4; j++)
+    {
+      if ((currMB->cbp & (1 << j)) && !(rec->cbp & (1 << j)))
+        reset_block(currMB, &currMB->cbp, &currMB->cbp_blk, j);
+    }
+  }
+  else
+  {
+    snprintf(errortext, ET_SIZE, "MBInfoFile: unsupported macroblock type %d in macroblock %d", mode, currMB->mbAddrX);
+    error(errortext, 500);
+  }
+
+  if (mode != I4MB && mode != I8MB)
+  {
+    memset(currMB->intra_pred_modes, DC_PRED, MB_BLOCK_PARTITIONS * sizeof(char));
+    for(j = currMB->block_y; j < currMB->block_y + BLOCK_MULTIPLE; j++)
+      memset(&ipredmodes[j][currMB->block_x], DC_PRED, BLOCK_MULTIPLE * sizeof(char));
+  }
+
+  //check luma cbp for transform size flag
+  if (((currMB->cbp&15) == 0) && currMB->mb_type != I4MB && currMB->mb_type != I8MB)
+    currMB->luma_transform_size_8x8_flag = FALSE;
+
+  currMB->i16offset = 0;
+  currMB->c_ipred_mode = DC_PRED_8;
+
+  if ((p_Vid->yuv_format != YUV400) && (p_Vid->yuv_format != YUV444) && mode != IPCM)
+  {
+    if (is_intra(currMB))
+    {
+      currSlice->intra_chroma_prediction(currMB, NULL, NULL, NULL);
+      currMB->c_ipred_mode = rec->c_ipred_mode;
+    }
+    currSlice->chroma_residual_coding (currMB);
+  }
+
+  if (mode == I16MB)
+  {
+    currMB->i16offset = I16Offset  (currMB->cbp, currMB->i16mode);
+  }
+
+  currSlice->set_motion_vectors_mb (currMB);
+
+  /*update adaptive rounding offset p_Inp*/
+  if (p_Vid->AdaptiveRounding)
+  {
+    if (currSlice->NoResidueDirect)
+      reset_adaptive_rounding_direct(p_Vid);
+    update_offset_params(currMB, currMB->best_mode, currMB->luma_transform_size_8x8_flag);
+  }
+  currSlice->NoResidueDirect = 0;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Replaces motion estimation and mode decision of a slice by the
+ *    recorded decisions (if a macroblock info file is used)
+ ************************************************************************
+ */
+void setup_mb_info_reuse (Slice *currSlice)
+{
+  if (currSlice->p_Vid->p_mb_info == NULL)
+    return;
+
+  currSlice->encode_one_macroblock         = encode_one_macroblock_reuse;
+  currSlice->mode_decision_for_I4x4_blocks = mode_decision_for_I4x4_blocks_reuse;
+  currSlice->mode_decision_for_I8x8_blocks = mode_decision_for_I8x8_blocks_reuse;
+  currSlice->find_sad_16x16                = find_sad_16x16_reuse;
+}
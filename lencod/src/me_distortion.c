@@ -24,6 +24,9 @@
 #include "refbuf.h"
 #include "mv_search.h"
 #include "me_distortion.h"
+#include "img_luma.h"
+#include "img_dist_ssim.h"
+#include "quant_kernels.h"
 
 
 //#define CHECKOVERFLOW(mcost) assert(mcost>=0)
@@ -37,12 +40,7 @@
 */
 distblk distortion4x4SAD(short* diff, distblk min_dist)
 {
-  int distortion = 0, k;
-  for (k = 0; k < 16; k++)
-  {
-    distortion += iabs(*diff++);
-  }
-  return (dist_scale((distblk) distortion));
+  return (dist_scale((distblk) dist_kernels.diff_sad(diff, 16)));
 }
 
 /*!
@@ -53,12 +51,7 @@ distblk distortion4x4SAD(short* diff, distblk min_dist)
 */
 distblk distortion4x4SSE(short* diff, distblk min_dist)
 {
-  int distortion = 0, k;
-  for (k = 0; k < 16; k++)
-  {
-    distortion += iabs2(*diff++);
-  }
-  return (dist_scale((distblk) distortion));
+  return (dist_scale(dist_kernels.diff_sse(diff, 16)));
 }
 
 /*!
@@ -106,14 +99,7 @@ distblk distortion8x8SADthres(short* diff, distblk min_cost)
 */
 distblk distortion8x8SAD(short* diff, distblk min_dist)
 {
-  int distortion = 0;
-  int k;
-
-  for (k = 0; k < 64; k++)
-  {
-    distortion += iabs(*diff++);
-  }
-  return (dist_scale((distblk) distortion));
+  return (dist_scale((distblk) dist_kernels.diff_sad(diff, 64)));
 }
 
 /*!
@@ -124,13 +110,7 @@ distblk distortion8x8SAD(short* diff, distblk min_dist)
 */
 distblk distortion8x8SSE(short* diff, distblk min_dist)
 {
-  distblk distortion = 0;
-  int k;
-  for (k = 0; k < 64; k++)
-  {
-    distortion += iabs2(*diff++);
-  }
-  return (dist_scale(distortion));
+  return (dist_scale(dist_kernels.diff_sse(diff, 64)));
 }
 
 /*!
@@ -147,6 +127,12 @@ distblk distortion8x8SATD(short* diff, distblk min_dist)
 
 void select_distortion(VideoParameters *p_Vid, InputParameters *p_Inp)
 {
+  int simd_level = init_distortion_kernels(p_Inp->DistortionSIMD);
+
+  init_luma_kernels(simd_level);
+  init_ssim_kernels(simd_level);
+  init_quant_kernels(simd_level);
+
   switch(p_Inp->ModeDecisionMetric)
   {
   case ERROR_SAD:
@@ -167,262 +153,136 @@ void select_distortion(VideoParameters *p_Vid, InputParameters *p_Inp)
 
 
 /*!
-***********************************************************************
+************************************************************************
 * \brief
-*    Calculate 4x4 Hadamard-Transformed SAD
-***********************************************************************
+*    SAD computation
+************************************************************************
 */
-int HadamardSAD4x4 (short* diff)
+distblk computeSAD(StorablePicture *ref1,
+               MEBlock *mv_block,
+               distblk min_mcost,
+               MotionVector *cand)
 {
-  int k, satd = 0;
-  int m[16], d[16];
-
-  /*===== hadamard transform =====*/
-  m[ 0] = diff[ 0] + diff[12];
-  m[ 1] = diff[ 1] + diff[13];
-  m[ 2] = diff[ 2] + diff[14];
-  m[ 3] = diff[ 3] + diff[15];
-  m[ 4] = diff[ 4] + diff[ 8];
-  m[ 5] = diff[ 5] + diff[ 9];
-  m[ 6] = diff[ 6] + diff[10];
-  m[ 7] = diff[ 7] + diff[11];
-  m[ 8] = diff[ 4] - diff[ 8];
-  m[ 9] = diff[ 5] - diff[ 9];
-  m[10] = diff[ 6] - diff[10];
-  m[11] = diff[ 7] - diff[11];
-  m[12] = diff[ 0] - diff[12];
-  m[13] = diff[ 1] - diff[13];
-  m[14] = diff[ 2] - diff[14];
-  m[15] = diff[ 3] - diff[15];
-
-  d[ 0] = m[ 0] + m[ 4];
-  d[ 1] = m[ 1] + m[ 5];
-  d[ 2] = m[ 2] + m[ 6];
-  d[ 3] = m[ 3] + m[ 7];
-  d[ 4] = m[ 8] + m[12];
-  d[ 5] = m[ 9] + m[13];
-  d[ 6] = m[10] + m[14];
-  d[ 7] = m[11] + m[15];
-  d[ 8] = m[ 0] - m[ 4];
-  d[ 9] = m[ 1] - m[ 5];
-  d[10] = m[ 2] - m[ 6];
-  d[11] = m[ 3] - m[ 7];
-  d[12] = m[12] - m[ 8];
-  d[13] = m[13] - m[ 9];
-  d[14] = m[14] - m[10];
-  d[15] = m[15] - m[11];
-
-  m[ 0] = d[ 0] + d[ 3];
-  m[ 1] = d[ 1] + d[ 2];
-  m[ 2] = d[ 1] - d[ 2];
-  m[ 3] = d[ 0] - d[ 3];
-  m[ 4] = d[ 4] + d[ 7];
-  m[ 5] = d[ 5] + d[ 6];
-  m[ 6] = d[ 5] - d[ 6];
-  m[ 7] = d[ 4] - d[ 7];
-  m[ 8] = d[ 8] + d[11];
-  m[ 9] = d[ 9] + d[10];
-  m[10] = d[ 9] - d[10];
-  m[11] = d[ 8] - d[11];
-  m[12] = d[12] + d[15];
-  m[13] = d[13] + d[14];
-  m[14] = d[13] - d[14];
-  m[15] = d[12] - d[15];
-
-  d[ 0] = m[ 0] + m[ 1];
-  d[ 1] = m[ 0] - m[ 1];
-  d[ 2] = m[ 2] + m[ 3];
-  d[ 3] = m[ 3] - m[ 2];
-  d[ 4] = m[ 4] + m[ 5];
-  d[ 5] = m[ 4] - m[ 5];
-  d[ 6] = m[ 6] + m[ 7];
-  d[ 7] = m[ 7] - m[ 6];
-  d[ 8] = m[ 8] + m[ 9];
-  d[ 9] = m[ 8] - m[ 9];
-  d[10] = m[10] + m[11];
-  d[11] = m[11] - m[10];
-  d[12] = m[12] + m[13];
-  d[13] = m[12] - m[13];
-  d[14] = m[14] + m[15];
-  d[15] = m[15] - m[14];
-
-  //===== sum up =====
-  // Table lookup is faster than abs macro
-  for (k=0; k<16; ++k)
+  int mcost;
+  int imin_cost = dist_down(min_mcost);
+  VideoParameters *p_Vid = mv_block->p_Vid;
+
+  mcost = dist_kernels.sad(mv_block->orig_pic[0], UMVLine4X (ref1, cand->mv_y, cand->mv_x), p_Vid->padded_size_x,
+    mv_block->blocksize_x, mv_block->blocksize_y, imin_cost);
+  if(mcost > imin_cost) 
+    return (dist_scale_f((distblk)mcost));
+
+  if ( mv_block->ChromaMEEnable ) 
   {
-    satd += iabs(d [k]);
-  }
+    // calculate chroma conribution to motion compensation error
+    int k;
+    int mcr_cost = 0; // chroma me cost
+
+    for (k=0; k < 2; k++)
+    {
+      mcr_cost = dist_kernels.sad(mv_block->orig_pic[k+1], UMVLine8X_chroma ( ref1, k+1, cand->mv_y, cand->mv_x), p_Vid->cr_padded_size_x,
+        mv_block->blocksize_cr_x, mv_block->blocksize_cr_y, INT_MAX);
+      mcost += mv_block->ChromaMEWeight * mcr_cost;
 
+      if(mcost >imin_cost)
+        return (dist_scale_f((distblk)mcost));
+    }
+  }
 
-  return ((satd+1)>>1);
+  CHECKOVERFLOW(mcost);
+  return (dist_scale((distblk)mcost));
 }
 
 /*!
-***********************************************************************
+************************************************************************
 * \brief
-*    Calculate 8x8 Hadamard-Transformed SAD
-***********************************************************************
+*    Full pel distortion of num candidates of the same block, computed
+*    with the block's single candidate function. min_mcost[i] is the
+*    limit for candidate i, its distortion is returned in mcost[i].
+************************************************************************
 */
-int HadamardSAD8x8 (short* diff)
+void computeUniPredBatch(StorablePicture *ref1,
+                         MEBlock *mv_block,
+                         int num,
+                         MotionVector *cand,
+                         distblk *min_mcost,
+                         distblk *mcost)
 {
-  int i, j, jj, sad=0;
-
-  // Hadamard related arrays
-  int m1[8][8], m2[8][8], m3[8][8];
-
-
-  //horizontal
-  for (j=0; j < 8; j++)
-  {
-    jj = j << 3;
-    m2[j][0] = diff[jj  ] + diff[jj+4];
-    m2[j][1] = diff[jj+1] + diff[jj+5];
-    m2[j][2] = diff[jj+2] + diff[jj+6];
-    m2[j][3] = diff[jj+3] + diff[jj+7];
-    m2[j][4] = diff[jj  ] - diff[jj+4];
-    m2[j][5] = diff[jj+1] - diff[jj+5];
-    m2[j][6] = diff[jj+2] - diff[jj+6];
-    m2[j][7] = diff[jj+3] - diff[jj+7];
-
-    m1[j][0] = m2[j][0] + m2[j][2];
-    m1[j][1] = m2[j][1] + m2[j][3];
-    m1[j][2] = m2[j][0] - m2[j][2];
-    m1[j][3] = m2[j][1] - m2[j][3];
-    m1[j][4] = m2[j][4] + m2[j][6];
-    m1[j][5] = m2[j][5] + m2[j][7];
-    m1[j][6] = m2[j][4] - m2[j][6];
-    m1[j][7] = m2[j][5] - m2[j][7];
-
-    m2[j][0] = m1[j][0] + m1[j][1];
-    m2[j][1] = m1[j][0] - m1[j][1];
-    m2[j][2] = m1[j][2] + m1[j][3];
-    m2[j][3] = m1[j][2] - m1[j][3];
-    m2[j][4] = m1[j][4] + m1[j][5];
-    m2[j][5] = m1[j][4] - m1[j][5];
-    m2[j][6] = m1[j][6] + m1[j][7];
-    m2[j][7] = m1[j][6] - m1[j][7];
-  }
+  int i;
 
-  //vertical
-  for (i=0; i < 8; i++)
-  {
-    m3[0][i] = m2[0][i] + m2[4][i];
-    m3[1][i] = m2[1][i] + m2[5][i];
-    m3[2][i] = m2[2][i] + m2[6][i];
-    m3[3][i] = m2[3][i] + m2[7][i];
-    m3[4][i] = m2[0][i] - m2[4][i];
-    m3[5][i] = m2[1][i] - m2[5][i];
-    m3[6][i] = m2[2][i] - m2[6][i];
-    m3[7][i] = m2[3][i] - m2[7][i];
-
-    m1[0][i] = m3[0][i] + m3[2][i];
-    m1[1][i] = m3[1][i] + m3[3][i];
-    m1[2][i] = m3[0][i] - m3[2][i];
-    m1[3][i] = m3[1][i] - m3[3][i];
-    m1[4][i] = m3[4][i] + m3[6][i];
-    m1[5][i] = m3[5][i] + m3[7][i];
-    m1[6][i] = m3[4][i] - m3[6][i];
-    m1[7][i] = m3[5][i] - m3[7][i];
-
-    m2[0][i] = m1[0][i] + m1[1][i];
-    m2[1][i] = m1[0][i] - m1[1][i];
-    m2[2][i] = m1[2][i] + m1[3][i];
-    m2[3][i] = m1[2][i] - m1[3][i];
-    m2[4][i] = m1[4][i] + m1[5][i];
-    m2[5][i] = m1[4][i] - m1[5][i];
-    m2[6][i] = m1[6][i] + m1[7][i];
-    m2[7][i] = m1[6][i] - m1[7][i];
-  }
-  for (j=0; j < 8; j++)
-    for (i=0; i < 8; i++) 
-      sad += iabs (m2[j][i]);
-
-  return ((sad+2)>>2);
+  for (i = 0; i < num; i++)
+    mcost[i] = mv_block->computePredFPel(ref1, mv_block, min_mcost[i], &cand[i]);
 }
 
 /*!
 ************************************************************************
 * \brief
-*    SAD computation
+*    Batched SAD / SSE computation (see computeUniPredBatch()). The luma
+*    distortions of all candidates are computed by one multiple
+*    candidate kernel; the results equal the ones of computeSAD() and
+*    computeSSE().
 ************************************************************************
 */
-distblk computeSAD(StorablePicture *ref1,
-               MEBlock *mv_block,
-               distblk min_mcost,
-               MotionVector *cand)
+static void computeBatch(StorablePicture *ref1,
+                         MEBlock *mv_block,
+                         int num,
+                         MotionVector *cand,
+                         distblk *min_mcost,
+                         distblk *mcost,
+                         int (*kernel)(imgpel *, imgpel *, int, int, int, int),
+                         void (*kernel_multi)(imgpel *, imgpel **, int, int, int, int, int *, int *))
 {
-  int mcost = 0;
-  int imin_cost = dist_down(min_mcost);
-  int y,x;
-  short blocksize_x = mv_block->blocksize_x;
-  short blocksize_y = mv_block->blocksize_y;
   VideoParameters *p_Vid = mv_block->p_Vid;
-  int pad_size_x = p_Vid->padded_size_x - blocksize_x;
-#if (JM_MEM_DISTORTION)
-  int *imgpel_abs = p_Vid->imgpel_abs;
-#endif
+  imgpel *ref_line[ME_BATCH_SIZE];
+  int imin_cost[ME_BATCH_SIZE];
+  int icost[ME_BATCH_SIZE];
+  int i, k;
 
-  imgpel *src_line, *ref_line;
-  src_line = mv_block->orig_pic[0];
-  ref_line = UMVLine4X (ref1, cand->mv_y, cand->mv_x);
-  for (y=0; y<blocksize_y; y++)
+  for (i = 0; i < num; i++)
   {
-    for (x = 0; x < blocksize_x; x+=4)
-    {
-#if (JM_MEM_DISTORTION)
-      mcost += imgpel_abs[ *src_line++ - *ref_line++ ];
-      mcost += imgpel_abs[ *src_line++ - *ref_line++ ];
-      mcost += imgpel_abs[ *src_line++ - *ref_line++ ];
-      mcost += imgpel_abs[ *src_line++ - *ref_line++ ];
-#else
-      mcost += iabs( *src_line++ - *ref_line++ );
-      mcost += iabs( *src_line++ - *ref_line++ );
-      mcost += iabs( *src_line++ - *ref_line++ );
-      mcost += iabs( *src_line++ - *ref_line++ );
-#endif
-    }
-    if(mcost > imin_cost) 
-      return (dist_scale_f((distblk)mcost));
-    ref_line += pad_size_x;
+    imin_cost[i] = dist_down(min_mcost[i]);
+    ref_line[i] = UMVLine4X (ref1, cand[i].mv_y, cand[i].mv_x);
   }
-  if ( mv_block->ChromaMEEnable ) 
-  {
-    // calculate chroma conribution to motion compensation error
-    int blocksize_x_cr = mv_block->blocksize_cr_x;
-    int blocksize_y_cr = mv_block->blocksize_cr_y;
-    int cr_pad_size_x = p_Vid->cr_padded_size_x - blocksize_x_cr;
-    int k;
-    int mcr_cost = 0; // chroma me cost
 
-    for (k=0; k < 2; k++)
-    {
-      src_line = mv_block->orig_pic[k+1];
-      ref_line = UMVLine8X_chroma ( ref1, k+1, cand->mv_y, cand->mv_x);
-      mcr_cost = 0;
+  kernel_multi(mv_block->orig_pic[0], ref_line, num, p_Vid->padded_size_x,
+    mv_block->blocksize_x, mv_block->blocksize_y, imin_cost, icost);
 
-      for (y = 0; y < blocksize_y_cr; y++)
+  for (i = 0; i < num; i++)
+  {
+    if ( mv_block->ChromaMEEnable ) 
+    {
+      // calculate chroma conribution to motion compensation error
+      for (k = 0; k < 2 && icost[i] <= imin_cost[i]; k++)
       {
-        for (x = 0; x < blocksize_x_cr; x += 2)
-        {
-#if (JM_MEM_DISTORTION)
-          mcr_cost += imgpel_abs[ *src_line++ - *ref_line++ ];
-          mcr_cost += imgpel_abs[ *src_line++ - *ref_line++ ];
-#else
-          mcr_cost += iabs( *src_line++ - *ref_line++ );
-          mcr_cost += iabs( *src_line++ - *ref_line++ );
-#endif
-        }
-        ref_line += cr_pad_size_x;
+        icost[i] += mv_block->ChromaMEWeight * kernel(mv_block->orig_pic[k+1], UMVLine8X_chroma ( ref1, k+1, cand[i].mv_y, cand[i].mv_x),
+          p_Vid->cr_padded_size_x, mv_block->blocksize_cr_x, mv_block->blocksize_cr_y, INT_MAX);
       }
-      mcost += mv_block->ChromaMEWeight * mcr_cost;
+    }
 
-      if(mcost >imin_cost)
-        return (dist_scale_f((distblk)mcost));
+    if (icost[i] > imin_cost[i])
+      mcost[i] = min_mcost[i];
+    else
+    {
+      CHECKOVERFLOW(icost[i]);
+      mcost[i] = dist_scale((distblk) icost[i]);
     }
   }
+}
 
-  CHECKOVERFLOW(mcost);
-  return (dist_scale((distblk)mcost));
+/*!
+************************************************************************
+* \brief
+*    Batched SAD computation
+************************************************************************
+*/
+void computeSADBatch(StorablePicture *ref1,
+                     MEBlock *mv_block,
+                     int num,
+                     MotionVector *cand,
+                     distblk *min_mcost,
+                     distblk *mcost)
+{
+  computeBatch(ref1, mv_block, num, cand, min_mcost, mcost, dist_kernels.sad, dist_kernels.sad_multi);
 }
 
 /*!
@@ -530,80 +390,24 @@ distblk computeBiPredSAD1(StorablePicture *ref1,
                       MotionVector *cand2)
 {
   int imin_cost = dist_down(min_mcost);
-  int mcost = 0;
-  int bi_diff;
-  int y,x;
-  short blocksize_x = mv_block->blocksize_x;
-  short blocksize_y = mv_block->blocksize_y;
+  int mcost;
   VideoParameters *p_Vid = mv_block->p_Vid;
-  int pad_size_x = p_Vid->padded_size_x - blocksize_x;
-#if (JM_MEM_DISTORTION)
-  int *imgpel_abs = p_Vid->imgpel_abs;
-#endif
 
-  imgpel *src_line   = mv_block->orig_pic[0];
-  imgpel *ref2_line  = UMVLine4X(ref2, cand2->mv_y, cand2->mv_x);
-  imgpel *ref1_line  = UMVLine4X(ref1, cand1->mv_y, cand1->mv_x);
-
-  for (y = 0; y < blocksize_y; y++)
-  {
-    for (x = 0; x < blocksize_x; x+=4)
-    {
-#if (JM_MEM_DISTORTION)
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += imgpel_abs[ bi_diff ];
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += imgpel_abs[ bi_diff ];
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += imgpel_abs[ bi_diff ];
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += imgpel_abs[ bi_diff ];
-#else
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs(bi_diff);
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs(bi_diff);
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs(bi_diff);
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs(bi_diff);
-#endif
-    }
-    if(mcost > imin_cost)
-      return (dist_scale_f((distblk)mcost));
-
-    ref2_line += pad_size_x;
-    ref1_line += pad_size_x;
-  }
+  mcost = dist_kernels.bi_sad(mv_block->orig_pic[0], UMVLine4X(ref1, cand1->mv_y, cand1->mv_x), UMVLine4X(ref2, cand2->mv_y, cand2->mv_x),
+    p_Vid->padded_size_x, mv_block->blocksize_x, mv_block->blocksize_y, imin_cost);
+  if(mcost > imin_cost)
+    return (dist_scale_f((distblk)mcost));
 
   if ( mv_block->ChromaMEEnable ) 
   {
     // calculate chroma conribution to motion compensation error
-    int blocksize_x_cr = mv_block->blocksize_cr_x;
-    int blocksize_y_cr = mv_block->blocksize_cr_y;
-    int cr_pad_size_x = p_Vid->cr_padded_size_x - blocksize_x_cr;
     int k;
     int mcr_cost = 0;
 
     for (k=1; k<3; k++)
     {
-      mcr_cost = 0;
-      src_line = mv_block->orig_pic[k];
-      ref2_line = UMVLine8X_chroma ( ref2, k, cand2->mv_y, cand2->mv_x);
-      ref1_line = UMVLine8X_chroma ( ref1, k, cand1->mv_y, cand1->mv_x);
-
-      for (y=0; y<blocksize_y_cr; y++)
-      {
-        for (x = 0; x < blocksize_x_cr; x+=2)
-        {
-          bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          mcr_cost += iabs(bi_diff);
-          bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          mcr_cost += iabs(bi_diff);
-        }        
-        ref2_line += cr_pad_size_x;
-        ref1_line += cr_pad_size_x;
-      }
+      mcr_cost = dist_kernels.bi_sad(mv_block->orig_pic[k], UMVLine8X_chroma ( ref1, k, cand1->mv_y, cand1->mv_x), UMVLine8X_chroma ( ref2, k, cand2->mv_y, cand2->mv_x),
+        p_Vid->cr_padded_size_x, mv_block->blocksize_cr_x, mv_block->blocksize_cr_y, INT_MAX);
       mcost += mv_block->ChromaMEWeight * mcr_cost;
 
       if(mcost > imin_cost)
@@ -750,36 +554,22 @@ distblk computeSATD(StorablePicture *ref1,
 {
   int imin_cost = dist_down(min_mcost);
   int mcost = 0;
-  int y, x, y4;
-  int src_size_x, src_size_mul;
+  int y, x;
+  int src_size_mul;
   short blocksize_x = mv_block->blocksize_x;
   short blocksize_y = mv_block->blocksize_y;
   VideoParameters *p_Vid = mv_block->p_Vid;
   imgpel *src_tmp = mv_block->orig_pic[0];
-  short *d, diff[MB_PIXELS];
-  imgpel *src_line, *ref_line;
+  short diff[MB_PIXELS];
   
   if ( !mv_block->test8x8 )
   { // 4x4 TRANSFORM
-    src_size_x = blocksize_x - BLOCK_SIZE;
     src_size_mul = blocksize_x * BLOCK_SIZE;
     for (y = cand->mv_y; y < cand->mv_y + (blocksize_y<<2); y += (BLOCK_SIZE_SP))
     {
       for (x=0; x<blocksize_x; x += BLOCK_SIZE)
       {
-        d    = diff;
-        ref_line = UMVLine4X (ref1, y, cand->mv_x + (x<<2));
-        src_line = src_tmp + x;
-        for (y4 = 0; y4 < BLOCK_SIZE; y4++ )
-        {
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-
-          ref_line += p_Vid->padded_size_x_m4x4;
-          src_line += src_size_x;
-        }
+        dist_kernels.diff(src_tmp + x, blocksize_x, UMVLine4X (ref1, y, cand->mv_x + (x<<2)), p_Vid->padded_size_x, BLOCK_SIZE, diff);
         mcost += HadamardSAD4x4 (diff);
         if(mcost > imin_cost)
           return dist_scale_f((distblk)mcost);
@@ -789,29 +579,12 @@ distblk computeSATD(StorablePicture *ref1,
   }
   else
   { // 8x8 TRANSFORM    
-    src_size_x = (blocksize_x - BLOCK_SIZE_8x8);
     src_size_mul = blocksize_x * BLOCK_SIZE_8x8;
     for (y = cand->mv_y; y < cand->mv_y + (blocksize_y<<2); y += (BLOCK_SIZE_8x8_SP) )
     {
       for (x=0; x<blocksize_x; x += BLOCK_SIZE_8x8 )
       {
-        d = diff;
-        ref_line = UMVLine4X (ref1, y, cand->mv_x + (x<<2));
-        src_line = src_tmp + x;
-        for (y4 = 0; y4 < BLOCK_SIZE_8x8; y4++ )
-        {
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-
-          ref_line += p_Vid->padded_size_x_m8x8;
-          src_line += src_size_x;
-        }
+        dist_kernels.diff(src_tmp + x, blocksize_x, UMVLine4X (ref1, y, cand->mv_x + (x<<2)), p_Vid->padded_size_x, BLOCK_SIZE_8x8, diff);
         mcost += HadamardSAD8x8 (diff);
         if(mcost > imin_cost)
           return dist_scale_f((distblk)mcost);
@@ -949,38 +722,23 @@ distblk computeBiPredSATD1(StorablePicture *ref1,
 {
   int imin_cost = dist_down(min_mcost);
   int mcost = 0;
-  int y, x, y4;
-  int src_size_x, src_size_mul;
+  int y, x;
+  int src_size_mul;
   imgpel *src_tmp = mv_block->orig_pic[0];
-  short *d, diff[MB_PIXELS];
-  imgpel *src_line, *ref1_line, *ref2_line;
+  short diff[MB_PIXELS];
   short blocksize_x = mv_block->blocksize_x;
   short blocksize_y = mv_block->blocksize_y;
   VideoParameters *p_Vid = mv_block->p_Vid;
 
   if ( !mv_block->test8x8 )
   { // 4x4 TRANSFORM
-    src_size_x = (blocksize_x - BLOCK_SIZE);
     src_size_mul = blocksize_x * BLOCK_SIZE;
     for (y=0; y<(blocksize_y<<2); y += (BLOCK_SIZE_SP))
     {
       for (x=0; x<blocksize_x; x += BLOCK_SIZE)
       {
-        d    = diff;
-        src_line   = src_tmp + x;
-        ref2_line  = UMVLine4X(ref2, cand2->mv_y + y, cand2->mv_x + (x<<2));
-        ref1_line  = UMVLine4X(ref1, cand1->mv_y + y, cand1->mv_x + (x<<2));
-        for (y4 = 0; y4 < BLOCK_SIZE; y4++ )
-        {
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-
-          ref1_line += p_Vid->padded_size_x_m4x4;
-          ref2_line += p_Vid->padded_size_x_m4x4;
-          src_line  += src_size_x;
-        }
+        dist_kernels.bi_diff(src_tmp + x, blocksize_x, UMVLine4X(ref1, cand1->mv_y + y, cand1->mv_x + (x<<2)),
+          UMVLine4X(ref2, cand2->mv_y + y, cand2->mv_x + (x<<2)), p_Vid->padded_size_x, BLOCK_SIZE, diff);
         mcost += HadamardSAD4x4 (diff);
         if(mcost > imin_cost) 
           return dist_scale_f((distblk)mcost);
@@ -990,7 +748,6 @@ distblk computeBiPredSATD1(StorablePicture *ref1,
   }
   else
   { // 8x8 TRANSFORM
-    src_size_x = (blocksize_x - BLOCK_SIZE_8x8);
     src_size_mul = blocksize_x * BLOCK_SIZE_8x8;
     for (y=0; y<(blocksize_y << 2); y += BLOCK_SIZE_8x8_SP )
     {
@@ -998,25 +755,8 @@ distblk computeBiPredSATD1(StorablePicture *ref1,
       int y_pos1 = cand1->mv_y + y;
       for (x=0; x<blocksize_x; x += BLOCK_SIZE_8x8 )
       {
-        d = diff;
-        src_line   = src_tmp + x;
-        ref2_line  = UMVLine4X(ref2, y_pos2, cand2->mv_x + (x<<2));
-        ref1_line  = UMVLine4X(ref1, y_pos1, cand1->mv_x + (x<<2));
-        for (y4 = 0; y4 < BLOCK_SIZE_8x8; y4++ )
-        {
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-
-          ref1_line += p_Vid->padded_size_x_m8x8;
-          ref2_line += p_Vid->padded_size_x_m8x8;
-          src_line += src_size_x;
-        }
+        dist_kernels.bi_diff(src_tmp + x, blocksize_x, UMVLine4X(ref1, y_pos1, cand1->mv_x + (x<<2)),
+          UMVLine4X(ref2, y_pos2, cand2->mv_x + (x<<2)), p_Vid->padded_size_x, BLOCK_SIZE_8x8, diff);
         mcost += HadamardSAD8x8 (diff);
         if(mcost > imin_cost)
           return dist_scale_f((distblk)mcost);
@@ -1194,53 +934,24 @@ distblk computeSSE(StorablePicture *ref1,
                )
 {
   int imin_cost = dist_down(min_mcost);
-  int mcost = 0;
-  int y,x;
-  short blocksize_x = mv_block->blocksize_x;
-  short blocksize_y = mv_block->blocksize_y;
+  int mcost;
   VideoParameters *p_Vid = mv_block->p_Vid;
-  int pad_size_x = p_Vid->padded_size_x - blocksize_x;
 
-  imgpel *src_line = mv_block->orig_pic[0];
-  imgpel *ref_line = UMVLine4X (ref1, cand->mv_y, cand->mv_x);
-  
-  for (y=0; y<blocksize_y; y++)
-  {
-    for (x = 0; x < blocksize_x; x+=4)
-    {
-      mcost += iabs2( *src_line++ - *ref_line++ );
-      mcost += iabs2( *src_line++ - *ref_line++ );
-      mcost += iabs2( *src_line++ - *ref_line++ );
-      mcost += iabs2( *src_line++ - *ref_line++ );
-    }
-    if(mcost > imin_cost)
-      return dist_scale_f((distblk)mcost);
-    ref_line += pad_size_x;
-  }
+  mcost = dist_kernels.sse(mv_block->orig_pic[0], UMVLine4X (ref1, cand->mv_y, cand->mv_x), p_Vid->padded_size_x,
+    mv_block->blocksize_x, mv_block->blocksize_y, imin_cost);
+  if(mcost > imin_cost)
+    return dist_scale_f((distblk)mcost);
 
   if ( mv_block->ChromaMEEnable ) 
   {
     // calculate chroma conribution to motion compensation error
-    int blocksize_x_cr = mv_block->blocksize_cr_x;
-    int blocksize_y_cr = mv_block->blocksize_cr_y;
-    int cr_pad_size_x = p_Vid->cr_padded_size_x - blocksize_x_cr;
     int k;
     int mcr_cost = 0;
 
     for (k=0; k<2; k++)
     {
-      mcr_cost = 0;
-      src_line = mv_block->orig_pic[k+1];
-      ref_line = UMVLine8X_chroma ( ref1, k+1, cand->mv_y, cand->mv_x);
-      for (y=0; y<blocksize_y_cr; y++)
-      {
-        for (x = 0; x < blocksize_x_cr; x+=2)
-        {
-          mcr_cost += iabs2( *src_line++ - *ref_line++ );
-          mcr_cost += iabs2( *src_line++ - *ref_line++ );
-        }
-        ref_line += cr_pad_size_x;
-      }
+      mcr_cost = dist_kernels.sse(mv_block->orig_pic[k+1], UMVLine8X_chroma ( ref1, k+1, cand->mv_y, cand->mv_x), p_Vid->cr_padded_size_x,
+        mv_block->blocksize_cr_x, mv_block->blocksize_cr_y, INT_MAX);
       mcost += mv_block->ChromaMEWeight * mcr_cost;
       if(mcost > imin_cost)
         return dist_scale_f((distblk)mcost);
@@ -1251,6 +962,21 @@ distblk computeSSE(StorablePicture *ref1,
   return dist_scale((distblk)mcost);
 }
 
+/*!
+************************************************************************
+* \brief
+*    Batched SSE computation
+************************************************************************
+*/
+void computeSSEBatch(StorablePicture *ref1,
+                     MEBlock *mv_block,
+                     int num,
+                     MotionVector *cand,
+                     distblk *min_mcost,
+                     distblk *mcost)
+{
+  computeBatch(ref1, mv_block, num, cand, min_mcost, mcost, dist_kernels.sse, dist_kernels.sse_multi);
+}
 
 /*!
 ************************************************************************
@@ -1358,66 +1084,24 @@ distblk computeBiPredSSE1(StorablePicture *ref1,
                       MotionVector *cand2)
 {
   int imin_cost = dist_down(min_mcost);
-  int mcost = 0;
-  int bi_diff;
-  int y,x;
-  short blocksize_x = mv_block->blocksize_x;
-  short blocksize_y = mv_block->blocksize_y;
+  int mcost;
   VideoParameters *p_Vid = mv_block->p_Vid;
-  int pad_size_x = p_Vid->padded_size_x - blocksize_x;
 
-  imgpel *src_line   = mv_block->orig_pic[0];
-  imgpel *ref2_line  = UMVLine4X(ref2, cand2->mv_y, cand2->mv_x);
-  imgpel *ref1_line  = UMVLine4X(ref1, cand1->mv_y, cand1->mv_x);
-
-  for (y = 0; y < blocksize_y; y++)
-  {
-    for (x = 0; x < blocksize_x; x+=4)
-    {
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs2(bi_diff);
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs2(bi_diff);
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs2(bi_diff);
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs2(bi_diff);
-    }
-    if(mcost > imin_cost)
-      return dist_scale_f((distblk)mcost);
-
-    ref2_line += pad_size_x;
-    ref1_line += pad_size_x;
-  }
+  mcost = dist_kernels.bi_sse(mv_block->orig_pic[0], UMVLine4X(ref1, cand1->mv_y, cand1->mv_x), UMVLine4X(ref2, cand2->mv_y, cand2->mv_x),
+    p_Vid->padded_size_x, mv_block->blocksize_x, mv_block->blocksize_y, imin_cost);
+  if(mcost > imin_cost)
+    return dist_scale_f((distblk)mcost);
 
   if ( mv_block->ChromaMEEnable ) 
   {
     // calculate chroma conribution to motion compensation error
-    int blocksize_x_cr = mv_block->blocksize_cr_x;
-    int blocksize_y_cr = mv_block->blocksize_cr_y;
-    int cr_pad_size_x  = p_Vid->cr_padded_size_x - blocksize_x_cr;
     int k;
     int mcr_cost = 0;
 
     for (k=0; k<2; k++)
     {
-      mcr_cost = 0;
-      src_line = mv_block->orig_pic[k+1];
-      ref2_line = UMVLine8X_chroma ( ref2, k+1, cand2->mv_y, cand2->mv_x);
-      ref1_line = UMVLine8X_chroma ( ref1, k+1, cand1->mv_y, cand1->mv_x);
-
-      for (y=0; y<blocksize_y_cr; y++)
-      {
-        for (x = 0; x < blocksize_x_cr; x+=2)
-        {
-          bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          mcr_cost += iabs2(bi_diff);
-          bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          mcr_cost += iabs2(bi_diff);
-        }        
-        ref2_line += cr_pad_size_x;
-        ref1_line += cr_pad_size_x;
-      }
+      mcr_cost = dist_kernels.bi_sse(mv_block->orig_pic[k+1], UMVLine8X_chroma ( ref1, k+1, cand1->mv_y, cand1->mv_x), UMVLine8X_chroma ( ref2, k+1, cand2->mv_y, cand2->mv_x),
+        p_Vid->cr_padded_size_x, mv_block->blocksize_cr_x, mv_block->blocksize_cr_y, INT_MAX);
       mcost += mv_block->ChromaMEWeight * mcr_cost;
       if(mcost > imin_cost)
         return dist_scale_f((distblk)mcost);
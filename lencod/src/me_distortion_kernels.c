@@ -0,0 +1,1200 @@
+/*!
+*************************************************************************************
+* \file me_distortion_kernels.c
+*
+* \brief
+*    Block distortion kernels (SAD, SSE, difference blocks and Hadamard SAD)
+*    used by the motion estimation and mode decision distortion functions.
+*    The multiple candidate SAD / SSE kernels evaluate several reference
+*    positions of the same source block in one call (batched EPZS search).
+*
+*    Portable C kernels are always available. On x86 CPUs SSE4.1 and AVX2
+*    versions are selected at run time (see init_distortion_kernels()).
+*    All kernels return exactly the same values as the C versions,
+*    including the partial sums returned on early termination.
+*
+*************************************************************************************
+*/
+
+#include "contributors.h"
+
+#include <limits.h>
+
+#include "global.h"
+#include "mbuffer.h"
+#include "me_distortion.h"
+
+#if (JM_SIMD_DISTORTION) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#  define SIMD_X86      1
+#  define TARGET_SSE41  __attribute__((target("sse4.1")))
+#  define TARGET_AVX2   __attribute__((target("avx2")))
+#elif (JM_SIMD_DISTORTION) && defined(_MSC_VER) && (_MSC_VER >= 1700) && (defined(_M_X64) || defined(_M_IX86))
+#  define SIMD_X86      1
+#  define TARGET_SSE41
+#  define TARGET_AVX2
+#else
+#  define SIMD_X86      0
+#endif
+
+#if (SIMD_X86)
+#include <string.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+DistortionKernels dist_kernels;
+
+/*!
+***********************************************************************
+* \brief
+*    SAD of a block. src is stored contiguously (width samples per line),
+*    ref uses a line stride of ref_stride samples. The lines are summed
+*    up in order and the sum is returned as soon as it exceeds imin_cost.
+***********************************************************************
+*/
+static int block_sad (imgpel *src, imgpel *ref, int ref_stride, int width, int height, int imin_cost)
+{
+  int mcost = 0;
+  int x, y;
+
+  for (y = 0; y < height; y++)
+  {
+    for (x = 0; x < width; x++)
+      mcost += iabs( src[x] - ref[x] );
+    if (mcost > imin_cost)
+      break;
+    src += width;
+    ref += ref_stride;
+  }
+  return mcost;
+}
+
+/*!
+***********************************************************************
+* \brief
+*    SSE of a block (see block_sad())
+***********************************************************************
+*/
+static int block_sse (imgpel *src, imgpel *ref, int ref_stride, int width, int height, int imin_cost)
+{
+  int mcost = 0;
+  int x, y;
+
+  for (y = 0; y < height; y++)
+  {
+    for (x = 0; x < width; x++)
+      mcost += iabs2( src[x] - ref[x] );
+    if (mcost > imin_cost)
+      break;
+    src += width;
+    ref += ref_stride;
+  }
+  return mcost;
+}
+
+/*!
+***********************************************************************
+* \brief
+*    SAD of a block against the average of two references (see block_sad())
+***********************************************************************
+*/
+static int block_bi_sad (imgpel *src, imgpel *ref1, imgpel *ref2, int ref_stride, int width, int height, int imin_cost)
+{
+  int mcost = 0;
+  int x, y;
+
+  for (y = 0; y < height; y++)
+  {
+    for (x = 0; x < width; x++)
+      mcost += iabs( src[x] - ((ref1[x] + ref2[x] + 1) >> 1) );
+    if (mcost > imin_cost)
+      break;
+    src  += width;
+    ref1 += ref_stride;
+    ref2 += ref_stride;
+  }
+  return mcost;
+}
+
+/*!
+***********************************************************************
+* \brief
+*    SSE of a block against the average of two references (see block_sad())
+***********************************************************************
+*/
+static int block_bi_sse (imgpel *src, imgpel *ref1, imgpel *ref2, int ref_stride, int width, int height, int imin_cost)
+{
+  int mcost = 0;
+  int x, y;
+
+  for (y = 0; y < height; y++)
+  {
+    for (x = 0; x < width; x++)
+      mcost += iabs2( src[x] - ((ref1[x] + ref2[x] + 1) >> 1) );
+    if (mcost > imin_cost)
+      break;
+    src  += width;
+    ref1 += ref_stride;
+    ref2 += ref_stride;
+  }
+  return mcost;
+}
+
+/*!
+***********************************************************************
+* \brief
+*    SAD of one source block against num reference blocks, all using a
+*    line stride of ref_stride samples. mcost[i] is the SAD of ref[i] if
+*    it does not exceed imin_cost[i]; otherwise it is a partial sum
+*    larger than imin_cost[i], which may differ from the one block_sad()
+*    returns (the SIMD versions test the limits every four lines).
+***********************************************************************
+*/
+static void block_sad_multi (imgpel *src, imgpel **ref, int num, int ref_stride, int width, int height, int *imin_cost, int *mcost)
+{
+  int i;
+
+  for (i = 0; i < num; i++)
+    mcost[i] = block_sad(src, ref[i], ref_stride, width, height, imin_cost[i]);
+}
+
+/*!
+***********************************************************************
+* \brief
+*    SSE of one source block against num reference blocks
+*    (see block_sad_multi())
+***********************************************************************
+*/
+static void block_sse_multi (imgpel *src, imgpel **ref, int num, int ref_stride, int width, int height, int *imin_cost, int *mcost)
+{
+  int i;
+
+  for (i = 0; i < num; i++)
+    mcost[i] = block_sse(src, ref[i], ref_stride, width, height, imin_cost[i]);
+}
+
+/*!
+***********************************************************************
+* \brief
+*    Difference of a size x size block (size = 4 or 8), stored
+*    contiguously in diff
+***********************************************************************
+*/
+static void block_diff (imgpel *src, int src_stride, imgpel *ref, int ref_stride, int size, short *diff)
+{
+  int x, y;
+
+  for (y = 0; y < size; y++)
+  {
+    for (x = 0; x < size; x++)
+      *diff++ = (short) (src[x] - ref[x]);
+    src += src_stride;
+    ref += ref_stride;
+  }
+}
+
+/*!
+***********************************************************************
+* \brief
+*    Difference of a size x size block against the average of two
+*    references
+***********************************************************************
+*/
+static void block_bi_diff (imgpel *src, int src_stride, imgpel *ref1, imgpel *ref2, int ref_stride, int size, short *diff)
+{
+  int x, y;
+
+  for (y = 0; y < size; y++)
+  {
+    for (x = 0; x < size; x++)
+      *diff++ = (short) (src[x] - ((ref1[x] + ref2[x] + 1) >> 1));
+    src  += src_stride;
+    ref1 += ref_stride;
+    ref2 += ref_stride;
+  }
+}
+
+/*!
+***********************************************************************
+* \brief
+*    Sum of absolute values of num difference samples
+***********************************************************************
+*/
+static int diff_sad (short *diff, int num)
+{
+  int distortion = 0, k;
+
+  for (k = 0; k < num; k++)
+    distortion += iabs(diff[k]);
+  return distortion;
+}
+
+/*!
+***********************************************************************
+* \brief
+*    Sum of squares of num difference samples
+***********************************************************************
+*/
+static distblk diff_sse (short *diff, int num)
+{
+  distblk distortion = 0;
+  int k;
+
+  for (k = 0; k < num; k++)
+    distortion += iabs2(diff[k]);
+  return distortion;
+}
+
+/*!
+***********************************************************************
+* \brief
+*    Calculate 4x4 Hadamard-Transformed SAD
+***********************************************************************
+*/
+static int hadamard_sad4x4 (short* diff)
+{
+  int k, satd = 0;
+  int m[16], d[16];
+
+  /*===== hadamard transform =====*/
+  m[ 0] = diff[ 0] + diff[12];
+  m[ 1] = diff[ 1] + diff[13];
+  m[ 2] = diff[ 2] + diff[14];
+  m[ 3] = diff[ 3] + diff[15];
+  m[ 4] = diff[ 4] + diff[ 8];
+  m[ 5] = diff[ 5] + diff[ 9];
+  m[ 6] = diff[ 6] + diff[10];
+  m[ 7] = diff[ 7] + diff[11];
+  m[ 8] = diff[ 4] - diff[ 8];
+  m[ 9] = diff[ 5] - diff[ 9];
+  m[10] = diff[ 6] - diff[10];
+  m[11] = diff[ 7] - diff[11];
+  m[12] = diff[ 0] - diff[12];
+  m[13] = diff[ 1] - diff[13];
+  m[14] = diff[ 2] - diff[14];
+  m[15] = diff[ 3] - diff[15];
+
+  d[ 0] = m[ 0] + m[ 4];
+  d[ 1] = m[ 1] + m[ 5];
+  d[ 2] = m[ 2] + m[ 6];
+  d[ 3] = m[ 3] + m[ 7];
+  d[ 4] = m[ 8] + m[12];
+  d[ 5] = m[ 9] + m[13];
+  d[ 6] = m[10] + m[14];
+  d[ 7] = m[11] + m[15];
+  d[ 8] = m[ 0] - m[ 4];
+  d[ 9] = m[ 1] - m[ 5];
+  d[10] = m[ 2] - m[ 6];
+  d[11] = m[ 3] - m[ 7];
+  d[12] = m[12] - m[ 8];
+  d[13] = m[13] - m[ 9];
+  d[14] = m[14] - m[10];
+  d[15] = m[15] - m[11];
+
+  m[ 0] = d[ 0] + d[ 3];
+  m[ 1] = d[ 1] + d[ 2];
+  m[ 2] = d[ 1] - d[ 2];
+  m[ 3] = d[ 0] - d[ 3];
+  m[ 4] = d[ 4] + d[ 7];
+  m[ 5] = d[ 5] + d[ 6];
+  m[ 6] = d[ 5] - d[ 6];
+  m[ 7] = d[ 4] - d[ 7];
+  m[ 8] = d[ 8] + d[11];
+  m[ 9] = d[ 9] + d[10];
+  m[10] = d[ 9] - d[10];
+  m[11] = d[ 8] - d[11];
+  m[12] = d[12] + d[15];
+  m[13] = d[13] + d[14];
+  m[14] = d[13] - d[14];
+  m[15] = d[12] - d[15];
+
+  d[ 0] = m[ 0] + m[ 1];
+  d[ 1] = m[ 0] - m[ 1];
+  d[ 2] = m[ 2] + m[ 3];
+  d[ 3] = m[ 3] - m[ 2];
+  d[ 4] = m[ 4] + m[ 5];
+  d[ 5] = m[ 4] - m[ 5];
+  d[ 6] = m[ 6] + m[ 7];
+  d[ 7] = m[ 7] - m[ 6];
+  d[ 8] = m[ 8] + m[ 9];
+  d[ 9] = m[ 8] - m[ 9];
+  d[10] = m[10] + m[11];
+  d[11] = m[11] - m[10];
+  d[12] = m[12] + m[13];
+  d[13] = m[12] - m[13];
+  d[14] = m[14] + m[15];
+  d[15] = m[15] - m[14];
+
+  //===== sum up =====
+  for (k=0; k<16; ++k)
+  {
+    satd += iabs(d [k]);
+  }
+
+  return ((satd+1)>>1);
+}
+
+/*!
+***********************************************************************
+* \brief
+*    Calculate 8x8 Hadamard-Transformed SAD
+***********************************************************************
+*/
+static int hadamard_sad8x8 (short* diff)
+{
+  int i, j, jj, sad=0;
+
+  // Hadamard related arrays
+  int m1[8][8], m2[8][8], m3[8][8];
+
+  //horizontal
+  for (j=0; j < 8; j++)
+  {
+    jj = j << 3;
+    m2[j][0] = diff[jj  ] + diff[jj+4];
+    m2[j][1] = diff[jj+1] + diff[jj+5];
+    m2[j][2] = diff[jj+2] + diff[jj+6];
+    m2[j][3] = diff[jj+3] + diff[jj+7];
+    m2[j][4] = diff[jj  ] - diff[jj+4];
+    m2[j][5] = diff[jj+1] - diff[jj+5];
+    m2[j][6] = diff[jj+2] - diff[jj+6];
+    m2[j][7] = diff[jj+3] - diff[jj+7];
+
+    m1[j][0] = m2[j][0] + m2[j][2];
+    m1[j][1] = m2[j][1] + m2[j][3];
+    m1[j][2] = m2[j][0] - m2[j][2];
+    m1[j][3] = m2[j][1] - m2[j][3];
+    m1[j][4] = m2[j][4] + m2[j][6];
+    m1[j][5] = m2[j][5] + m2[j][7];
+    m1[j][6] = m2[j][4] - m2[j][6];
+    m1[j][7] = m2[j][5] - m2[j][7];
+
+    m2[j][0] = m1[j][0] + m1[j][1];
+    m2[j][1] = m1[j][0] - m1[j][1];
+    m2[j][2] = m1[j][2] + m1[j][3];
+    m2[j][3] = m1[j][2] - m1[j][3];
+    m2[j][4] = m1[j][4] + m1[j][5];
+    m2[j][5] = m1[j][4] - m1[j][5];
+    m2[j][6] = m1[j][6] + m1[j][7];
+    m2[j][7] = m1[j][6] - m1[j][7];
+  }
+
+  //vertical
+  for (i=0; i < 8; i++)
+  {
+    m3[0][i] = m2[0][i] + m2[4][i];
+    m3[1][i] = m2[1][i] + m2[5][i];
+    m3[2][i] = m2[2][i] + m2[6][i];
+    m3[3][i] = m2[3][i] + m2[7][i];
+    m3[4][i] = m2[0][i] - m2[4][i];
+    m3[5][i] = m2[1][i] - m2[5][i];
+    m3[6][i] = m2[2][i] - m2[6][i];
+    m3[7][i] = m2[3][i] - m2[7][i];
+
+    m1[0][i] = m3[0][i] + m3[2][i];
+    m1[1][i] = m3[1][i] + m3[3][i];
+    m1[2][i] = m3[0][i] - m3[2][i];
+    m1[3][i] = m3[1][i] - m3[3][i];
+    m1[4][i] = m3[4][i] + m3[6][i];
+    m1[5][i] = m3[5][i] + m3[7][i];
+    m1[6][i] = m3[4][i] - m3[6][i];
+    m1[7][i] = m3[5][i] - m3[7][i];
+
+    m2[0][i] = m1[0][i] + m1[1][i];
+    m2[1][i] = m1[0][i] - m1[1][i];
+    m2[2][i] = m1[2][i] + m1[3][i];
+    m2[3][i] = m1[2][i] - m1[3][i];
+    m2[4][i] = m1[4][i] + m1[5][i];
+    m2[5][i] = m1[4][i] - m1[5][i];
+    m2[6][i] = m1[6][i] + m1[7][i];
+    m2[7][i] = m1[6][i] - m1[7][i];
+  }
+  for (j=0; j < 8; j++)
+    for (i=0; i < 8; i++)
+      sad += iabs (m2[j][i]);
+
+  return ((sad+2)>>2);
+}
+
+#if (SIMD_X86)
+/*
+ * x86 kernels
+ *
+ * Samples are processed as 16 bit integers, loaded 4 or 8 (SSE4.1) or 16
+ * (AVX2) at a time, for both 8 bit (IMGTYPE 0) and 16 bit imgpel. Sample
+ * differences therefore always fit into 16 bits and squared differences
+ * into 32 bits. Block widths that are not a multiple of 4 (e.g. 2 sample
+ * wide 4:2:0 chroma blocks) use the C kernels.
+ *
+ * The Hadamard transforms work on 32 bit lanes and are exact for all bit
+ * depths. The order in which rows and columns are transformed does not
+ * change the transform coefficients (only their position and sign), so
+ * the sum of absolute values equals the one of the C version.
+ */
+
+#if (IMGTYPE == 0)
+static inline TARGET_SSE41 __m128i load_pel4 (imgpel *p)
+{
+  int v;
+  memcpy(&v, p, sizeof(v));
+  return _mm_cvtepu8_epi16(_mm_cvtsi32_si128(v));
+}
+
+static inline TARGET_SSE41 __m128i load_pel8 (imgpel *p)
+{
+  return _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i *) p));
+}
+
+static inline TARGET_AVX2 __m256i load_pel16 (imgpel *p)
+{
+  return _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) p));
+}
+#else
+static inline TARGET_SSE41 __m128i load_pel4 (imgpel *p)
+{
+  return _mm_loadl_epi64((__m128i *) p);
+}
+
+static inline TARGET_SSE41 __m128i load_pel8 (imgpel *p)
+{
+  return _mm_loadu_si128((__m128i *) p);
+}
+
+static inline TARGET_AVX2 __m256i load_pel16 (imgpel *p)
+{
+  return _mm256_loadu_si256((__m256i *) p);
+}
+#endif
+
+static inline TARGET_SSE41 int hsum_epi32 (__m128i v)
+{
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(v);
+}
+
+static inline TARGET_AVX2 int hsum256_epi32 (__m256i v)
+{
+  return hsum_epi32(_mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+// difference of one line of width samples (4, 8, 12, 16, ...) and its SAD / SSE as 4 x 32 bit
+static inline TARGET_SSE41 __m128i line_sad_sse41 (__m128i s, __m128i r, __m128i acc)
+{
+  return _mm_add_epi32(acc, _mm_madd_epi16(_mm_abs_epi16(_mm_sub_epi16(s, r)), _mm_set1_epi16(1)));
+}
+
+static inline TARGET_SSE41 __m128i line_sse_sse41 (__m128i s, __m128i r, __m128i acc)
+{
+  __m128i d = _mm_sub_epi16(s, r);
+  return _mm_add_epi32(acc, _mm_madd_epi16(d, d));
+}
+
+static TARGET_SSE41 int block_sad_sse41 (imgpel *src, imgpel *ref, int ref_stride, int width, int height, int imin_cost)
+{
+  int mcost = 0;
+  int x, y;
+
+  if (width & 0x03)
+    return block_sad(src, ref, ref_stride, width, height, imin_cost);
+
+  for (y = 0; y < height; y++)
+  {
+    __m128i acc = _mm_setzero_si128();
+    for (x = 0; x + 8 <= width; x += 8)
+      acc = line_sad_sse41(load_pel8(src + x), load_pel8(ref + x), acc);
+    if (x < width)
+      acc = line_sad_sse41(load_pel4(src + x), load_pel4(ref + x), acc);
+    mcost += hsum_epi32(acc);
+    if (mcost > imin_cost)
+      break;
+    src += width;
+    ref += ref_stride;
+  }
+  return mcost;
+}
+
+static TARGET_SSE41 int block_sse_sse41 (imgpel *src, imgpel *ref, int ref_stride, int width, int height, int imin_cost)
+{
+  int mcost = 0;
+  int x, y;
+
+  if (width & 0x03)
+    return block_sse(src, ref, ref_stride, width, height, imin_cost);
+
+  for (y = 0; y < height; y++)
+  {
+    __m128i acc = _mm_setzero_si128();
+    for (x = 0; x + 8 <= width; x += 8)
+      acc = line_sse_sse41(load_pel8(src + x), load_pel8(ref + x), acc);
+    if (x < width)
+      acc = line_sse_sse41(load_pel4(src + x), load_pel4(ref + x), acc);
+    mcost += hsum_epi32(acc);
+    if (mcost > imin_cost)
+      break;
+    src += width;
+    ref += ref_stride;
+  }
+  return mcost;
+}
+
+// Multiple candidate versions. Four candidates are processed together; their
+// line sums are kept in vector accumulators and only reduced and compared
+// against the limits after every fourth line. A terminated candidate thus
+// returns a sum of up to three more lines than block_sad() (still larger
+// than its limit). width is a compile time constant after inlining.
+static inline TARGET_SSE41 void block_multi4_sse41 (imgpel *src, imgpel **ref, int ref_stride, int width, int height,
+                                                    __m128i limit, int *mcost, int square)
+{
+  __m128i sum = _mm_setzero_si128();
+  int j, k, x, y;
+
+  for (y = 0; y < height; y += 4)
+  {
+    __m128i acc[4];
+
+    for (k = 0; k < 4; k++)
+      acc[k] = _mm_setzero_si128();
+
+    for (j = 0; j < 4; j++)
+    {
+      for (x = 0; x < width; x += 8)
+      {
+        __m128i s = (width == 4) ? load_pel4(src + x) : load_pel8(src + x);
+
+        for (k = 0; k < 4; k++)
+        {
+          __m128i r = (width == 4) ? load_pel4(ref[k] + x) : load_pel8(ref[k] + x);
+          acc[k] = square ? line_sse_sse41(s, r, acc[k]) : line_sad_sse41(s, r, acc[k]);
+        }
+      }
+      src += width;
+      for (k = 0; k < 4; k++)
+        ref[k] += ref_stride;
+    }
+
+    sum = _mm_add_epi32(sum, _mm_hadd_epi32(_mm_hadd_epi32(acc[0], acc[1]), _mm_hadd_epi32(acc[2], acc[3])));
+    if (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(sum, limit))) == 0x0f)
+      break;
+  }
+  _mm_storeu_si128((__m128i *) mcost, sum);
+}
+
+static inline TARGET_SSE41 void block_multi_sse41 (imgpel *src, imgpel **ref, int num, int ref_stride, int width, int height,
+                                                   int *imin_cost, int *mcost, int square)
+{
+  int i, k;
+
+  for (i = 0; i < num; i += 4)
+  {
+    imgpel *r[4];
+    int lim[4], cost[4];
+
+    // unused slots repeat the first candidate with a limit that terminates them
+    for (k = 0; k < 4; k++)
+    {
+      r[k]   = ref[(i + k < num) ? i + k : i];
+      lim[k] = (i + k < num) ? imin_cost[i + k] : -1;
+    }
+
+    if (width == 16)
+      block_multi4_sse41(src, r, ref_stride, 16, height, _mm_loadu_si128((__m128i *) lim), cost, square);
+    else if (width == 8)
+      block_multi4_sse41(src, r, ref_stride,  8, height, _mm_loadu_si128((__m128i *) lim), cost, square);
+    else
+      block_multi4_sse41(src, r, ref_stride,  4, height, _mm_loadu_si128((__m128i *) lim), cost, square);
+
+    for (k = 0; k < 4 && i + k < num; k++)
+      mcost[i + k] = cost[k];
+  }
+}
+
+static TARGET_SSE41 void block_sad_multi_sse41 (imgpel *src, imgpel **ref, int num, int ref_stride, int width, int height, int *imin_cost, int *mcost)
+{
+  if ((width != 4 && width != 8 && width != 16) || (height & 0x03))
+    block_sad_multi(src, ref, num, ref_stride, width, height, imin_cost, mcost);
+  else
+    block_multi_sse41(src, ref, num, ref_stride, width, height, imin_cost, mcost, 0);
+}
+
+static TARGET_SSE41 void block_sse_multi_sse41 (imgpel *src, imgpel **ref, int num, int ref_stride, int width, int height, int *imin_cost, int *mcost)
+{
+  if ((width != 4 && width != 8 && width != 16) || (height & 0x03))
+    block_sse_multi(src, ref, num, ref_stride, width, height, imin_cost, mcost);
+  else
+    block_multi_sse41(src, ref, num, ref_stride, width, height, imin_cost, mcost, 1);
+}
+
+static TARGET_SSE41 int block_bi_sad_sse41 (imgpel *src, imgpel *ref1, imgpel *ref2, int ref_stride, int width, int height, int imin_cost)
+{
+  int mcost = 0;
+  int x, y;
+
+  if (width & 0x03)
+    return block_bi_sad(src, ref1, ref2, ref_stride, width, height, imin_cost);
+
+  for (y = 0; y < height; y++)
+  {
+    __m128i acc = _mm_setzero_si128();
+    for (x = 0; x + 8 <= width; x += 8)
+      acc = line_sad_sse41(load_pel8(src + x), _mm_avg_epu16(load_pel8(ref1 + x), load_pel8(ref2 + x)), acc);
+    if (x < width)
+      acc = line_sad_sse41(load_pel4(src + x), _mm_avg_epu16(load_pel4(ref1 + x), load_pel4(ref2 + x)), acc);
+    mcost += hsum_epi32(acc);
+    if (mcost > imin_cost)
+      break;
+    src  += width;
+    ref1 += ref_stride;
+    ref2 += ref_stride;
+  }
+  return mcost;
+}
+
+static TARGET_SSE41 int block_bi_sse_sse41 (imgpel *src, imgpel *ref1, imgpel *ref2, int ref_stride, int width, int height, int imin_cost)
+{
+  int mcost = 0;
+  int x, y;
+
+  if (width & 0x03)
+    return block_bi_sse(src, ref1, ref2, ref_stride, width, height, imin_cost);
+
+  for (y = 0; y < height; y++)
+  {
+    __m128i acc = _mm_setzero_si128();
+    for (x = 0; x + 8 <= width; x += 8)
+      acc = line_sse_sse41(load_pel8(src + x), _mm_avg_epu16(load_pel8(ref1 + x), load_pel8(ref2 + x)), acc);
+    if (x < width)
+      acc = line_sse_sse41(load_pel4(src + x), _mm_avg_epu16(load_pel4(ref1 + x), load_pel4(ref2 + x)), acc);
+    mcost += hsum_epi32(acc);
+    if (mcost > imin_cost)
+      break;
+    src  += width;
+    ref1 += ref_stride;
+    ref2 += ref_stride;
+  }
+  return mcost;
+}
+
+static TARGET_SSE41 void block_diff_sse41 (imgpel *src, int src_stride, imgpel *ref, int ref_stride, int size, short *diff)
+{
+  int y;
+
+  if (size == 4)
+  {
+    for (y = 0; y < 4; y++, diff += 4)
+    {
+      _mm_storel_epi64((__m128i *) diff, _mm_sub_epi16(load_pel4(src), load_pel4(ref)));
+      src += src_stride;
+      ref += ref_stride;
+    }
+  }
+  else
+  {
+    for (y = 0; y < 8; y++, diff += 8)
+    {
+      _mm_storeu_si128((__m128i *) diff, _mm_sub_epi16(load_pel8(src), load_pel8(ref)));
+      src += src_stride;
+      ref += ref_stride;
+    }
+  }
+}
+
+static TARGET_SSE41 void block_bi_diff_sse41 (imgpel *src, int src_stride, imgpel *ref1, imgpel *ref2, int ref_stride, int size, short *diff)
+{
+  int y;
+
+  if (size == 4)
+  {
+    for (y = 0; y < 4; y++, diff += 4)
+    {
+      _mm_storel_epi64((__m128i *) diff, _mm_sub_epi16(load_pel4(src), _mm_avg_epu16(load_pel4(ref1), load_pel4(ref2))));
+      src  += src_stride;
+      ref1 += ref_stride;
+      ref2 += ref_stride;
+    }
+  }
+  else
+  {
+    for (y = 0; y < 8; y++, diff += 8)
+    {
+      _mm_storeu_si128((__m128i *) diff, _mm_sub_epi16(load_pel8(src), _mm_avg_epu16(load_pel8(ref1), load_pel8(ref2))));
+      src  += src_stride;
+      ref1 += ref_stride;
+      ref2 += ref_stride;
+    }
+  }
+}
+
+static TARGET_SSE41 int diff_sad_sse41 (short *diff, int num)
+{
+  __m128i acc = _mm_setzero_si128();
+  int k;
+
+  for (k = 0; k + 8 <= num; k += 8)
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_abs_epi16(_mm_loadu_si128((__m128i *) (diff + k))), _mm_set1_epi16(1)));
+  return hsum_epi32(acc) + diff_sad(diff + k, num - k);
+}
+
+static TARGET_SSE41 distblk diff_sse_sse41 (short *diff, int num)
+{
+  __m128i acc = _mm_setzero_si128();
+  int k;
+
+  // squares of two 16 bit samples are added in 32 bits, the sums are accumulated in 64 bits
+  for (k = 0; k + 8 <= num; k += 8)
+  {
+    __m128i d = _mm_loadu_si128((__m128i *) (diff + k));
+    __m128i s = _mm_madd_epi16(d, d);
+    acc = _mm_add_epi64(acc, _mm_add_epi64(_mm_cvtepu32_epi64(s), _mm_cvtepu32_epi64(_mm_srli_si128(s, 8))));
+  }
+  acc = _mm_add_epi64(acc, _mm_srli_si128(acc, 8));
+#if defined(__x86_64__) || defined(_M_X64)
+  return (distblk) _mm_cvtsi128_si64(acc) + diff_sse(diff + k, num - k);
+#else
+  {
+    int64 sum;
+    _mm_storel_epi64((__m128i *) &sum, acc);
+    return (distblk) sum + diff_sse(diff + k, num - k);
+  }
+#endif
+}
+
+// 4 point Hadamard transform of 4 lines (rows or columns) held in r[0..3]
+static inline TARGET_SSE41 void hadamard4_sse41 (__m128i *r)
+{
+  __m128i t0 = _mm_add_epi32(r[0], r[3]);
+  __m128i t1 = _mm_add_epi32(r[1], r[2]);
+  __m128i t2 = _mm_sub_epi32(r[1], r[2]);
+  __m128i t3 = _mm_sub_epi32(r[0], r[3]);
+
+  r[0] = _mm_add_epi32(t0, t1);
+  r[1] = _mm_sub_epi32(t0, t1);
+  r[2] = _mm_add_epi32(t3, t2);
+  r[3] = _mm_sub_epi32(t3, t2);
+}
+
+// transpose of the 4x4 matrix of 32 bit samples held in r[0..3]
+static inline TARGET_SSE41 void transpose4_sse41 (__m128i *r)
+{
+  __m128i t0 = _mm_unpacklo_epi32(r[0], r[1]);
+  __m128i t1 = _mm_unpacklo_epi32(r[2], r[3]);
+  __m128i t2 = _mm_unpackhi_epi32(r[0], r[1]);
+  __m128i t3 = _mm_unpackhi_epi32(r[2], r[3]);
+
+  r[0] = _mm_unpacklo_epi64(t0, t1);
+  r[1] = _mm_unpackhi_epi64(t0, t1);
+  r[2] = _mm_unpacklo_epi64(t2, t3);
+  r[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+static TARGET_SSE41 int hadamard_sad4x4_sse41 (short* diff)
+{
+  __m128i r[4], sum;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    r[i] = _mm_cvtepi16_epi32(_mm_loadl_epi64((__m128i *) (diff + 4 * i)));
+
+  hadamard4_sse41(r);
+  transpose4_sse41(r);
+  hadamard4_sse41(r);
+
+  sum = _mm_add_epi32(_mm_add_epi32(_mm_abs_epi32(r[0]), _mm_abs_epi32(r[1])), _mm_add_epi32(_mm_abs_epi32(r[2]), _mm_abs_epi32(r[3])));
+  return ((hsum_epi32(sum) + 1) >> 1);
+}
+
+// 8 point Hadamard transform of 8 lines (rows or columns) held in r[0..7]
+static inline TARGET_SSE41 void hadamard8_sse41 (__m128i *r)
+{
+  __m128i t[8];
+  int i;
+
+  for (i = 0; i < 4; i++)
+  {
+    t[i    ] = _mm_add_epi32(r[i], r[i + 4]);
+    t[i + 4] = _mm_sub_epi32(r[i], r[i + 4]);
+  }
+  for (i = 0; i < 8; i += 4)
+  {
+    r[i    ] = _mm_add_epi32(t[i    ], t[i + 2]);
+    r[i + 1] = _mm_add_epi32(t[i + 1], t[i + 3]);
+    r[i + 2] = _mm_sub_epi32(t[i    ], t[i + 2]);
+    r[i + 3] = _mm_sub_epi32(t[i + 1], t[i + 3]);
+  }
+  for (i = 0; i < 8; i += 2)
+  {
+    t[i    ] = _mm_add_epi32(r[i], r[i + 1]);
+    t[i + 1] = _mm_sub_epi32(r[i], r[i + 1]);
+  }
+  for (i = 0; i < 8; i++)
+    r[i] = t[i];
+}
+
+static TARGET_SSE41 int hadamard_sad8x8_sse41 (short* diff)
+{
+  // lo[j] / hi[j] hold columns 0..3 / 4..7 of line j
+  __m128i lo[8], hi[8], t[4], sum;
+  int i;
+
+  for (i = 0; i < 8; i++)
+  {
+    __m128i d = _mm_loadu_si128((__m128i *) (diff + 8 * i));
+    lo[i] = _mm_cvtepi16_epi32(d);
+    hi[i] = _mm_cvtepi16_epi32(_mm_srli_si128(d, 8));
+  }
+
+  // vertical
+  hadamard8_sse41(lo);
+  hadamard8_sse41(hi);
+
+  // transpose the four 4x4 quadrants and swap the off diagonal ones
+  transpose4_sse41(lo);
+  transpose4_sse41(lo + 4);
+  transpose4_sse41(hi);
+  transpose4_sse41(hi + 4);
+  for (i = 0; i < 4; i++)
+  {
+    t[i]      = lo[i + 4];
+    lo[i + 4] = hi[i];
+    hi[i]     = t[i];
+  }
+
+  // horizontal
+  hadamard8_sse41(lo);
+  hadamard8_sse41(hi);
+
+  sum = _mm_setzero_si128();
+  for (i = 0; i < 8; i++)
+    sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_abs_epi32(lo[i]), _mm_abs_epi32(hi[i])));
+  return ((hsum_epi32(sum) + 2) >> 2);
+}
+
+// AVX2 versions of the kernels for 16 sample wide blocks and of the 8x8 Hadamard SAD
+static inline TARGET_AVX2 __m256i line16_sad_avx2 (__m256i s, __m256i r)
+{
+  return _mm256_madd_epi16(_mm256_abs_epi16(_mm256_sub_epi16(s, r)), _mm256_set1_epi16(1));
+}
+
+static inline TARGET_AVX2 __m256i line16_sse_avx2 (__m256i s, __m256i r)
+{
+  __m256i d = _mm256_sub_epi16(s, r);
+  return _mm256_madd_epi16(d, d);
+}
+
+static TARGET_AVX2 int block_sad_avx2 (imgpel *src, imgpel *ref, int ref_stride, int width, int height, int imin_cost)
+{
+  int mcost = 0;
+  int y;
+
+  if (width != 16)
+    return block_sad_sse41(src, ref, ref_stride, width, height, imin_cost);
+
+  for (y = 0; y < height; y++)
+  {
+    mcost += hsum256_epi32(line16_sad_avx2(load_pel16(src), load_pel16(ref)));
+    if (mcost > imin_cost)
+      break;
+    src += 16;
+    ref += ref_stride;
+  }
+  return mcost;
+}
+
+static TARGET_AVX2 int block_sse_avx2 (imgpel *src, imgpel *ref, int ref_stride, int width, int height, int imin_cost)
+{
+  int mcost = 0;
+  int y;
+
+  if (width != 16)
+    return block_sse_sse41(src, ref, ref_stride, width, height, imin_cost);
+
+  for (y = 0; y < height; y++)
+  {
+    mcost += hsum256_epi32(line16_sse_avx2(load_pel16(src), load_pel16(ref)));
+    if (mcost > imin_cost)
+      break;
+    src += 16;
+    ref += ref_stride;
+  }
+  return mcost;
+}
+
+static TARGET_AVX2 int block_bi_sad_avx2 (imgpel *src, imgpel *ref1, imgpel *ref2, int ref_stride, int width, int height, int imin_cost)
+{
+  int mcost = 0;
+  int y;
+
+  if (width != 16)
+    return block_bi_sad_sse41(src, ref1, ref2, ref_stride, width, height, imin_cost);
+
+  for (y = 0; y < height; y++)
+  {
+    mcost += hsum256_epi32(line16_sad_avx2(load_pel16(src), _mm256_avg_epu16(load_pel16(ref1), load_pel16(ref2))));
+    if (mcost > imin_cost)
+      break;
+    src  += 16;
+    ref1 += ref_stride;
+    ref2 += ref_stride;
+  }
+  return mcost;
+}
+
+static TARGET_AVX2 int block_bi_sse_avx2 (imgpel *src, imgpel *ref1, imgpel *ref2, int ref_stride, int width, int height, int imin_cost)
+{
+  int mcost = 0;
+  int y;
+
+  if (width != 16)
+    return block_bi_sse_sse41(src, ref1, ref2, ref_stride, width, height, imin_cost);
+
+  for (y = 0; y < height; y++)
+  {
+    mcost += hsum256_epi32(line16_sse_avx2(load_pel16(src), _mm256_avg_epu16(load_pel16(ref1), load_pel16(ref2))));
+    if (mcost > imin_cost)
+      break;
+    src  += 16;
+    ref1 += ref_stride;
+    ref2 += ref_stride;
+  }
+  return mcost;
+}
+
+static inline TARGET_AVX2 void block_multi4_avx2 (imgpel *src, imgpel **ref, int ref_stride, int height,
+                                                  __m128i limit, int *mcost, int square)
+{
+  __m128i sum = _mm_setzero_si128();
+  int j, k, y;
+
+  for (y = 0; y < height; y += 4)
+  {
+    __m256i acc[4];
+
+    for (k = 0; k < 4; k++)
+      acc[k] = _mm256_setzero_si256();
+
+    for (j = 0; j < 4; j++)
+    {
+      __m256i s = load_pel16(src);
+
+      for (k = 0; k < 4; k++)
+      {
+        __m256i r = load_pel16(ref[k]);
+        acc[k] = _mm256_add_epi32(acc[k], square ? line16_sse_avx2(s, r) : line16_sad_avx2(s, r));
+        ref[k] += ref_stride;
+      }
+      src += 16;
+    }
+
+    {
+      __m256i t = _mm256_hadd_epi32(_mm256_hadd_epi32(acc[0], acc[1]), _mm256_hadd_epi32(acc[2], acc[3]));
+      sum = _mm_add_epi32(sum, _mm_add_epi32(_mm256_castsi256_si128(t), _mm256_extracti128_si256(t, 1)));
+    }
+    if (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(sum, limit))) == 0x0f)
+      break;
+  }
+  _mm_storeu_si128((__m128i *) mcost, sum);
+}
+
+static inline TARGET_AVX2 void block_multi_avx2 (imgpel *src, imgpel **ref, int num, int ref_stride, int height,
+                                                 int *imin_cost, int *mcost, int square)
+{
+  int i, k;
+
+  for (i = 0; i < num; i += 4)
+  {
+    imgpel *r[4];
+    int lim[4], cost[4];
+
+    for (k = 0; k < 4; k++)
+    {
+      r[k]   = ref[(i + k < num) ? i + k : i];
+      lim[k] = (i + k < num) ? imin_cost[i + k] : -1;
+    }
+
+    block_multi4_avx2(src, r, ref_stride, height, _mm_loadu_si128((__m128i *) lim), cost, square);
+
+    for (k = 0; k < 4 && i + k < num; k++)
+      mcost[i + k] = cost[k];
+  }
+}
+
+static TARGET_AVX2 void block_sad_multi_avx2 (imgpel *src, imgpel **ref, int num, int ref_stride, int width, int height, int *imin_cost, int *mcost)
+{
+  if (width != 16 || (height & 0x03))
+    block_sad_multi_sse41(src, ref, num, ref_stride, width, height, imin_cost, mcost);
+  else
+    block_multi_avx2(src, ref, num, ref_stride, height, imin_cost, mcost, 0);
+}
+
+static TARGET_AVX2 void block_sse_multi_avx2 (imgpel *src, imgpel **ref, int num, int ref_stride, int width, int height, int *imin_cost, int *mcost)
+{
+  if (width != 16 || (height & 0x03))
+    block_sse_multi_sse41(src, ref, num, ref_stride, width, height, imin_cost, mcost);
+  else
+    block_multi_avx2(src, ref, num, ref_stride, height, imin_cost, mcost, 1);
+}
+
+// 8 point Hadamard transform of 8 lines (rows or columns) held in r[0..7]
+static inline TARGET_AVX2 void hadamard8_avx2 (__m256i *r)
+{
+  __m256i t[8];
+  int i;
+
+  for (i = 0; i < 4; i++)
+  {
+    t[i    ] = _mm256_add_epi32(r[i], r[i + 4]);
+    t[i + 4] = _mm256_sub_epi32(r[i], r[i + 4]);
+  }
+  for (i = 0; i < 8; i += 4)
+  {
+    r[i    ] = _mm256_add_epi32(t[i    ], t[i + 2]);
+    r[i + 1] = _mm256_add_epi32(t[i + 1], t[i + 3]);
+    r[i + 2] = _mm256_sub_epi32(t[i    ], t[i + 2]);
+    r[i + 3] = _mm256_sub_epi32(t[i + 1], t[i + 3]);
+  }
+  for (i = 0; i < 8; i += 2)
+  {
+    t[i    ] = _mm256_add_epi32(r[i], r[i + 1]);
+    t[i + 1] = _mm256_sub_epi32(r[i], r[i + 1]);
+  }
+  for (i = 0; i < 8; i++)
+    r[i] = t[i];
+}
+
+static TARGET_AVX2 int hadamard_sad8x8_avx2 (short* diff)
+{
+  __m256i r[8], t[8], sum;
+  int i;
+
+  for (i = 0; i < 8; i++)
+    r[i] = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i *) (diff + 8 * i)));
+
+  // vertical
+  hadamard8_avx2(r);
+
+  // transpose
+  for (i = 0; i < 8; i += 2)
+  {
+    t[i    ] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+    t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+  }
+  for (i = 0; i < 8; i += 4)
+  {
+    r[i    ] = _mm256_unpacklo_epi64(t[i    ], t[i + 2]);
+    r[i + 1] = _mm256_unpackhi_epi64(t[i    ], t[i + 2]);
+    r[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+    r[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+  }
+  for (i = 0; i < 4; i++)
+  {
+    t[i    ] = _mm256_permute2x128_si256(r[i], r[i + 4], 0x20);
+    t[i + 4] = _mm256_permute2x128_si256(r[i], r[i + 4], 0x31);
+  }
+
+  // horizontal
+  hadamard8_avx2(t);
+
+  sum = _mm256_setzero_si256();
+  for (i = 0; i < 8; i++)
+    sum = _mm256_add_epi32(sum, _mm256_abs_epi32(t[i]));
+  return ((hsum256_epi32(sum) + 2) >> 2);
+}
+
+/*!
+***********************************************************************
+* \brief
+*    Returns the instruction set extensions supported by the CPU
+*    (SIMD_NONE, SIMD_SSE41 or SIMD_AVX2)
+***********************************************************************
+*/
+static int get_simd_level (void)
+{
+#if defined(_MSC_VER)
+  int info[4];
+  int max_id;
+
+  __cpuid(info, 0);
+  max_id = info[0];
+  __cpuid(info, 1);
+  if (!(info[2] & (1 << 19)))
+    return SIMD_NONE;
+  // AVX2 also requires the OS to save the YMM registers (OSXSAVE, AVX and XCR0 bits 1 and 2)
+  if (max_id >= 7 && (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 0x06) == 0x06))
+  {
+    __cpuidex(info, 7, 0);
+    if (info[1] & (1 << 5))
+      return SIMD_AVX2;
+  }
+  return SIMD_SSE41;
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return SIMD_AVX2;
+  if (__builtin_cpu_supports("sse4.1"))
+    return SIMD_SSE41;
+  return SIMD_NONE;
+#endif
+}
+#endif
+
+/*!
+***********************************************************************
+* \brief
+*    Selects the distortion kernels. The fastest kernels supported by
+*    the CPU are used unless max_level limits the instruction set
+*    extensions (SIMD_NONE selects the C kernels).
+*    Returns the selected level.
+***********************************************************************
+*/
+int init_distortion_kernels (int max_level)
+{
+  int level = SIMD_NONE;
+
+  dist_kernels.sad         = block_sad;
+  dist_kernels.sse         = block_sse;
+  dist_kernels.sad_multi   = block_sad_multi;
+  dist_kernels.sse_multi   = block_sse_multi;
+  dist_kernels.bi_sad      = block_bi_sad;
+  dist_kernels.bi_sse      = block_bi_sse;
+  dist_kernels.diff        = block_diff;
+  dist_kernels.bi_diff     = block_bi_diff;
+  dist_kernels.diff_sad    = diff_sad;
+  dist_kernels.diff_sse    = diff_sse;
+  dist_kernels.hadamard4x4 = hadamard_sad4x4;
+  dist_kernels.hadamard8x8 = hadamard_sad8x8;
+
+#if (SIMD_X86)
+  level = imin(get_simd_level(), max_level);
+
+  if (level >= SIMD_SSE41)
+  {
+    dist_kernels.sad         = block_sad_sse41;
+    dist_kernels.sse         = block_sse_sse41;
+    dist_kernels.sad_multi   = block_sad_multi_sse41;
+    dist_kernels.sse_multi   = block_sse_multi_sse41;
+    dist_kernels.bi_sad      = block_bi_sad_sse41;
+    dist_kernels.bi_sse      = block_bi_sse_sse41;
+    dist_kernels.diff        = block_diff_sse41;
+    dist_kernels.bi_diff     = block_bi_diff_sse41;
+    dist_kernels.diff_sad    = diff_sad_sse41;
+    dist_kernels.diff_sse    = diff_sse_sse41;
+    dist_kernels.hadamard4x4 = hadamard_sad4x4_sse41;
+    dist_kernels.hadamard8x8 = hadamard_sad8x8_sse41;
+  }
+  if (level >= SIMD_AVX2)
+  {
+    dist_kernels.sad         = block_sad_avx2;
+    dist_kernels.sse         = block_sse_avx2;
+    dist_kernels.sad_multi   = block_sad_multi_avx2;
+    dist_kernels.sse_multi   = block_sse_multi_avx2;
+    dist_kernels.bi_sad      = block_bi_sad_avx2;
+    dist_kernels.bi_sse      = block_bi_sse_avx2;
+    dist_kernels.hadamard8x8 = hadamard_sad8x8_avx2;
+  }
+#endif
+
+  return level;
+}
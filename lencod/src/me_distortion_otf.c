@@ -40,44 +40,22 @@ distblk computeSAD_otf(StorablePicture *ref1,
                distblk min_mcost,
                MotionVector *cand)
 {
-  int mcost = 0;
+  int mcost;
   int imin_cost = dist_down(min_mcost);
-  int y,x;
   short blocksize_x = mv_block->blocksize_x;
   short blocksize_y = mv_block->blocksize_y;
   VideoParameters *p_Vid = mv_block->p_Vid;
   DecodedPictureBuffer *p_Dpb = p_Vid->p_Dpb_layer[p_Vid->dpb_layer_id];
-#if (JM_MEM_DISTORTION)
-  int *imgpel_abs = p_Vid->imgpel_abs;
-#endif
-  imgpel  *src_line, *ref_line ; 
   imgpel  data[MB_PIXELS];                                  // local allocation could be optimized by a global instanciation
   int     tmp_line[ (MB_BLOCK_SIZE+5)*(MB_BLOCK_SIZE+5) ] ;
   
-  src_line = mv_block->orig_pic[0];
-  ref_line = data ;
   // get block with interpolation on-the-fly
-  p_Dpb->pf_get_block_luma( p_Vid, ref_line, tmp_line, cand->mv_x, cand->mv_y, blocksize_x, blocksize_y, ref1, 0 )  ;
+  p_Dpb->pf_get_block_luma( p_Vid, data, tmp_line, cand->mv_x, cand->mv_y, blocksize_x, blocksize_y, ref1, 0 )  ;
+
+  mcost = dist_kernels.sad(mv_block->orig_pic[0], data, blocksize_x, blocksize_x, blocksize_y, imin_cost);
+  if(mcost > imin_cost) 
+    return (dist_scale_f((distblk)mcost));
 
-  for (y=0; y<blocksize_y; y++)
-  {
-    for (x = 0; x < blocksize_x; x+=4)
-    {
-#if (JM_MEM_DISTORTION)
-      mcost += imgpel_abs[ *src_line++ - *ref_line++ ];
-      mcost += imgpel_abs[ *src_line++ - *ref_line++ ];
-      mcost += imgpel_abs[ *src_line++ - *ref_line++ ];
-      mcost += imgpel_abs[ *src_line++ - *ref_line++ ];
-#else
-      mcost += iabs( *src_line++ - *ref_line++ );
-      mcost += iabs( *src_line++ - *ref_line++ );
-      mcost += iabs( *src_line++ - *ref_line++ );
-      mcost += iabs( *src_line++ - *ref_line++ );
-#endif
-    }
-    if(mcost > imin_cost) 
-      return (dist_scale_f((distblk)mcost));
-  }
   if ( mv_block->ChromaMEEnable ) 
   {
     // calculate chroma conribution to motion compensation error
@@ -88,24 +66,8 @@ distblk computeSAD_otf(StorablePicture *ref1,
 
     for (k=0; k < 2; k++)
     {
-      src_line = mv_block->orig_pic[k+1];
-      ref_line = data ;
-      p_Dpb->pf_get_block_chroma[OTF_ME]( p_Vid, ref_line, tmp_line, cand->mv_x, cand->mv_y, blocksize_x_cr, blocksize_y_cr, ref1, k+1 ) ;
-      mcr_cost = 0;    
-
-      for (y = 0; y < blocksize_y_cr; y++)
-      {
-        for (x = 0; x < blocksize_x_cr; x += 2)
-        {
-#if (JM_MEM_DISTORTION)
-          mcr_cost += imgpel_abs[ *src_line++ - *ref_line++ ];
-          mcr_cost += imgpel_abs[ *src_line++ - *ref_line++ ];
-#else
-          mcr_cost += iabs( *src_line++ - *ref_line++ );
-          mcr_cost += iabs( *src_line++ - *ref_line++ );
-#endif
-        }
-      }
+      p_Dpb->pf_get_block_chroma[OTF_ME]( p_Vid, data, tmp_line, cand->mv_x, cand->mv_y, blocksize_x_cr, blocksize_y_cr, ref1, k+1 ) ;
+      mcr_cost = dist_kernels.sad(mv_block->orig_pic[k+1], data, blocksize_x_cr, blocksize_x_cr, blocksize_y_cr, INT_MAX);
       mcost += mv_block->ChromaMEWeight * mcr_cost;
 
       if(mcost >imin_cost)
@@ -227,55 +189,21 @@ distblk computeBiPredSAD1_otf(StorablePicture *ref1,
                       MotionVector *cand2)
 {
   int imin_cost = dist_down(min_mcost);
-  int mcost = 0;
-  int bi_diff;
-  int y,x;
+  int mcost;
   short blocksize_x = mv_block->blocksize_x;
   short blocksize_y = mv_block->blocksize_y;
   VideoParameters *p_Vid = mv_block->p_Vid;
   DecodedPictureBuffer *p_Dpb = p_Vid->p_Dpb_layer[p_Vid->dpb_layer_id];
-#if (JM_MEM_DISTORTION)
-  int *imgpel_abs = p_Vid->imgpel_abs;
-#endif
 
-  imgpel  *src_line, *ref2_line, *ref1_line ; 
   imgpel  data2[MB_PIXELS], data1[MB_PIXELS];                                  // local allocation could be optimized by a global instanciation
   int     tmp_line[ (MB_BLOCK_SIZE+5)*(MB_BLOCK_SIZE+5) ] ;
 
-  src_line = mv_block->orig_pic[0];
-  ref2_line = data2 ;
-  ref1_line = data1 ;
-
-  p_Dpb->pf_get_block_luma( p_Vid, ref2_line, tmp_line, cand2->mv_x, cand2->mv_y, blocksize_x, blocksize_y, ref2, 0 );
-  p_Dpb->pf_get_block_luma( p_Vid, ref1_line, tmp_line, cand1->mv_x, cand1->mv_y, blocksize_x, blocksize_y, ref1, 0 );
+  p_Dpb->pf_get_block_luma( p_Vid, data2, tmp_line, cand2->mv_x, cand2->mv_y, blocksize_x, blocksize_y, ref2, 0 );
+  p_Dpb->pf_get_block_luma( p_Vid, data1, tmp_line, cand1->mv_x, cand1->mv_y, blocksize_x, blocksize_y, ref1, 0 );
 
-  for (y = 0; y < blocksize_y; y++)
-  {
-    for (x = 0; x < blocksize_x; x+=4)
-    {
-#if (JM_MEM_DISTORTION)
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += imgpel_abs[ bi_diff ];
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += imgpel_abs[ bi_diff ];
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += imgpel_abs[ bi_diff ];
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += imgpel_abs[ bi_diff ];
-#else
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs(bi_diff);
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs(bi_diff);
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs(bi_diff);
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs(bi_diff);
-#endif
-    }
-    if(mcost > imin_cost)
-      return (dist_scale_f((distblk)mcost));
-  }
+  mcost = dist_kernels.bi_sad(mv_block->orig_pic[0], data1, data2, blocksize_x, blocksize_x, blocksize_y, imin_cost);
+  if(mcost > imin_cost)
+    return (dist_scale_f((distblk)mcost));
 
   if ( mv_block->ChromaMEEnable ) 
   {
@@ -287,24 +215,9 @@ distblk computeBiPredSAD1_otf(StorablePicture *ref1,
 
     for (k=1; k<3; k++)
     {
-      mcr_cost = 0;
-      
-      src_line = mv_block->orig_pic[k];
-      ref2_line = data2 ;
-      ref1_line = data1 ;
-      p_Dpb->pf_get_block_chroma[OTF_ME]( p_Vid, ref2_line, tmp_line, cand2->mv_x, cand2->mv_y, blocksize_x_cr, blocksize_y_cr, ref2, k ) ;
-      p_Dpb->pf_get_block_chroma[OTF_ME]( p_Vid, ref1_line, tmp_line, cand1->mv_x, cand1->mv_y, blocksize_x_cr, blocksize_y_cr, ref1, k ) ;
-
-      for (y=0; y<blocksize_y_cr; y++)
-      {
-        for (x = 0; x < blocksize_x_cr; x+=2)
-        {
-          bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          mcr_cost += iabs(bi_diff);
-          bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          mcr_cost += iabs(bi_diff);
-        }
-      }
+      p_Dpb->pf_get_block_chroma[OTF_ME]( p_Vid, data2, tmp_line, cand2->mv_x, cand2->mv_y, blocksize_x_cr, blocksize_y_cr, ref2, k ) ;
+      p_Dpb->pf_get_block_chroma[OTF_ME]( p_Vid, data1, tmp_line, cand1->mv_x, cand1->mv_y, blocksize_x_cr, blocksize_y_cr, ref1, k ) ;
+      mcr_cost = dist_kernels.bi_sad(mv_block->orig_pic[k], data1, data2, blocksize_x_cr, blocksize_x_cr, blocksize_y_cr, INT_MAX);
       mcost += mv_block->ChromaMEWeight * mcr_cost;
 
       if(mcost > imin_cost)
@@ -453,40 +366,28 @@ distblk computeSATD_otf(StorablePicture *ref1,
 {
   int imin_cost = dist_down(min_mcost);
   int mcost = 0;
-  int y, x, y4;
-  int src_size_x, src_size_mul;
+  int y, x;
+  int src_size_mul;
   short blocksize_x = mv_block->blocksize_x;
   short blocksize_y = mv_block->blocksize_y;
   VideoParameters *p_Vid = mv_block->p_Vid;
   DecodedPictureBuffer *p_Dpb = p_Vid->p_Dpb_layer[p_Vid->dpb_layer_id];
 
   imgpel  *src_tmp = mv_block->orig_pic[0];
-  short   *d, diff[MB_PIXELS];
-  imgpel  *src_line, *ref_line, data[MB_PIXELS] ;
+  short   diff[MB_PIXELS];
+  imgpel  data[MB_PIXELS] ;
   int     tmp_line[ (MB_BLOCK_SIZE+5)*(MB_BLOCK_SIZE+5) ] ;
 
 
   if ( !mv_block->test8x8 )
   { // 4x4 TRANSFORM
-    src_size_x = blocksize_x - BLOCK_SIZE;
     src_size_mul = blocksize_x * BLOCK_SIZE;
     for (y = cand->mv_y; y < cand->mv_y + (blocksize_y<<2); y += (BLOCK_SIZE_SP))
     {
       for (x=0; x<blocksize_x; x += BLOCK_SIZE)
       {
-        d    = diff;
-        ref_line = data ;
-        p_Dpb->pf_get_block_luma( p_Vid, ref_line, tmp_line, cand->mv_x + (x<<2) , y, BLOCK_SIZE, BLOCK_SIZE, ref1, 0 );
-        src_line = src_tmp + x;
-        for (y4 = 0; y4 < BLOCK_SIZE; y4++ )
-        {
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-
-          src_line += src_size_x;
-        }
+        p_Dpb->pf_get_block_luma( p_Vid, data, tmp_line, cand->mv_x + (x<<2) , y, BLOCK_SIZE, BLOCK_SIZE, ref1, 0 );
+        dist_kernels.diff(src_tmp + x, blocksize_x, data, BLOCK_SIZE, BLOCK_SIZE, diff);
         mcost += HadamardSAD4x4 (diff);
         if(mcost > imin_cost)
           return dist_scale_f((distblk)mcost);
@@ -496,29 +397,13 @@ distblk computeSATD_otf(StorablePicture *ref1,
   }
   else
   { // 8x8 TRANSFORM    
-    src_size_x = (blocksize_x - BLOCK_SIZE_8x8);
     src_size_mul = blocksize_x * BLOCK_SIZE_8x8;
     for (y = cand->mv_y; y < cand->mv_y + (blocksize_y<<2); y += (BLOCK_SIZE_8x8_SP) )
     {
       for (x=0; x<blocksize_x; x += BLOCK_SIZE_8x8 )
       {
-        d = diff;
-        ref_line = data ;
-        p_Dpb->pf_get_block_luma( p_Vid, ref_line, tmp_line, cand->mv_x + (x<<2) , y, BLOCK_SIZE_8x8, BLOCK_SIZE_8x8, ref1, 0 );
-        src_line = src_tmp + x;
-        for (y4 = 0; y4 < BLOCK_SIZE_8x8; y4++ )
-        {
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-          *d++ = *src_line++ - *ref_line++ ;
-
-          src_line += src_size_x;
-        }
+        p_Dpb->pf_get_block_luma( p_Vid, data, tmp_line, cand->mv_x + (x<<2) , y, BLOCK_SIZE_8x8, BLOCK_SIZE_8x8, ref1, 0 );
+        dist_kernels.diff(src_tmp + x, blocksize_x, data, BLOCK_SIZE_8x8, BLOCK_SIZE_8x8, diff);
         mcost += HadamardSAD8x8 (diff);
         if(mcost > imin_cost)
           return dist_scale_f((distblk)mcost);
@@ -658,11 +543,11 @@ distblk computeBiPredSATD1_otf(StorablePicture *ref1,
 {
   int imin_cost = dist_down(min_mcost);
   int mcost = 0;
-  int y, x, y4;
-  int src_size_x, src_size_mul;
+  int y, x;
+  int src_size_mul;
   imgpel *src_tmp = mv_block->orig_pic[0];
-  short *d, diff[MB_PIXELS];
-  imgpel *src_line, *ref1_line, *ref2_line, data1[MB_PIXELS], data2[MB_PIXELS] ;
+  short diff[MB_PIXELS];
+  imgpel data1[MB_PIXELS], data2[MB_PIXELS] ;
   int tmp_line[ (MB_BLOCK_SIZE+5)*(MB_BLOCK_SIZE+5) ] ;
   short blocksize_x = mv_block->blocksize_x;
   short blocksize_y = mv_block->blocksize_y;
@@ -671,28 +556,14 @@ distblk computeBiPredSATD1_otf(StorablePicture *ref1,
 
   if ( !mv_block->test8x8 )
   { // 4x4 TRANSFORM
-    src_size_x = (blocksize_x - BLOCK_SIZE);
     src_size_mul = blocksize_x * BLOCK_SIZE;
     for (y=0; y<(blocksize_y<<2); y += (BLOCK_SIZE_SP))
     {
       for (x=0; x<blocksize_x; x += BLOCK_SIZE)
       {
-        d    = diff;
-        ref2_line = data2;
-        ref1_line = data1;
-        src_line   = src_tmp + x;
-        p_Dpb->pf_get_block_luma( p_Vid, ref2_line, tmp_line, cand2->mv_x + (x<<2) , cand2->mv_y + y, BLOCK_SIZE, BLOCK_SIZE, ref2, 0 );
-        p_Dpb->pf_get_block_luma( p_Vid, ref1_line, tmp_line, cand1->mv_x + (x<<2) , cand1->mv_y + y, BLOCK_SIZE, BLOCK_SIZE, ref1, 0 );
-        
-        for (y4 = 0; y4 < BLOCK_SIZE; y4++ )
-        {
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-
-          src_line  += src_size_x;
-        }
+        p_Dpb->pf_get_block_luma( p_Vid, data2, tmp_line, cand2->mv_x + (x<<2) , cand2->mv_y + y, BLOCK_SIZE, BLOCK_SIZE, ref2, 0 );
+        p_Dpb->pf_get_block_luma( p_Vid, data1, tmp_line, cand1->mv_x + (x<<2) , cand1->mv_y + y, BLOCK_SIZE, BLOCK_SIZE, ref1, 0 );
+        dist_kernels.bi_diff(src_tmp + x, blocksize_x, data1, data2, BLOCK_SIZE, BLOCK_SIZE, diff);
         mcost += HadamardSAD4x4 (diff);
         if(mcost > imin_cost) 
           return dist_scale_f((distblk)mcost);
@@ -702,7 +573,6 @@ distblk computeBiPredSATD1_otf(StorablePicture *ref1,
   }
   else
   { // 8x8 TRANSFORM
-    src_size_x = (blocksize_x - BLOCK_SIZE_8x8);
     src_size_mul = blocksize_x * BLOCK_SIZE_8x8;
     for (y=0; y<(blocksize_y << 2); y += BLOCK_SIZE_8x8_SP )
     {
@@ -710,26 +580,9 @@ distblk computeBiPredSATD1_otf(StorablePicture *ref1,
       int y_pos1 = cand1->mv_y + y;
       for (x=0; x<blocksize_x; x += BLOCK_SIZE_8x8 )
       {
-        d = diff;
-        ref2_line  = data2;
-        ref1_line  = data1;
-        src_line   = src_tmp + x;
-        p_Dpb->pf_get_block_luma( p_Vid, ref2_line, tmp_line, cand2->mv_x + (x<<2) , y_pos2, BLOCK_SIZE_8x8, BLOCK_SIZE_8x8, ref2, 0 );
-        p_Dpb->pf_get_block_luma( p_Vid, ref1_line, tmp_line, cand1->mv_x + (x<<2) , y_pos1, BLOCK_SIZE_8x8, BLOCK_SIZE_8x8, ref1, 0 );
-
-        for (y4 = 0; y4 < BLOCK_SIZE_8x8; y4++ )
-        {
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          *d++ = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-
-          src_line += src_size_x;
-        }
+        p_Dpb->pf_get_block_luma( p_Vid, data2, tmp_line, cand2->mv_x + (x<<2) , y_pos2, BLOCK_SIZE_8x8, BLOCK_SIZE_8x8, ref2, 0 );
+        p_Dpb->pf_get_block_luma( p_Vid, data1, tmp_line, cand1->mv_x + (x<<2) , y_pos1, BLOCK_SIZE_8x8, BLOCK_SIZE_8x8, ref1, 0 );
+        dist_kernels.bi_diff(src_tmp + x, blocksize_x, data1, data2, BLOCK_SIZE_8x8, BLOCK_SIZE_8x8, diff);
         mcost += HadamardSAD8x8 (diff);
         if(mcost > imin_cost)
           return dist_scale_f((distblk)mcost);
@@ -911,32 +764,20 @@ distblk computeSSE_otf(StorablePicture *ref1,
                )
 {
   int imin_cost = dist_down(min_mcost);
-  int mcost = 0;
-  int y,x;
+  int mcost;
   short blocksize_x = mv_block->blocksize_x;
   short blocksize_y = mv_block->blocksize_y;
   VideoParameters *p_Vid = mv_block->p_Vid;
   DecodedPictureBuffer *p_Dpb = p_Vid->p_Dpb_layer[p_Vid->dpb_layer_id];
 
-  imgpel *src_line = mv_block->orig_pic[0];
-  imgpel *ref_line , data[MB_PIXELS] ; 
+  imgpel  data[MB_PIXELS] ; 
   int     tmp_line[ (MB_BLOCK_SIZE+5)*(MB_BLOCK_SIZE+5) ] ;
-  ref_line = data;
 
-  p_Dpb->pf_get_block_luma( p_Vid, ref_line, tmp_line, cand->mv_x, cand->mv_y, blocksize_x, blocksize_y, ref1, 0 );
+  p_Dpb->pf_get_block_luma( p_Vid, data, tmp_line, cand->mv_x, cand->mv_y, blocksize_x, blocksize_y, ref1, 0 );
 
-  for (y=0; y<blocksize_y; y++)
-  {
-    for (x = 0; x < blocksize_x; x+=4)
-    {
-      mcost += iabs2( *src_line++ - *ref_line++ );
-      mcost += iabs2( *src_line++ - *ref_line++ );
-      mcost += iabs2( *src_line++ - *ref_line++ );
-      mcost += iabs2( *src_line++ - *ref_line++ );
-    }
-    if(mcost > imin_cost)
-      return dist_scale_f((distblk)mcost);
-  }
+  mcost = dist_kernels.sse(mv_block->orig_pic[0], data, blocksize_x, blocksize_x, blocksize_y, imin_cost);
+  if(mcost > imin_cost)
+    return dist_scale_f((distblk)mcost);
 
   if ( mv_block->ChromaMEEnable ) 
   {
@@ -948,18 +789,8 @@ distblk computeSSE_otf(StorablePicture *ref1,
 
     for (k=0; k<2; k++)
     {
-      mcr_cost = 0;
-      src_line = mv_block->orig_pic[k+1];
-      ref_line = data ;
-      p_Dpb->pf_get_block_chroma[OTF_ME]( p_Vid, ref_line, tmp_line, cand->mv_x, cand->mv_y, blocksize_x_cr, blocksize_y_cr, ref1, k+1 ) ;
-      for (y=0; y<blocksize_y_cr; y++)
-      {
-        for (x = 0; x < blocksize_x_cr; x+=2)
-        {
-          mcr_cost += iabs2( *src_line++ - *ref_line++ );
-          mcr_cost += iabs2( *src_line++ - *ref_line++ );
-        }
-      }
+      p_Dpb->pf_get_block_chroma[OTF_ME]( p_Vid, data, tmp_line, cand->mv_x, cand->mv_y, blocksize_x_cr, blocksize_y_cr, ref1, k+1 ) ;
+      mcr_cost = dist_kernels.sse(mv_block->orig_pic[k+1], data, blocksize_x_cr, blocksize_x_cr, blocksize_y_cr, INT_MAX);
       mcost += mv_block->ChromaMEWeight * mcr_cost;
       if(mcost > imin_cost)
         return dist_scale_f((distblk)mcost);
@@ -1078,40 +909,21 @@ distblk computeBiPredSSE1_otf(StorablePicture *ref1,
                       MotionVector *cand2)
 {
   int imin_cost = dist_down(min_mcost);
-  int mcost = 0;
-  int bi_diff;
-  int y,x;
+  int mcost;
   short blocksize_x = mv_block->blocksize_x;
   short blocksize_y = mv_block->blocksize_y;
   VideoParameters *p_Vid = mv_block->p_Vid;
   DecodedPictureBuffer *p_Dpb = p_Vid->p_Dpb_layer[p_Vid->dpb_layer_id];
 
-  imgpel  *src_line, *ref2_line, *ref1_line ; 
   imgpel  data2[MB_PIXELS], data1[MB_PIXELS];                                  // local allocation could be optimized by a global instanciation
   int     tmp_line[ (MB_BLOCK_SIZE+5)*(MB_BLOCK_SIZE+5) ] ;
-  src_line = mv_block->orig_pic[0];
-  ref2_line = data2 ;
-  ref1_line = data1 ;
 
-  p_Dpb->pf_get_block_luma( p_Vid, ref2_line, tmp_line, cand2->mv_x, cand2->mv_y, blocksize_x, blocksize_y, ref2, 0 );
-  p_Dpb->pf_get_block_luma( p_Vid, ref1_line, tmp_line, cand1->mv_x, cand1->mv_y, blocksize_x, blocksize_y, ref1, 0 );
+  p_Dpb->pf_get_block_luma( p_Vid, data2, tmp_line, cand2->mv_x, cand2->mv_y, blocksize_x, blocksize_y, ref2, 0 );
+  p_Dpb->pf_get_block_luma( p_Vid, data1, tmp_line, cand1->mv_x, cand1->mv_y, blocksize_x, blocksize_y, ref1, 0 );
 
-  for (y = 0; y < blocksize_y; y++)
-  {
-    for (x = 0; x < blocksize_x; x+=4)
-    {
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs2(bi_diff);
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs2(bi_diff);
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs2(bi_diff);
-      bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-      mcost += iabs2(bi_diff);
-    }
-    if(mcost > imin_cost)
-      return dist_scale_f((distblk)mcost);
-  }
+  mcost = dist_kernels.bi_sse(mv_block->orig_pic[0], data1, data2, blocksize_x, blocksize_x, blocksize_y, imin_cost);
+  if(mcost > imin_cost)
+    return dist_scale_f((distblk)mcost);
 
   if ( mv_block->ChromaMEEnable ) 
   {
@@ -1123,23 +935,9 @@ distblk computeBiPredSSE1_otf(StorablePicture *ref1,
 
     for (k=0; k<2; k++)
     {
-      mcr_cost = 0;
-      src_line = mv_block->orig_pic[k+1];
-      ref2_line = data2 ;
-      ref1_line = data1 ;
-      p_Dpb->pf_get_block_chroma[OTF_ME]( p_Vid, ref2_line, tmp_line, cand2->mv_x, cand2->mv_y, blocksize_x_cr, blocksize_y_cr, ref2, k+1 ) ;
-      p_Dpb->pf_get_block_chroma[OTF_ME]( p_Vid, ref1_line, tmp_line, cand1->mv_x, cand1->mv_y, blocksize_x_cr, blocksize_y_cr, ref1, k+1 ) ;
-
-      for (y=0; y<blocksize_y_cr; y++)
-      {
-        for (x = 0; x < blocksize_x_cr; x+=2)
-        {
-          bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          mcr_cost += iabs2(bi_diff);
-          bi_diff = (*src_line++) - ((*ref1_line++ + *ref2_line++ + 1)>>1);
-          mcr_cost += iabs2(bi_diff);
-        }
-      }
+      p_Dpb->pf_get_block_chroma[OTF_ME]( p_Vid, data2, tmp_line, cand2->mv_x, cand2->mv_y, blocksize_x_cr, blocksize_y_cr, ref2, k+1 ) ;
+      p_Dpb->pf_get_block_chroma[OTF_ME]( p_Vid, data1, tmp_line, cand1->mv_x, cand1->mv_y, blocksize_x_cr, blocksize_y_cr, ref1, k+1 ) ;
+      mcr_cost = dist_kernels.bi_sse(mv_block->orig_pic[k+1], data1, data2, blocksize_x_cr, blocksize_x_cr, blocksize_y_cr, INT_MAX);
       mcost += mv_block->ChromaMEWeight * mcr_cost;
       if(mcost > imin_cost)
         return dist_scale_f((distblk)mcost);
@@ -27,6 +27,7 @@
 #include "me_distortion.h"
 #include "me_epzs.h"
 #include "me_epzs_common.h"
+#include "me_hme.h"
 #include "mv_search.h"
 
 // Functions
@@ -167,6 +168,10 @@ EPZS_motion_estimation (Macroblock * currMB,     // <--  current Macroblock
     if (p_Inp->EPZSSpatialMem)
       EPZS_spatial_memory_predictors (p_EPZS, mv_block, cur_list, &prednum, ref_picture->size_x >> 2);
 
+    //! Hierarchical pre-search predictor (see me_hme.c)
+    if (p_Inp->HMEEnable && min_mcost > 3 * stopCriterion)
+      prednum += get_hme_predictor (currMB, mv_block, pred_mv, lambda_factor, &p_EPZS_point[prednum].motion);
+
 #if (MVC_EXTENSION_ENABLE)
     if ( p_Inp->EPZSTemporal[currSlice->view_id] && blocktype < 5 ) 
 #else
@@ -528,6 +533,10 @@ EPZS_subMB_motion_estimation  (Macroblock * currMB,     // <--  current Macroblo
     if (p_Inp->EPZSSpatialMem)
       EPZS_spatial_memory_predictors (p_EPZS, mv_block, cur_list, &prednum, ref_picture->size_x >> 2);
 
+    //! Hierarchical pre-search predictor (see me_hme.c)
+    if (p_Inp->HMEEnable && min_mcost > 3 * stopCriterion)
+      prednum += get_hme_predictor (currMB, mv_block, pred_mv, lambda_factor, &p_EPZS_point[prednum].motion);
+
     //! Blocktype/Reference dependent predictors.
     //! Since already mvs for other blocktypes/references have been computed, we can reuse
     //! them in order to easier determine the optimal point. Use of predictors could depend
@@ -475,11 +475,11 @@ EPZSStructInit (Slice * currSlice)
   EPZSWindowPredictorInit ((short) p_Inp->search_range[p_Vid->view_id], p_EPZS->window_predictor_ext, 1);
 
   //! Also assing search predictor memory
-  // maxwindow + spatial + blocktype + temporal + memspatial
+  // maxwindow + spatial + blocktype + temporal + memspatial + hierarchical pre-search
 #if (MVC_EXTENSION_ENABLE)
-  p_EPZS->predictor = allocEPZSpattern (searchlevels * 20 + 5 + 5 + 9 * (p_Inp->EPZSTemporal[0] | p_Inp->EPZSTemporal[1]) + 3 * (p_Inp->EPZSSpatialMem));
+  p_EPZS->predictor = allocEPZSpattern (searchlevels * 20 + 5 + 5 + 9 * (p_Inp->EPZSTemporal[0] | p_Inp->EPZSTemporal[1]) + 3 * (p_Inp->EPZSSpatialMem) + (p_Inp->HMEEnable != 0));
 #else
-  p_EPZS->predictor = allocEPZSpattern (searchlevels * 20 + 5 + 5 + 9 * (p_Inp->EPZSTemporal) + 3 * (p_Inp->EPZSSpatialMem));
+  p_EPZS->predictor = allocEPZSpattern (searchlevels * 20 + 5 + 5 + 9 * (p_Inp->EPZSTemporal) + 3 * (p_Inp->EPZSSpatialMem) + (p_Inp->HMEEnable != 0));
 #endif
 
   //! Finally assign memory for all other elements
@@ -27,10 +27,40 @@
 #include "me_distortion.h"
 #include "me_epzs.h"
 #include "me_epzs_common.h"
+#include "me_hme.h"
 #include "mv_search.h"
 
+//! full pel candidates evaluated by one batched distortion call
+typedef struct
+{
+  int          num;
+  int          pos     [ME_BATCH_SIZE];  //!< predictor index or pattern point number
+  MotionVector tmv     [ME_BATCH_SIZE];  //!< candidate motion vector
+  MotionVector cand    [ME_BATCH_SIZE];  //!< padded candidate motion vector
+  distblk      mv_cost [ME_BATCH_SIZE];  //!< motion vector cost
+  distblk      limit   [ME_BATCH_SIZE];  //!< distortion limit
+  distblk      dist    [ME_BATCH_SIZE];  //!< distortion
+} EPZSBatch;
+
 // Functions
 
+/*!
+***********************************************************************
+* \brief
+*    Adds a full pel candidate to a batch
+***********************************************************************
+*/
+static inline void add_batch_candidate (EPZSBatch *batch, int pos, MotionVector *tmv, MotionVector *cand, distblk mv_cost, distblk limit)
+{
+  int k = batch->num++;
+
+  batch->pos[k]     = pos;
+  batch->tmv[k]     = *tmv;
+  batch->cand[k]    = *cand;
+  batch->mv_cost[k] = mv_cost;
+  batch->limit[k]   = limit;
+}
+
 /*!
 ***********************************************************************
 * \brief
@@ -130,7 +160,8 @@ EPZS_integer_motion_estimation (Macroblock * currMB,     // <--  current Macrobl
     int prednum = 5;
     int conditionEPZS;
     MotionVector tmp2 = {0, 0}, tmv;
-    int pos;
+    int pos, k;
+    EPZSBatch batch;
     short invalid_refs = 0;
 
     stopCriterion = EPZSDetermineStopCriterion (p_EPZS, prevSad, mv_block, lambda_dist);
@@ -162,6 +193,10 @@ EPZS_integer_motion_estimation (Macroblock * currMB,     // <--  current Macrobl
     if (p_Inp->EPZSSpatialMem)
       EPZS_spatial_memory_predictors (p_EPZS, mv_block, cur_list, &prednum, ref_picture->size_x >> 2);
 
+    //! Hierarchical pre-search predictor (see me_hme.c)
+    if (p_Inp->HMEEnable && min_mcost > 3 * stopCriterion)
+      prednum += get_hme_predictor (currMB, mv_block, pred_mv, lambda_factor, &p_EPZS_point[prednum].motion);
+
     // Temporal predictors
 #if (MVC_EXTENSION_ENABLE)
     if ( p_Inp->EPZSTemporal[currSlice->view_id] )
@@ -208,41 +243,59 @@ EPZS_integer_motion_estimation (Macroblock * currMB,     // <--  current Macrobl
       EPZSBlockTypePredictorsMB (currSlice, mv_block, p_EPZS_point, &prednum);
 
     //! Check all predictors
-    for (pos = 0; pos < prednum; ++pos)
+    //! The distortions of up to ME_BATCH_SIZE candidates are computed by one call and
+    //! the candidates are then checked in order. Candidates are selected with the
+    //! thresholds at the time the batch is formed and checked again with the current
+    //! ones. Thresholds only decrease, so the result is the same as when checking
+    //! one candidate at a time.
+    for (pos = 0; pos < prednum; )
     {
-      tmv = p_EPZS_point[pos].motion;
-      //if (((iabs (tmv.mv_x - mv->mv_x) > searchRange->max_x || iabs (tmv.mv_y - mv->mv_y) > searchRange->max_y)) && (tmv.mv_x || tmv.mv_y))
-      if ((iabs (tmv.mv_x - mv->mv_x) - searchRange->max_x <= 0) && (iabs (tmv.mv_y - mv->mv_y) - searchRange->max_y <= 0))
+      batch.num = 0;
+      for (; pos < prednum && batch.num < ME_BATCH_SIZE; ++pos)
       {
-        EPZSPoint = &EPZSMap[tmv.mv_y][mapCenter_x + tmv.mv_x];
-        if (*EPZSPoint != p_EPZS->BlkCount)
+        tmv = p_EPZS_point[pos].motion;
+        //if (((iabs (tmv.mv_x - mv->mv_x) > searchRange->max_x || iabs (tmv.mv_y - mv->mv_y) > searchRange->max_y)) && (tmv.mv_x || tmv.mv_y))
+        if ((iabs (tmv.mv_x - mv->mv_x) - searchRange->max_x <= 0) && (iabs (tmv.mv_y - mv->mv_y) - searchRange->max_y <= 0))
         {
-          *EPZSPoint = p_EPZS->BlkCount;
-          cand = pad_MVs (tmv, mv_block);
+          EPZSPoint = &EPZSMap[tmv.mv_y][mapCenter_x + tmv.mv_x];
+          if (*EPZSPoint != p_EPZS->BlkCount)
+          {
+            *EPZSPoint = p_EPZS->BlkCount;
+            cand = pad_MVs (tmv, mv_block);
 
-          //--- set motion cost (cost for motion vector) and check ---
-          mcost = mv_cost (p_Vid, lambda_factor, &cand, &pred);
+            //--- set motion cost (cost for motion vector) and check ---
+            mcost = mv_cost (p_Vid, lambda_factor, &cand, &pred);
 
-          if (mcost < second_mcost)
-          {
-            mcost += mv_block->computePredFPel (ref_picture, mv_block, second_mcost - mcost, &cand);
+            if (mcost < second_mcost)
+              add_batch_candidate (&batch, pos, &tmv, &cand, mcost, second_mcost - mcost);
+          }
+        }
+      }
 
-            //--- check if motion cost is less than minimum cost ---
-            if (mcost < min_mcost)
-            {
-              tmp2 = tmp;
-              tmp = tmv;
-              second_mcost = min_mcost;
-              min_mcost = mcost;
-              checkMedian = TRUE;
-            }
-            //else if (mcost < second_mcost && (tmp.mv_x != tmv.mv_x || tmp.mv_y != tmv.mv_y))
-            else if (mcost < second_mcost)
-            {
-              tmp2 = tmv;
-              second_mcost = mcost;
-              checkMedian = TRUE;
-            }
+      if (batch.num)
+        mv_block->computeBatchPredFPel (ref_picture, mv_block, batch.num, batch.cand, batch.limit, batch.dist);
+
+      for (k = 0; k < batch.num; ++k)
+      {
+        if (batch.mv_cost[k] < second_mcost)
+        {
+          mcost = batch.mv_cost[k] + batch.dist[k];
+
+          //--- check if motion cost is less than minimum cost ---
+          if (mcost < min_mcost)
+          {
+            tmp2 = tmp;
+            tmp = batch.tmv[k];
+            second_mcost = min_mcost;
+            min_mcost = mcost;
+            checkMedian = TRUE;
+          }
+          //else if (mcost < second_mcost && (tmp.mv_x != tmv.mv_x || tmp.mv_y != tmv.mv_y))
+          else if (mcost < second_mcost)
+          {
+            tmp2 = batch.tmv[k];
+            second_mcost = mcost;
+            checkMedian = TRUE;
           }
         }
       }
@@ -306,35 +359,50 @@ EPZS_integer_motion_estimation (Macroblock * currMB,     // <--  current Macrobl
           checkPts = totalCheckPts;
           do
           {
-            tmv = add_MVs (center, &(searchPatternF->point[pointNumber].motion));
-
-            if (((iabs (tmv.mv_x - mv->mv_x) - searchRange->max_x) <= 0) && ((iabs (tmv.mv_y - mv->mv_y) - searchRange->max_y) <= 0))
+            // the points of one pattern pass only depend on the center; evaluate them in batches
+            batch.num = 0;
+            do
             {
-              EPZSPoint = &EPZSMap[tmv.mv_y][mapCenter_x + tmv.mv_x];
-              if (*EPZSPoint != p_EPZS->BlkCount)
+              tmv = add_MVs (center, &(searchPatternF->point[pointNumber].motion));
+
+              if (((iabs (tmv.mv_x - mv->mv_x) - searchRange->max_x) <= 0) && ((iabs (tmv.mv_y - mv->mv_y) - searchRange->max_y) <= 0))
               {
-                *EPZSPoint = p_EPZS->BlkCount;
-                cand = pad_MVs (tmv, mv_block);
+                EPZSPoint = &EPZSMap[tmv.mv_y][mapCenter_x + tmv.mv_x];
+                if (*EPZSPoint != p_EPZS->BlkCount)
+                {
+                  *EPZSPoint = p_EPZS->BlkCount;
+                  cand = pad_MVs (tmv, mv_block);
+
+                  mcost = mv_cost (p_Vid, lambda_factor, &cand, &pred);
 
-                mcost = mv_cost (p_Vid, lambda_factor, &cand, &pred);
+                  if (mcost < min_mcost)
+                    add_batch_candidate (&batch, pointNumber, &tmv, &cand, mcost, min_mcost - mcost);
+                }
+              }
+              ++pointNumber;
+              if (pointNumber >= searchPatternF->searchPoints)
+                pointNumber -= searchPatternF->searchPoints;
+              checkPts--;
+            }
+            while (checkPts > 0 && batch.num < ME_BATCH_SIZE);
+
+            if (batch.num)
+              mv_block->computeBatchPredFPel (ref_picture, mv_block, batch.num, batch.cand, batch.limit, batch.dist);
+
+            for (k = 0; k < batch.num; ++k)
+            {
+              if (batch.mv_cost[k] < min_mcost)
+              {
+                mcost = batch.mv_cost[k] + batch.dist[k];
 
                 if (mcost < min_mcost)
                 {
-                  mcost += mv_block->computePredFPel (ref_picture, mv_block, min_mcost - mcost, &cand);
-
-                  if (mcost < min_mcost)
-                  {
-                    tmp = tmv;
-                    min_mcost = mcost;
-                    motionDirection = pointNumber;
-                  }
+                  tmp = batch.tmv[k];
+                  min_mcost = mcost;
+                  motionDirection = batch.pos[k];
                 }
               }
             }
-            ++pointNumber;
-            if (pointNumber >= searchPatternF->searchPoints)
-              pointNumber -= searchPatternF->searchPoints;
-            checkPts--;
           }
           while (checkPts > 0);
 
@@ -519,7 +587,8 @@ EPZS_integer_subMB_motion_estimation (Macroblock * currMB,    // <--  current Ma
     int conditionEPZS;
 
     MotionVector tmv, tmp2 = {0,0};
-    int pos;
+    int pos, k;
+    EPZSBatch batch;
 
     stopCriterion = EPZSDetermineStopCriterion (p_EPZS, prevSad, mv_block, lambda_dist);
 
@@ -544,6 +613,10 @@ EPZS_integer_subMB_motion_estimation (Macroblock * currMB,    // <--  current Ma
     if (p_Inp->EPZSSpatialMem)
       EPZS_spatial_memory_predictors (p_EPZS, mv_block, cur_list, &prednum, ref_picture->size_x >> 2);
 
+    //! Hierarchical pre-search predictor (see me_hme.c)
+    if (p_Inp->HMEEnable && min_mcost > 3 * stopCriterion)
+      prednum += get_hme_predictor (currMB, mv_block, pred_mv, lambda_factor, &p_EPZS_point[prednum].motion);
+
     //! Blocktype/Reference dependent predictors.
     //! Since already mvs for other blocktypes/references have been computed, we can reuse
     //! them in order to easier determine the optimal point. Use of predictors could depend
@@ -554,31 +627,51 @@ EPZS_integer_subMB_motion_estimation (Macroblock * currMB,    // <--  current Ma
       EPZSBlockTypePredictors (currSlice, mv_block, p_EPZS_point, &prednum);
 
     //! Check all predictors
-    for (pos = 0; pos < prednum; ++pos)
+    //! Distortions are computed in batches as in EPZS_integer_motion_estimation. The
+    //! termination criteria are still tested after each predictor position.
+    for (pos = 0; pos < prednum; )
     {
-      tmv = p_EPZS_point[pos].motion;
-      //if (((iabs (tmv.mv_x - mv->mv_x) > searchRange->max_x || iabs (tmv.mv_y - mv->mv_y) > searchRange->max_y)) && (tmv.mv_x || tmv.mv_y))
-      if ((iabs (tmv.mv_x - mv->mv_x) - searchRange->max_x <= 0) && (iabs (tmv.mv_y - mv->mv_y) - searchRange->max_y <= 0))
-      {
+      int first = pos;
 
-        if (EPZSMap[tmv.mv_y][mapCenter_x + tmv.mv_x] != p_EPZS->BlkCount)
+      batch.num = 0;
+      for (; pos < prednum && batch.num < ME_BATCH_SIZE; ++pos)
+      {
+        tmv = p_EPZS_point[pos].motion;
+        //if (((iabs (tmv.mv_x - mv->mv_x) > searchRange->max_x || iabs (tmv.mv_y - mv->mv_y) > searchRange->max_y)) && (tmv.mv_x || tmv.mv_y))
+        if ((iabs (tmv.mv_x - mv->mv_x) - searchRange->max_x <= 0) && (iabs (tmv.mv_y - mv->mv_y) - searchRange->max_y <= 0))
         {
-          EPZSMap[tmv.mv_y][mapCenter_x + tmv.mv_x] = p_EPZS->BlkCount;
 
-          cand = pad_MVs (tmv, mv_block);
+          if (EPZSMap[tmv.mv_y][mapCenter_x + tmv.mv_x] != p_EPZS->BlkCount)
+          {
+            EPZSMap[tmv.mv_y][mapCenter_x + tmv.mv_x] = p_EPZS->BlkCount;
 
-          //--- set motion cost (cost for motion vector) and check ---
-          mcost = mv_cost (p_Vid, lambda_factor, &cand, &pred);
+            cand = pad_MVs (tmv, mv_block);
 
-          if (mcost < second_mcost)
+            //--- set motion cost (cost for motion vector) and check ---
+            mcost = mv_cost (p_Vid, lambda_factor, &cand, &pred);
+
+            if (mcost < second_mcost)
+              add_batch_candidate (&batch, pos, &tmv, &cand, mcost, second_mcost - mcost);
+          }
+        }
+      }
+
+      if (batch.num)
+        mv_block->computeBatchPredFPel (ref_picture, mv_block, batch.num, batch.cand, batch.limit, batch.dist);
+
+      for (k = 0; first < pos; ++first)
+      {
+        if (k < batch.num && batch.pos[k] == first)
+        {
+          if (batch.mv_cost[k] < second_mcost)
           {
-            mcost += mv_block->computePredFPel (ref_picture, mv_block, second_mcost - mcost, &cand);
+            mcost = batch.mv_cost[k] + batch.dist[k];
 
             //--- check if motion cost is less than minimum cost ---
             if (mcost < min_mcost)
             {
               tmp2 = tmp;
-              tmp = tmv;
+              tmp = batch.tmv[k];
               second_mcost = min_mcost;
               min_mcost = mcost;
               checkMedian = TRUE;
@@ -586,41 +679,42 @@ EPZS_integer_subMB_motion_estimation (Macroblock * currMB,    // <--  current Ma
             //else if (mcost < second_mcost && (tmp.mv_x != tmv.mv_x || tmp.mv_y != tmv.mv_y))
             else if (mcost < second_mcost)
             {
-              tmp2 = tmv;
+              tmp2 = batch.tmv[k];
               second_mcost = mcost;
               checkMedian = TRUE;
             }
           }
+          ++k;
         }
-      }
 
-      if ((ref > 0 && currSlice->structure == FRAME) && (*prevSad * 3 < min_mcost))
-      {  
+        if ((ref > 0 && currSlice->structure == FRAME) && (*prevSad * 3 < min_mcost))
+        {  
 #if EPZSREF
-        if (p_Inp->EPZSSpatialMem)
+          if (p_Inp->EPZSSpatialMem)
 #else 
-        if (p_Inp->EPZSSpatialMem && ref == 0)
+          if (p_Inp->EPZSSpatialMem && ref == 0)
 #endif 
-        {
-          *p_motion = tmp;
+          {
+            *p_motion = tmp;
+          }
+          return min_mcost;
         }
-        return min_mcost;
-      }
 
-      // At this point, let us add an early termination criterion
-      // after checking each predictor. This can help speed up a lot.
-      if (min_mcost < ((3 * stopCriterion) >> 2))
-      {
+        // At this point, let us add an early termination criterion
+        // after checking each predictor. This can help speed up a lot.
+        if (min_mcost < ((3 * stopCriterion) >> 2))
+        {
 #if EPZSREF
-        if (p_Inp->EPZSSpatialMem)
+          if (p_Inp->EPZSSpatialMem)
 #else 
-        if (p_Inp->EPZSSpatialMem && ref == 0)
+          if (p_Inp->EPZSSpatialMem && ref == 0)
 #endif 
-        {
-          *p_motion = tmp;
+          {
+            *p_motion = tmp;
+          }
+          *mv = tmp;
+          return min_mcost;
         }
-        *mv = tmp;
-        return min_mcost;
       }
     }
 
@@ -659,34 +753,47 @@ EPZS_integer_subMB_motion_estimation (Macroblock * currMB,    // <--  current Ma
           checkPts = totalCheckPts;
           do
           {
-            tmv = add_MVs (center, &(searchPatternF->point[pointNumber].motion));
+            batch.num = 0;
+            do
+            {
+              tmv = add_MVs (center, &(searchPatternF->point[pointNumber].motion));
+
+              if ((iabs (tmv.mv_x - mv->mv_x) <= searchRange->max_x) && (iabs (tmv.mv_y - mv->mv_y) <= searchRange->max_y))
+              {
+                if (EPZSMap[tmv.mv_y][mapCenter_x + tmv.mv_x] != p_EPZS->BlkCount)
+                {
+                  EPZSMap[tmv.mv_y][mapCenter_x + tmv.mv_x] = p_EPZS->BlkCount;
+                  cand = pad_MVs(tmv, mv_block);
+
+                  mcost = mv_cost (p_Vid, lambda_factor, &cand, &pred);
+                  if (mcost < min_mcost)
+                    add_batch_candidate (&batch, pointNumber, &tmv, &cand, mcost, min_mcost - mcost);
+                }
+              }
+              ++pointNumber;
+              if (pointNumber >= searchPatternF->searchPoints)
+                pointNumber -= searchPatternF->searchPoints;
+              checkPts--;
+            }
+            while (checkPts > 0 && batch.num < ME_BATCH_SIZE);
+
+            if (batch.num)
+              mv_block->computeBatchPredFPel (ref_picture, mv_block, batch.num, batch.cand, batch.limit, batch.dist);
 
-            if ((iabs (tmv.mv_x - mv->mv_x) <= searchRange->max_x) && (iabs (tmv.mv_y - mv->mv_y) <= searchRange->max_y))
+            for (k = 0; k < batch.num; ++k)
             {
-              if (EPZSMap[tmv.mv_y][mapCenter_x + tmv.mv_x] != p_EPZS->BlkCount)
+              if (batch.mv_cost[k] < min_mcost)
               {
-                EPZSMap[tmv.mv_y][mapCenter_x + tmv.mv_x] = p_EPZS->BlkCount;
-                cand = pad_MVs(tmv, mv_block);
+                mcost = batch.mv_cost[k] + batch.dist[k];
 
-                mcost = mv_cost (p_Vid, lambda_factor, &cand, &pred);
                 if (mcost < min_mcost)
                 {
-
-                  mcost += mv_block->computePredFPel (ref_picture, mv_block, min_mcost - mcost, &cand);
-
-                  if (mcost < min_mcost)
-                  {
-                    tmp = tmv;
-                    min_mcost = mcost;
-                    motionDirection = pointNumber;
-                  }
+                  tmp = batch.tmv[k];
+                  min_mcost = mcost;
+                  motionDirection = batch.pos[k];
                 }
               }
             }
-            ++pointNumber;
-            if (pointNumber >= searchPatternF->searchPoints)
-              pointNumber -= searchPatternF->searchPoints;
-            checkPts--;
           }
           while (checkPts > 0);
 
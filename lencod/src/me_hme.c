@@ -0,0 +1,258 @@
+/*!
+*************************************************************************************
+* \file me_hme.c
+*
+* \brief
+*    Hierarchical motion estimation pre-search.
+*
+*    Each reference picture keeps a 1/2 and a 1/4 resolution version of its luma
+*    plane (built together with the sub-pel planes in UnifiedOneForthPix()). For
+*    every macroblock and reference a full search is done at 1/4 resolution and
+*    refined at 1/2 resolution. The resulting vector is used as an additional
+*    predictor by the EPZS and UMHexagon searches, which helps them lock onto
+*    motion that the spatial and temporal predictors miss when large search
+*    ranges are used.
+*
+*************************************************************************************
+*/
+
+#include "contributors.h"
+
+#include <limits.h>
+
+#include "global.h"
+#include "image.h"
+#include "memalloc.h"
+#include "me_distortion.h"
+#include "mv_search.h"
+#include "me_hme.h"
+
+/*!
+************************************************************************
+* \brief
+*    Allocate the pre-search memory of a slice
+************************************************************************
+*/
+void HMEStructInit (Slice *currSlice)
+{
+  int list, ref;
+
+  if ((currSlice->p_HME = (HMEParameters *) calloc(1, sizeof(HMEParameters))) == NULL)
+    no_mem_exit("HMEStructInit: p_HME");
+
+  for (list = 0; list < 6; ++list)
+    for (ref = 0; ref < MAX_LIST_SIZE; ++ref)
+      currSlice->p_HME->mb_addr[list][ref] = -1;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Free the pre-search memory of a slice
+************************************************************************
+*/
+void HMEStructDelete (Slice *currSlice)
+{
+  free (currSlice->p_HME);
+  currSlice->p_HME = NULL;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Build the lower resolution levels of the luma pyramid of a
+*    reference picture. Level 0 points to the picture itself.
+************************************************************************
+*/
+void generate_hme_pyramid (VideoParameters *p_Vid, StorablePicture *s)
+{
+  if (s->p_hme_int_img == NULL)
+  {
+    int level;
+
+    if ((s->p_hme_int_img = (imgpel ***) calloc(HME_LEVELS, sizeof(imgpel **))) == NULL)
+      no_mem_exit("generate_hme_pyramid: p_hme_int_img");
+    for (level = 1; level < HME_LEVELS; ++level)
+      get_mem2Dpel(&s->p_hme_int_img[level], s->size_y >> level, s->size_x >> level);
+  }
+  s->p_hme_int_img[0] = s->imgY;
+
+  GenerateImagePyramid(p_Vid, s->size_x, s->size_y, s->p_hme_int_img, 0, 0);
+}
+
+/*!
+************************************************************************
+* \brief
+*    Free the luma pyramid of a reference picture
+************************************************************************
+*/
+void free_hme_pyramid (StorablePicture *s)
+{
+  if (s->p_hme_int_img)
+  {
+    int level;
+
+    for (level = 1; level < HME_LEVELS; ++level)
+      free_mem2Dpel(s->p_hme_int_img[level]);
+    free(s->p_hme_int_img);
+    s->p_hme_int_img = NULL;
+  }
+}
+
+/*!
+************************************************************************
+* \brief
+*    Downsample a block by 2 in both directions (2x2 average)
+************************************************************************
+*/
+static void downsample_block (imgpel *dst, imgpel *src, int src_stride, int width, int height)
+{
+  int i, j;
+
+  for (j = 0; j < height; j += 2)
+  {
+    imgpel *src0 = src + j * src_stride;
+    imgpel *src1 = src0 + src_stride;
+    for (i = 0; i < width; i += 2)
+      *dst++ = (imgpel) ((src0[i] + src0[i + 1] + src1[i] + src1[i + 1] + 2) >> 2);
+  }
+}
+
+/*!
+************************************************************************
+* \brief
+*    Motion vector cost of a full pel displacement (mv_x, mv_y)
+*    of the current macroblock
+************************************************************************
+*/
+static inline distblk hme_mv_cost (VideoParameters *p_Vid, int lambda_factor, const MotionVector *pred, int mv_x, int mv_y)
+{
+  MotionVector mv;
+
+  mv.mv_x = (short) iClip3(pred->mv_x - p_Vid->max_mvd + 1, pred->mv_x + p_Vid->max_mvd - 1, mv_x << 2);
+  mv.mv_y = (short) iClip3(pred->mv_y - p_Vid->max_mvd + 1, pred->mv_y + p_Vid->max_mvd - 1, mv_y << 2);
+
+  return mv_cost (p_Vid, lambda_factor, &mv, pred);
+}
+
+/*!
+************************************************************************
+* \brief
+*    Full search of the current macroblock at one pyramid level
+*    within +-range around (cx, cy) (in samples of that level).
+*    The block has to stay inside the plane (the center is clipped
+*    accordingly). The distortion is scaled to full resolution and
+*    the motion vector cost is added, so that the search prefers
+*    vectors close to the predictor. Returns the best position in
+*    best_x, best_y.
+************************************************************************
+*/
+static void hme_level_search (Macroblock *currMB, StorablePicture *ref_picture, imgpel *org, int level, int cx, int cy, int range,
+                              const MotionVector *pred, int lambda_factor, int *best_x, int *best_y)
+{
+  VideoParameters *p_Vid = currMB->p_Vid;
+  imgpel **plane = ref_picture->p_hme_int_img[level];
+  int width  = ref_picture->size_x >> level;
+  int height = ref_picture->size_y >> level;
+  int size   = MB_BLOCK_SIZE >> level;
+  int shift  = 2 * level;
+  int x, y, min_x, max_x, min_y, max_y;
+  distblk mcost, min_cost;
+
+  cx = iClip3(0, width  - size, cx);
+  cy = iClip3(0, height - size, cy);
+  min_x = imax(0, cx - range);
+  max_x = imin(width  - size, cx + range);
+  min_y = imax(0, cy - range);
+  max_y = imin(height - size, cy + range);
+
+  min_cost = hme_mv_cost(p_Vid, lambda_factor, pred, (cx << level) - currMB->pix_x, (cy << level) - currMB->opix_y)
+    + dist_scale((distblk) dist_kernels.sad(org, &plane[cy][cx], width, size, size, INT_MAX) << shift);
+  *best_x = cx;
+  *best_y = cy;
+
+  for (y = min_y; y <= max_y; ++y)
+  {
+    for (x = min_x; x <= max_x; ++x)
+    {
+      mcost = hme_mv_cost(p_Vid, lambda_factor, pred, (x << level) - currMB->pix_x, (y << level) - currMB->opix_y);
+      if (mcost < min_cost)
+      {
+        mcost += dist_scale((distblk) dist_kernels.sad(org, &plane[y][x], width, size, size, dist_down(min_cost - mcost) >> shift) << shift);
+        if (mcost < min_cost)
+        {
+          min_cost = mcost;
+          *best_x = x;
+          *best_y = y;
+        }
+      }
+    }
+  }
+}
+
+/*!
+************************************************************************
+* \brief
+*    Pre-search of the current macroblock in one reference picture
+************************************************************************
+*/
+static void hme_search (Macroblock *currMB, StorablePicture *ref_picture, const MotionVector *pred, int lambda_factor, MotionVector *mv)
+{
+  VideoParameters *p_Vid = currMB->p_Vid;
+  imgpel org1[(MB_BLOCK_SIZE >> 1) * (MB_BLOCK_SIZE >> 1)];
+  imgpel org2[(MB_BLOCK_SIZE >> 2) * (MB_BLOCK_SIZE >> 2)];
+  imgpel org0[MB_PIXELS];
+  int pix_x = currMB->pix_x, pix_y = currMB->opix_y;
+  int range = ((p_Vid->searchRange.max_x >> 2) + 3) >> 2;
+  int j, x2, y2, x1, y1;
+
+  for (j = 0; j < MB_BLOCK_SIZE; ++j)
+    memcpy(&org0[j * MB_BLOCK_SIZE], &p_Vid->pCurImg[pix_y + j][pix_x], MB_BLOCK_SIZE * sizeof(imgpel));
+  downsample_block(org1, org0, MB_BLOCK_SIZE, MB_BLOCK_SIZE, MB_BLOCK_SIZE);
+  downsample_block(org2, org1, MB_BLOCK_SIZE >> 1, MB_BLOCK_SIZE >> 1, MB_BLOCK_SIZE >> 1);
+
+  // full search at 1/4 resolution
+  hme_level_search(currMB, ref_picture, org2, 2, pix_x >> 2, pix_y >> 2, range, pred, lambda_factor, &x2, &y2);
+
+  // refinement at 1/2 resolution
+  hme_level_search(currMB, ref_picture, org1, 1, x2 << 1, y2 << 1, 2, pred, lambda_factor, &x1, &y1);
+
+  mv->mv_x = (short) (((x1 << 1) - pix_x) << 2);
+  mv->mv_y = (short) (((y1 << 1) - pix_y) << 2);
+}
+
+/*!
+************************************************************************
+* \brief
+*    Get the pre-search vector of the current macroblock for the
+*    list and reference of mv_block. The search is done once per
+*    macroblock and reference (with the predictor and lambda of the
+*    first block searched, normally the 16x16 one) and reused for all
+*    block types. Returns 1 if a non zero vector is available.
+************************************************************************
+*/
+int get_hme_predictor (Macroblock *currMB, MEBlock *mv_block, MotionVector *pred_mv, int lambda_factor, MotionVector *hme_mv)
+{
+  Slice *currSlice = currMB->p_Slice;
+  HMEParameters *p_HME = currSlice->p_HME;
+  int cur_list = mv_block->list + currMB->list_offset;
+  int ref = mv_block->ref_idx;
+  StorablePicture *ref_picture;
+
+  if (p_HME == NULL)
+    return 0;
+
+  ref_picture = currSlice->listX[cur_list][ref];
+  if (ref_picture->p_hme_int_img == NULL)
+    return 0;
+
+  if (p_HME->mb_addr[cur_list][ref] != currMB->mbAddrX)
+  {
+    hme_search(currMB, ref_picture, pred_mv, lambda_factor, &p_HME->mv[cur_list][ref]);
+    p_HME->mb_addr[cur_list][ref] = currMB->mbAddrX;
+  }
+
+  *hme_mv = p_HME->mv[cur_list][ref];
+
+  return (hme_mv->mv_x != 0 || hme_mv->mv_y != 0);
+}
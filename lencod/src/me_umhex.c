@@ -36,6 +36,7 @@
 #include "me_distortion.h"
 #include "mv_search.h"
 #include "me_fullsearch.h"
+#include "me_hme.h"
 
 #define Q_BITS          15
 #define MIN_IMG_WIDTH   176
@@ -308,6 +309,21 @@ UMHEXIntegerPelBlockMotionSearch  (Macroblock *currMB,     // <--  current Macro
       SEARCH_ONE_PIXEL
     }
   }
+
+  // check the hierarchical pre-search vector (see me_hme.c)
+  if (p_Inp->HMEEnable && min_mcost >= ET_Thred && get_hme_predictor(currMB, mv_block, pred_mv, lambda_factor, &cand))
+  {
+    cand.mv_x = (short) (cand.mv_x + pic_pix_x);
+    cand.mv_y = (short) (cand.mv_y + pic_pix_y);
+    SEARCH_ONE_PIXEL
+      iMinNow = best;
+    for (m = 0; m < 4; m++)
+    {
+      cand.mv_x = iMinNow.mv_x + Diamond[m].mv_x;
+      cand.mv_y = iMinNow.mv_y + Diamond[m].mv_y;
+      SEARCH_ONE_PIXEL
+    }
+  }
   /***********************************init process*************************/
   //for multi ref
   if(ref>0 && currSlice->structure == FRAME  && min_mcost > ET_Thred && SAD_prediction[pic_pix_x2] < p_UMHex->Multi_Ref_Thd_MB[blocktype])
@@ -32,6 +32,7 @@
 #include "macroblock.h"
 #include "me_distortion.h"
 #include "mv_search.h"
+#include "me_hme.h"
 
 
 static const MotionVector Diamond[4] = {{-4, 0}, {4, 0}, {0, -4}, {0, 4}};
@@ -201,6 +202,15 @@ smpUMHEXIntegerPelBlockMotionSearch (Macroblock *currMB,      // <--  current Ma
     iMinNow = best;
   }
 
+  // check the hierarchical pre-search vector (see me_hme.c)
+  if (currMB->p_Inp->HMEEnable && get_hme_predictor(currMB, mv_block, pred_mv, lambda_factor, &cand))
+  {
+    cand.mv_x = (short) (cand.mv_x + pic_pix_x);
+    cand.mv_y = (short) (cand.mv_y + pic_pix_y);
+    SEARCH_ONE_PIXEL;
+    iMinNow = best;
+  }
+
   // If the min_mcost is small enough, do a local search then terminate
   // Ihis is good for stationary or quasi-stationary areas
   if (min_mcost < (p_UMHexSMP->ConvergeThreshold >> block_type_shift_factor[blocktype]))
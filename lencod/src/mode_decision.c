@@ -108,6 +108,39 @@ void end_encode_one_macroblock(Macroblock *currMB)
 *    Initialize Encoding parameters for Macroblock
 *************************************************************************************
 */
+/*!
+*************************************************************************************
+* \brief
+*    Sets the chroma vector adjustment of the reference pictures of a
+*    (non MBAFF) slice. The reference pictures are shared by all slices
+*    of the picture, so they are only written if the value changes
+*    (see encode_slices_parallel())
+*************************************************************************************
+*/
+void set_chroma_vector_adjustment(Slice *currSlice)
+{
+  int l, k;
+
+  for (l = LIST_0; l < BI_PRED; l++)
+  {
+    for(k = 0; k < currSlice->listXsize[l]; k++)
+    {
+      StorablePicture *ref_pic = currSlice->listX[l][k];
+      int adjustment = 0;
+
+      if(currSlice->structure != ref_pic->structure)
+      {
+        if (currSlice->structure == TOP_FIELD)
+          adjustment = -2;
+        else if (currSlice->structure == BOTTOM_FIELD)
+          adjustment = 2;
+      }
+      if (ref_pic->chroma_vector_adjustment != adjustment)
+        ref_pic->chroma_vector_adjustment = adjustment;
+    }
+  }
+}
+
 void init_enc_mb_params(Macroblock* currMB, RD_PARAMS *enc_mb, int intra)
 {
   VideoParameters *p_Vid = currMB->p_Vid;
@@ -122,6 +155,8 @@ void init_enc_mb_params(Macroblock* currMB, RD_PARAMS *enc_mb, int intra)
   int l,k;
 
   enc_mb->curr_mb_field = (short) ((currSlice->mb_aff_frame_flag) && (currMB->mb_field));
+  enc_mb->prune_sub8x8  = 0;
+  enc_mb->cost16x16     = DISTBLK_MAX;
 
   // Set valid modes  
   enc_mb->valid[I8MB]  = (short) ((!p_Inp->DisableIntraInInter[p_Vid->view_id] || intra )?   p_Inp->Transform8x8Mode : 0);
@@ -193,23 +228,7 @@ void init_enc_mb_params(Macroblock* currMB, RD_PARAMS *enc_mb, int intra)
 
   if (!currSlice->mb_aff_frame_flag)
   {
-    for (l = LIST_0; l < BI_PRED; l++)
-    {
-      for(k = 0; k < currSlice->listXsize[l]; k++)
-      {
-        if(currSlice->structure != currSlice->listX[l][k]->structure)
-        {
-          if (currSlice->structure == TOP_FIELD)
-            currSlice->listX[l][k]->chroma_vector_adjustment = -2;
-          else if (currSlice->structure == BOTTOM_FIELD)
-            currSlice->listX[l][k]->chroma_vector_adjustment = 2;
-          else
-            currSlice->listX[l][k]->chroma_vector_adjustment= 0;
-        }
-        else
-          currSlice->listX[l][k]->chroma_vector_adjustment= 0;
-      }
-    }
+    set_chroma_vector_adjustment(currSlice);
   }
   else
   {
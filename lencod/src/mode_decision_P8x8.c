@@ -21,6 +21,7 @@
 #include "q_around.h"
 #include "md_common.h"
 #include "rdopt.h"
+#include "md_fast.h"
 
 
 void copy_part_info(Info8x8 *b8x8, Info8x8 *part)
@@ -250,6 +251,10 @@ void submacroblock_mode_decision_p_slice(Macroblock *currMB,
         else if(p_Inp->subMBCodingState == 2)
           currSlice->reset_coding_state (currMB, currSlice->p_RDO->cs_tmp);
       }
+
+      //--- FastMDHigh: no sub-8x8 partitions if the 8x8 partition leaves little to gain ---
+      if (mode == 4 && !transform8x8 && enc_mb->prune_sub8x8 && fast_md_prune_sub8x8(currMB, enc_mb, cnt_nonz, *cost))
+        break;
     } // if ((enc_mb->valid[mode] && (transform8x8 == 0 || mode != 0 || (mode == 0 && active_sps->direct_8x8_inference_flag)))
   } // for (min_rdcost=1e30, index = 1; index<6; index++)
 
@@ -597,6 +602,10 @@ void submacroblock_mode_decision_b_slice(Macroblock *currMB,
         else if(p_Inp->subMBCodingState == 2)
           currSlice->reset_coding_state (currMB, currSlice->p_RDO->cs_tmp);
       }
+
+      //--- FastMDHigh: no sub-8x8 partitions if the 8x8 partition leaves little to gain ---
+      if (mode == 4 && !transform8x8 && enc_mb->prune_sub8x8 && fast_md_prune_sub8x8(currMB, enc_mb, cnt_nonz, *cost))
+        break;
     } // if ((enc_mb->valid[mode] && (transform8x8 == 0 || mode != 0 || (mode == 0 && active_sps->direct_8x8_inference_flag)))
   } // for (min_rdcost=1e30, index = 0; index<6; index++)
 
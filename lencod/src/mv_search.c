@@ -769,6 +769,14 @@ void init_mv_block(Macroblock *currMB, MEBlock *mv_block, short blocktype, int l
     mv_block->computeBiPredHPel = p_Vid->computeBiPred1[H_PEL];
     mv_block->computeBiPredQPel = p_Vid->computeBiPred1[Q_PEL];
   }
+
+  // batched full pel evaluation (EPZS); multiple candidate kernels for plain SAD / SSE
+  if (mv_block->computePredFPel == computeSAD)
+    mv_block->computeBatchPredFPel = computeSADBatch;
+  else if (mv_block->computePredFPel == computeSSE)
+    mv_block->computeBatchPredFPel = computeSSEBatch;
+  else
+    mv_block->computeBatchPredFPel = computeUniPredBatch;
 }
 
 /*!
@@ -1559,6 +1567,62 @@ distblk GetDirectCostMB (Macroblock *currMB)
   return cost;
 }
 
+#if defined(OPENMP)
+/*!
+ ************************************************************************
+ * \brief
+ *    Motion search for a macroblock partition in all references of
+ *    mv_block->list, the references are searched concurrently
+ *    (MERefThreads)
+ *
+ * \par
+ *    Each reference gets its own copy of mv_block and of the original
+ *    block. The full searches keep no state across the references, so
+ *    the vectors and costs match those of the serial loop.
+ ************************************************************************
+ */
+static void reference_motion_search (Macroblock *currMB, MEBlock *mv_block, int blocktype, int block8x8, int *lambda_factor)
+{
+  VideoParameters *p_Vid = currMB->p_Vid;
+  InputParameters *p_Inp = currMB->p_Inp;
+  Slice *currSlice = currMB->p_Slice;
+  int list    = mv_block->list;
+  int num_ref = currSlice->listXsize[list + currMB->list_offset];
+  int size    = mv_block->blocksize_x * mv_block->blocksize_y;
+  int num_cmp = p_Inp->ChromaMEEnable ? 3 : 1;
+  short bx = bx0[blocktype][block8x8];
+  short by = by0[blocktype][block8x8];
+  int ref;
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(p_Inp->MERefThreads)
+  for (ref = 0; ref < num_ref; ++ref)
+  {
+    MEBlock  ref_block = *mv_block;
+    imgpel   orig_pels[3][MB_PIXELS];
+    imgpel  *orig_pic[3];
+    int k;
+
+    for (k = 0; k < num_cmp; ++k)
+    {
+      orig_pic[k] = orig_pels[k];
+      memcpy(orig_pic[k], mv_block->orig_pic[k], size * sizeof(imgpel));
+    }
+    ref_block.orig_pic = orig_pic;
+    ref_block.ref_idx  = (char) ref;
+    // in the serial loop the search of the previous reference already reset ChromaMEEnable
+    if (ref > 0)
+      ref_block.ChromaMEEnable = (p_Inp->ChromaMEEnable == ME_YUV_FP_SP ) ? TRUE : FALSE;
+
+    //----- set search range ---
+    get_search_range(&ref_block, p_Inp, (short) ref, blocktype);
+
+    p_Vid->motion_cost[blocktype][list][ref][block8x8] = BlockMotionSearch (currMB, &ref_block, bx<<2, by<<2, lambda_factor);
+  }
+
+  mv_block->ChromaMEEnable = (p_Inp->ChromaMEEnable == ME_YUV_FP_SP ) ? TRUE : FALSE;
+}
+#endif
+
 /*!
  ************************************************************************
  * \brief
@@ -1659,6 +1723,16 @@ void PartitionMotionSearch (Macroblock *currMB,
       {
         //----- set arrays -----
         mv_block.list = (char) list;
+#if defined(OPENMP)
+        if (p_Inp->MERefThreads > 1 && currSlice->listXsize[list+list_offset] > 1)
+        {
+          reference_motion_search (currMB, &mv_block, blocktype, block8x8, lambda_factor);
+
+          for (ref=0; ref < currSlice->listXsize[list+list_offset]; ref++)
+            set_me_parameters(motion, &currSlice->all_mv[list][ref][blocktype][by][bx], list, (char) ref, step_h, step_v, pic_block_y, pic_block_x);
+          continue;
+        }
+#endif
         for (ref=0; ref < currSlice->listXsize[list+list_offset]; ref++) 
         {
             mv_block.ref_idx = (char) ref;
@@ -16,6 +16,7 @@
 
 #include "pred_struct.h"
 #include "explicit_seq.h"
+#include "lookahead.h"
 
 #define DEBUG_PRED_STRUCT 0
 
@@ -456,8 +457,17 @@ SeqStructure * init_seq_structure( VideoParameters *p_Vid, InputParameters *p_In
   p_Vid->frm_struct_buffer = imin( p_Vid->frm_struct_buffer, p_Inp->no_frames );
   p_Inp->FrmStructBufferLength = imin( p_Inp->FrmStructBufferLength, p_Inp->no_frames ); 
 
-  p_Inp->FrmStructBufferLength = p_Inp->no_frames;
-  p_Vid->frm_struct_buffer = p_Inp->no_frames;
+  // the look-ahead pre-analysis reads the frames as the structure is populated, hence do not populate all frames at once;
+  // prediction structures may extend past the populated frames, so the buffer holds two population runs
+  if ( p_Inp->LookAheadFrames )
+  {
+    p_Vid->frm_struct_buffer = imin( 2 * p_Inp->FrmStructBufferLength, p_Inp->no_frames );
+  }
+  else
+  {
+    p_Inp->FrmStructBufferLength = p_Inp->no_frames;
+    p_Vid->frm_struct_buffer = p_Inp->no_frames;
+  }
 
   *memory_size += sizeof( SeqStructure );
 
@@ -468,7 +478,7 @@ SeqStructure * init_seq_structure( VideoParameters *p_Vid, InputParameters *p_In
   p_seq_struct->last_idr_frame           = 0;
   p_seq_struct->last_intra_frame         = 0;
   p_seq_struct->last_mmco_5_frame        = -1;
-  p_seq_struct->curr_num_to_populate     = p_Vid->frm_struct_buffer;
+  p_seq_struct->curr_num_to_populate     = p_Inp->FrmStructBufferLength;
   p_seq_struct->pop_start_frame          = 0;
   p_seq_struct->last_rand_access_disp    = 0;
   p_seq_struct->last_idr_disp            = 0;
@@ -477,6 +487,7 @@ SeqStructure * init_seq_structure( VideoParameters *p_Vid, InputParameters *p_In
   p_seq_struct->last_sp_frame            = 0;
   p_seq_struct->last_sp_disp             = 0;
   p_seq_struct->pop_flag                 = 0;
+  p_seq_struct->p_LA                     = p_Vid->p_LA;
 
 #if (MVC_EXTENSION_ENABLE)
   p_seq_struct->num_frames_mvc           = p_seq_struct->num_frames * p_Inp->num_of_views; // two views hence twice the buffer size
@@ -488,7 +499,7 @@ SeqStructure * init_seq_structure( VideoParameters *p_Vid, InputParameters *p_In
   init_gop_struct ( p_Inp, p_seq_struct, 1, memory_size ); // IDR GOPs
   init_gop_struct ( p_Inp, p_seq_struct, 0, memory_size ); // Intra GOPs
 
-  frames_to_pop = p_Vid->frm_struct_buffer;
+  frames_to_pop = p_Inp->FrmStructBufferLength;
 
   // populate frames
 #if (MVC_EXTENSION_ENABLE)
@@ -824,6 +835,34 @@ static int establish_intra( InputParameters *p_Inp, SeqStructure *p_seq_struct,
       }
     }
   }
+  // insert intra frames at the scene cuts detected by the look-ahead pre-analysis
+  if ( !is_intra && p_seq_struct->p_LA != NULL )
+  {
+    if ( !(p_Inp->PreferDispOrder) ) // coding order
+    {
+      is_intra = lookahead_scene_cut( p_seq_struct->p_LA, curr_frame );
+    }
+    else // display order (insertion)
+    {
+      int idx;
+      PredStructAtom *p_cur_gop;
+
+      for ( idx = (p_seq_struct->num_intra_gops - 1); idx >= 0; idx-- )
+      {
+        p_cur_gop = p_seq_struct->p_intra_gop + idx;
+        // check if length of structure overflows the available frame number
+        if ( sim ? (curr_frame + p_cur_gop->length) > p_Inp->no_frames : p_cur_gop->length > avail_frames )
+        {
+          continue;
+        }
+        if ( lookahead_scene_cut( p_seq_struct->p_LA, curr_frame + p_cur_gop->p_frm[0].disp_offset ) )
+        {
+          is_intra = 1 + idx;
+          break;
+        }
+      }
+    }
+  }
   // additional case can be added to insert IDR based on *pre-analysis* and other "pre-scient" tools
 
   return is_intra;
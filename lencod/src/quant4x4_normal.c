@@ -17,6 +17,7 @@
 #include "contributors.h"
 
 #include <math.h>
+#include <limits.h>
 
 #include "global.h"
 
@@ -28,6 +29,7 @@
 #include "q_offsets.h"
 #include "q_matrix.h"
 #include "quant4x4.h"
+#include "quant_kernels.h"
 
 /*!
  ************************************************************************
@@ -38,156 +40,39 @@
  */
 int quant_4x4_normal(Macroblock *currMB, int **tblock, struct quant_methods *q_method)
 {
-  VideoParameters *p_Vid = currMB->p_Vid;
-  QuantParameters *p_Quant = p_Vid->p_Quant;
-  Slice *currSlice = currMB->p_Slice;
-  Boolean is_cavlc = (Boolean) (currSlice->symbol_mode == CAVLC);
-
-  int   block_x = q_method->block_x;
-  int  qp = q_method->qp;
-  int*  ACL = &q_method->ACLevel[0];
-  int*  ACR = &q_method->ACRun[0];  
-  LevelQuantParams **q_params_4x4 = q_method->q_params;
-  const byte (*pos_scan)[2] = q_method->pos_scan;
-  const byte *c_cost = q_method->c_cost;
-  int *coeff_cost = q_method->coeff_cost;
-
-  
-  LevelQuantParams *q_params = NULL;
-  int i,j, coeff_ctr;
-
-  int *m7;
-  int scaled_coeff;
-
-  int   level, run = 0;
-  int   nonzero = FALSE;
-  int   qp_per = p_Quant->qp_per_matrix[qp];
-  int   q_bits = Q_BITS + qp_per;
-  const byte *p_scan = &pos_scan[0][0];
-
-  // Quantization
-  for (coeff_ctr = 0; coeff_ctr < 16; ++coeff_ctr)
-  {
-    i = *p_scan++;  // horizontal position
-    j = *p_scan++;  // vertical position
-
-    m7 = &tblock[j][block_x + i];
-
-    if (*m7 != 0)
-    {
-      q_params = &q_params_4x4[j][i];
-      scaled_coeff = iabs (*m7) * q_params->ScaleComp;
-      level = (scaled_coeff + q_params->OffsetComp) >> q_bits;
-
-      if (level != 0)
-      {
-        if (is_cavlc)
-          level = imin(level, CAVLC_LEVEL_LIMIT);
-
-        *coeff_cost += (level > 1) ? MAX_VALUE : c_cost[run];
+  QuantParameters *p_Quant = currMB->p_Vid->p_Quant;
+  int level_limit = (currMB->p_Slice->symbol_mode == CAVLC) ? CAVLC_LEVEL_LIMIT : INT_MAX;
+  int level[16];
+  QuantBlock qb;
+  uint64 nz;
 
-        level  = isignab(level, *m7);
-        *m7     = rshift_rnd_sf(((level * q_params->InvScaleComp) << qp_per), 4);
-        // inverse scale can be alternative performed as follows to ensure 16bit
-        // arithmetic is satisfied.
-        // *m7 = (qp_per<4) ? rshift_rnd_sf((level*q_params->InvScaleComp),4-qp_per) : (level*q_params->InvScaleComp)<<(qp_per-4);
-        *ACL++ = level;
-        *ACR++ = run; 
-        // reset zero level counter
-        run    = 0;
-        nonzero = TRUE;        
-      }
-      else
-      {
-        *m7 = 0;
-        ++run;
-      }
-    }
-    else
-    {
-      ++run;
-    } 
-  }
+  init_quant_block(&qb, tblock, q_method, BLOCK_SIZE, p_Quant->qp_per_matrix[q_method->qp], level_limit, level);
 
-  *ACL = 0;
+  // levels in raster order, then the level / run list in scan order
+  nz = tq_kernels.quant(&qb);
+  quant_pack_levels(&qb, nz, q_method->pos_scan, 16, q_method->ACLevel, q_method->ACRun, q_method->c_cost, q_method->coeff_cost);
 
-  return nonzero;
+  return (nz != 0);
 }
 
 int quant_ac4x4_normal(Macroblock *currMB, int **tblock, struct quant_methods *q_method)
 {
-  int   block_x = q_method->block_x;
-
-  int   qp = q_method->qp;
-  int*  ACL = &q_method->ACLevel[0];
-  int*  ACR = &q_method->ACRun[0]; 
-  LevelQuantParams **q_params_4x4 = q_method->q_params;
-  const byte (*pos_scan)[2] = q_method->pos_scan;
-  const byte *c_cost = q_method->c_cost;
-  int *coeff_cost = q_method->coeff_cost;
-
-  Boolean is_cavlc = (Boolean) (currMB->p_Slice->symbol_mode == CAVLC);
-  VideoParameters *p_Vid = currMB->p_Vid;
-  QuantParameters *p_Quant = p_Vid->p_Quant;
-  LevelQuantParams *q_params = NULL;
-
-  int i,j, coeff_ctr;
-
-  int *m7;
-  int scaled_coeff;
-
-  int   level, run = 0;
-  int   nonzero = FALSE;  
-  int   qp_per = p_Quant->qp_per_matrix[qp];
-  int   q_bits = Q_BITS + qp_per;
-  const byte *p_scan = &pos_scan[1][0];
-
-  // Quantization
-  for (coeff_ctr = 1; coeff_ctr < 16; ++coeff_ctr)
-  {
-    i = *p_scan++;  // horizontal position
-    j = *p_scan++;  // vertical position
-
-    m7 = &tblock[j][block_x + i];
-    if (*m7 != 0)
-    {
-      q_params = &q_params_4x4[j][i];
-      scaled_coeff = iabs (*m7) * q_params->ScaleComp;
-      level = (scaled_coeff + q_params->OffsetComp) >> q_bits;
-
-      if (level != 0)
-      {
-        if (is_cavlc)
-          level = imin(level, CAVLC_LEVEL_LIMIT);
-
-        *coeff_cost += (level > 1) ? MAX_VALUE : c_cost[run];
+  QuantParameters *p_Quant = currMB->p_Vid->p_Quant;
+  int level_limit = (currMB->p_Slice->symbol_mode == CAVLC) ? CAVLC_LEVEL_LIMIT : INT_MAX;
+  int level[16];
+  QuantBlock qb;
+  uint64 nz;
+  int block_x = q_method->block_x;
+  int dc = tblock[0][block_x];
 
-        level  = isignab(level, *m7);
-        *m7    = rshift_rnd_sf(((level * q_params->InvScaleComp) << qp_per), 4);
-        // inverse scale can be alternative performed as follows to ensure 16bit
-        // arithmetic is satisfied.
-        // *m7 = (qp_per<4) ? rshift_rnd_sf((level*q_params->InvScaleComp),4-qp_per) : (level*q_params->InvScaleComp)<<(qp_per-4);
-        *ACL++  = level;
-        *ACR++  = run; 
-        // reset zero level counter
-        run     = 0;
-        nonzero = TRUE;
-      }
-      else
-      {
-        *m7 = 0;
-        ++run;        
-      }
-    }
-    else
-    {
-      ++run;
-    }          
-  }
+  init_quant_block(&qb, tblock, q_method, BLOCK_SIZE, p_Quant->qp_per_matrix[q_method->qp], level_limit, level);
 
-  *ACL = 0;
+  // the DC coefficient is not part of the AC levels and stays untouched
+  nz = tq_kernels.quant(&qb) & ~(uint64) 1;
+  tblock[0][block_x] = dc;
+  quant_pack_levels(&qb, nz, &q_method->pos_scan[1], 15, q_method->ACLevel, q_method->ACRun, q_method->c_cost, q_method->coeff_cost);
 
-  return nonzero;
+  return (nz != 0);
 }
  
 /*!
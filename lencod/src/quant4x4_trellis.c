@@ -169,7 +169,7 @@ void rdoq_4x4_CABAC(Macroblock *currMB, int **tblock, struct quant_methods *q_me
   double lambda_md = p_Vid->lambda_rdoq[p_Vid->type][p_Vid->masterQP]; 
 
   noCoeff = init_trellis_data_4x4_CABAC(currMB, tblock, q_method, p_scan, &levelData[0], &kStart, &kStop, LUMA_4x4);
-  estBits = est_write_and_store_CBP_block_bit(currMB, LUMA_4x4);
+  estBits = (noCoeff > 0) ? est_write_and_store_CBP_block_bit(currMB, LUMA_4x4) : 0;
   est_writeRunLevel_CABAC(currMB, levelData, levelTrellis, LUMA_4x4, lambda_md, kStart, kStop, noCoeff, estBits);
 }
 
@@ -314,7 +314,7 @@ void rdoq_ac4x4_CABAC(Macroblock *currMB, int **tblock, struct quant_methods *q_
   int kStart = 0, kStop = 0, noCoeff = 0, estBits;
 
   noCoeff = init_trellis_data_4x4_CABAC(currMB, tblock, q_method, p_scan, &levelData[0], &kStart, &kStop, type);
-  estBits = est_write_and_store_CBP_block_bit(currMB, type);
+  estBits = (noCoeff > 0) ? est_write_and_store_CBP_block_bit(currMB, type) : 0;
   est_writeRunLevel_CABAC(currMB, levelData, levelTrellis, type, lambda_md, kStart, kStop, noCoeff, estBits);
 }
 
@@ -427,7 +427,7 @@ void rdoq_dc_CABAC(Macroblock *currMB, int **tblock, int qp_per, int qp_rem, Lev
   int kStart = 0, kStop = 0, noCoeff = 0, estBits;
 
   noCoeff = init_trellis_data_DC_CABAC(currMB, tblock, qp_per, qp_rem, q_params_4x4, p_scan, &levelData[0], &kStart, &kStop);
-  estBits = est_write_and_store_CBP_block_bit(currMB, type);
+  estBits = (noCoeff > 0) ? est_write_and_store_CBP_block_bit(currMB, type) : 0;
   est_writeRunLevel_CABAC(currMB, levelData, levelTrellis, type, lambda_md, kStart, kStop, noCoeff, estBits);
 }
 
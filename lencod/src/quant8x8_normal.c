@@ -16,6 +16,7 @@
 #include "contributors.h"
 
 #include <math.h>
+#include <limits.h>
 
 #include "global.h"
 
@@ -27,6 +28,7 @@
 #include "q_offsets.h"
 #include "q_matrix.h"
 #include "quant8x8.h"
+#include "quant_kernels.h"
 
 
 /*!
@@ -42,70 +44,19 @@
  */
 int quant_8x8_normal(Macroblock *currMB, int **tblock, struct quant_methods *q_method)
 {
-  VideoParameters *p_Vid = currMB->p_Vid;
-  QuantParameters *p_Quant = p_Vid->p_Quant;
-  int block_x = q_method->block_x;
-  int*  ACLevel = q_method->ACLevel;
-  int*  ACRun   = q_method->ACRun;
-  int  qp = q_method->qp;
-  LevelQuantParams **q_params_8x8 = q_method->q_params;
-  const byte (*pos_scan)[2] = q_method->pos_scan;
-  const byte *c_cost = q_method->c_cost;
-  int *coeff_cost = q_method->coeff_cost;
-
-  int i,j, coeff_ctr;
-
-  int *m7;
-  int scaled_coeff;
-
-  int   level, run = 0;
-  int   nonzero = FALSE;
-  int   qp_per = p_Quant->qp_per_matrix[qp];
-  int   q_bits = Q_BITS_8 + qp_per;
-  const byte *p_scan = &pos_scan[0][0];
-  int*  ACL = &ACLevel[0];
-  int*  ACR = &ACRun[0];
-
-  // Quantization
-  for (coeff_ctr = 0; coeff_ctr < 64; coeff_ctr++)
-  {
-    i = *p_scan++;  // horizontal position
-    j = *p_scan++;  // vertical position
-
-    m7 = &tblock[j][block_x + i];
-    if (*m7 != 0)
-    {
-      scaled_coeff = iabs (*m7) * q_params_8x8[j][i].ScaleComp;
-      level = (scaled_coeff + q_params_8x8[j][i].OffsetComp) >> q_bits;
-
-      if (level != 0)
-      {
-        nonzero = TRUE;
-
-        *coeff_cost += (level > 1) ? MAX_VALUE : c_cost[run];
+  QuantParameters *p_Quant = currMB->p_Vid->p_Quant;
+  int level_limit = INT_MAX;
+  int level[64];
+  QuantBlock qb;
+  uint64 nz;
 
-        level  = isignab(level, *m7);
-        *m7    = rshift_rnd_sf(((level * q_params_8x8[j][i].InvScaleComp) << qp_per), 6);
-        *ACL++ = level;
-        *ACR++ = run; 
-        // reset zero level counter
-        run    = 0;
-      }
-      else
-      {
-        run++;
-        *m7 = 0;
-      }
-    }
-    else
-    {
-      run++;
-    }
-  }
+  init_quant_block(&qb, tblock, q_method, BLOCK_SIZE_8x8, p_Quant->qp_per_matrix[q_method->qp], level_limit, level);
 
-  *ACL = 0;
+  // levels in raster order, then the level / run list in scan order
+  nz = tq_kernels.quant(&qb);
+  quant_pack_levels(&qb, nz, q_method->pos_scan, 64, q_method->ACLevel, q_method->ACRun, q_method->c_cost, q_method->coeff_cost);
 
-  return nonzero;
+  return (nz != 0);
 }
 
 /*!
@@ -123,80 +74,19 @@ int quant_8x8_normal(Macroblock *currMB, int **tblock, struct quant_methods *q_m
 int quant_8x8cavlc_normal(Macroblock *currMB, int **tblock, struct quant_methods *q_method, int***  cofAC)
 {
   QuantParameters *p_Quant = currMB->p_Vid->p_Quant;
-  int block_x = q_method->block_x;
-
-  int  qp = q_method->qp;
-  LevelQuantParams **q_params_8x8 = q_method->q_params;
-  const byte (*pos_scan)[2] = q_method->pos_scan;
-  const byte *c_cost = q_method->c_cost;
-  int *coeff_cost = q_method->coeff_cost;  
-
-
-  int i,j, k, coeff_ctr;
-
-  int *m7;
-  int scaled_coeff;  
-
-  int level, runs[4] = { 0 };
-  int nonzero = FALSE; 
-  int qp_per = p_Quant->qp_per_matrix[qp];  
-  int q_bits = Q_BITS_8 + qp_per;
-  const byte *p_scan = &pos_scan[0][0];
-  int*  ACL[4];  
-  int*  ACR[4];
-
-  for (k = 0; k < 4; k++)
-  {
-    ACL[k] = &cofAC[k][0][0];
-    ACR[k] = &cofAC[k][1][0];
-  }
-
-  // Quantization
-  for (k = 0; k < 4; k++)
-  {
-    for (coeff_ctr = 0; coeff_ctr < 16; coeff_ctr++)
-    {
-      i = *p_scan++;  // horizontal position
-      j = *p_scan++;  // vertical position
-
-      m7 = &tblock[j][block_x + i];
-      if (*m7 != 0)
-      {
-      scaled_coeff = iabs (*m7) * q_params_8x8[j][i].ScaleComp;
-      level = (scaled_coeff + q_params_8x8[j][i].OffsetComp) >> q_bits;
-
-      if (level != 0)
-      {
-        level = imin(level, CAVLC_LEVEL_LIMIT);
-
-        nonzero=TRUE;
-
-        *coeff_cost += (level > 1) ? MAX_VALUE : c_cost[runs[k]];
-
-        level  = isignab(level, *m7);
-        *m7    = rshift_rnd_sf(((level * q_params_8x8[j][i].InvScaleComp) << qp_per), 6);
+  int level_limit = CAVLC_LEVEL_LIMIT;
+  int level[64];
+  QuantBlock qb;
+  uint64 nz;
+  int k;
 
-        *(ACL[k])++ = level;
-        *(ACR[k])++ = runs[k];
-        // reset zero level counter
-        runs[k] = 0;
-      }
-      else
-      {        
-          runs[k]++;
-          *m7 = 0;      
-        }
-      }
-      else
-      {
-        runs[k]++;
-      }
-    }
-  }
+  init_quant_block(&qb, tblock, q_method, BLOCK_SIZE_8x8, p_Quant->qp_per_matrix[q_method->qp], level_limit, level);
 
-  for(k = 0; k < 4; k++)
-    *(ACL[k]) = 0;
+  // levels in raster order, then the four interleaved level / run lists in scan order
+  nz = tq_kernels.quant(&qb);
+  for (k = 0; k < 4; ++k)
+    quant_pack_levels(&qb, nz, &q_method->pos_scan[16 * k], 16, cofAC[k][0], cofAC[k][1], q_method->c_cost, q_method->coeff_cost);
 
-  return nonzero;
+  return (nz != 0);
 }
 
@@ -0,0 +1,398 @@
+/*!
+*************************************************************************************
+* \file quant_kernels.c
+*
+* \brief
+*    Forward transform and quantization kernels of the 4x4 and 8x8 residual
+*    coding (normal and adaptive rounding quantizers).
+*
+*    The quantization kernel processes a block in raster order: it computes
+*    all levels, the reconstructed coefficients and the adaptive rounding
+*    adjustments in one pass and returns the mask of the nonzero levels.
+*    quant_pack_levels() then turns the mask into the level / run lists in
+*    scan order, visiting only the scan positions up to the last nonzero
+*    level.
+*
+*    Portable C kernels are always available. On x86 CPUs SSE4.1 versions
+*    are selected at run time (see init_quant_kernels()). All kernels return
+*    exactly the same values as the C versions.
+*
+*************************************************************************************
+*/
+
+#include "contributors.h"
+
+#include "global.h"
+#include "transform.h"
+#include "mbuffer.h"
+#include "me_distortion.h"
+#include "quant_kernels.h"
+
+#if (JM_SIMD_DISTORTION) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#  define SIMD_X86      1
+#  define TARGET_SSE41  __attribute__((target("sse4.1")))
+#elif (JM_SIMD_DISTORTION) && defined(_MSC_VER) && (_MSC_VER >= 1700) && (defined(_M_X64) || defined(_M_IX86))
+#  define SIMD_X86      1
+#  define TARGET_SSE41
+#else
+#  define SIMD_X86      0
+#endif
+
+#if (SIMD_X86)
+#include <immintrin.h>
+#endif
+
+TransformQuantKernels tq_kernels;
+
+/*!
+***********************************************************************
+* \brief
+*    Sets up the quantization of a size x size block of a quant_methods
+*    call (normal quantizer: no rounding adjustments)
+***********************************************************************
+*/
+void init_quant_block (QuantBlock *qb, int **tblock, QuantMethods *q_method, int size, int qp_per, int level_limit, int *level)
+{
+  qb->tblock           = tblock;
+  qb->fadjust          = NULL;
+  qb->level            = level;
+  qb->q_params         = q_method->q_params;
+  qb->block_x          = q_method->block_x;
+  qb->size             = size;
+  qb->qp_per           = qp_per;
+  qb->q_bits           = ((size == 8) ? Q_BITS_8 : Q_BITS) + qp_per;
+  qb->dq_bits          = (size == 8) ? 6 : 4;
+  qb->level_limit      = level_limit;
+  qb->adapt_rnd_weight = 0;
+}
+
+/*!
+***********************************************************************
+* \brief
+*    Writes the nonzero levels of num scan positions to the level / run
+*    lists and updates the coefficient cost. nz is the nonzero mask
+*    returned by the quantization kernel; the scan stops after the last
+*    nonzero level.
+***********************************************************************
+*/
+void quant_pack_levels (QuantBlock *qb, uint64 nz, const byte (*pos_scan)[2], int num, int *ACL, int *ACR, const byte *c_cost, int *coeff_cost)
+{
+  int shift = (qb->size == 8) ? 3 : 2;
+  int run = 0, k;
+
+  for (k = 0; k < num && nz != 0; ++k)
+  {
+    int    pos = (pos_scan[k][1] << shift) + pos_scan[k][0];
+    uint64 bit = (uint64) 1 << pos;
+
+    if (nz & bit)
+    {
+      int level = qb->level[pos];
+
+      nz &= ~bit;
+      *coeff_cost += (iabs(level) > 1) ? MAX_VALUE : c_cost[run];
+      *ACL++ = level;
+      *ACR++ = run;
+      run = 0;
+    }
+    else
+      ++run;
+  }
+
+  *ACL = 0;
+}
+
+/*!
+***********************************************************************
+* \brief
+*    Quantization of a block (C version)
+***********************************************************************
+*/
+static uint64 quant_block (QuantBlock *qb)
+{
+  int size = qb->size, q_bits = qb->q_bits, qp_per = qb->qp_per, dq_bits = qb->dq_bits;
+  uint64 nz = 0;
+  int i, j;
+
+  for (j = 0; j < size; ++j)
+  {
+    int *m7  = &qb->tblock[j][qb->block_x];
+    int *adj = (qb->fadjust != NULL) ? &qb->fadjust[j][qb->block_x] : NULL;
+    int *lev = &qb->level[j * size];
+    LevelQuantParams *q_params = qb->q_params[j];
+
+    for (i = 0; i < size; ++i)
+    {
+      int level = 0;
+
+      if (m7[i] != 0)
+      {
+        int scaled_coeff = iabs (m7[i]) * q_params[i].ScaleComp;
+
+        level = imin((scaled_coeff + q_params[i].OffsetComp) >> q_bits, qb->level_limit);
+        if (level != 0)
+        {
+          if (adj)
+            adj[i] = rshift_rnd_sf((qb->adapt_rnd_weight * (scaled_coeff - (level << q_bits))), q_bits + 1);
+          level = isignab(level, m7[i]);
+          m7[i] = rshift_rnd_sf(((level * q_params[i].InvScaleComp) << qp_per), dq_bits);
+          nz |= (uint64) 1 << (j * size + i);
+        }
+      }
+      if (level == 0)
+      {
+        if (adj)
+          adj[i] = 0;
+        m7[i] = 0;
+      }
+      lev[i] = level;
+    }
+  }
+  return nz;
+}
+
+#if (SIMD_X86)
+
+//! 4x4 transpose of four rows of 32 bit values
+#define TRANSPOSE4_EPI32(r0, r1, r2, r3)                   \
+  {                                                        \
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1);               \
+    __m128i t1 = _mm_unpacklo_epi32(r2, r3);               \
+    __m128i t2 = _mm_unpackhi_epi32(r0, r1);               \
+    __m128i t3 = _mm_unpackhi_epi32(r2, r3);               \
+    r0 = _mm_unpacklo_epi64(t0, t1);                       \
+    r1 = _mm_unpackhi_epi64(t0, t1);                       \
+    r2 = _mm_unpacklo_epi64(t2, t3);                       \
+    r3 = _mm_unpackhi_epi64(t2, t3);                       \
+  }
+
+/*!
+***********************************************************************
+* \brief
+*    4x4 forward integer transform (SSE4.1)
+***********************************************************************
+*/
+TARGET_SSE41 static void forward4x4_sse41 (int **block, int **tblock, int pos_y, int pos_x)
+{
+  __m128i p0 = _mm_loadu_si128((__m128i *) &block[pos_y    ][pos_x]);
+  __m128i p1 = _mm_loadu_si128((__m128i *) &block[pos_y + 1][pos_x]);
+  __m128i p2 = _mm_loadu_si128((__m128i *) &block[pos_y + 2][pos_x]);
+  __m128i p3 = _mm_loadu_si128((__m128i *) &block[pos_y + 3][pos_x]);
+  __m128i t0, t1, t2, t3;
+
+  // Horizontal (one row per lane)
+  TRANSPOSE4_EPI32(p0, p1, p2, p3);
+  t0 = _mm_add_epi32(p0, p3);
+  t1 = _mm_add_epi32(p1, p2);
+  t2 = _mm_sub_epi32(p1, p2);
+  t3 = _mm_sub_epi32(p0, p3);
+  p0 = _mm_add_epi32(t0, t1);
+  p1 = _mm_add_epi32(_mm_slli_epi32(t3, 1), t2);
+  p2 = _mm_sub_epi32(t0, t1);
+  p3 = _mm_sub_epi32(t3, _mm_slli_epi32(t2, 1));
+
+  // Vertical (one column per lane)
+  TRANSPOSE4_EPI32(p0, p1, p2, p3);
+  t0 = _mm_add_epi32(p0, p3);
+  t1 = _mm_add_epi32(p1, p2);
+  t2 = _mm_sub_epi32(p1, p2);
+  t3 = _mm_sub_epi32(p0, p3);
+  _mm_storeu_si128((__m128i *) &tblock[pos_y    ][pos_x], _mm_add_epi32(t0, t1));
+  _mm_storeu_si128((__m128i *) &tblock[pos_y + 1][pos_x], _mm_add_epi32(t2, _mm_slli_epi32(t3, 1)));
+  _mm_storeu_si128((__m128i *) &tblock[pos_y + 2][pos_x], _mm_sub_epi32(t0, t1));
+  _mm_storeu_si128((__m128i *) &tblock[pos_y + 3][pos_x], _mm_sub_epi32(t3, _mm_slli_epi32(t2, 1)));
+}
+
+/*!
+***********************************************************************
+* \brief
+*    One dimensional 8 point forward transform of four lanes
+***********************************************************************
+*/
+TARGET_SSE41 static inline void butterfly8_sse41 (const __m128i *p, __m128i *o)
+{
+  __m128i a0 = _mm_add_epi32(p[0], p[7]);
+  __m128i a1 = _mm_add_epi32(p[1], p[6]);
+  __m128i a2 = _mm_add_epi32(p[2], p[5]);
+  __m128i a3 = _mm_add_epi32(p[3], p[4]);
+  __m128i b0 = _mm_add_epi32(a0, a3);
+  __m128i b1 = _mm_add_epi32(a1, a2);
+  __m128i b2 = _mm_sub_epi32(a0, a3);
+  __m128i b3 = _mm_sub_epi32(a1, a2);
+  __m128i b4, b5, b6, b7;
+
+  a0 = _mm_sub_epi32(p[0], p[7]);
+  a1 = _mm_sub_epi32(p[1], p[6]);
+  a2 = _mm_sub_epi32(p[2], p[5]);
+  a3 = _mm_sub_epi32(p[3], p[4]);
+
+  b4 = _mm_add_epi32(_mm_add_epi32(a1, a2), _mm_add_epi32(_mm_srai_epi32(a0, 1), a0));
+  b5 = _mm_sub_epi32(_mm_sub_epi32(a0, a3), _mm_add_epi32(_mm_srai_epi32(a2, 1), a2));
+  b6 = _mm_sub_epi32(_mm_add_epi32(a0, a3), _mm_add_epi32(_mm_srai_epi32(a1, 1), a1));
+  b7 = _mm_add_epi32(_mm_sub_epi32(a1, a2), _mm_add_epi32(_mm_srai_epi32(a3, 1), a3));
+
+  o[0] = _mm_add_epi32(b0, b1);
+  o[1] = _mm_add_epi32(b4, _mm_srai_epi32(b7, 2));
+  o[2] = _mm_add_epi32(b2, _mm_srai_epi32(b3, 1));
+  o[3] = _mm_add_epi32(b5, _mm_srai_epi32(b6, 2));
+  o[4] = _mm_sub_epi32(b0, b1);
+  o[5] = _mm_sub_epi32(b6, _mm_srai_epi32(b5, 2));
+  o[6] = _mm_sub_epi32(_mm_srai_epi32(b2, 1), b3);
+  o[7] = _mm_sub_epi32(_mm_srai_epi32(b4, 2), b7);
+}
+
+/*!
+***********************************************************************
+* \brief
+*    8x8 forward integer transform (SSE4.1), in 4x4 quarters
+***********************************************************************
+*/
+TARGET_SSE41 static void forward8x8_sse41 (int **block, int **tblock, int pos_y, int pos_x)
+{
+  __m128i p[8], tmp[2][8], col[2][8];
+  int h, g, k;
+
+  // Horizontal: tmp[h][k] holds column k of the rows 4h..4h+3 (one row per lane)
+  for (h = 0; h < 2; ++h)
+  {
+    for (k = 0; k < 4; ++k)
+    {
+      p[k]     = _mm_loadu_si128((__m128i *) &block[pos_y + 4 * h + k][pos_x]);
+      p[k + 4] = _mm_loadu_si128((__m128i *) &block[pos_y + 4 * h + k][pos_x + 4]);
+    }
+    TRANSPOSE4_EPI32(p[0], p[1], p[2], p[3]);
+    TRANSPOSE4_EPI32(p[4], p[5], p[6], p[7]);
+    butterfly8_sse41(p, tmp[h]);
+  }
+
+  // Vertical: col[g][r] holds the columns 4g..4g+3 of row r (one column per lane)
+  for (g = 0; g < 2; ++g)
+  {
+    for (h = 0; h < 2; ++h)
+    {
+      __m128i *q = &col[g][4 * h];
+
+      q[0] = tmp[h][4 * g];
+      q[1] = tmp[h][4 * g + 1];
+      q[2] = tmp[h][4 * g + 2];
+      q[3] = tmp[h][4 * g + 3];
+      TRANSPOSE4_EPI32(q[0], q[1], q[2], q[3]);
+    }
+    butterfly8_sse41(col[g], p);
+    for (k = 0; k < 8; ++k)
+      _mm_storeu_si128((__m128i *) &tblock[pos_y + k][pos_x + 4 * g], p[k]);
+  }
+}
+
+//! per block constants of the SSE4.1 quantization
+typedef struct quant_const_sse41
+{
+  __m128i q_bits, qp_per, dq_bits, q_bits1;
+  __m128i dq_round, adj_round, limit, weight;
+} QuantConstSSE41;
+
+/*!
+***********************************************************************
+* \brief
+*    Quantization of four coefficients (SSE4.1). Returns the nonzero
+*    mask of the four levels.
+***********************************************************************
+*/
+TARGET_SSE41 static inline int quant4_sse41 (int *m7, int *adj, LevelQuantParams *q_params, int *lev, const QuantConstSSE41 *k)
+{
+  // deinterleave OffsetComp / ScaleComp / InvScaleComp of four coefficients
+  __m128 a = _mm_castsi128_ps(_mm_loadu_si128((__m128i *) q_params));
+  __m128 b = _mm_castsi128_ps(_mm_loadu_si128((__m128i *) q_params + 1));
+  __m128 c = _mm_castsi128_ps(_mm_loadu_si128((__m128i *) q_params + 2));
+  __m128i offset = _mm_castps_si128(_mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 0, 0)),
+                                                   _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+  __m128i scale  = _mm_castps_si128(_mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+                                                   _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+  __m128i inv    = _mm_castps_si128(_mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+                                                   _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+  __m128i coef   = _mm_loadu_si128((__m128i *) m7);
+  __m128i zero   = _mm_setzero_si128();
+  __m128i scaled = _mm_mullo_epi32(_mm_abs_epi32(coef), scale);
+  __m128i level  = _mm_min_epi32(_mm_sra_epi32(_mm_add_epi32(scaled, offset), k->q_bits), k->limit);
+  __m128i is_zero = _mm_or_si128(_mm_cmpeq_epi32(level, zero), _mm_cmpeq_epi32(coef, zero));
+  __m128i rec;
+
+  level = _mm_andnot_si128(is_zero, level);
+  if (adj)
+  {
+    __m128i diff = _mm_sub_epi32(scaled, _mm_sll_epi32(level, k->q_bits));
+    __m128i val  = _mm_sra_epi32(_mm_add_epi32(_mm_mullo_epi32(k->weight, diff), k->adj_round), k->q_bits1);
+    _mm_storeu_si128((__m128i *) adj, _mm_andnot_si128(is_zero, val));
+  }
+  level = _mm_sign_epi32(level, coef);
+  rec   = _mm_sll_epi32(_mm_mullo_epi32(level, inv), k->qp_per);
+  rec   = _mm_sra_epi32(_mm_add_epi32(rec, k->dq_round), k->dq_bits);
+  _mm_storeu_si128((__m128i *) m7, rec);
+  _mm_storeu_si128((__m128i *) lev, level);
+
+  return (~_mm_movemask_ps(_mm_castsi128_ps(is_zero))) & 0x0F;
+}
+
+/*!
+***********************************************************************
+* \brief
+*    Quantization of a block (SSE4.1)
+***********************************************************************
+*/
+TARGET_SSE41 static uint64 quant_block_sse41 (QuantBlock *qb)
+{
+  QuantConstSSE41 k;
+  int size = qb->size;
+  uint64 nz = 0;
+  int i, j;
+
+  k.q_bits    = _mm_cvtsi32_si128(qb->q_bits);
+  k.q_bits1   = _mm_cvtsi32_si128(qb->q_bits + 1);
+  k.qp_per    = _mm_cvtsi32_si128(qb->qp_per);
+  k.dq_bits   = _mm_cvtsi32_si128(qb->dq_bits);
+  k.dq_round  = _mm_set1_epi32(1 << (qb->dq_bits - 1));
+  k.adj_round = _mm_set1_epi32(1 << qb->q_bits);
+  k.limit     = _mm_set1_epi32(qb->level_limit);
+  k.weight    = _mm_set1_epi32(qb->adapt_rnd_weight);
+
+  for (j = 0; j < size; ++j)
+  {
+    int *m7  = &qb->tblock[j][qb->block_x];
+    int *adj = (qb->fadjust != NULL) ? &qb->fadjust[j][qb->block_x] : NULL;
+
+    for (i = 0; i < size; i += 4)
+    {
+      int mask = quant4_sse41(m7 + i, adj ? adj + i : NULL, qb->q_params[j] + i, &qb->level[j * size + i], &k);
+      nz |= (uint64) mask << (j * size + i);
+    }
+  }
+  return nz;
+}
+
+#endif
+
+/*!
+***********************************************************************
+* \brief
+*    Selects the transform and quantization kernels of the given
+*    instruction set level (see init_distortion_kernels())
+***********************************************************************
+*/
+void init_quant_kernels (int level)
+{
+  tq_kernels.forward4x4 = forward4x4;
+  tq_kernels.forward8x8 = forward8x8;
+  tq_kernels.quant      = quant_block;
+
+#if (SIMD_X86)
+  if (level >= SIMD_SSE41)
+  {
+    tq_kernels.forward4x4 = forward4x4_sse41;
+    tq_kernels.forward8x8 = forward8x8_sse41;
+    tq_kernels.quant      = quant_block_sse41;
+  }
+#else
+  (void) level;
+#endif
+}
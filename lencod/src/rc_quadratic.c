@@ -22,6 +22,7 @@
 
 #include "global.h"
 #include "ratectl.h"
+#include "lookahead.h"
 
 
 static const float THETA = 1.3636F;
@@ -250,6 +251,7 @@ void rc_init_seq(VideoParameters *p_Vid, InputParameters *p_Inp, RCQuadratic *p_
     p_quad->Pm_rgRp[i] = 0.0;
     p_quad->PPictureMAD[i] = 0.0;
   }
+  p_quad->PPictureFrameNo = -1;
 
   //Define the largest variation of quantization parameters
   p_quad->PMaxQpChange = p_Inp->RCMaxQPChange;
@@ -1041,7 +1043,10 @@ void updateRCModel (VideoParameters *p_Vid, InputParameters *p_Inp, RCQuadratic
     if( MADModelFlag )
       updateMADModel(p_Vid, p_Inp, p_quad, p_gen);
     else if( p_Vid->type == P_SLICE || (p_Inp->RCUpdateMode == RC_MODE_1 && (p_Vid->number != 0)) )
+    {
       p_quad->PPictureMAD[0] = p_quad->CurrentFrameMAD;
+      p_quad->PPictureFrameNo = p_Vid->frame_no;
+    }
   }
 }
 
@@ -1151,6 +1156,7 @@ void updateMADModel (VideoParameters *p_Vid, InputParameters *p_Inp, RCQuadratic
     }
     p_quad->PPictureMAD[0] = p_quad->CurrentFrameMAD;
     p_quad->PictureMAD[0]  = p_quad->PPictureMAD[0];
+    p_quad->PPictureFrameNo = p_Vid->frame_no;
 
     if(p_Vid->BasicUnit == p_Vid->FrameSizeInMbs)
       p_quad->ReferenceMAD[0]=p_quad->PictureMAD[1];
@@ -1282,6 +1288,21 @@ void MADModelEstimator (VideoParameters *p_Vid, InputParameters *p_Inp, RCQuadra
   }
 }
 
+/*!
+ *************************************************************************************
+ * \brief
+ *    complexity change, measured by the look-ahead pre-analysis, between the picture
+ *    of the last P picture MAD and the current picture (1.0 without pre-analysis)
+ *************************************************************************************
+*/
+static double lookaheadMADRatio( VideoParameters *p_Vid, RCQuadratic *p_quad )
+{
+  if ( p_Vid->p_LA == NULL )
+    return 1.0;
+
+  return lookahead_complexity_ratio( p_Vid->p_LA, p_Vid->frame_no, p_quad->PPictureFrameNo );
+}
+
 /*!
  *************************************************************************************
  * \brief
@@ -1382,6 +1403,7 @@ int updateQPRC0(VideoParameters *p_Vid, InputParameters *p_Inp, RCQuadratic *p_q
 
         /* predict the MAD of current picture*/
         p_quad->CurrentFrameMAD = p_quad->MADPictureC1*p_quad->PreviousPictureMAD + p_quad->MADPictureC2;
+        p_quad->CurrentFrameMAD *= lookaheadMADRatio( p_Vid, p_quad );
 
         /*compute the number of bits for the texture*/
         if(p_quad->Target < 0)
@@ -1586,6 +1608,7 @@ int updateQPRC1(VideoParameters *p_Vid, InputParameters *p_Inp, RCQuadratic *p_q
 
         /* predict the MAD of current picture*/
         p_quad->CurrentFrameMAD=p_quad->MADPictureC1*p_quad->PreviousPictureMAD + p_quad->MADPictureC2;
+        p_quad->CurrentFrameMAD *= lookaheadMADRatio( p_Vid, p_quad );
 
         /*compute the number of bits for the texture*/
         if(p_quad->Target < 0)
@@ -1765,6 +1788,7 @@ int updateQPRC2(VideoParameters *p_Vid, InputParameters *p_Inp, RCQuadratic *p_q
 
         /* predict the MAD of current picture*/
         p_quad->CurrentFrameMAD=p_quad->MADPictureC1*p_quad->PreviousPictureMAD + p_quad->MADPictureC2;
+        p_quad->CurrentFrameMAD *= lookaheadMADRatio( p_Vid, p_quad );
 
         /*compute the number of bits for the texture*/
         if(p_quad->Target < 0)
@@ -1959,6 +1983,7 @@ int updateQPRC3(VideoParameters *p_Vid, InputParameters *p_Inp, RCQuadratic *p_q
 
         /* predict the MAD of current picture*/
         p_quad->CurrentFrameMAD=p_quad->MADPictureC1*p_quad->PreviousPictureMAD + p_quad->MADPictureC2;
+        p_quad->CurrentFrameMAD *= lookaheadMADRatio( p_Vid, p_quad );
 
         /*compute the number of bits for the texture*/
         if(p_quad->Target < 0)
@@ -47,7 +47,9 @@
 #include "mv_search.h"
 #include "md_common.h"
 #include "md_distortion.h"
+#include "me_distortion.h"
 #include "intra16x16.h"
+#include "md_reuse.h"
 
 #define FASTMODE 1
 
@@ -130,9 +132,9 @@ void clear_rdopt (Slice *currSlice)
 
   // Should create new functions for free/alloc of RD_8x8DATA
   free_rd8x8data(p_RDO->tr4x4);
-  free(p_RDO->tr4x4);
+  mem_free(p_RDO->tr4x4);
   free_rd8x8data(p_RDO->tr8x8);
-  free(p_RDO->tr8x8);
+  mem_free(p_RDO->tr8x8);
 
   free_mem4Dmv(p_RDO->all_mv8x8);
 
@@ -155,6 +157,8 @@ void clear_rdopt (Slice *currSlice)
   delete_coding_state (p_RDO->cs_b8);
   delete_coding_state (p_RDO->cs_cm);
   delete_coding_state (p_RDO->cs_tmp);
+  delete_ctx_journal (currSlice->ctx_journal);
+  currSlice->ctx_journal = NULL;
 }
 
 void setupDistCost(Slice *currSlice, InputParameters *p_Inp)
@@ -209,10 +213,10 @@ void init_rdopt (Slice *currSlice)
     get_mem_ACcoeff_new(&p_RDO->cofAC8x8ts, 3);
   }
 
-  if (((p_RDO->tr4x4)  = (RD_8x8DATA *) calloc(1, sizeof(RD_8x8DATA)))==NULL) 
+  if (((p_RDO->tr4x4)  = (RD_8x8DATA *) mem_calloc(1, sizeof(RD_8x8DATA)))==NULL) 
     no_mem_exit("init_rdopt: p_RDO->tr4x4");
   alloc_rd8x8data(p_RDO->tr4x4);
-  if (((p_RDO->tr8x8)  = (RD_8x8DATA *) calloc(1, sizeof(RD_8x8DATA)))==NULL) 
+  if (((p_RDO->tr8x8)  = (RD_8x8DATA *) mem_calloc(1, sizeof(RD_8x8DATA)))==NULL) 
     no_mem_exit("init_rdopt: p_RDO->tr4x4");
   alloc_rd8x8data(p_RDO->tr8x8);
 
@@ -274,6 +278,8 @@ void init_rdopt (Slice *currSlice)
   p_RDO->cs_b8  = create_coding_state (p_Inp);
   p_RDO->cs_cm  = create_coding_state (p_Inp);
   p_RDO->cs_tmp = create_coding_state (p_Inp);
+  if (p_Inp->rdopt != 0 && currSlice->symbol_mode == CABAC)
+    currSlice->ctx_journal = create_ctx_journal (currSlice);
   if (p_Inp->CtxAdptLagrangeMult == 1)
   {
     p_Vid->mb16x16_cost = CALM_MF_FACTOR_THRESHOLD;
@@ -307,6 +313,9 @@ void init_rdopt (Slice *currSlice)
 
   setupDistortion(currSlice);
   setupDistCost  (currSlice, p_Inp);
+
+  // coding decisions taken from a macroblock info file
+  setup_mb_info_reuse(currSlice);
 }
 
 /*!
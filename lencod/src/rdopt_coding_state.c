@@ -7,6 +7,13 @@
  *    Storing/restoring coding state for
  *    Rate-Distortion optimized mode decision
  *
+ *    The CABAC contexts of a slice are not copied as a whole at every
+ *    checkpoint: the arithmetic coder enters each context it writes in the
+ *    slice journal, and a checkpoint only exchanges the contexts entered
+ *    since its own position in the journal. A checkpoint taken before the
+ *    journal was last cleared (slice start or overflow) falls back to a
+ *    full copy.
+ *
  * \author
  *    Heiko Schwarz
  *
@@ -14,6 +21,8 @@
  *    17. April 2001
  **************************************************************************/
 
+#include <limits.h>
+
 #include "global.h"
 
 #include "rdopt_coding_state.h"
@@ -85,7 +94,7 @@ CSobj *create_coding_state (InputParameters *p_Inp)
     //=== context for binary arithmetic coding ===
     cs->mot_ctx = create_contexts_MotionInfo ();
     cs->tex_ctx = create_contexts_TextureInfo();
-
+    cs->jgen = -1;
   }
   else
   {
@@ -108,6 +117,166 @@ CSobj *create_coding_state (InputParameters *p_Inp)
   return cs;
 }
 
+/*!
+ ************************************************************************
+ * \brief
+ *    create the context journal of a slice
+ ************************************************************************
+ */
+CtxJournal *create_ctx_journal (Slice *currSlice)
+{
+  CtxJournal *jrnl;
+
+  if ((jrnl = (CtxJournal *) calloc (1, sizeof(CtxJournal))) == NULL)
+    no_mem_exit("create_ctx_journal: jrnl");
+
+  jrnl->tex_base = (BiContextType *) currSlice->tex_ctx;
+  jrnl->mot_base = (BiContextType *) currSlice->mot_ctx;
+  jrnl->num_tex  = sizeof(TextureInfoContexts) / sizeof(BiContextType);
+  jrnl->num_ctx  = jrnl->num_tex + sizeof(MotionInfoContexts) / sizeof(BiContextType);
+  jrnl->size     = 16 * jrnl->num_ctx;
+
+  if ((jrnl->idx = (int *) calloc (jrnl->size, sizeof(int))) == NULL)
+    no_mem_exit("create_ctx_journal: jrnl->idx");
+  if ((jrnl->stamp = (int *) calloc (jrnl->num_ctx, sizeof(int))) == NULL)
+    no_mem_exit("create_ctx_journal: jrnl->stamp");
+
+  clear_ctx_journal(jrnl);
+
+  return jrnl;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    delete the context journal of a slice
+ ************************************************************************
+ */
+void delete_ctx_journal (CtxJournal *jrnl)
+{
+  if (jrnl != NULL)
+  {
+    free (jrnl->idx);
+    free (jrnl->stamp);
+    free (jrnl);
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    clear the context journal; all checkpoints taken so far fall
+ *    back to a full context copy when they are next used
+ ************************************************************************
+ */
+void clear_ctx_journal (CtxJournal *jrnl)
+{
+  memset(jrnl->stamp, 0, jrnl->num_ctx * sizeof(int));
+  jrnl->num   = 0;
+  jrnl->epoch = 1;
+  ++jrnl->gen;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    start a new checkpoint epoch: contexts written from now on are
+ *    entered again even if they are already in the journal
+ ************************************************************************
+ */
+static inline void next_ctx_journal_epoch (CtxJournal *jrnl)
+{
+  if (++jrnl->epoch == INT_MAX)
+    clear_ctx_journal(jrnl);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    context with journal index k
+ ************************************************************************
+ */
+static inline BiContextType *journal_ctx (MotionInfoContexts *mot_ctx, TextureInfoContexts *tex_ctx, int num_tex, int k)
+{
+  return (k < num_tex) ? (BiContextType *) tex_ctx + k : (BiContextType *) mot_ctx + (k - num_tex);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    store the slice contexts in a checkpoint
+ ************************************************************************
+ */
+static void store_contexts (Slice *currSlice, CSobj *cs)
+{
+  CtxJournal *jrnl = currSlice->ctx_journal;
+
+  if (jrnl == NULL || cs->jgen != jrnl->gen)
+  {
+    *cs->mot_ctx = *currSlice->mot_ctx;
+    *cs->tex_ctx = *currSlice->tex_ctx;
+  }
+  else
+  {
+    int i;
+    for (i = cs->jpos; i < jrnl->num; ++i)
+    {
+      int k = jrnl->idx[i];
+      *journal_ctx(cs->mot_ctx, cs->tex_ctx, jrnl->num_tex, k) = *journal_ctx(currSlice->mot_ctx, currSlice->tex_ctx, jrnl->num_tex, k);
+    }
+  }
+
+  if (jrnl != NULL)
+  {
+    cs->jpos = jrnl->num;
+    cs->jgen = jrnl->gen;
+    next_ctx_journal_epoch(jrnl);
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    restore the slice contexts from a checkpoint
+ *
+ *    The restored contexts are entered in the journal again since they
+ *    changed with respect to the other checkpoints.
+ ************************************************************************
+ */
+static void reset_contexts (Slice *currSlice, CSobj *cs)
+{
+  CtxJournal *jrnl = currSlice->ctx_journal;
+
+  if (jrnl == NULL || cs->jgen != jrnl->gen || jrnl->num + (jrnl->num - cs->jpos) > jrnl->size)
+  {
+    *currSlice->mot_ctx = *cs->mot_ctx;
+    *currSlice->tex_ctx = *cs->tex_ctx;
+    if (jrnl != NULL)
+      clear_ctx_journal(jrnl);
+  }
+  else
+  {
+    int i, last = jrnl->num;
+    for (i = cs->jpos; i < last; ++i)
+    {
+      int k = jrnl->idx[i];
+      *journal_ctx(currSlice->mot_ctx, currSlice->tex_ctx, jrnl->num_tex, k) = *journal_ctx(cs->mot_ctx, cs->tex_ctx, jrnl->num_tex, k);
+      if (jrnl->stamp[k] != jrnl->epoch)
+      {
+        jrnl->stamp[k] = jrnl->epoch;
+        jrnl->idx[jrnl->num++] = k;
+      }
+    }
+  }
+
+  if (jrnl != NULL)
+  {
+    cs->jpos = jrnl->num;
+    cs->jgen = jrnl->gen;
+    next_ctx_journal_epoch(jrnl);
+  }
+}
+
 /*!
  ************************************************************************
  * \brief
@@ -171,8 +340,7 @@ static void store_coding_state_cabac (Macroblock *currMB, CSobj *cs)
   }
 
   //=== contexts for binary arithmetic coding ===
-  *cs->mot_ctx = *currSlice->mot_ctx;
-  *cs->tex_ctx = *currSlice->tex_ctx;
+  store_contexts(currSlice, cs);
 
   //=== syntax element number and bitcounters ===
   cs->bits = currMB->bits;
@@ -251,8 +419,7 @@ static void reset_coding_state_cabac (Macroblock *currMB, CSobj *cs)
   }
 
   //=== contexts for binary arithmetic coding ===
-  *currSlice->mot_ctx = *cs->mot_ctx;
-  *currSlice->tex_ctx = *cs->tex_ctx;
+  reset_contexts(currSlice, cs);
 
   //=== syntax element number and bit counters ===
   currMB->bits = cs->bits;
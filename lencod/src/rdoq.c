@@ -32,11 +32,25 @@
 */
 void init_rdoq_slice(Slice *currSlice)
 {
+  int qp_rem, i, j;
+
   //currSlice->norm_factor_4x4 = (double) ((int64) 1 << (2 * DQ_BITS + 19)); // norm factor 4x4 is basically (1<<31)
   //currSlice->norm_factor_8x8 = (double) ((int64) 1 << (2 * Q_BITS_8 + 9)); // norm factor 8x8 is basically (1<<41)
   currSlice->norm_factor_4x4 = pow(2, (2 * DQ_BITS + 19));
   currSlice->norm_factor_8x8 = pow(2, (2 * Q_BITS_8 + 9));
+
+  // distortion weights of the level candidates, computed once instead of per coefficient
+  for (qp_rem = 0; qp_rem < 6; ++qp_rem)
+  {
+    for (j = 0; j < 4; ++j)
+      for (i = 0; i < 4; ++i)
+        currSlice->est_err_4x4[qp_rem][(j << 2) + i] = (double) estErr4x4[qp_rem][j][i] / currSlice->norm_factor_4x4;
+    for (j = 0; j < 8; ++j)
+      for (i = 0; i < 8; ++i)
+        currSlice->est_err_8x8[qp_rem][(j << 3) + i] = (double) estErr8x8[qp_rem][j][i] / currSlice->norm_factor_8x8;
+  }
 }
+
 /*!
 ****************************************************************************
 * \brief
@@ -53,9 +67,9 @@ int init_trellis_data_DC_cr_CAVLC(Macroblock *currMB, int **tblock, int qp_per,
   int *m7;
   int q_bits = Q_BITS + qp_per + 1; 
   int q_offset = ( 1 << (q_bits - 1) );
-  double err; 
-  int scaled_coeff, level, lowerInt, k;
-  double estErr = (double) estErr4x4[qp_rem][0][0] / currSlice->norm_factor_4x4; // note that we could also use int64
+  int q_offset_zero = rdoq_zero_offset(currMB->p_Inp, q_offset);
+  int scaled_coeff, level, lowerInt;
+  double estErr = currSlice->est_err_4x4[qp_rem][0];
 
   for (coeff_ctr = 0; coeff_ctr < end_coeff_ctr; coeff_ctr++)
   {
@@ -69,7 +83,6 @@ int init_trellis_data_DC_cr_CAVLC(Macroblock *currMB, int **tblock, int qp_per,
       dataLevel->levelDouble = 0;
       dataLevel->errLevel[0] = 0.0;
       dataLevel->noLevels = 1;
-      err = 0.0;      
       dataLevel->pre_level = 0;
       dataLevel->sign = 0;
     }
@@ -79,7 +92,7 @@ int init_trellis_data_DC_cr_CAVLC(Macroblock *currMB, int **tblock, int qp_per,
       dataLevel->levelDouble = scaled_coeff;
       level = (scaled_coeff >> q_bits);
 
-      lowerInt = ((scaled_coeff - (level << q_bits)) < q_offset )? 1 : 0;
+      lowerInt = ((scaled_coeff - (level << q_bits)) < ((level == 0) ? q_offset_zero : q_offset)) ? 1 : 0;
       dataLevel->level[0] = 0;
       if (level == 0 && lowerInt == 1)
       {
@@ -102,11 +115,7 @@ int init_trellis_data_DC_cr_CAVLC(Macroblock *currMB, int **tblock, int qp_per,
         dataLevel->noLevels = 3;
       }
 
-      for (k = 0; k < dataLevel->noLevels; k++)
-      {
-        err = (double)(dataLevel->level[k] << q_bits) - (double)scaled_coeff;
-        dataLevel->errLevel[k] = (err * err * estErr); 
-      }
+      rdoq_level_errors(dataLevel, scaled_coeff, q_bits, estErr);
 
       if(dataLevel->noLevels == 1)
         dataLevel->pre_level = 0;
@@ -137,9 +146,9 @@ int init_trellis_data_DC_cr_CABAC(Macroblock *currMB, int **tblock, int qp_per,
   int *m7;
   int q_bits = Q_BITS + qp_per + 1; 
   int q_offset = ( 1 << (q_bits - 1) );
-  double err; 
-  int scaled_coeff, level, lowerInt, k;
-  double estErr = (double) estErr4x4[qp_rem][0][0] / currSlice->norm_factor_4x4; // note that we could also use int64
+  int q_offset_zero = rdoq_zero_offset(currMB->p_Inp, q_offset);
+  int scaled_coeff, level, lowerInt;
+  double estErr = currSlice->est_err_4x4[qp_rem][0];
 
   for (coeff_ctr = 0; coeff_ctr < end_coeff_ctr; coeff_ctr++)
   {
@@ -153,7 +162,6 @@ int init_trellis_data_DC_cr_CABAC(Macroblock *currMB, int **tblock, int qp_per,
       dataLevel->levelDouble = 0;
       dataLevel->errLevel[0] = 0.0;
       dataLevel->noLevels = 1;
-      err = 0.0;      
     }
     else
     {
@@ -161,7 +169,7 @@ int init_trellis_data_DC_cr_CABAC(Macroblock *currMB, int **tblock, int qp_per,
       dataLevel->levelDouble = scaled_coeff;
       level = (scaled_coeff >> q_bits);
 
-      lowerInt=( (scaled_coeff - (level << q_bits)) < q_offset )? 1 : 0;
+      lowerInt = ((scaled_coeff - (level << q_bits)) < ((level == 0) ? q_offset_zero : q_offset)) ? 1 : 0;
       dataLevel->level[0] = 0;
       if (level == 0)
       {
@@ -194,11 +202,7 @@ int init_trellis_data_DC_cr_CABAC(Macroblock *currMB, int **tblock, int qp_per,
         noCoeff++;
       }
 
-      for (k = 0; k < dataLevel->noLevels; k++)
-      {
-        err = (double)(dataLevel->level[k] << q_bits) - (double)scaled_coeff;
-        dataLevel->errLevel[k] = (err * err * estErr); 
-      }
+      rdoq_level_errors(dataLevel, scaled_coeff, q_bits, estErr);
     }
     dataLevel++;
   }
@@ -107,8 +107,8 @@ int est_CAVLC_bits (VideoParameters *p_Vid, int level_to_enc[16], int sign_to_en
   int yuv = p_Vid->yuv_format - 1;
   static const int incVlc[] = {0, 3, 6, 12, 24, 48, 32768};  // maximum vlc = 6
 
-  int  pLevel[16] = {0};
-  int  pRun[16] = {0};
+  int  pLevel[16];
+  int  pRun[16];
 
   static const int Token_lentab[3][4][17] = 
   {
@@ -213,7 +213,7 @@ int est_CAVLC_bits (VideoParameters *p_Vid, int level_to_enc[16], int sign_to_en
   max_coeff_num = ( (block_type == CHROMA_DC) ? p_Vid->num_cdc_coeff : 
   ( (block_type == LUMA_INTRA16x16AC || block_type == CB_INTRA16x16AC || block_type == CR_INTRA16x16AC || block_type == CHROMA_AC) ? 15 : 16) );
 
-  //convert zigzag scan to (run, level) pairs
+  //convert zigzag scan to (run, level) pairs, counting the coefficients and trailing ones in the same pass
   for (coeff_ctr = 0; coeff_ctr < max_coeff_num; coeff_ctr++)
   {
     run++;
@@ -222,34 +222,22 @@ int est_CAVLC_bits (VideoParameters *p_Vid, int level_to_enc[16], int sign_to_en
     {
       pLevel[scan_pos] = isignab(level, sign_to_enc[coeff_ctr]);
       pRun  [scan_pos] = run;
-      ++scan_pos;
-      run = -1;                     // reset zero level counter
-    }
-  }
-
-  level = 1;
-  for(k = 0; (k < max_coeff_num) && level != 0; k++)    
-  {
-    level = pLevel[k]; // level
-    run   = pRun[k];   // run
-
-    if (level)
-    {
-      totzeros += run; // lets add run always (even if zero) to avoid conditional
+      totzeros += run;
       if (iabs(level) == 1)
       {
         numones ++;
-        numtrailingones ++;
-        numtrailingones = imin(numtrailingones, 3); // clip to 3
+        numtrailingones = imin(numtrailingones + 1, 3); // clip to 3
       }
       else
       {
         numtrailingones = 0;
       }
-      numcoeff ++;
-      lastcoeff = k;
+      lastcoeff = scan_pos;
+      ++scan_pos;
+      run = -1;                     // reset zero level counter
     }
   }
+  numcoeff = scan_pos;
 
   if (!cdc)
   {
@@ -384,13 +372,10 @@ void est_RunLevel_CAVLC(Macroblock *currMB, levelDataStruct *levelData, int *lev
   int subblock_y = (b8 < 2) ? ((b4 < 2) ? 0 : 1) :((b4 < 2) ? 2 : 3); 
   // vert.  position for coeff_count context      
   int nnz; 
+  int order[16], num_cand = 0, n;
+  int cur_level, cur_bits = -1, bits[3];
   levelDataStruct *dataLevel = &levelData[0];
 
-  if (block_type != CHROMA_AC)
-    nnz = predict_nnz(currMB, LUMA, subblock_x, subblock_y); 
-  else
-    nnz = predict_nnz_chroma(currMB, currMB->subblock_x >> 2, (currMB->subblock_y >> 2) + 4);
-
   for (coeff_ctr=0;coeff_ctr < coeff_num;coeff_ctr++)
   { 
     levelTrellis[coeff_ctr] = 0;
@@ -409,6 +394,7 @@ void est_RunLevel_CAVLC(Macroblock *currMB, levelDataStruct *levelData, int *lev
     {
       dataLevel->coeff_ctr = coeff_ctr;
       lastnonzero = coeff_ctr;
+      order[num_cand++] = coeff_ctr;
     }
     else
       dataLevel->coeff_ctr = -1;
@@ -417,24 +403,37 @@ void est_RunLevel_CAVLC(Macroblock *currMB, levelDataStruct *levelData, int *lev
 
   if(lastnonzero != -1)
   {
-    //sort the coefficients based on their absolute value
-    qsort(levelData, lastnonzero + 1, sizeof(levelDataStruct), cmp);
-    dataLevel = &levelData[lastnonzero];
+    if (block_type != CHROMA_AC)
+      nnz = predict_nnz(currMB, LUMA, subblock_x, subblock_y); 
+    else
+      nnz = predict_nnz_chroma(currMB, currMB->subblock_x >> 2, (currMB->subblock_y >> 2) + 4);
 
-    for(coeff_ctr = lastnonzero; coeff_ctr >= 0; coeff_ctr--) // go over all coeff
+    //sort the coefficients with level candidates based on their absolute value
+    for (n = 1; n < num_cand; n++)
     {
-      if(dataLevel->noLevels == 1)
-      {
-        dataLevel--;
-        continue;
-      }
+      int cur = order[n];
+
+      for (k = n; k > 0 && cmp(&levelData[order[k - 1]], &levelData[cur]) > 0; k--)
+        order[k] = order[k - 1];
+      order[k] = cur;
+    }
+
+    for (n = num_cand - 1; n >= 0; n--) // go over all coeff
+    {
+      dataLevel = &levelData[order[n]];
 
       lagrAcc -= dataLevel->errLevel[dataLevel->noLevels-1];
+      cur_level = level_to_enc[dataLevel->coeff_ctr];
       for(cstat=0; cstat<dataLevel->noLevels; cstat++) // go over all states of cur coeff k
       {
         level_to_enc[dataLevel->coeff_ctr] = dataLevel->level[cstat];
+        // the state keeping the current level was estimated with the previous coefficient
+        if (cur_bits >= 0 && dataLevel->level[cstat] == cur_level)
+          bits[cstat] = cur_bits;
+        else
+          bits[cstat] = est_CAVLC_bits( p_Vid, level_to_enc, sign_to_enc, nnz, block_type);
         lagr = lagrAcc + dataLevel->errLevel[cstat];
-        lagr += lambda * est_CAVLC_bits( p_Vid, level_to_enc, sign_to_enc, nnz, block_type);
+        lagr += lambda * bits[cstat];
         if(cstat==0 || lagr<minlagr)
         {
           minlagr = lagr;
@@ -444,7 +443,7 @@ void est_RunLevel_CAVLC(Macroblock *currMB, levelDataStruct *levelData, int *lev
 
       lagrAcc += dataLevel->errLevel[bestcstat];
       level_to_enc[dataLevel->coeff_ctr] = dataLevel->level[bestcstat];
-      dataLevel--;
+      cur_bits = bits[bestcstat];
     }
 
     for(coeff_ctr = 0; coeff_ctr <= lastnonzero; coeff_ctr++)
@@ -473,8 +472,9 @@ void init_trellis_data_4x4_CAVLC(Macroblock *currMB, int **tblock, int block_x,
   int end_coeff_ctr = ( ( type == LUMA_4x4 ) ? 16 : 15 );
   int q_bits = Q_BITS + qp_per; 
   int q_offset = ( 1 << (q_bits - 1) );
-  int scaled_coeff, level, lowerInt, k;
-  double err, estErr;
+  int q_offset_zero = rdoq_zero_offset(currMB->p_Inp, q_offset);
+  int scaled_coeff, level, lowerInt;
+  double estErr;
 
 
   for (coeff_ctr = 0; coeff_ctr < end_coeff_ctr; coeff_ctr++)
@@ -489,20 +489,19 @@ void init_trellis_data_4x4_CAVLC(Macroblock *currMB, int **tblock, int block_x,
       dataLevel->levelDouble = 0;
       dataLevel->level[0] = 0;
       dataLevel->noLevels = 1;
-      err = 0.0;
       dataLevel->errLevel[0] = 0.0;
       dataLevel->pre_level = 0;
       dataLevel->sign = 0;
     }
     else
     {
-      estErr = ((double) estErr4x4[qp_rem][j][i]) / currSlice->norm_factor_4x4;
+      estErr = currSlice->est_err_4x4[qp_rem][(j << 2) + i];
 
       scaled_coeff = iabs(*m7) * q_params[j][i].ScaleComp;
       dataLevel->levelDouble = scaled_coeff;
       level = (scaled_coeff >> q_bits);
 
-      lowerInt = ((scaled_coeff - (level << q_bits)) < q_offset )? 1 : 0;
+      lowerInt = ((scaled_coeff - (level << q_bits)) < ((level == 0) ? q_offset_zero : q_offset)) ? 1 : 0;
       
       dataLevel->level[0] = 0;
       if (level == 0 && lowerInt == 1)
@@ -526,11 +525,7 @@ void init_trellis_data_4x4_CAVLC(Macroblock *currMB, int **tblock, int block_x,
         dataLevel->noLevels = 3;
       }
 
-      for (k = 0; k < dataLevel->noLevels; k++)
-      {
-        err = (double)(dataLevel->level[k] << q_bits) - (double)scaled_coeff;
-        dataLevel->errLevel[k] = (err * err * estErr); 
-      }
+      rdoq_level_errors(dataLevel, scaled_coeff, q_bits, estErr);
 
       if(dataLevel->noLevels == 1)
         dataLevel->pre_level = 0;
@@ -556,9 +551,10 @@ void init_trellis_data_DC_CAVLC(Macroblock *currMB, int **tblock, int qp_per, in
   int i, j, coeff_ctr, end_coeff_ctr = 16;
   int q_bits   = Q_BITS + qp_per + 1; 
   int q_offset = ( 1 << (q_bits - 1) );
-  int scaled_coeff, level, lowerInt, k;
+  int q_offset_zero = rdoq_zero_offset(currMB->p_Inp, q_offset);
+  int scaled_coeff, level, lowerInt;
   int *m7;
-  double err, estErr = (double) estErr4x4[qp_rem][0][0] / currSlice->norm_factor_4x4; // note that we could also use int64
+  double estErr = currSlice->est_err_4x4[qp_rem][0];
 
   for (coeff_ctr = 0; coeff_ctr < end_coeff_ctr; coeff_ctr++)
   {
@@ -571,7 +567,6 @@ void init_trellis_data_DC_CAVLC(Macroblock *currMB, int **tblock, int qp_per, in
       dataLevel->levelDouble = 0;
       dataLevel->level[0] = 0;
       dataLevel->noLevels = 1;
-      err = 0.0;
       dataLevel->errLevel[0] = 0.0;
       dataLevel->pre_level = 0;
       dataLevel->sign = 0;
@@ -582,7 +577,7 @@ void init_trellis_data_DC_CAVLC(Macroblock *currMB, int **tblock, int qp_per, in
       dataLevel->levelDouble = scaled_coeff;
       level = (scaled_coeff >> q_bits);
 
-      lowerInt=( (scaled_coeff - (level<<q_bits)) < q_offset )? 1 : 0;
+      lowerInt = ((scaled_coeff - (level << q_bits)) < ((level == 0) ? q_offset_zero : q_offset)) ? 1 : 0;
 
       dataLevel->level[0] = 0;    
       if (level == 0 && lowerInt == 1)
@@ -606,11 +601,7 @@ void init_trellis_data_DC_CAVLC(Macroblock *currMB, int **tblock, int qp_per, in
         dataLevel->noLevels = 3;
       }
 
-      for (k = 0; k < dataLevel->noLevels; k++)
-      {
-        err = (double)(dataLevel->level[k] << q_bits) - (double)scaled_coeff;
-        dataLevel->errLevel[k] = (err * err * estErr); 
-      }
+      rdoq_level_errors(dataLevel, scaled_coeff, q_bits, estErr);
 
       if(dataLevel->noLevels == 1)
         dataLevel->pre_level = 0;
@@ -636,8 +627,9 @@ void init_trellis_data_8x8_CAVLC(Macroblock *currMB, int **tblock, int block_x,
   int *m7;
   int q_bits   = Q_BITS_8 + qp_per;
   int q_offset = ( 1 << (q_bits - 1) );
-  double err, estErr;
-  int scaled_coeff, level, lowerInt, k;
+  int q_offset_zero = rdoq_zero_offset(currMB->p_Inp, q_offset);
+  double estErr;
+  int scaled_coeff, level, lowerInt;
   
   levelDataStruct *dataLevel = &levelData[0][0];  
 
@@ -656,20 +648,19 @@ void init_trellis_data_8x8_CAVLC(Macroblock *currMB, int **tblock, int block_x,
         dataLevel->levelDouble = 0;
         dataLevel->level[0] = 0;
         dataLevel->noLevels = 1;
-        err = 0.0;
         dataLevel->errLevel[0] = 0.0;
         dataLevel->pre_level = 0;
         dataLevel->sign = 0;
       }
       else
       {
-        estErr = (double) estErr8x8[qp_rem][j][i] / currSlice->norm_factor_8x8;
+        estErr = currSlice->est_err_8x8[qp_rem][(j << 3) + i];
 
         scaled_coeff = iabs(*m7) * q_params[j][i].ScaleComp;
         dataLevel->levelDouble = scaled_coeff;
         level = (scaled_coeff >> q_bits);
 
-        lowerInt = ((scaled_coeff - (level << q_bits)) < q_offset ) ? 1 : 0;
+        lowerInt = ((scaled_coeff - (level << q_bits)) < ((level == 0) ? q_offset_zero : q_offset)) ? 1 : 0;
 
         dataLevel->level[0] = 0;
         if (level == 0 && lowerInt == 1)
@@ -702,11 +693,7 @@ void init_trellis_data_8x8_CAVLC(Macroblock *currMB, int **tblock, int block_x,
           dataLevel->noLevels = 3;
         }
 
-        for (k = 0; k < dataLevel->noLevels; k++)
-        {
-          err = (double)(dataLevel->level[k] << q_bits) - (double)scaled_coeff;
-          dataLevel->errLevel[k] = err * err * estErr; 
-        }
+        rdoq_level_errors(dataLevel, scaled_coeff, q_bits, estErr);
 
         if(dataLevel->noLevels == 1)
           dataLevel->pre_level = 0;
@@ -28,6 +28,7 @@
 #include "output.h"
 #include "parset.h"
 #include "report.h"
+#include "md_fast.h"
 #include "img_process_types.h"
 
 
@@ -348,6 +349,16 @@ void report_stats(VideoParameters *p_Vid, InputParameters *p_Inp, StatParameters
   else
     fprintf(p_stat," RD-optimized mode decision   : not used\n");
 
+  if (p_Inp->FastMDHigh)
+  {
+    int64 num_cand = p_Stats->md_tested + p_Stats->md_pruned;
+
+    fprintf(p_stat," Fast mode decision           : %s (FastMDHigh = %d)\n", fast_md_preset_name(p_Inp->FastMDHigh), p_Inp->FastMDHigh);
+    fprintf(p_stat," MD candidates tested/pruned  : %" FORMAT_OFF_T "/%" FORMAT_OFF_T " (%.1f%% pruned)\n",
+      p_Stats->md_tested, p_Stats->md_pruned, 100.0 * (double) p_Stats->md_pruned / dmax(1.0, (double) num_cand));
+    fprintf(p_stat," Sub-8x8 searches pruned      : %" FORMAT_OFF_T "\n", p_Stats->md_sub8x8_pruned);
+  }
+
   fprintf(p_stat,"\n ---------------------|----------------|---------------|");
   fprintf(p_stat,"\n     Item             |     Intra      |   All frames  |");
   fprintf(p_stat,"\n ---------------------|----------------|---------------|");
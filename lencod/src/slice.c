@@ -39,6 +39,7 @@
 #include "ratectl.h"
 #include "me_epzs.h"
 #include "me_epzs_int.h"
+#include "me_hme.h"
 #include "wp.h"
 #include "slice.h"
 #include "rdoq.h"
@@ -47,6 +48,9 @@
 #include "conformance.h"
 #include "list_reorder.h"
 #include "md_common.h"
+#include "md_fast.h"
+#include "thread_util.h"
+#include "mode_decision.h"
 #include "mmco.h"
 #include "mv_search.h"
 #include "quant4x4.h"
@@ -213,6 +217,7 @@ static int start_slice(Slice *currSlice, StatParameters *cur_stats)
       writeVlcByteAlign(p_Vid, currStream, cur_stats);
 
       eep->p_Vid = p_Vid;
+      eep->journal = currSlice->ctx_journal;
       arienco_start_encoding(eep, currStream->streamBuffer, &(currStream->byte_pos));
 
       arienco_reset_EC(eep);
@@ -423,21 +428,17 @@ static void init_bipred_enabled(VideoParameters *p_Vid)
 /*!
 ************************************************************************
 * \brief
-*    Encodes one slice
+*    Sets up one slice: initializes the slice parameters, reference
+*    lists and contexts and writes the slice header (first part of
+*    encode_one_slice())
 * \par
-*   returns the number of coded MBs in the SLice 
-*   صǰƬѱ
+*   returns the new slice, its first MB is currSlice->start_mb_nr
 ************************************************************************
 */
-int encode_one_slice (VideoParameters *p_Vid, int SliceGroupId, int TotalCodedMBs)
+static Slice *prepare_one_slice (VideoParameters *p_Vid, int SliceGroupId)
 {
-    printf("\033[1;33m tmp_test===============%s ======= \033[0m \n",__FUNCTION__); 
   InputParameters *p_Inp = p_Vid->p_Inp;
-  Boolean end_of_slice = FALSE;
-  
   int len;
-  int NumberOfCodedMBs = 0;
-  Macroblock* currMB   = NULL;
   int CurrentMbAddr;
   StatParameters *cur_stats = &p_Vid->enc_picture->stats;
   Slice *currSlice = NULL;  
@@ -484,6 +485,27 @@ int encode_one_slice (VideoParameters *p_Vid, int SliceGroupId, int TotalCodedMB
   if(currSlice->UseRDOQuant == 1 && currSlice->RDOQ_QP_Num > 1)
     get_dQP_table(currSlice);
 
+  return currSlice;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Encodes the macroblocks of a slice set up by prepare_one_slice()
+* \par
+*   returns the number of coded MBs in the slice, *lastMB is set to
+*   the last coded macroblock
+************************************************************************
+*/
+static int encode_slice_macroblocks (Slice *currSlice, Macroblock **lastMB)
+{
+  VideoParameters *p_Vid = currSlice->p_Vid;
+  InputParameters *p_Inp = currSlice->p_Inp;
+  Boolean end_of_slice = FALSE;
+  int NumberOfCodedMBs = 0;
+  Macroblock* currMB   = NULL;
+  int CurrentMbAddr = currSlice->start_mb_nr;
+
   while (end_of_slice == FALSE) // loop over macroblocks
   {
     Boolean recode_macroblock = FALSE;
@@ -550,6 +572,21 @@ int encode_one_slice (VideoParameters *p_Vid, int SliceGroupId, int TotalCodedMB
   }
 
 
+  *lastMB = currMB;
+  return NumberOfCodedMBs;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Terminates a slice coded by encode_slice_macroblocks()
+************************************************************************
+*/
+static void close_one_slice (Slice *currSlice, Macroblock *currMB, int lastslice)
+{
+  VideoParameters *p_Vid = currSlice->p_Vid;
+  InputParameters *p_Inp = currSlice->p_Inp;
+
   if ((p_Inp->WPIterMC) && (p_Vid->frameOffsetAvail == 0) && p_Vid->nal_reference_idc)
   {
     compute_offset(currSlice);
@@ -557,10 +594,414 @@ int encode_one_slice (VideoParameters *p_Vid, int SliceGroupId, int TotalCodedMB
   p_Vid->num_ref_idx_l0_active = currSlice->num_ref_idx_active[LIST_0];
   p_Vid->num_ref_idx_l1_active = currSlice->num_ref_idx_active[LIST_1];
 
-  terminate_slice (currMB, (NumberOfCodedMBs + TotalCodedMBs >= (int)p_Vid->PicSizeInMbs), cur_stats );
+  if (currSlice->ext_events != NULL)
+    write_deferred_extraction (currSlice);
+#if TRACE
+  if (currSlice->trace != NULL)
+  {
+    trace_flush_buffer (currSlice->trace);
+    currSlice->trace = NULL;
+  }
+#endif
+
+  terminate_slice (currMB, lastslice, &p_Vid->enc_picture->stats);
+}
+
+/*!
+************************************************************************
+* \brief
+*    Encodes one slice
+* \par
+*   returns the number of coded MBs in the SLice 
+*   صǰƬѱ
+************************************************************************
+*/
+int encode_one_slice (VideoParameters *p_Vid, int SliceGroupId, int TotalCodedMBs)
+{
+    printf("\033[1;33m tmp_test===============%s ======= \033[0m \n",__FUNCTION__); 
+  Macroblock *currMB = NULL;
+  Slice *currSlice;
+  int NumberOfCodedMBs;
+
+  currSlice = prepare_one_slice (p_Vid, SliceGroupId);
+  NumberOfCodedMBs = encode_slice_macroblocks (currSlice, &currMB);
+  close_one_slice (currSlice, currMB, (NumberOfCodedMBs + TotalCodedMBs >= (int)p_Vid->PicSizeInMbs));
+
+  return NumberOfCodedMBs;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Points a slice (and its partitions) to the given VideoParameters
+************************************************************************
+*/
+static void set_slice_video_par (Slice *currSlice, VideoParameters *p_Vid)
+{
+  int i;
+
+  currSlice->p_Vid = p_Vid;
+  for (i = 0; i < currSlice->max_part_nr; ++i)
+  {
+    currSlice->partArr[i].p_Vid           = p_Vid;
+    currSlice->partArr[i].ee_cabac.p_Vid  = p_Vid;
+    currSlice->partArr[i].ee_recode.p_Vid = p_Vid;
+  }
+  if (currSlice->p_EPZS != NULL)
+    currSlice->p_EPZS->p_Vid = p_Vid;
+}
+
+/*!
+************************************************************************
+* \brief
+*    Adds the macroblock statistics collected for one slice
+*    (see next_macroblock()) to the picture statistics
+************************************************************************
+*/
+static void add_slice_stats (StatParameters *cur_stats, StatParameters *slice_stats)
+{
+  int i, j, k;
+
+  for (i = 0; i < 4; i++)
+    cur_stats->intra_chroma_mode[i] += slice_stats->intra_chroma_mode[i];
+
+  cur_stats->md_tested        += slice_stats->md_tested;
+  cur_stats->md_pruned        += slice_stats->md_pruned;
+  cur_stats->md_sub8x8_pruned += slice_stats->md_sub8x8_pruned;
+
+  for (i = 0; i < NUM_SLICE_TYPES; i++)
+  {
+    cur_stats->quant[i]                 += slice_stats->quant[i];
+    cur_stats->num_macroblocks[i]       += slice_stats->num_macroblocks[i];
+    cur_stats->bit_use_mb_type[i]       += slice_stats->bit_use_mb_type[i];
+    cur_stats->tmp_bit_use_cbp[i]       += slice_stats->tmp_bit_use_cbp[i];
+    cur_stats->bit_use_coeffC[i]        += slice_stats->bit_use_coeffC[i];
+    cur_stats->bit_use_coeff[0][i]      += slice_stats->bit_use_coeff[0][i];
+    cur_stats->bit_use_coeff[1][i]      += slice_stats->bit_use_coeff[1][i];
+    cur_stats->bit_use_coeff[2][i]      += slice_stats->bit_use_coeff[2][i];
+    cur_stats->bit_use_delta_quant[i]   += slice_stats->bit_use_delta_quant[i];
+    cur_stats->bit_use_stuffing_bits[i] += slice_stats->bit_use_stuffing_bits[i];
+
+    for (k = 0; k < 2; k++)
+      cur_stats->b8_mode_0_use[i][k] += slice_stats->b8_mode_0_use[i][k];
+
+    for (j = 0; j < MAXMODE; j++)
+    {
+      cur_stats->mode_use[i][j]     += slice_stats->mode_use[i][j];
+      cur_stats->bit_use_mode[i][j] += slice_stats->bit_use_mode[i][j];
+      for (k = 0; k < 2; k++)
+        cur_stats->mode_use_transform[i][j][k] += slice_stats->mode_use_transform[i][j][k];
+    }
+  }
+}
+
+/*!
+************************************************************************
+* \brief
+*    Sets up all remaining slices of a slice group for parallel
+*    macroblock coding (see encode_slices_parallel())
+*
+* \par
+*    The slice headers are written serially in slice order. Each
+*    slice gets its own copy of the VideoParameters with private
+*    scratch buffers and statistics. The slices are only coded by
+*    encode_slice_jobs() and merged back by close_slices_parallel().
+*
+*    On return p_Vid is set up as after the last slice of the group
+*    (current_mb_nr is its last macroblock).
+************************************************************************
+*/
+void prepare_slices_parallel (VideoParameters *p_Vid, int SliceGroupId, int TotalCodedMBs, SliceJobs *jobs)
+{
+  InputParameters *p_Inp = p_Vid->p_Inp;
+  int mbs_per_slice = (p_Inp->slice_mode == 1) ? p_Inp->slice_argument : (int) p_Vid->PicSizeInMbs;
+  int max_slices = (p_Vid->PicSizeInMbs - TotalCodedMBs + mbs_per_slice - 1) / mbs_per_slice;
+  int i, mb_nr, last_mb_nr;
+
+  memset(jobs, 0, sizeof(SliceJobs));
+  jobs->main_b8x8info            = p_Vid->b8x8info;
+  jobs->main_motion_cost         = p_Vid->motion_cost;
+  jobs->main_stats               = p_Vid->p_Stats;
+  jobs->SumFrameQP               = p_Vid->SumFrameQP;
+  jobs->NumberofCodedMacroBlocks = p_Vid->NumberofCodedMacroBlocks;
+  jobs->intras                   = p_Vid->intras;
+  jobs->iInterViewMBs            = p_Vid->iInterViewMBs;
+  jobs->me_time                  = p_Vid->me_time;
+  jobs->me_tot_time              = p_Vid->me_tot_time;
+  jobs->fast_md                  = p_Vid->fast_md;
+
+  jobs->slices      = (Slice **)           calloc(max_slices, sizeof(Slice *));
+  jobs->last_mb     = (Macroblock **)      calloc(max_slices, sizeof(Macroblock *));
+  jobs->coded_mbs   = (int *)              calloc(max_slices, sizeof(int));
+  jobs->vid_copy    = (VideoParameters *)  calloc(max_slices, sizeof(VideoParameters));
+  jobs->mb_stats    = (StatParameters *)   calloc(max_slices, sizeof(StatParameters));
+  jobs->vid_stats   = (StatParameters *)   calloc(max_slices, sizeof(StatParameters));
+  jobs->b8x8info    = (Block8x8Info *)     calloc(max_slices, sizeof(Block8x8Info));
+  jobs->motion_cost = (distblk *****)      calloc(max_slices, sizeof(distblk ****));
+  if (!jobs->slices || !jobs->last_mb || !jobs->coded_mbs || !jobs->vid_copy || !jobs->mb_stats || !jobs->vid_stats || !jobs->b8x8info || !jobs->motion_cost)
+    no_mem_exit("prepare_slices_parallel: slice data");
+#if TRACE
+  if ((jobs->trace = (TraceBuffer *) calloc(max_slices, sizeof(TraceBuffer))) == NULL)
+    no_mem_exit("prepare_slices_parallel: jobs->trace");
+#endif
+
+  //===== set up all slices (headers, reference lists) in slice order =====
+  while (!FmoSliceGroupCompletelyCoded (p_Vid, SliceGroupId))
+  {
+    Slice *currSlice;
+    VideoParameters *p_Vid_slice;
+    int num = jobs->num_slices;
+
+    if (num >= max_slices)
+    {
+      snprintf (errortext, ET_SIZE, "prepare_slices_parallel: more than %d slices in picture", max_slices);
+      error (errortext, 500);
+    }
+#if TRACE
+    // the slice header is traced with the macroblocks of the slice
+    trace_redirect (&jobs->trace[num]);
+    currSlice   = prepare_one_slice (p_Vid, SliceGroupId);
+    trace_redirect (NULL);
+    currSlice->trace = &jobs->trace[num];
+#else
+    currSlice   = prepare_one_slice (p_Vid, SliceGroupId);
+#endif
+    p_Vid_slice = &jobs->vid_copy[num];
+
+    // macroblocks of the slice; their slice number is assigned here so that
+    // the availability checks of other slices never see a macroblock change
+    last_mb_nr = mb_nr = currSlice->start_mb_nr;
+    for (i = 0; i < mbs_per_slice && mb_nr >= 0; ++i)
+    {
+      p_Vid->mb_data[mb_nr].slice_nr = currSlice->slice_nr;
+      last_mb_nr = mb_nr;
+      mb_nr = FmoGetNextMBNr (p_Vid, mb_nr);
+    }
+
+    *p_Vid_slice = *p_Vid;
+    jobs->vid_stats[num]  = *p_Vid->p_Stats;
+    p_Vid_slice->p_Stats  = &jobs->vid_stats[num];
+    p_Vid_slice->b8x8info = &jobs->b8x8info[num];
+    if (p_Vid->max_num_references)
+      get_mem4Ddistblk (&jobs->motion_cost[num], 8, 2, p_Vid->max_num_references, 4);
+    p_Vid_slice->motion_cost = jobs->motion_cost[num];
+
+    set_slice_video_par (currSlice, p_Vid_slice);
+    set_chroma_vector_adjustment (currSlice);
+    currSlice->cur_stats = &jobs->mb_stats[num];
+
+    // the Extraction output is written in slice order by close_one_slice()
+    if (p_Inp->ExtractionOn || p_Inp->ExtractionPrint)
+    {
+      currSlice->max_ext_events = 256;
+      currSlice->num_ext_events = 0;
+      if ((currSlice->ext_events = (ExtEvent *) malloc(currSlice->max_ext_events * sizeof(ExtEvent))) == NULL)
+        no_mem_exit("prepare_slices_parallel: currSlice->ext_events");
+    }
+
+    jobs->slices[jobs->num_slices++] = currSlice;
+
+    p_Vid->current_mb_nr = last_mb_nr;
+    if (mb_nr < 0)
+      break;
+
+    // proceed to next slice (the last one is finished by the caller)
+    FmoSetLastMacroblockInSlice (p_Vid, p_Vid->current_mb_nr);
+    p_Vid->current_slice_nr++;
+    p_Vid->p_Stats->bit_slice = 0;
+  }
+}
+
+//! slices shared by the threads of encode_slice_jobs()
+typedef struct slice_job_queue
+{
+  SliceJobs  **jobs;
+  int          num_slices;    //!< number of slices of all pictures
+  int          next;          //!< next slice to be coded
+  ThreadMutex  mutex;         //!< protects next
+} SliceJobQueue;
+
+/*!
+************************************************************************
+* \brief
+*    Codes slices of the queue until all have been taken
+************************************************************************
+*/
+static void slice_job_thread (void *arg)
+{
+  SliceJobQueue *queue = (SliceJobQueue *) arg;
+  SliceJobs **jobs = queue->jobs;
+  int n, s, pic;
+
+  for (;;)
+  {
+    thread_mutex_lock (&queue->mutex);
+    n = queue->next++;
+    thread_mutex_unlock (&queue->mutex);
+    if (n >= queue->num_slices)
+      break;
+
+    for (pic = 0, s = n; s >= jobs[pic]->num_slices; )
+      s -= jobs[pic++]->num_slices;
+#if TRACE
+    trace_redirect (&jobs[pic]->trace[s]);
+#endif
+    jobs[pic]->coded_mbs[s] = encode_slice_macroblocks (jobs[pic]->slices[s], &jobs[pic]->last_mb[s]);
+  }
+#if TRACE
+  trace_redirect (NULL);
+#endif
+}
+
+/*!
+************************************************************************
+* \brief
+*    Codes the macroblocks of the slices set up by
+*    prepare_slices_parallel(), for one or more pictures at once,
+*    on num_threads threads (the calling one included)
+************************************************************************
+*/
+void encode_slice_jobs (SliceJobs **jobs, int num_pictures, int num_threads)
+{
+  SliceJobQueue queue;
+  ThreadHandle *threads = NULL;
+  int num_helpers, k;
+
+  queue.jobs       = jobs;
+  queue.num_slices = 0;
+  queue.next       = 0;
+  for (k = 0; k < num_pictures; ++k)
+    queue.num_slices += jobs[k]->num_slices;
+
+  num_helpers = imin(num_threads, queue.num_slices) - 1;
+  if (num_helpers > 0 && (threads = (ThreadHandle *) calloc(num_helpers, sizeof(ThreadHandle))) == NULL)
+    no_mem_exit("encode_slice_jobs: threads");
+
+  thread_mutex_init (&queue.mutex);
+  for (k = 0; k < num_helpers; ++k)
+    thread_create (&threads[k], slice_job_thread, &queue);
+
+  slice_job_thread (&queue);
+
+  for (k = 0; k < num_helpers; ++k)
+    thread_join (threads[k]);
+  thread_mutex_destroy (&queue.mutex);
+  free (threads);
+}
+
+/*!
+************************************************************************
+* \brief
+*    Merges the slices coded by encode_slice_jobs() back into p_Vid
+*    (the state after the last slice plus the counters of all slices)
+*    and terminates them serially in slice order
+*
+* \par
+*   returns the number of coded MBs
+************************************************************************
+*/
+int close_slices_parallel (VideoParameters *p_Vid, SliceJobs *jobs, int TotalCodedMBs)
+{
+  int num_slices = jobs->num_slices;
+  int NumberOfCodedMBs = 0;
+  int i, k, mb_nr;
+  VideoParameters *last = &jobs->vid_copy[num_slices - 1];
+
+  for (k = 0; k < num_slices - 1; ++k)
+  {
+    last->SumFrameQP               += jobs->vid_copy[k].SumFrameQP - jobs->SumFrameQP;
+    last->NumberofCodedMacroBlocks += jobs->vid_copy[k].NumberofCodedMacroBlocks - jobs->NumberofCodedMacroBlocks;
+    last->intras                   += jobs->vid_copy[k].intras - jobs->intras;
+    last->iInterViewMBs            += jobs->vid_copy[k].iInterViewMBs - jobs->iInterViewMBs;
+    last->me_time                  += jobs->vid_copy[k].me_time - jobs->me_time;
+    last->me_tot_time              += jobs->vid_copy[k].me_tot_time - jobs->me_tot_time;
+    merge_fast_md (&last->fast_md, &jobs->vid_copy[k].fast_md, &jobs->fast_md);
+  }
+  jobs->main_stats->bit_slice        = last->p_Stats->bit_slice;
+  jobs->main_stats->stored_bit_slice = last->p_Stats->stored_bit_slice;
+  *p_Vid = *last;
+  p_Vid->p_Stats     = jobs->main_stats;
+  p_Vid->b8x8info    = jobs->main_b8x8info;
+  p_Vid->motion_cost = jobs->main_motion_cost;
+
+  for (k = 0; k < num_slices; ++k)
+  {
+    mb_nr = jobs->slices[k]->start_mb_nr;
+    for (i = 0; i < jobs->coded_mbs[k]; ++i)
+    {
+      p_Vid->mb_data[mb_nr].p_Vid = p_Vid;
+      mb_nr = FmoGetNextMBNr (p_Vid, mb_nr);
+    }
+    NumberOfCodedMBs += jobs->coded_mbs[k];
+  }
+
+  //===== terminate the slices in slice order =====
+  for (k = 0; k < num_slices; ++k)
+  {
+    set_slice_video_par (jobs->slices[k], p_Vid);
+    add_slice_stats (&p_Vid->enc_picture->stats, &jobs->mb_stats[k]);
+    jobs->slices[k]->cur_stats = &p_Vid->enc_picture->stats;
+    close_one_slice (jobs->slices[k], jobs->last_mb[k], (k == num_slices - 1) && (NumberOfCodedMBs + TotalCodedMBs >= (int)p_Vid->PicSizeInMbs));
+
+    free (jobs->slices[k]->ext_events);
+    jobs->slices[k]->ext_events     = NULL;
+    jobs->slices[k]->max_ext_events = 0;
+  }
+
+  for (k = 0; k < num_slices; ++k)
+  {
+    if (jobs->motion_cost[k])
+      free_mem4Ddistblk (jobs->motion_cost[k]);
+  }
+  free (jobs->motion_cost);
+#if TRACE
+  free (jobs->trace);
+#endif
+  free (jobs->b8x8info);
+  free (jobs->vid_stats);
+  free (jobs->mb_stats);
+  free (jobs->vid_copy);
+  free (jobs->coded_mbs);
+  free (jobs->last_mb);
+  free (jobs->slices);
+
   return NumberOfCodedMBs;
 }
 
+/*!
+************************************************************************
+* \brief
+*    Encodes all remaining slices of a slice group in parallel
+*    (SliceThreads > 1, SliceMode = 1)
+*
+* \par
+*    The slice headers are written and the slices are terminated
+*    serially in slice order; only the macroblock loops run
+*    concurrently. Each slice works on its own copy of the
+*    VideoParameters with private scratch buffers and statistics,
+*    which are merged back afterwards. Neighbouring macroblocks of
+*    other slices are never used for prediction, so the bitstream is
+*    identical to the one of the serial encoder. The Extraction output
+*    (log, keys and perturbed mvds) is recorded per slice and written
+*    when the slice is terminated (see write_deferred_extraction()).
+*
+*    The caller finishes the last slice as after encode_one_slice().
+*
+* \par
+*   returns the number of coded MBs
+************************************************************************
+*/
+int encode_slices_parallel (VideoParameters *p_Vid, int SliceGroupId, int TotalCodedMBs)
+{
+  SliceJobs jobs;
+  SliceJobs *p_jobs = &jobs;
+
+  prepare_slices_parallel (p_Vid, SliceGroupId, TotalCodedMBs, &jobs);
+  encode_slice_jobs (&p_jobs, 1, p_Vid->p_Inp->SliceThreads);
+
+  return close_slices_parallel (p_Vid, &jobs, TotalCodedMBs);
+}
+
 
 /*!
 ************************************************************************
@@ -1261,6 +1702,7 @@ void set_slice (VideoParameters *p_Vid, Slice *currSlice)
   currSlice->ThisPOC           = p_Vid->ThisPOC;
   currSlice->qp                = p_Vid->p_curr_frm_struct->qp;
   currSlice->start_mb_nr       = p_Vid->current_mb_nr;
+  currSlice->cur_stats         = &p_Vid->enc_picture->stats;
   currSlice->colour_plane_id   = p_Vid->colour_plane_id;
 
   currSlice->si_frame_indicator =  currSlice->slice_type == SI_SLICE ? TRUE : FALSE;
@@ -1323,6 +1765,7 @@ void init_slice (VideoParameters *p_Vid, Slice **currSlice, int start_mb_addr)
   int active_ref_lists = (p_Vid->mb_aff_frame_flag) ? 6 : 2;
   DecodedPictureBuffer *p_Dpb = p_Vid->p_Dpb_layer[layer_id];
   int alloc_size = 0;
+  MemArena *heap;
 
 #if (MVC_EXTENSION_ENABLE)
   if(p_Inp->num_of_views == 2)
@@ -1350,7 +1793,10 @@ void init_slice (VideoParameters *p_Vid, Slice **currSlice, int start_mb_addr)
   if (currPic->no_slices >= MAXSLICEPERPICTURE)
     error ("Too many slices per picture, increase MAXSLICEPERPICTURE in global.h.", -1);
 
+  // slice scratch memory comes from the arena of the picture, see free_slice_list()
+  heap = set_mem_arena(currPic->arena);
   currPic->slices[currPic->no_slices - 1] = malloc_slice(p_Vid, p_Inp);  //Ϊsliceռ
+  set_mem_arena(heap);
   *currSlice = currPic->slices[currPic->no_slices-1];
 
   p_Vid->currentSlice = *currSlice;
@@ -1610,6 +2056,7 @@ void init_slice (VideoParameters *p_Vid, Slice **currSlice, int start_mb_addr)
 
   (*currSlice)->max_num_references = (short) p_Vid->max_num_references;
 
+  heap = set_mem_arena(currPic->arena);
   if (((*currSlice)->slice_type != I_SLICE) && (*currSlice)->slice_type != SI_SLICE)
   {
     alloc_size += get_mem5Dmv (&((*currSlice)->all_mv), 2, (*currSlice)->max_num_references, 9, 4, 4);
@@ -1630,6 +2077,7 @@ void init_slice (VideoParameters *p_Vid, Slice **currSlice, int start_mb_addr)
       }
     }
   }
+  set_mem_arena(heap);
 
   if (p_Vid->mb_aff_frame_flag)
     init_mbaff_lists(*currSlice);
@@ -1667,6 +2115,9 @@ void init_slice (VideoParameters *p_Vid, Slice **currSlice, int start_mb_addr)
       EPZSStructInit (*currSlice);
       EPZSSliceInit  (*currSlice);
     }
+
+    if (p_Inp->HMEEnable)
+      HMEStructInit (*currSlice);
   }
 
 
@@ -1693,9 +2144,10 @@ void init_slice (VideoParameters *p_Vid, Slice **currSlice, int start_mb_addr)
     }
   }
 
+  heap = set_mem_arena(currPic->arena);
   if (p_Inp->UseRDOQuant)
   {
-    if (((*currSlice)->estBitsCabac = (estBitsCabacStruct*) calloc(NUM_BLOCK_TYPES, sizeof(estBitsCabacStruct)))==NULL) 
+    if (((*currSlice)->estBitsCabac = (estBitsCabacStruct*) mem_calloc(NUM_BLOCK_TYPES, sizeof(estBitsCabacStruct)))==NULL) 
       no_mem_exit("init_slice: (*currSlice)->estBitsCabac"); 
 
     init_rdoq_slice(*currSlice);
@@ -1744,6 +2196,7 @@ void init_slice (VideoParameters *p_Vid, Slice **currSlice, int start_mb_addr)
   allocate_block_mem(*currSlice);
   init_coding_state_methods(*currSlice);
   init_rdopt(*currSlice);
+  set_mem_arena(heap);
 }
 
 /*!
@@ -1904,6 +2357,7 @@ void init_slice_lite (VideoParameters *p_Vid, Slice **currSlice, int start_mb_ad
     (*currSlice)->tmp_mv4      = NULL;
     (*currSlice)->motion_cost4 = NULL;
     (*currSlice)->p_EPZS       = NULL;
+    (*currSlice)->p_HME        = NULL;
 
     (*currSlice)->mb_pred   = NULL;
     (*currSlice)->mb_rres   = NULL;
@@ -1958,12 +2412,12 @@ static Slice *malloc_slice(VideoParameters *p_Vid, InputParameters *p_Inp)
   }
 
   // KS: this is approx. max. allowed code picture size
-  if ((currSlice = (Slice *) calloc(1, sizeof(Slice))) == NULL) no_mem_exit ("malloc_slice: currSlice structure");
+  if ((currSlice = (Slice *) mem_calloc(1, sizeof(Slice))) == NULL) no_mem_exit ("malloc_slice: currSlice structure");
 
   currSlice->p_Vid             = p_Vid;
   currSlice->p_Inp             = p_Inp;
 
-  if (((currSlice->p_RDO)  = (RDOPTStructure *) calloc(1, sizeof(RDOPTStructure)))==NULL) 
+  if (((currSlice->p_RDO)  = (RDOPTStructure *) mem_calloc(1, sizeof(RDOPTStructure)))==NULL) 
     no_mem_exit("malloc_slice: p_RDO");
 
   currSlice->symbol_mode  = (char) p_Inp->symbol_mode;
@@ -1991,14 +2445,14 @@ static Slice *malloc_slice(VideoParameters *p_Vid, InputParameters *p_Inp)
 
   currSlice->num_mb = 0;          // no coded MBs so far
 
-  if ((currSlice->partArr = (DataPartition *) calloc(currSlice->max_part_nr, sizeof(DataPartition))) == NULL) 
+  if ((currSlice->partArr = (DataPartition *) mem_calloc(currSlice->max_part_nr, sizeof(DataPartition))) == NULL) 
     no_mem_exit ("malloc_slice: partArr");
   for (i=0; i<currSlice->max_part_nr; i++) // loop over all data partitions
   {
     dataPart = &(currSlice->partArr[i]);
-    if ((dataPart->bitstream = (Bitstream *) calloc(1, sizeof(Bitstream))) == NULL) 
+    if ((dataPart->bitstream = (Bitstream *) mem_calloc(1, sizeof(Bitstream))) == NULL) 
       no_mem_exit ("malloc_slice: Bitstream");
-    if ((dataPart->bitstream->streamBuffer = (byte *) calloc(buffer_size, sizeof(byte))) == NULL) 
+    if ((dataPart->bitstream->streamBuffer = (byte *) mem_calloc(buffer_size, sizeof(byte))) == NULL) 
       no_mem_exit ("malloc_slice: StreamBuffer");
     dataPart->bitstream->buffer_size = buffer_size;
     // Initialize storage of bitstream parameters
@@ -2035,7 +2489,7 @@ static Slice *malloc_slice_lite(VideoParameters *p_Vid, InputParameters *p_Inp)
   Slice *currSlice;
   //int cr_size = (p_Inp->separate_colour_plane_flag != 0) ? 0 : 512;
 
-  if ((currSlice = (Slice *) calloc(1, sizeof(Slice))) == NULL) no_mem_exit ("malloc_slice: currSlice structure");
+  if ((currSlice = (Slice *) mem_calloc(1, sizeof(Slice))) == NULL) no_mem_exit ("malloc_slice: currSlice structure");
 
   currSlice->p_Vid = p_Vid;
   currSlice->p_Inp = p_Inp;
@@ -2156,10 +2610,10 @@ void free_slice(Slice *currSlice)
           {
             if (dataPart->bitstream->streamBuffer != NULL)
             {
-              free(dataPart->bitstream->streamBuffer);       
+              mem_free(dataPart->bitstream->streamBuffer);       
               dataPart->bitstream->streamBuffer = NULL;
             }
-            free(dataPart->bitstream);
+            mem_free(dataPart->bitstream);
             dataPart->bitstream = NULL;
           }
         }
@@ -2173,7 +2627,7 @@ void free_slice(Slice *currSlice)
     if(currSlice->p_RDO)
     {
       clear_rdopt (currSlice);
-      free (currSlice->p_RDO);
+      mem_free (currSlice->p_RDO);
     }
 
     if(currSlice->cofAC)
@@ -2197,7 +2651,7 @@ void free_slice(Slice *currSlice)
 
     if (currSlice->partArr != NULL)
     {
-      free(currSlice->partArr);
+      mem_free(currSlice->partArr);
       currSlice->partArr = NULL;
     }
 
@@ -2218,7 +2672,7 @@ void free_slice(Slice *currSlice)
 
     if (currSlice->UseRDOQuant)
     {
-      free(currSlice->estBitsCabac);
+      mem_free(currSlice->estBitsCabac);
 
       free_rddata(currSlice, &currSlice->rddata_trellis_curr);
       if(currSlice->RDOQ_QP_Num > 1)
@@ -2279,9 +2733,11 @@ void free_slice(Slice *currSlice)
         if(currSlice->p_EPZS)
           EPZSStructDelete (currSlice);    
       }
+      if (currSlice->p_HME)
+        HMEStructDelete (currSlice);
     }
 
-    free(currSlice);
+    mem_free(currSlice);
   }
 }
 
@@ -2300,6 +2756,8 @@ void free_slice_list(Picture *currPic)
 
   if (currPic !=  NULL)
   {
+    MemArena *heap = set_mem_arena(currPic->arena);
+
     free_nal_unit(currPic);
 
     for (i = 0; i < currPic->no_slices; i++)
@@ -2307,6 +2765,9 @@ void free_slice_list(Picture *currPic)
       free_slice (currPic->slices[i]);
       currPic->slices[i] = NULL;
     }
+
+    set_mem_arena(heap);
+    reset_mem_arena(currPic->arena);
   }
 }
 
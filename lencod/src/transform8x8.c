@@ -31,7 +31,9 @@
 #include "symbol.h"
 #include "mc_prediction.h"
 #include "md_distortion.h"
+#include "me_distortion.h"
 #include "quant8x8.h"
+#include "quant_kernels.h"
 #include "rdoq.h"
 #include "q_matrix.h"
 #include "q_offsets.h"
@@ -559,7 +561,7 @@ int residual_transform_quant_luma_8x8(Macroblock *currMB, ColorPlane pl, int b8,
     quant_methods.c_cost     = COEFF_COST8x8[currSlice->disthres];
 
     // Forward 8x8 transform
-    forward8x8(mb_ores, mb_rres, block_y, block_x);
+    tq_kernels.forward8x8(mb_ores, mb_rres, block_y, block_x);
 
     // Quantization process
     nonzero = currSlice->quant_8x8(currMB, &mb_rres[block_y], &quant_methods);
@@ -637,7 +639,7 @@ int residual_transform_quant_luma_8x8_cavlc(Macroblock *currMB, ColorPlane pl, i
     quant_methods.c_cost     = COEFF_COST8x8[currSlice->disthres];
 
     // Forward 8x8 transform
-    forward8x8(mb_ores, mb_rres, block_y, block_x);
+    tq_kernels.forward8x8(mb_ores, mb_rres, block_y, block_x);
 
     // Quantization process
     nonzero = currSlice->quant_8x8cavlc(currMB, &mb_rres[block_y], &quant_methods, currSlice->cofAC[pl_off]);
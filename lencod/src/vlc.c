@@ -17,10 +17,12 @@
 #include "contributors.h"
 
 #include <math.h>
+#include <stdarg.h>
 
 #include "global.h"
 #include "enc_statistics.h"
 #include "vlc.h"
+#include "thread_util.h"
 
 #if TRACE
 #define SYMTRACESTRING(s) strncpy(sym.tracestring,s,TRACESTRING_SIZE)
@@ -1422,6 +1424,118 @@ int writeSyntaxElement_Level_VLCN(SyntaxElement *se, int vlc, DataPartition *dp,
 #if TRACE
 int bitcounter = 0;
 
+//! trace output of the slice coded by this thread (NULL: the trace file), see trace_redirect()
+static THREAD_LOCAL TraceBuffer *trace_buffer = NULL;
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Makes room for len more characters in a trace buffer
+ ************************************************************************
+ */
+static void reserve_trace_text (TraceBuffer *buf, int len)
+{
+  if (buf->size + len + 1 > buf->max_size)
+  {
+    buf->max_size = imax(2 * buf->max_size, buf->size + len + 1 + 4096);
+    if ((buf->text = (char *) realloc(buf->text, buf->max_size)) == NULL)
+      no_mem_exit("reserve_trace_text: buf->text");
+  }
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Appends text to a trace buffer
+ ************************************************************************
+ */
+static void append_trace_text (TraceBuffer *buf, const char *text)
+{
+  int len = (int) strlen(text);
+
+  reserve_trace_text(buf, len);
+  memcpy(buf->text + buf->size, text, len + 1);
+  buf->size += len;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Writes the bit counter and the trace string of a symbol,
+ *    the trace string padded to column
+ ************************************************************************
+ */
+static void write_symbol_trace (FILE *p_trace, int counter, const char *tracestring, int column)
+{
+  int chars;
+
+  putc('@', p_trace);
+  chars = fprintf(p_trace, "%i", counter);
+  while(chars++ < 6)
+    putc(' ',p_trace);
+
+  chars += fprintf(p_trace, "%s", tracestring);
+  while(chars++ < column)
+    putc(' ',p_trace);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Formats the buffered trace line of a symbol of len bits:
+ *    "\001<len>\002<column>\002<tracestring>\003<tail>". The bit counter
+ *    is inserted by trace_flush_buffer().
+ ************************************************************************
+ */
+static void format_symbol_record (char *line, int size, const char *tracestring, int column, const char *tail, int len)
+{
+  snprintf(line, size, "\001%d\002%d\002%s\003%s", len, column, tracestring, tail);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Formats the bit pattern and the value of a CAVLC symbol
+ ************************************************************************
+ */
+static void format_vlc_tail (char *tail, int size, SyntaxElement *sym)
+{
+  int i, n = 0;
+
+  // align bit pattern
+  for(i = sym->len; i < 15; i++)
+    tail[n++] = ' ';
+
+  // print bit pattern
+  for(i = 1; i <= sym->len && n < size - 32; i++)
+    tail[n++] = ((sym->bitpattern >> (sym->len-i)) & 0x1) ? '1' : '0';
+  snprintf(tail + n, size - n, " (%3d) \n", sym->value1);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Writes the trace line of a symbol of len bits
+ ************************************************************************
+ */
+static void trace_symbol (const char *tracestring, int column, const char *tail, int len)
+{
+  if (trace_buffer != NULL)
+  {
+    char line[TRACESTRING_SIZE + 256];
+
+    format_symbol_record(line, sizeof(line), tracestring, column, tail, len);
+    append_trace_text(trace_buffer, line);
+    trace_buffer->bits += len;
+  }
+  else
+  {
+    write_symbol_trace(p_Enc->p_trace, bitcounter, tracestring, column);
+    fputs(tail, p_Enc->p_trace);
+    bitcounter += len;
+  }
+}
+
 /*!
  ************************************************************************
  * \brief
@@ -1430,59 +1544,160 @@ int bitcounter = 0;
  */
 void trace2out(SyntaxElement *sym)
 {
-  int i, chars;
+  char tail[128];
 
   if (p_Enc->p_trace != NULL)
   {
-    putc('@', p_Enc->p_trace);
-    chars = fprintf(p_Enc->p_trace, "%i", bitcounter);
-    while(chars++ < 6)
-      putc(' ',p_Enc->p_trace);
-
-    chars += fprintf(p_Enc->p_trace, "%s", sym->tracestring);
-    while(chars++ < 55)
-      putc(' ',p_Enc->p_trace);
+    format_vlc_tail(tail, sizeof(tail), sym);
+    trace_symbol(sym->tracestring, 55, tail, sym->len);
+    fflush (p_Enc->p_trace);
+  }
+}
 
-    // align bit pattern
-    if(sym->len<15)
-    {
-      for(i=0 ; i<15-sym->len ; i++)
-        fputc(' ', p_Enc->p_trace);
-    }
+void trace2out_cabac(SyntaxElement *sym)
+{
+  char tail[32];
 
-    // print bit pattern
+  if (p_Enc->p_trace != NULL)
+  {
+    snprintf(tail, sizeof(tail), " (%3d) \n", sym->value1);
+    trace_symbol(sym->tracestring, 70, tail, sym->len);
+    fflush (p_Enc->p_trace);
+  }
+  else if (trace_buffer != NULL)
+    trace_buffer->bits += sym->len;
+  else
     bitcounter += sym->len;
-    for(i=1 ; i<=sym->len ; i++)
-    {
-      if((sym->bitpattern >> (sym->len-i)) & 0x1)
-        fputc('1', p_Enc->p_trace);
-      else
-        fputc('0', p_Enc->p_trace);
-    }
-    fprintf(p_Enc->p_trace, " (%3d) \n",sym->value1);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Writes formatted text to the trace file (or the trace buffer of
+ *    the slice coded by this thread)
+ ************************************************************************
+ */
+void trace_printf(const char *format, ...)
+{
+  char line[1024];
+  va_list args;
+
+  if (p_Enc->p_trace == NULL)
+    return;
+
+  va_start(args, format);
+  vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+
+  if (trace_buffer != NULL)
+    append_trace_text(trace_buffer, line);
+  else
+    fputs(line, p_Enc->p_trace);
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Sends the trace output of the calling thread to buf
+ *    (NULL: to the trace file)
+ ************************************************************************
+ */
+void trace_redirect(TraceBuffer *buf)
+{
+  trace_buffer = buf;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Returns the position of the next trace line of the calling thread in
+ *    its trace buffer, -1 if it does not trace into a buffer
+ ************************************************************************
+ */
+int trace_position(void)
+{
+  return (trace_buffer != NULL && p_Enc->p_trace != NULL) ? trace_buffer->size : -1;
+}
+
+/*!
+ ************************************************************************
+ * \brief
+ *    Replaces the CAVLC symbol line at position pos of a trace buffer
+ *    (see trace_position()) by the line of sym, for symbols that are
+ *    changed after they have been written. Returns the position of the
+ *    following line.
+ ************************************************************************
+ */
+int trace_replace_symbol(TraceBuffer *buf, int pos, SyntaxElement *sym)
+{
+  char line[TRACESTRING_SIZE + 256];
+  char tail[128];
+  char *old = buf->text + pos;
+  int old_size = (int) (strchr(old, '\n') + 1 - old);
+  int new_size;
+
+  buf->bits -= (int) strtol(old + 1, NULL, 10);
+  buf->bits += sym->len;
+
+  format_vlc_tail(tail, sizeof(tail), sym);
+  format_symbol_record(line, sizeof(line), sym->tracestring, 55, tail, sym->len);
+  new_size = (int) strlen(line);
+
+  if (new_size > old_size)
+  {
+    reserve_trace_text(buf, new_size - old_size);
+    old = buf->text + pos;
   }
-  fflush (p_Enc->p_trace);
+  memmove(old + new_size, old + old_size, buf->size - pos - old_size + 1);
+  memcpy(old, line, new_size);
+  buf->size += new_size - old_size;
+
+  return pos + new_size;
 }
 
-void trace2out_cabac(SyntaxElement *sym)
+/*!
+ ************************************************************************
+ * \brief
+ *    Writes a trace buffer to the trace file, as if its output had been
+ *    written there directly, and releases it
+ ************************************************************************
+ */
+void trace_flush_buffer(TraceBuffer *buf)
 {
-  int chars;
+  char *text = buf->text;
+  int counter = bitcounter;
 
-  if (p_Enc->p_trace != NULL)
+  if (text != NULL && p_Enc->p_trace != NULL)
   {
-    putc('@', p_Enc->p_trace);
-    chars = fprintf(p_Enc->p_trace, "%i", bitcounter);
-    while(chars++ < 6)
-      putc(' ',p_Enc->p_trace);
+    while (*text)
+    {
+      char *end = strchr(text, '\001');
 
-    chars += fprintf(p_Enc->p_trace, "%s", sym->tracestring);
-    while(chars++ < 70)
-      putc(' ',p_Enc->p_trace);
+      if (end == NULL)
+      {
+        fputs(text, p_Enc->p_trace);
+        break;
+      }
+      fwrite(text, 1, end - text, p_Enc->p_trace);
 
-    fprintf(p_Enc->p_trace, " (%3d) \n",sym->value1);
+      // symbol line: "\001<len>\002<column>\002<tracestring>\003"
+      {
+        int len     = (int) strtol(end + 1, &text, 10);
+        int column  = (int) strtol(text + 1, &text, 10);
+        char *tracestring = text + 1;
+
+        text = strchr(tracestring, '\003');
+        *text++ = '\0';
+        write_symbol_trace(p_Enc->p_trace, counter, tracestring, column);
+        counter += len;
+      }
+    }
+    fflush (p_Enc->p_trace);
   }
-  fflush (p_Enc->p_trace);
-  bitcounter += sym->len;
+  bitcounter += buf->bits;
+
+  free(buf->text);
+  memset(buf, 0, sizeof(TraceBuffer));
 }
 #endif
 